@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+#
+# Builds overrun.wad, a check of the emulation of vanilla's intercepts
+# overrun: an E1M1 and a demo lump, OVERRUN, that plays on it.
+#
+#   python3 overrun.py overrun.wad
+#   doomgeneric -iwad doom.wad -file overrun.wad -playdemo overrun
+#
+# The IWAD must be a registered or Ultimate doom.wad, as the shareware
+# version refuses -file.  Only STARTAN3, FLOOR4_8 and CEIL3_5 are used.
+#
+# The map is a hall 128 units wide, cut into 8 unit wide sectors by 255
+# two-sided lines.  The player starts at x = 300 facing east and fires
+# along the hall, so the trace of the shot crosses more lines than the
+# intercepts array holds.  In vanilla the overrun that follows writes 1
+# into the blockmap width, after which no lines are found in most of
+# the map.  The player then backs west through the line at x = 200,
+# which blocks everything, and over the exit line at x = 104.
+#
+# With the overrun emulated, the level ends after 74 tics.  If the
+# player stops at the blocking line, or the game crashes, it is not.
+#
+
+import math
+import struct
+import sys
+
+CELLS = 256             # sectors along the hall
+CELLW = 8               # width of each
+HALLW = 128             # width of the hall
+BLOCKX = 200            # the two-sided line that blocks
+EXITX = 104             # the line that ends the level (W1 exit)
+
+ML_BLOCKING = 1
+ML_TWOSIDED = 4
+
+def vid(i, j):
+    return j * (CELLS + 1) + i
+
+verts = [(i * CELLW, j * HALLW) for j in range(2) for i in range(CELLS + 1)]
+lines = []
+sides = []
+segs = []
+ssectors = []
+crossing = {}           # two-sided line at each x, by cell edge
+
+for i in range(CELLS):
+    first = len(segs)
+
+    # west, north, east and south edges, clockwise
+    for a, b, nb in (((i, 0), (i, 1), i - 1), ((i, 1), (i + 1, 1), None),
+                     ((i + 1, 1), (i + 1, 0), i + 1), ((i + 1, 0), (i, 0), None)):
+        if nb is not None and 0 <= nb < CELLS:
+            x = max(a[0], b[0])
+            if x in crossing:
+                li = crossing[x]
+                side = 1
+                lines[li][6] = len(sides)
+            else:
+                li = len(lines)
+                side = 0
+                flags = ML_TWOSIDED | (ML_BLOCKING if x * CELLW == BLOCKX else 0)
+                special = 52 if x * CELLW == EXITX else 0
+                lines.append([vid(*a), vid(*b), flags, special, 0, len(sides), -1])
+                crossing[x] = li
+            sides.append((b'-', i))
+        else:
+            li = len(lines)
+            side = 0
+            lines.append([vid(*a), vid(*b), ML_BLOCKING, 0, 0, len(sides), -1])
+            sides.append((b'STARTAN3', i))
+
+        (x1, y1), (x2, y2) = verts[vid(*a)], verts[vid(*b)]
+        angle = int(round(math.atan2(y2 - y1, x2 - x1) / (2 * math.pi) * 65536)) & 0xffff
+        segs.append(struct.pack('<hhHhhh', vid(*a), vid(*b), angle, li, side, 0))
+
+    ssectors.append(struct.pack('<hh', 4, first))
+
+nodes = []
+
+def build(i0, i1):
+    if i1 - i0 == 1:
+        return 0x8000 | i0
+    im = (i0 + i1) // 2
+    right = build(im, i1)
+    left = build(i0, im)
+    nodes.append(struct.pack('<4h', im * CELLW, 0, 0, HALLW)
+                 + struct.pack('<4h', HALLW, 0, im * CELLW, i1 * CELLW)
+                 + struct.pack('<4h', HALLW, 0, i0 * CELLW, im * CELLW)
+                 + struct.pack('<HH', right, left))
+    return len(nodes) - 1
+
+build(0, CELLS)
+
+sectors = b''.join(struct.pack('<hh8s8shhh', 0, HALLW, b'FLOOR4_8', b'CEIL3_5', 160, 0, 0)
+                   for _ in range(CELLS))
+things = struct.pack('<hhhhh', 300, HALLW // 2, 0, 1, 7)
+
+# 128 unit blocks with a margin, each list starting with line 0 as in
+# the id tools.
+
+ox, oy = -8, -8
+bw = (CELLS * CELLW + 16) // 128 + 1
+bh = (HALLW + 16) // 128 + 1
+offsets = []
+blocklists = []
+pos = 4 + bw * bh
+for by in range(bh):
+    for bx in range(bw):
+        x1, y1 = ox + bx * 128, oy + by * 128
+        block = [0]
+        for n, l in enumerate(lines):
+            (ax, ay), (bx_, by_) = verts[l[0]], verts[l[1]]
+            if max(ax, bx_) >= x1 and min(ax, bx_) <= x1 + 128 \
+               and max(ay, by_) >= y1 and min(ay, by_) <= y1 + 128:
+                block.append(n)
+        block.append(-1)
+        offsets.append(pos)
+        blocklists += block
+        pos += len(block)
+blockmap = struct.pack('<4h', ox, oy, bw, bh) \
+    + struct.pack('<%dh' % len(offsets), *offsets) \
+    + struct.pack('<%dh' % len(blocklists), *blocklists)
+
+# Version 1.9, -skill 3, E1M1, single player, then one ticcmd of
+# forwardmove, sidemove, angleturn and buttons per tic.
+
+demo = bytes([109, 2, 1, 1, 0, 0, 0, 0, 0, 1, 0, 0, 0])
+demo += bytes([0, 0, 0, 0]) * 11                # settle
+demo += bytes([0, 0, 0, 1]) * 20                # fire east
+demo += bytes([0, 0, 0, 0]) * 10
+demo += bytes([256 - 25, 0, 0, 0]) * 33         # back up west
+demo += bytes([0x80])
+
+lumps = [
+    ('E1M1', b''),
+    ('THINGS', things),
+    ('LINEDEFS', b''.join(struct.pack('<7h', *l) for l in lines)),
+    ('SIDEDEFS', b''.join(struct.pack('<hh8s8s8sh', 0, 0, b'-', b'-', m, s) for m, s in sides)),
+    ('VERTEXES', b''.join(struct.pack('<hh', *v) for v in verts)),
+    ('SEGS', b''.join(segs)),
+    ('SSECTORS', b''.join(ssectors)),
+    ('NODES', b''.join(nodes)),
+    ('SECTORS', sectors),
+    ('REJECT', bytes((CELLS * CELLS + 7) // 8)),
+    ('BLOCKMAP', blockmap),
+    ('OVERRUN', demo),
+]
+
+data = b''
+directory = b''
+pos = 12
+for name, lump in lumps:
+    directory += struct.pack('<ii8s', pos, len(lump), name.encode())
+    data += lump
+    pos += len(lump)
+
+with open(sys.argv[1] if len(sys.argv) > 1 else 'overrun.wad', 'wb') as f:
+    f.write(b'PWAD' + struct.pack('<ii', len(lumps), pos) + data + directory)
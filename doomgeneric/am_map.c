@@ -87,10 +87,10 @@
 #define AM_NUMMARKPOINTS 10
 
 // scale on entry
-#define INITSCALEMTOF (.2*FRACUNIT)
+#define INITSCALEMTOF (.2*FRACUNIT*SCREENSCALE)
 // how much the automap moves window per tic in frame-buffer coordinates
 // moves 140 pixels in 1 second
-#define F_PANINC	4
+#define F_PANINC	(4*SCREENSCALE)
 // how much zoom-in per tic
 // goes to 2x in 1 second
 #define M_ZOOMIN        ((int) (1.02*FRACUNIT))
@@ -141,7 +141,7 @@ typedef struct
 //   starting from the middle.
 //
 #define R ((8*PLAYERRADIUS)/7)
-mline_t player_arrow[] = {
+THREADLOCAL mline_t player_arrow[] = {
     { { -R+R/8, 0 }, { R, 0 } }, // -----
     { { R, 0 }, { R-R/2, R/4 } },  // ----->
     { { R, 0 }, { R-R/2, -R/4 } },
@@ -153,7 +153,7 @@ mline_t player_arrow[] = {
 #undef R
 
 #define R ((8*PLAYERRADIUS)/7)
-mline_t cheat_player_arrow[] = {
+THREADLOCAL mline_t cheat_player_arrow[] = {
     { { -R+R/8, 0 }, { R, 0 } }, // -----
     { { R, 0 }, { R-R/2, R/6 } },  // ----->
     { { R, 0 }, { R-R/2, -R/6 } },
@@ -174,7 +174,7 @@ mline_t cheat_player_arrow[] = {
 #undef R
 
 #define R (FRACUNIT)
-mline_t triangle_guy[] = {
+THREADLOCAL mline_t triangle_guy[] = {
     { { (fixed_t)(-.867*R), (fixed_t)(-.5*R) }, { (fixed_t)(.867*R ), (fixed_t)(-.5*R) } },
     { { (fixed_t)(.867*R ), (fixed_t)(-.5*R) }, { (fixed_t)(0      ), (fixed_t)(R    ) } },
     { { (fixed_t)(0      ), (fixed_t)(R    ) }, { (fixed_t)(-.867*R), (fixed_t)(-.5*R) } }
@@ -182,7 +182,7 @@ mline_t triangle_guy[] = {
 #undef R
 
 #define R (FRACUNIT)
-mline_t thintriangle_guy[] = {
+THREADLOCAL mline_t thintriangle_guy[] = {
     { { (fixed_t)(-.5*R), (fixed_t)(-.7*R) }, { (fixed_t)(R    ), (fixed_t)(0    ) } },
     { { (fixed_t)(R    ), (fixed_t)(0    ) }, { (fixed_t)(-.5*R), (fixed_t)(.7*R ) } },
     { { (fixed_t)(-.5*R), (fixed_t)(.7*R ) }, { (fixed_t)(-.5*R), (fixed_t)(-.7*R) } }
@@ -192,80 +192,80 @@ mline_t thintriangle_guy[] = {
 
 
 
-static int 	cheating = 0;
-static int 	grid = 0;
+static THREADLOCAL int 	cheating = 0;
+static THREADLOCAL int 	grid = 0;
 
-static int 	leveljuststarted = 1; 	// kluge until AM_LevelInit() is called
+static THREADLOCAL int 	leveljuststarted = 1; 	// kluge until AM_LevelInit() is called
 
-boolean    	automapactive = false;
-static int 	finit_width = SCREENWIDTH;
-static int 	finit_height = SCREENHEIGHT - 32;
+THREADLOCAL boolean    	automapactive = false;
+static THREADLOCAL int 	finit_width = SCREENWIDTH;
+static THREADLOCAL int 	finit_height = SCREENHEIGHT - 32*SCREENSCALE;
 
 // location of window on screen
-static int 	f_x;
-static int	f_y;
+static THREADLOCAL int 	f_x;
+static THREADLOCAL int	f_y;
 
 // size of window on screen
-static int 	f_w;
-static int	f_h;
+static THREADLOCAL int 	f_w;
+static THREADLOCAL int	f_h;
 
-static int 	lightlev; 		// used for funky strobing effect
-static byte*	fb; 			// pseudo-frame buffer
-static int 	amclock;
+static THREADLOCAL int 	lightlev; 		// used for funky strobing effect
+static THREADLOCAL byte*	fb; 			// pseudo-frame buffer
+static THREADLOCAL int 	amclock;
 
-static mpoint_t m_paninc; // how far the window pans each tic (map coords)
-static fixed_t 	mtof_zoommul; // how far the window zooms in each tic (map coords)
-static fixed_t 	ftom_zoommul; // how far the window zooms in each tic (fb coords)
+static THREADLOCAL mpoint_t m_paninc; // how far the window pans each tic (map coords)
+static THREADLOCAL fixed_t 	mtof_zoommul; // how far the window zooms in each tic (map coords)
+static THREADLOCAL fixed_t 	ftom_zoommul; // how far the window zooms in each tic (fb coords)
 
-static fixed_t 	m_x, m_y;   // LL x,y where the window is on the map (map coords)
-static fixed_t 	m_x2, m_y2; // UR x,y where the window is on the map (map coords)
+static THREADLOCAL fixed_t 	m_x, m_y;   // LL x,y where the window is on the map (map coords)
+static THREADLOCAL fixed_t 	m_x2, m_y2; // UR x,y where the window is on the map (map coords)
 
 //
 // width/height of window on map (map coords)
 //
-static fixed_t 	m_w;
-static fixed_t	m_h;
+static THREADLOCAL fixed_t 	m_w;
+static THREADLOCAL fixed_t	m_h;
 
 // based on level size
-static fixed_t 	min_x;
-static fixed_t	min_y; 
-static fixed_t 	max_x;
-static fixed_t  max_y;
+static THREADLOCAL fixed_t 	min_x;
+static THREADLOCAL fixed_t	min_y; 
+static THREADLOCAL fixed_t 	max_x;
+static THREADLOCAL fixed_t  max_y;
 
-static fixed_t 	max_w; // max_x-min_x,
-static fixed_t  max_h; // max_y-min_y
+static THREADLOCAL fixed_t 	max_w; // max_x-min_x,
+static THREADLOCAL fixed_t  max_h; // max_y-min_y
 
 // based on player size
-static fixed_t 	min_w;
-static fixed_t  min_h;
+static THREADLOCAL fixed_t 	min_w;
+static THREADLOCAL fixed_t  min_h;
 
 
-static fixed_t 	min_scale_mtof; // used to tell when to stop zooming out
-static fixed_t 	max_scale_mtof; // used to tell when to stop zooming in
+static THREADLOCAL fixed_t 	min_scale_mtof; // used to tell when to stop zooming out
+static THREADLOCAL fixed_t 	max_scale_mtof; // used to tell when to stop zooming in
 
 // old stuff for recovery later
-static fixed_t old_m_w, old_m_h;
-static fixed_t old_m_x, old_m_y;
+static THREADLOCAL fixed_t old_m_w, old_m_h;
+static THREADLOCAL fixed_t old_m_x, old_m_y;
 
 // old location used by the Follower routine
-static mpoint_t f_oldloc;
+static THREADLOCAL mpoint_t f_oldloc;
 
 // used by MTOF to scale from map-to-frame-buffer coords
-static fixed_t scale_mtof = (fixed_t)INITSCALEMTOF;
+static THREADLOCAL fixed_t scale_mtof = (fixed_t)INITSCALEMTOF;
 // used by FTOM to scale from frame-buffer-to-map coords (=1/scale_mtof)
-static fixed_t scale_ftom;
+static THREADLOCAL fixed_t scale_ftom;
 
-static player_t *plr; // the player represented by an arrow
+static THREADLOCAL player_t *plr; // the player represented by an arrow
 
-static patch_t *marknums[10]; // numbers used for marking by the automap
-static mpoint_t markpoints[AM_NUMMARKPOINTS]; // where the points are
-static int markpointnum = 0; // next point to be assigned
+static THREADLOCAL patch_t *marknums[10]; // numbers used for marking by the automap
+static THREADLOCAL mpoint_t markpoints[AM_NUMMARKPOINTS]; // where the points are
+static THREADLOCAL int markpointnum = 0; // next point to be assigned
 
-static int followplayer = 1; // specifies whether to follow the player around
+static THREADLOCAL int followplayer = 1; // specifies whether to follow the player around
 
-cheatseq_t cheat_amap = CHEAT("iddt", 0);
+THREADLOCAL cheatseq_t cheat_amap = CHEAT("iddt", 0);
 
-static boolean stopped = true;
+static THREADLOCAL boolean stopped = true;
 
 // Calculates the slope and slope according to the x-axis of a line
 // segment in map coordinates (with the upright y-axis n' all) so
@@ -424,7 +424,7 @@ void AM_changeWindowLoc(void)
 void AM_initVariables(void)
 {
     int pnum;
-    static event_t st_notify = { ev_keyup, AM_MSGENTERED, 0, 0 };
+    static THREADLOCAL event_t st_notify = { ev_keyup, AM_MSGENTERED, 0, 0 };
 
     automapactive = true;
     fb = I_VideoBuffer;
@@ -540,7 +540,7 @@ void AM_LevelInit(void)
 //
 void AM_Stop (void)
 {
-    static event_t st_notify = { 0, ev_keyup, AM_MSGEXITED, 0 };
+    static THREADLOCAL event_t st_notify = { 0, ev_keyup, AM_MSGEXITED, 0 };
 
     AM_unloadPics();
     automapactive = false;
@@ -553,7 +553,7 @@ void AM_Stop (void)
 //
 void AM_Start (void)
 {
-    static int lastlevel = -1, lastepisode = -1;
+    static THREADLOCAL int lastlevel = -1, lastepisode = -1;
 
     if (!stopped) AM_Stop();
     stopped = false;
@@ -597,8 +597,8 @@ AM_Responder
 {
 
     int rc;
-    static int bigstate=0;
-    static char buffer[20];
+    static THREADLOCAL int bigstate=0;
+    static THREADLOCAL char buffer[20];
     int key;
 
     rc = false;
@@ -784,10 +784,10 @@ void AM_doFollowPlayer(void)
 //
 void AM_updateLightLev(void)
 {
-    static int nexttic = 0;
+    static THREADLOCAL int nexttic = 0;
     //static int litelevels[] = { 0, 3, 5, 6, 6, 7, 7, 7 };
-    static int litelevels[] = { 0, 4, 7, 10, 12, 14, 15, 15 };
-    static int litelevelscnt = 0;
+    static THREADLOCAL int litelevels[] = { 0, 4, 7, 10, 12, 14, 15, 15 };
+    static THREADLOCAL int litelevelscnt = 0;
    
     // Change light level
     if (amclock>nexttic)
@@ -995,7 +995,7 @@ AM_drawFline
     register int ay;
     register int d;
     
-    static int fuck = 0;
+    static THREADLOCAL int fuck = 0;
 
     // For debugging only
     if (      fl->a.x < 0 || fl->a.x >= f_w
@@ -1063,7 +1063,7 @@ AM_drawMline
 ( mline_t*	ml,
   int		color )
 {
-    static fline_t fl;
+    static THREADLOCAL fline_t fl;
 
     if (AM_clipMline(ml, &fl))
 	AM_drawFline(&fl, color); // draws it on frame buffer using fb coords
@@ -1123,7 +1123,7 @@ void AM_drawGrid(int color)
 void AM_drawWalls(void)
 {
     int i;
-    static mline_t l;
+    static THREADLOCAL mline_t l;
 
     for (i=0;i<numlines;i++)
     {
@@ -1247,7 +1247,7 @@ void AM_drawPlayers(void)
 {
     int		i;
     player_t*	p;
-    static int 	their_colors[] = { GREENS, GRAYS, BROWNS, REDS };
+    static THREADLOCAL int 	their_colors[] = { GREENS, GRAYS, BROWNS, REDS };
     int		their_color = -1;
     int		color;
 
@@ -1318,12 +1318,12 @@ void AM_drawMarks(void)
 	{
 	    //      w = SHORT(marknums[i]->width);
 	    //      h = SHORT(marknums[i]->height);
-	    w = 5; // because something's wrong with the wad, i guess
-	    h = 6; // because something's wrong with the wad, i guess
+	    w = 5*SCREENSCALE; // because something's wrong with the wad, i guess
+	    h = 6*SCREENSCALE; // because something's wrong with the wad, i guess
 	    fx = CXMTOF(markpoints[i].x);
 	    fy = CYMTOF(markpoints[i].y);
 	    if (fx >= f_x && fx <= f_w - w && fy >= f_y && fy <= f_h - h)
-		V_DrawPatch(fx, fy, marknums[i]);
+		V_DrawPatch(fx/SCREENSCALE, fy/SCREENSCALE, marknums[i]);
 	}
     }
 
@@ -19,14 +19,21 @@
 // Events can be discarded if no responder claims them
 //
 
+#include <stdio.h>
 #include <stdlib.h>
 #include "d_event.h"
 
-#define MAXEVENTS 64
+// The queue belongs to the thread that runs the game, as does the rest
+// of an instance's state.  Input read on another thread is handed over
+// in a dg_keyqueue_t and posted from DG_GetKey.  The indexes only ever
+// grow.
 
-static event_t events[MAXEVENTS];
-static int eventhead;
-static int eventtail;
+#define MAXEVENTS 256
+
+static THREADLOCAL event_t events[MAXEVENTS];
+static THREADLOCAL unsigned int eventhead;
+static THREADLOCAL unsigned int eventtail;
+static THREADLOCAL unsigned int eventsdropped;
 
 //
 // D_PostEvent
@@ -34,8 +41,21 @@ static int eventtail;
 //
 void D_PostEvent (event_t* ev)
 {
-    events[eventhead] = *ev;
-    eventhead = (eventhead + 1) % MAXEVENTS;
+    // If the queue is full, drop the new event rather than the ones
+    // that are waiting.
+
+    if (eventhead - eventtail >= MAXEVENTS)
+    {
+        if (eventsdropped++ == 0)
+        {
+            printf("D_PostEvent: event queue full, dropping events\n");
+        }
+
+        return;
+    }
+
+    events[eventhead % MAXEVENTS] = *ev;
+    eventhead++;
 }
 
 // Read an event from the queue.
@@ -51,13 +71,19 @@ event_t *D_PopEvent(void)
         return NULL;
     }
     
-    result = &events[eventtail];
+    result = &events[eventtail % MAXEVENTS];
 
     // Advance to the next event in the queue.
 
-    eventtail = (eventtail + 1) % MAXEVENTS;
+    eventtail++;
 
     return result;
 }
 
+// Number of events dropped because the queue was full.
+
+unsigned int D_DroppedEvents(void)
+{
+    return eventsdropped;
+}
 
@@ -125,13 +125,18 @@ typedef enum
 
 
 
-// Called by IO functions when input is detected.
+// Called by IO functions when input is detected, on the thread
+// that runs the game.
 void D_PostEvent (event_t *ev);
 
 // Read an event from the event queue
 
 event_t *D_PopEvent(void);
 
+// Events lost because the queue was full.
+
+unsigned int D_DroppedEvents(void);
+
 
 #endif
 
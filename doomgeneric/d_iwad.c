@@ -57,9 +57,9 @@ static const iwad_t iwads[] =
 
 #define MAX_IWAD_DIRS 128
 
-static boolean iwad_dirs_built = false;
-static char *iwad_dirs[MAX_IWAD_DIRS];
-static int num_iwad_dirs = 0;
+static THREADLOCAL boolean iwad_dirs_built = false;
+static THREADLOCAL char *iwad_dirs[MAX_IWAD_DIRS];
+static THREADLOCAL int num_iwad_dirs = 0;
 
 static void AddIWADDir(char *dir)
 {
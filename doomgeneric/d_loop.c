@@ -31,6 +31,7 @@
 
 #include "m_argv.h"
 #include "m_fixed.h"
+#include "m_trace.h"
 
 #include "net_client.h"
 #include "net_gui.h"
@@ -57,61 +58,66 @@ typedef struct
 // from all players.
 //
 
-static ticcmd_set_t ticdata[BACKUPTICS];
+static THREADLOCAL ticcmd_set_t ticdata[BACKUPTICS];
 
 // The index of the next tic to be made (with a call to BuildTiccmd).
 
-static int maketic;
+static THREADLOCAL int maketic;
 
 // The number of complete tics received from the server so far.
 
-static int recvtic;
+static THREADLOCAL int recvtic;
 
 // The number of tics that have been run (using RunTic) so far.
 
-int gametic;
+THREADLOCAL int gametic;
 
 // When set to true, a single tic is run each time TryRunTics() is called.
 // This is used for -timedemo mode.
 
-boolean singletics = false;
+THREADLOCAL boolean singletics = false;
+
+// When set to true, TryRunTics() returns rather than wait for the next
+// tic, so that frames can be drawn in between tics (-uncapped).
+
+THREADLOCAL boolean uncapped = false;
 
 // Index of the local player.
 
-static int localplayer;
+static THREADLOCAL int localplayer;
 
 // Used for original sync code.
 
-static int      skiptics = 0;
+static THREADLOCAL int      skiptics = 0;
 
 // Reduce the bandwidth needed by sampling game input less and transmitting
 // less.  If ticdup is 2, sample half normal, 3 = one third normal, etc.
 
-int		ticdup;
+THREADLOCAL int		ticdup;
 
 // Amount to offset the timer for game sync.
 
-fixed_t         offsetms;
+THREADLOCAL fixed_t         offsetms;
 
 // Use new client syncronisation code
 
-static boolean  new_sync = true;
+static THREADLOCAL boolean  new_sync = true;
 
 // Callback functions for loop code.
 
-static loop_interface_t *loop_interface = NULL;
+static THREADLOCAL loop_interface_t *loop_interface = NULL;
 
 // Current players in the multiplayer game.
 // This is distinct from playeringame[] used by the game code, which may
 // modify playeringame[] when playing back multiplayer demos.
 
-static boolean local_playeringame[NET_MAXPLAYERS];
+static THREADLOCAL boolean local_playeringame[NET_MAXPLAYERS];
 
 // Requested player class "sent" to the server on connect.
 // If we are only doing a single player game then this needs to be remembered
 // and saved in the game settings.
 
-static int player_class;
+static THREADLOCAL int player_class;
 
 
 // 35 fps clock adjusted by offsetms milliseconds
@@ -198,7 +204,7 @@ static boolean BuildNewTic(void)
 // Builds ticcmds for console player,
 // sends out a packet
 //
-int      lasttime;
+THREADLOCAL int      lasttime;
 
 void NetUpdate (void)
 {
@@ -584,9 +590,9 @@ static int GetLowTic(void)
     return lowtic;
 }
 
-static int frameon;
-static int frameskip[4];
-static int oldnettics;
+static THREADLOCAL int frameon;
+static THREADLOCAL int frameskip[4];
+static THREADLOCAL int oldnettics;
 
 static void OldNetSync(void)
 {
@@ -700,15 +706,15 @@ static void SinglePlayerClear(ticcmd_set_t *set)
 }
 
 //
-// TryRunTics
+// RunTics
 //
 
-void TryRunTics (void)
+static void RunTics (void)
 {
     int	i;
     int	lowtic;
     int	entertic;
-    static int oldentertics;
+    static THREADLOCAL int oldentertics;
     int realtics;
     int	availabletics;
     int	counts;
@@ -776,7 +782,7 @@ void TryRunTics (void)
         // Don't stay in this loop forever.  The menu is still running,
         // so return to update the screen
 
-	if (I_GetTime() / ticdup - entertic > 0)
+	if (I_GetTime() / ticdup - entertic > 0 || uncapped)
 	{
 	    return;
 	}
@@ -820,6 +826,73 @@ void TryRunTics (void)
     }
 }
 
+//
+// TryRunTics
+//
+
+void TryRunTics (void)
+{
+    uint64_t trace;
+
+    trace = M_TraceBegin();
+    RunTics();
+    M_TraceEnd(tz_tryruntics, trace);
+}
+
+//
+// D_RunTics
+// Run ntics tics with the given commands for the local player, as fast
+// as possible.  Nothing is read from the timer or the input devices and
+// nothing is drawn.  A NULL cmds runs the tics with no input.
+//
+
+void D_RunTics(ticcmd_t *cmds, int ntics)
+{
+    ticcmd_set_t *set;
+    int i, j;
+
+    if (net_client_connected)
+    {
+        I_Error("D_RunTics: cannot step a network game");
+    }
+
+    // From now on tics are only run on request, as with -timedemo, so
+    // NetUpdate no longer builds commands from real time.  Any commands
+    // it buffered up before are dropped.
+
+    singletics = true;
+    maketic = gametic / ticdup;
+
+    for (i = 0; i < ntics; ++i)
+    {
+        set = &ticdata[maketic % BACKUPTICS];
+
+        if (cmds != NULL)
+        {
+            set->cmds[localplayer] = cmds[i];
+        }
+        else
+        {
+            memset(&set->cmds[localplayer], 0, sizeof(ticcmd_t));
+        }
+
+        set->ingame[localplayer] = true;
+        SinglePlayerClear(set);
+
+        ++maketic;
+
+        for (j = 0; j < ticdup; ++j)
+        {
+            memcpy(local_playeringame, set->ingame, sizeof(local_playeringame));
+
+            loop_interface->RunTic(set->cmds, set->ingame);
+            gametic++;
+
+            TicdupSquash(set);
+        }
+    }
+}
+
 void D_RegisterLoopCallbacks(loop_interface_t *i)
 {
     loop_interface = i;
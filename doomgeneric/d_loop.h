@@ -61,6 +61,9 @@ void D_QuitNetGame (void);
 //? how many ticks to run?
 void TryRunTics (void);
 
+// Run tics with the given commands, without timing or input.
+void D_RunTics(ticcmd_t *cmds, int ntics);
+
 // Called at start of game loop to initialize timers
 void D_StartGameLoop(void);
 
@@ -74,8 +77,9 @@ boolean D_InitNetGame(net_connect_data_t *connect_data);
 void D_StartNetGame(net_gamesettings_t *settings,
                     netgame_startup_callback_t callback);
 
-extern boolean singletics;
-extern int gametic, ticdup;
+extern THREADLOCAL boolean singletics;
+extern THREADLOCAL boolean uncapped;
+extern THREADLOCAL int gametic, ticdup;
 
 #endif
 
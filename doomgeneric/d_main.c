@@ -50,10 +50,12 @@
 #include "m_controls.h"
 #include "m_misc.h"
 #include "m_menu.h"
+#include "m_trace.h"
 #include "p_saveg.h"
 
 #include "i_endoom.h"
 #include "i_joystick.h"
+#include "i_sound.h"
 #include "i_system.h"
 #include "i_timer.h"
 #include "i_video.h"
@@ -69,11 +71,14 @@
 #include "net_query.h"
 
 #include "p_setup.h"
+#include "p_snap.h"
 #include "r_local.h"
 #include "statdump.h"
 
 #include "d_main.h"
 
+#include "doomgeneric.h"
+
 //
 // D-DoomLoop()
 // Not a globally visible function,
@@ -87,45 +92,48 @@ void D_DoomLoop (void);
 
 // Location where savegames are stored
 
-char *          savegamedir;
+THREADLOCAL char *          savegamedir;
 
 // location of IWAD and WAD files
 
-char *          iwadfile;
+THREADLOCAL char *          iwadfile;
 
 
-boolean		devparm;	// started game with -devparm
-boolean         nomonsters;	// checkparm of -nomonsters
-boolean         respawnparm;	// checkparm of -respawn
-boolean         fastparm;	// checkparm of -fast
+THREADLOCAL boolean		devparm;	// started game with -devparm
+THREADLOCAL boolean         nomonsters;	// checkparm of -nomonsters
+THREADLOCAL boolean         respawnparm;	// checkparm of -respawn
+THREADLOCAL boolean         fastparm;	// checkparm of -fast
 
 //extern int soundVolume;
 //extern  int	sfxVolume;
 //extern  int	musicVolume;
 
-extern  boolean	inhelpscreens;
+extern THREADLOCAL boolean	inhelpscreens;
 
-skill_t		startskill;
-int             startepisode;
-int		startmap;
-boolean		autostart;
-int             startloadgame;
+THREADLOCAL skill_t		startskill;
+THREADLOCAL int             startepisode;
+THREADLOCAL int		startmap;
+THREADLOCAL boolean		autostart;
+THREADLOCAL int             startloadgame;
 
-boolean		advancedemo;
+THREADLOCAL boolean		advancedemo;
 
 // Store demo, do not accept any inputs
-boolean         storedemo;
+THREADLOCAL boolean         storedemo;
 
 // "BFG Edition" version of doom2.wad does not include TITLEPIC.
-boolean         bfgedition;
+THREADLOCAL boolean         bfgedition;
 
 // If true, the main game loop has started.
-boolean         main_loop_started = false;
+THREADLOCAL boolean         main_loop_started = false;
+
+THREADLOCAL char		wadfile[1024];		// primary wad file
+THREADLOCAL char		mapdir[1024];           // directory of development maps
 
-char		wadfile[1024];		// primary wad file
-char		mapdir[1024];           // directory of development maps
+THREADLOCAL int             show_endoom = 1;
 
-int             show_endoom = 1;
+// -maxfps, or 0 for no limit.
+static THREADLOCAL int		maxfps;
 
 
 void D_ConnectNetGame(void);
@@ -161,19 +169,19 @@ void D_ProcessEvents (void)
 //
 
 // wipegamestate can be set to -1 to force a wipe on the next draw
-gamestate_t     wipegamestate = GS_DEMOSCREEN;
-extern  boolean setsizeneeded;
-extern  int             showMessages;
+THREADLOCAL gamestate_t     wipegamestate = GS_DEMOSCREEN;
+extern THREADLOCAL boolean setsizeneeded;
+extern THREADLOCAL int             showMessages;
 void R_ExecuteSetViewSize (void);
 
 void D_Display (void)
 {
-    static  boolean		viewactivestate = false;
-    static  boolean		menuactivestate = false;
-    static  boolean		inhelpscreensstate = false;
-    static  boolean		fullscreen = false;
-    static  gamestate_t		oldgamestate = -1;
-    static  int			borderdrawcount;
+    static THREADLOCAL boolean		viewactivestate = false;
+    static THREADLOCAL boolean		menuactivestate = false;
+    static THREADLOCAL boolean		inhelpscreensstate = false;
+    static THREADLOCAL boolean		fullscreen = false;
+    static THREADLOCAL gamestate_t		oldgamestate = -1;
+    static THREADLOCAL int			borderdrawcount;
     int				nowtime;
     int				tics;
     int				wipestart;
@@ -287,8 +295,9 @@ void D_Display (void)
 		if (automapactive)
 			y = 4;
 		else
-			y = viewwindowy+4;
-		V_DrawPatchDirect(viewwindowx + (scaledviewwidth - 68) / 2, y,
+			y = viewwindowy/SCREENSCALE+4;
+		V_DrawPatchDirect((viewwindowx + (scaledviewwidth - 68*SCREENSCALE) / 2)
+		                  / SCREENSCALE, y,
 							  W_CacheLumpName (DEH_String("M_PAUSE"), PU_CACHE));
     }
 
@@ -402,14 +411,78 @@ boolean D_GrabMouseCallback(void)
     return (gamestate == GS_LEVEL) && !demoplayback && !advancedemo;
 }
 
+// With -uncapped, how far into the next tic the frame is drawn, from
+// when the last tics were run.
+
+static void D_UpdateFractionalTic (boolean ranTics)
+{
+    static THREADLOCAL int lasttictime;
+    int64_t elapsed;
+    int now;
+
+    now = I_GetTimeMS();
+
+    if (ranTics)
+    {
+        lasttictime = now;
+    }
+
+    elapsed = now - lasttictime;
+    fractionaltic = (fixed_t) ((elapsed * TICRATE << FRACBITS) / 1000);
+
+    if (fractionaltic > FRACUNIT)
+    {
+        fractionaltic = FRACUNIT;
+    }
+}
+
+// Wait until it is time for the next frame under -maxfps.
+
+static void D_LimitFrameRate (void)
+{
+    static THREADLOCAL int lastframetime;
+    int frametime;
+    int now;
+
+    frametime = 1000 / maxfps;
+    now = I_GetTimeMS();
+
+    if (now - lastframetime < frametime)
+    {
+        I_Sleep(frametime - (now - lastframetime));
+        now = I_GetTimeMS();
+    }
+
+    lastframetime = now;
+}
+
 void doomgeneric_Tick()
 {
+    int oldgametic;
+
     // frame syncronous IO operations
     I_StartFrame ();
 
-    TryRunTics (); // will run at least one tic
+    // Runs at least one tic, unless -uncapped lets it return
+    // to draw another frame in the meantime.
+    oldgametic = gametic;
+    TryRunTics ();
 
-    S_UpdateSounds (players[consoleplayer].mo);// move positional sounds
+    // move positional sounds, unless that is done every tic
+    if (!snd_ticsync)
+    {
+        S_UpdateSounds (players[consoleplayer].mo);
+    }
+
+    if (uncapped)
+    {
+        D_UpdateFractionalTic (gametic != oldgametic);
+
+        if (maxfps > 0)
+        {
+            D_LimitFrameRate ();
+        }
+    }
 
     // Update display, next frame, with current state.
     if (screenvisible)
@@ -418,6 +491,35 @@ void doomgeneric_Tick()
     }
 }
 
+void doomgeneric_Step(ticcmd_t *cmds, int ntics)
+{
+    D_RunTics(cmds, ntics);
+}
+
+void doomgeneric_Render(void)
+{
+    // The screen wipe is paced by the real clock, so skip it.
+    wipegamestate = gamestate;
+    fractionaltic = FRACUNIT;
+
+    D_Display ();
+}
+
+snapshot_t *doomgeneric_SaveSnapshot(snapshot_t *snapshot)
+{
+    return P_SaveSnapshot(snapshot);
+}
+
+int doomgeneric_RestoreSnapshot(snapshot_t *snapshot)
+{
+    return P_RestoreSnapshot(snapshot);
+}
+
+void doomgeneric_FreeSnapshot(snapshot_t *snapshot)
+{
+    P_FreeSnapshot(snapshot);
+}
+
 //
 //  D_DoomLoop
 //
@@ -463,9 +565,9 @@ void D_DoomLoop (void)
 //
 //  DEMO LOOP
 //
-int             demosequence;
-int             pagetic;
-char                    *pagename;
+THREADLOCAL int             demosequence;
+THREADLOCAL int             pagetic;
+THREADLOCAL char                    *pagename;
 
 
 //
@@ -603,7 +705,7 @@ void D_StartTitle (void)
 // These are from the original source: some of them are perhaps
 // not used in any dehacked patches
 
-static char *banners[] =
+static THREADLOCAL char *banners[] =
 {
     // doom2.wad
     "                         "
@@ -863,7 +965,7 @@ void D_SetGameDescription(void)
 }
 
 //      print title for every printed line
-char            title[128];
+THREADLOCAL char            title[128];
 
 static boolean D_AddFile(char *filename)
 {
@@ -879,7 +981,7 @@ static boolean D_AddFile(char *filename)
 // Some dehacked mods replace these.  These are only displayed if they are 
 // replaced by dehacked.
 
-static char *copyright_banners[] =
+static THREADLOCAL char *copyright_banners[] =
 {
     "===========================================================================\n"
     "ATTENTION:  This version of DOOM has been modified.  If you would like to\n"
@@ -1175,6 +1277,8 @@ void D_DoomMain (void)
 
     I_PrintBanner(PACKAGE_STRING);
 
+    M_TraceInit();
+
     DEH_printf("Z_Init: Init zone memory allocation daemon. \n");
     Z_Init ();
 
@@ -1333,8 +1437,8 @@ void D_DoomMain (void)
     if ( (p=M_CheckParm ("-turbo")) )
     {
 	int     scale = 200;
-	extern int forwardmove[2];
-	extern int sidemove[2];
+	extern THREADLOCAL int forwardmove[2];
+	extern THREADLOCAL int sidemove[2];
 	
 	if (p<myargc-1)
 	    scale = atoi (myargv[p+1]);
@@ -1734,6 +1838,30 @@ void D_DoomMain (void)
         testcontrols = true;
     }
 
+    //!
+    // @category video
+    //
+    // Draw frames as fast as the platform takes them rather than once
+    // per tic, with things moved part of the way from where they were
+    // at the last tic.  The game itself still runs at 35 tics a second.
+    //
+
+    uncapped = M_ParmExists("-uncapped");
+
+    //!
+    // @arg <n>
+    // @category video
+    //
+    // With -uncapped, draw at most n frames a second.
+    //
+
+    p = M_CheckParmWithArgs("-maxfps", 1);
+
+    if (p > 0)
+    {
+        maxfps = atoi(myargv[p+1]);
+    }
+
     // Check for load game parameter
     // We do this here and save the slot number, so that the network code
     // can override it or send the load slot to other players.
@@ -43,7 +43,10 @@ void D_StartTitle (void);
 // GLOBAL VARIABLES
 //
 
-extern  gameaction_t    gameaction;
+extern THREADLOCAL gameaction_t    gameaction;
+
+// Set when the demo loop is to move on to its next page or demo.
+extern THREADLOCAL boolean         advancedemo;
 
 
 #endif
@@ -25,9 +25,11 @@
 #include "m_argv.h"
 #include "m_menu.h"
 #include "m_misc.h"
+#include "i_sound.h"
 #include "i_system.h"
 #include "i_timer.h"
 #include "i_video.h"
+#include "s_sound.h"
 #include "g_game.h"
 #include "doomdef.h"
 #include "doomstat.h"
@@ -38,13 +40,13 @@
 
 #include "d_loop.h"
 
-ticcmd_t *netcmds;
+THREADLOCAL ticcmd_t *netcmds;
 
 // Called when a player leaves the game
 
 static void PlayerQuitGame(player_t *player)
 {
-    static char exitmsg[80];
+    static THREADLOCAL char exitmsg[80];
     unsigned int player_num;
 
     player_num = player - players;
@@ -70,7 +72,7 @@ static void PlayerQuitGame(player_t *player)
 
 static void RunTic(ticcmd_t *cmds, boolean *ingame)
 {
-    extern boolean advancedemo;
+    extern THREADLOCAL boolean advancedemo;
     unsigned int i;
 
     // Check for player quits.
@@ -92,6 +94,11 @@ static void RunTic(ticcmd_t *cmds, boolean *ingame)
         D_DoAdvanceDemo ();
 
     G_Ticker ();
+
+    if (snd_ticsync)
+    {
+        S_UpdateSounds (players[consoleplayer].mo);
+    }
 }
 
 static loop_interface_t doom_loop_interface = {
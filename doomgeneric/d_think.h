@@ -60,6 +60,9 @@ typedef struct thinker_s
     struct thinker_s*	prev;
     struct thinker_s*	next;
     think_t		function;
+
+    // pool it was allocated from, see P_AllocThinker
+    int			pool;
     
 } thinker_t;
 
@@ -1,27 +1,193 @@
 #include <stdio.h>
+#include <string.h>
 
 #include "m_argv.h"
+#include "i_system.h"
+#include "m_trace.h"
 
 #include "doomgeneric.h"
 
-pixel_t* DG_ScreenBuffer = NULL;
+struct doomgeneric_instance_s
+{
+    int argc;
+    char **argv;
+    pixel_t *screenbuffer;
+    void *userdata;
+};
+
+THREADLOCAL pixel_t* DG_ScreenBuffer = NULL;
+
+THREADLOCAL dg_audioring_t* DG_AudioRing = NULL;
+
+// The instance belonging to this thread.
+
+static THREADLOCAL doomgeneric_instance_t *current_instance = NULL;
+
+#ifndef DOOMGENERIC_REENTRANT
+static int num_instances = 0;
+#endif
 
 void M_FindResponseFile(void);
 void D_DoomMain (void);
 
 
-void doomgeneric_Create(int argc, char **argv)
+doomgeneric_instance_t *doomgeneric_CreateInstance(int argc, char **argv,
+                                                   void *userdata)
 {
+    doomgeneric_instance_t *instance;
+
+    if (current_instance != NULL)
+    {
+        I_Error("doomgeneric_CreateInstance: this thread already has an instance");
+    }
+
+#ifndef DOOMGENERIC_REENTRANT
+    // Engine state is shared by the whole process.
+
+    if (num_instances > 0)
+    {
+        I_Error("doomgeneric_CreateInstance: only one instance is supported "
+                "without DOOMGENERIC_REENTRANT");
+    }
+
+    ++num_instances;
+#endif
+
+    instance = malloc(sizeof(doomgeneric_instance_t));
+
+    if (instance == NULL)
+    {
+        I_Error("doomgeneric_CreateInstance: out of memory");
+    }
+
+    instance->argc = argc;
+    instance->argv = argv;
+    instance->screenbuffer = malloc(DOOMGENERIC_RESX * DOOMGENERIC_RESY * 4);
+    instance->userdata = userdata;
+
+    current_instance = instance;
+
 	// save arguments
     myargc = argc;
     myargv = argv;
 
 	M_FindResponseFile();
 
-	DG_ScreenBuffer = malloc(DOOMGENERIC_RESX * DOOMGENERIC_RESY * 4);
+	DG_ScreenBuffer = instance->screenbuffer;
 
 	DG_Init();
 
 	D_DoomMain ();
+
+    return instance;
+}
+
+void doomgeneric_Create(int argc, char **argv)
+{
+    doomgeneric_CreateInstance(argc, argv, NULL);
+}
+
+void doomgeneric_TickInstance(doomgeneric_instance_t *instance)
+{
+    if (instance != current_instance)
+    {
+        I_Error("doomgeneric_TickInstance: instance belongs to another thread");
+    }
+
+    doomgeneric_Tick();
+}
+
+doomgeneric_instance_t *doomgeneric_GetInstance(void)
+{
+    return current_instance;
+}
+
+void *doomgeneric_GetUserData(doomgeneric_instance_t *instance)
+{
+    return instance->userdata;
+}
+
+pixel_t *doomgeneric_GetScreenBuffer(doomgeneric_instance_t *instance)
+{
+    return instance->screenbuffer;
+}
+
+
+int doomgeneric_PushKey(dg_keyqueue_t *queue, int pressed, unsigned char key)
+{
+    unsigned int write;
+
+    write = queue->write;
+
+    if (write - LOAD_ACQUIRE(&queue->read) >= DG_KEYQUEUE_SIZE)
+    {
+        ++queue->dropped;
+        return 0;
+    }
+
+    queue->keys[write % DG_KEYQUEUE_SIZE] = (pressed << 8) | key;
+    STORE_RELEASE(&queue->write, write + 1);
+
+    return 1;
+}
+
+int doomgeneric_PopKey(dg_keyqueue_t *queue, int *pressed, unsigned char *key)
+{
+    unsigned short keyData;
+    unsigned int read;
+
+    read = queue->read;
+
+    if (read == LOAD_ACQUIRE(&queue->write))
+    {
+        return 0;
+    }
+
+    keyData = queue->keys[read % DG_KEYQUEUE_SIZE];
+    STORE_RELEASE(&queue->read, read + 1);
+
+    *pressed = keyData >> 8;
+    *key = keyData & 0xFF;
+
+    return 1;
 }
 
+int doomgeneric_ReadAudio(dg_audioring_t *ring, int16_t *samples, int frames)
+{
+    unsigned int read, available, start, n;
+
+    read = ring->read;
+    available = LOAD_ACQUIRE(&ring->write) - read;
+
+    if ((unsigned int) frames > available)
+    {
+        frames = available;
+    }
+
+    // In up to two pieces, as the frames may wrap around the end.
+
+    start = read % DG_AUDIO_FRAMES;
+    n = DG_AUDIO_FRAMES - start;
+
+    if (n > (unsigned int) frames)
+    {
+        n = frames;
+    }
+
+    memcpy(samples, ring->samples + start * 2, n * 4);
+    memcpy(samples + n * 2, ring->samples, (frames - n) * 4);
+
+    STORE_RELEASE(&ring->read, read + frames);
+
+    return frames;
+}
+
+void doomgeneric_SetTracing(int enable)
+{
+    M_TraceEnable(enable != 0);
+}
+
+int doomgeneric_DumpTrace(const char *filename)
+{
+    return M_TraceDump(filename);
+}
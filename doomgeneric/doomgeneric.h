@@ -24,15 +24,127 @@ typedef uint32_t pixel_t;
 #endif  // CMAP256
 
 
-extern pixel_t* DG_ScreenBuffer;
+// Same as in doomtype.h, which platform code does not include.
+
+#ifndef THREADLOCAL
+#ifdef DOOMGENERIC_REENTRANT
+#if defined(_MSC_VER)
+#define THREADLOCAL __declspec(thread)
+#else
+#define THREADLOCAL __thread
+#endif
+#else
+#define THREADLOCAL
+#endif
+#endif
+
+// In a reentrant build this is the screen of the calling thread's instance.
+
+extern THREADLOCAL pixel_t* DG_ScreenBuffer;
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// A running game.  Without DOOMGENERIC_REENTRANT there can only be one per
+// process.  With it, every thread may create one; all engine state is then
+// thread-local, and an instance must only be ticked by the thread that
+// created it.
+
+typedef struct doomgeneric_instance_s doomgeneric_instance_t;
+
 void doomgeneric_Create(int argc, char **argv);
 void doomgeneric_Tick();
 
+// Headless use: run ntics tics back to back with the given commands for
+// the console player (one per tic, or NULL for no input).  Nothing is
+// drawn, and neither the clock nor DG_GetKey is consulted.  Call
+// doomgeneric_Render when a frame is actually wanted.  The ticcmd_t
+// layout is in d_ticcmd.h.
+struct ticcmd_s;
+void doomgeneric_Step(struct ticcmd_s *cmds, int ntics);
+void doomgeneric_Render(void);
+
+// Snapshots of the level being played, for resetting it or searching
+// ahead from a state without going through a savegame.  A snapshot may
+// be restored into any instance started with the same WAD files, for
+// instance one per thread to run several continuations of a game at
+// once; the level is loaded first if needed.  Restoring only reads the
+// snapshot, so threads can share one.  doomgeneric_RestoreSnapshot
+// returns 0 if the level does not match.  Passing an old snapshot to
+// doomgeneric_SaveSnapshot reuses its memory.  Save returns NULL when
+// no level is being played.
+struct snapshot_s;
+struct snapshot_s *doomgeneric_SaveSnapshot(struct snapshot_s *snapshot);
+int doomgeneric_RestoreSnapshot(struct snapshot_s *snapshot);
+void doomgeneric_FreeSnapshot(struct snapshot_s *snapshot);
+
+doomgeneric_instance_t *doomgeneric_CreateInstance(int argc, char **argv,
+                                                   void *userdata);
+void doomgeneric_TickInstance(doomgeneric_instance_t *instance);
+
+// Instance created by the calling thread, or NULL.  Platform callbacks can
+// use this with doomgeneric_GetUserData to find their per-game state.
+doomgeneric_instance_t *doomgeneric_GetInstance(void);
+void *doomgeneric_GetUserData(doomgeneric_instance_t *instance);
+pixel_t *doomgeneric_GetScreenBuffer(doomgeneric_instance_t *instance);
+
+// A queue of keys for DG_GetKey to return.  One thread may push keys
+// while another pops them, with no locks, so a platform can read input
+// on a thread of its own as soon as it arrives.  Keys that do not fit
+// are counted in `dropped`.  A zeroed queue is empty.
+
+#define DG_KEYQUEUE_SIZE 256    // a power of two
+
+typedef struct
+{
+    unsigned short keys[DG_KEYQUEUE_SIZE];
+    unsigned int write;         // only changed by doomgeneric_PushKey
+    unsigned int read;          // only changed by doomgeneric_PopKey
+    unsigned int dropped;
+} dg_keyqueue_t;
+
+// Returns 0 if the queue is full and the key was dropped.
+int doomgeneric_PushKey(dg_keyqueue_t *queue, int pressed, unsigned char key);
+
+// Returns 0 if the queue is empty, like DG_GetKey.
+int doomgeneric_PopKey(dg_keyqueue_t *queue, int *pressed, unsigned char *key);
+
+// Sound from the built-in mixer (i_mixsound.c): 16 bit stereo frames,
+// left sample first, at `rate` Hz.  The game fills the ring and a thread
+// of the platform's empties it, with no locks, as with dg_keyqueue_t.
+// Frames that do not fit are counted in `dropped`.  Point DG_AudioRing
+// at a zeroed ring in DG_Init to get sound; the mixer sets `rate` when
+// it starts, and mixes nothing while DG_AudioRing is NULL.
+//
+// With -sndtics every tic adds exactly rate / 35 frames (in whole frames
+// that add up), whatever the clock says, so the same game gives the same
+// samples, in step with the frames.  Empty the ring after each
+// doomgeneric_Step then; it holds 13 tics at 44100 Hz.
+
+#define DG_AUDIO_FRAMES 16384   // a power of two
+
+typedef struct
+{
+    int16_t samples[DG_AUDIO_FRAMES * 2];
+    uint32_t rate;
+    uint32_t write;             // in frames, only changed by the mixer
+    uint32_t read;              // only changed by doomgeneric_ReadAudio
+    uint32_t dropped;
+} dg_audioring_t;
+
+extern THREADLOCAL dg_audioring_t* DG_AudioRing;
+
+// Copies up to `frames` frames out of the ring, and returns how many.
+int doomgeneric_ReadAudio(dg_audioring_t *ring, int16_t *samples, int frames);
+
+// Trace zones around the hot functions of the engine, written out as
+// Chrome trace events.  Any thread may turn tracing on and off and dump
+// what all threads have recorded, e.g. a watchdog that finds a game
+// stuck.  DumpTrace returns 0 if the file can't be written.
+void doomgeneric_SetTracing(int enable);
+int doomgeneric_DumpTrace(const char *filename);
+
 
 //Implement below functions for your platform
 void DG_Init();
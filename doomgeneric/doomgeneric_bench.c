@@ -0,0 +1,407 @@
+//doomgeneric benchmark: times demo playback
+//
+// Nothing is displayed and there is no keyboard.  The demos named after
+// -bench are played back as fast as possible, -benchrepeat times each,
+// drawing a frame every tic:
+//
+//   doomgeneric -iwad doom2.wad -bench demo1 demo2 -benchrepeat 5
+//
+// The results are written as JSON to -benchout (bench.json by default,
+// "-" for stdout): frames per second, percentiles of the time taken by
+// each frame, and the time spent in P_Ticker, R_RenderBSPNode,
+// R_DrawPlanes, R_DrawMasked and I_FinishUpdate, for every run and in
+// total.  Demo files can be added with -file, e.g. -file run.lmp -bench
+// run.  Pass -nodraw to time the game logic alone.
+
+#include "doomkeys.h"
+#include "m_argv.h"
+#include "m_bench.h"
+#include "doomgeneric.h"
+#include "i_system.h"
+#include "i_timer.h"
+#include "i_video.h"
+
+#include "d_main.h"
+#include "doomstat.h"
+#include "g_game.h"
+#include "w_wad.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#define MAX_DEMOS 32
+
+typedef struct
+{
+    int gametics;
+    int frames;
+    uint64_t time;
+    uint64_t benchtime[NUMBENCHTIMERS];
+} runstats_t;
+
+static char *s_Demos[MAX_DEMOS];
+static int s_NumDemos;
+static int s_Repeat = 1;
+static boolean s_Draw = true;
+
+static FILE *s_Out;
+static int s_NumRuns;
+
+// The time taken by every frame so far, in ns.
+static uint64_t *s_FrameTimes;
+static int s_NumFrames;
+static int s_MaxFrames;
+
+static void AddFrameTime(uint64_t time)
+{
+    if (s_NumFrames == s_MaxFrames)
+    {
+        s_MaxFrames = s_MaxFrames ? s_MaxFrames * 2 : 4096;
+        s_FrameTimes = realloc(s_FrameTimes,
+                               s_MaxFrames * sizeof(*s_FrameTimes));
+
+        if (s_FrameTimes == NULL)
+        {
+            I_Error("AddFrameTime: out of memory");
+        }
+    }
+
+    s_FrameTimes[s_NumFrames++] = time;
+}
+
+static int CompareTimes(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+
+    return x < y ? -1 : x > y;
+}
+
+static double Ms(uint64_t ns)
+{
+    return ns / 1000000.0;
+}
+
+// Nearest rank percentile of n sorted times.
+
+static double Percentile(uint64_t *times, int n, int percent)
+{
+    int rank = (n * percent + 99) / 100;
+
+    return Ms(times[rank > 0 ? rank - 1 : 0]);
+}
+
+//
+// JSON output
+//
+
+// The statistics of a run or of all of them, as the members of an object
+// indented by `indent`.  Sorts the frame times.
+
+static void WriteStats(runstats_t *stats, uint64_t *times, const char *indent)
+{
+    double seconds = stats->time / 1000000000.0;
+    double frames = stats->frames > 0 ? stats->frames : 1;
+    int i;
+
+    qsort(times, stats->frames, sizeof(*times), CompareTimes);
+
+    fprintf(s_Out, "%s\"gametics\": %d,\n", indent, stats->gametics);
+    fprintf(s_Out, "%s\"frames\": %d,\n", indent, stats->frames);
+    fprintf(s_Out, "%s\"seconds\": %.6f,\n", indent, seconds);
+    fprintf(s_Out, "%s\"fps\": %.2f,\n", indent,
+                   seconds > 0 ? stats->frames / seconds : 0.0);
+
+    fprintf(s_Out, "%s\"frame_ms\": {", indent);
+
+    if (stats->frames > 0)
+    {
+        fprintf(s_Out, " \"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f,"
+                       " \"p99\": %.4f, \"max\": %.4f ",
+                       Ms(stats->time) / frames,
+                       Percentile(times, stats->frames, 50),
+                       Percentile(times, stats->frames, 90),
+                       Percentile(times, stats->frames, 99),
+                       Ms(times[stats->frames - 1]));
+    }
+
+    fprintf(s_Out, "},\n");
+
+    fprintf(s_Out, "%s\"subsystems\": {\n", indent);
+
+    for (i = 0; i < NUMBENCHTIMERS; ++i)
+    {
+        fprintf(s_Out, "%s    \"%s\": { \"total_ms\": %.3f,"
+                       " \"ms_per_frame\": %.4f }%s\n",
+                       indent, benchtimernames[i],
+                       Ms(stats->benchtime[i]),
+                       Ms(stats->benchtime[i]) / frames,
+                       i < NUMBENCHTIMERS - 1 ? "," : "");
+    }
+
+    fprintf(s_Out, "%s}\n", indent);
+}
+
+static void WriteRun(char *demo, int pass, runstats_t *stats, int first)
+{
+    fprintf(s_Out, "%s\n        {\n", s_NumRuns > 0 ? "," : "");
+    fprintf(s_Out, "            \"demo\": \"%s\",\n", demo);
+    fprintf(s_Out, "            \"pass\": %d,\n", pass);
+    WriteStats(stats, s_FrameTimes + first, "            ");
+    fprintf(s_Out, "        }");
+
+    ++s_NumRuns;
+}
+
+static void OpenOutput(void)
+{
+    char *filename = "bench.json";
+    int i;
+
+    //!
+    // @arg <file>
+    // @platform bench
+    //
+    // File to write the benchmark results to (default bench.json), or
+    // - for stdout.
+    //
+
+    i = M_CheckParmWithArgs("-benchout", 1);
+
+    if (i > 0)
+    {
+        filename = myargv[i + 1];
+    }
+
+    if (!strcmp(filename, "-"))
+    {
+        s_Out = stdout;
+    }
+    else
+    {
+        s_Out = fopen(filename, "w");
+
+        if (s_Out == NULL)
+        {
+            I_Error("OpenOutput: can't write %s", filename);
+        }
+    }
+
+    fprintf(s_Out, "{\n");
+    fprintf(s_Out, "    \"width\": %d,\n", SCREENWIDTH);
+    fprintf(s_Out, "    \"height\": %d,\n", SCREENHEIGHT);
+    fprintf(s_Out, "    \"draw\": %s,\n", s_Draw ? "true" : "false");
+    fprintf(s_Out, "    \"repeat\": %d,\n", s_Repeat);
+    fprintf(s_Out, "    \"runs\": [");
+}
+
+//
+// Playing the demos
+//
+
+static void AddDemo(char *name)
+{
+    if (W_CheckNumForName(name) < 0)
+    {
+        I_Error("AddDemo: there is no demo lump %s", name);
+    }
+
+    if (s_NumDemos == MAX_DEMOS)
+    {
+        I_Error("AddDemo: more than %d demos", MAX_DEMOS);
+    }
+
+    s_Demos[s_NumDemos++] = name;
+}
+
+static void ParseArgs(void)
+{
+    static char *defaults[] = { "DEMO1", "DEMO2", "DEMO3", "DEMO4" };
+    int i, p;
+
+    //!
+    // @arg <demo...>
+    // @platform bench
+    //
+    // Demo lumps to time (default all of DEMO1 to DEMO4 that the WAD
+    // files have).
+    //
+
+    p = M_CheckParm("-bench");
+
+    if (p > 0)
+    {
+        for (i = p + 1; i < myargc && myargv[i][0] != '-'; ++i)
+        {
+            AddDemo(myargv[i]);
+        }
+    }
+
+    if (s_NumDemos == 0)
+    {
+        for (i = 0; i < arrlen(defaults); ++i)
+        {
+            if (W_CheckNumForName(defaults[i]) >= 0)
+            {
+                AddDemo(defaults[i]);
+            }
+        }
+    }
+
+    if (s_NumDemos == 0)
+    {
+        I_Error("ParseArgs: no demos to play");
+    }
+
+    //!
+    // @arg <n>
+    // @platform bench
+    //
+    // Number of times to play each demo (default 1).
+    //
+
+    p = M_CheckParmWithArgs("-benchrepeat", 1);
+
+    if (p > 0)
+    {
+        s_Repeat = atoi(myargv[p + 1]);
+
+        if (s_Repeat < 1)
+        {
+            I_Error("ParseArgs: invalid -benchrepeat %s", myargv[p + 1]);
+        }
+    }
+
+    s_Draw = !M_CheckParm("-nodraw");
+}
+
+// Play one demo to the end.  The first tic, which loads the level, is not
+// timed.
+
+static void RunDemo(char *demo, runstats_t *stats)
+{
+    int starttic;
+    uint64_t start, now;
+
+    // Stop the title loop from playing demos of its own.
+    advancedemo = false;
+
+    G_DeferedPlayDemo(demo);
+    doomgeneric_Step(NULL, 1);
+
+    if (s_Draw)
+    {
+        doomgeneric_Render();
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    M_BenchClear();
+    benchmarking = true;
+    starttic = gametic;
+
+    while (demoplayback)
+    {
+        start = I_GetTimeNS();
+
+        doomgeneric_Step(NULL, 1);
+
+        if (s_Draw)
+        {
+            doomgeneric_Render();
+        }
+
+        now = I_GetTimeNS();
+        AddFrameTime(now - start);
+        stats->time += now - start;
+        ++stats->frames;
+    }
+
+    benchmarking = false;
+    stats->gametics = gametic - starttic;
+    memcpy(stats->benchtime, benchtime, sizeof(stats->benchtime));
+
+    advancedemo = false;
+}
+
+void DG_Init()
+{
+}
+
+void DG_DrawFrame()
+{
+}
+
+void DG_SleepMs(uint32_t ms)
+{
+    usleep (ms * 1000);
+}
+
+uint32_t DG_GetTicksMs()
+{
+    struct timeval  tp;
+    struct timezone tzp;
+
+    gettimeofday(&tp, &tzp);
+
+    return (tp.tv_sec * 1000) + (tp.tv_usec / 1000); /* return milliseconds */
+}
+
+int DG_GetKey(int* pressed, unsigned char* doomKey)
+{
+    return 0;
+}
+
+void DG_SetWindowTitle(const char * title)
+{
+}
+
+int main(int argc, char **argv)
+{
+    runstats_t run, total;
+    int pass, first, i, j;
+
+    doomgeneric_Create(argc, argv);
+
+    ParseArgs();
+    OpenOutput();
+
+    memset(&total, 0, sizeof(total));
+
+    for (pass = 0; pass < s_Repeat; ++pass)
+    {
+        for (i = 0; i < s_NumDemos; ++i)
+        {
+            first = s_NumFrames;
+
+            RunDemo(s_Demos[i], &run);
+
+            total.gametics += run.gametics;
+            total.frames += run.frames;
+            total.time += run.time;
+
+            for (j = 0; j < NUMBENCHTIMERS; ++j)
+            {
+                total.benchtime[j] += run.benchtime[j];
+            }
+
+            WriteRun(s_Demos[i], pass, &run, first);
+        }
+    }
+
+    fprintf(s_Out, "\n    ],\n");
+    fprintf(s_Out, "    \"total\": {\n");
+    WriteStats(&total, s_FrameTimes, "        ");
+    fprintf(s_Out, "    }\n}\n");
+
+    if (s_Out != stdout)
+    {
+        fclose(s_Out);
+    }
+
+    I_Quit();
+
+    return 0;
+}
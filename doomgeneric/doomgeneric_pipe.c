@@ -0,0 +1,639 @@
+//doomgeneric for streaming frames to a file, a pipe or shared memory
+//
+// Nothing is displayed and there is no input.  Frames go either to a
+// file or stdout as raw pixels or a YUV4MPEG2 stream:
+//
+//   doomgeneric -pipeformat y4m | ffmpeg -i - doom.mp4
+//   doomgeneric | ffmpeg -f rawvideo -pix_fmt bgr0 -s 640x400 -r 35 -i - doom.mp4
+//
+// or into a POSIX shared memory ring for another process to read, see
+// doomgeneric_pipe.h.  When built with the mixer of i_mixsound.c, the
+// sound is in shared memory too, or written to a file of its own with
+// -pipeaudio, 1/35 second for every tic, to go with the frames of
+// -timedemo and the like:
+//
+//   doomgeneric -timedemo demo1 -pipeformat y4m -pipeout d.y4m -pipeaudio d.pcm
+//   ffmpeg -i d.y4m -f s16le -ar 44100 -ac 2 -i d.pcm doom.mp4
+//
+// Either way the frames live in a ring of slots, and DG_ScreenBuffer
+// points at the slot being drawn, so a frame is never copied.  When the
+// consumer falls behind and all slots are taken, the game waits for it
+// at most -pipelatency milliseconds, then drops the frame and draws the
+// next one over it.
+
+#include "doomkeys.h"
+#include "m_argv.h"
+#include "doomgeneric.h"
+#include "doomgeneric_pipe.h"
+#include "i_sound.h"
+#include "i_system.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#ifdef CMAP256
+#error doomgeneric_pipe.c needs 32 bit pixels
+#endif
+
+#define FRAME_STRIDE (DOOMGENERIC_RESX * 4)
+#define FRAME_SIZE (FRAME_STRIDE * DOOMGENERIC_RESY)
+#define PIPE_FPS 35
+
+#define DEFAULT_SLOTS 4
+
+static dg_pipe_header_t *s_Ring = NULL;
+static size_t s_RingSize;
+static char *s_ShmName = NULL;
+
+// Milliseconds to wait for a free slot, or -1 to wait as long as needed.
+static int s_Latency;
+
+// Output file when not using shared memory, and the thread writing it.
+static int s_OutFd = -1;
+static int s_Y4M = 0;
+static unsigned char *s_Yuv = NULL;
+static pthread_t s_Writer;
+static pthread_mutex_t s_Mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_Cond = PTHREAD_COND_INITIALIZER;
+static volatile int s_WriteFailed = 0;
+
+// -pipeaudio
+static FILE *s_AudioFile = NULL;
+
+static uint64_t LoadSeq(uint64_t *seq)
+{
+    return __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+}
+
+static void StoreSeq(uint64_t *seq, uint64_t value)
+{
+    __atomic_store_n(seq, value, __ATOMIC_RELEASE);
+}
+
+static uint32_t *Slot(uint64_t frame)
+{
+    return (uint32_t *) ((char *) s_Ring + s_Ring->frame_offset
+                         + (frame % s_Ring->slots) * s_Ring->frame_size);
+}
+
+// Wake up whoever waits on the ring in this process.
+
+static void Notify(void)
+{
+    if (s_OutFd >= 0)
+    {
+        pthread_mutex_lock(&s_Mutex);
+        pthread_cond_broadcast(&s_Cond);
+        pthread_mutex_unlock(&s_Mutex);
+    }
+}
+
+//
+// Writing to a file
+//
+
+static int WriteAll(const void *buf, size_t len)
+{
+    const char *p = buf;
+    ssize_t n;
+
+    while (len > 0)
+    {
+        n = write(s_OutFd, p, len);
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return 0;
+        }
+
+        p += n;
+        len -= n;
+    }
+
+    return 1;
+}
+
+// BT.601 studio range, chroma averaged over 2x2 pixels.
+
+static int WriteY4MFrame(const uint32_t *pix)
+{
+    static const char frame[] = "FRAME\n";
+    const int w = DOOMGENERIC_RESX, h = DOOMGENERIC_RESY;
+    const int cw = (w + 1) / 2, ch = (h + 1) / 2;
+    unsigned char *y = s_Yuv, *u = s_Yuv + w * h, *v = u + cw * ch;
+    int i, j, dx, dy, r, g, b;
+    uint32_t c;
+
+    for (i = 0; i < w * h; ++i)
+    {
+        c = pix[i];
+        r = (c >> 16) & 0xff;
+        g = (c >> 8) & 0xff;
+        b = c & 0xff;
+        y[i] = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+    }
+
+    for (j = 0; j < ch; ++j)
+    {
+        for (i = 0; i < cw; ++i)
+        {
+            r = g = b = 0;
+
+            for (dy = 0; dy < 2; ++dy)
+            {
+                for (dx = 0; dx < 2; ++dx)
+                {
+                    int px = 2 * i + dx < w ? 2 * i + dx : w - 1;
+                    int py = 2 * j + dy < h ? 2 * j + dy : h - 1;
+
+                    c = pix[py * w + px];
+                    r += (c >> 16) & 0xff;
+                    g += (c >> 8) & 0xff;
+                    b += c & 0xff;
+                }
+            }
+
+            r /= 4;
+            g /= 4;
+            b /= 4;
+            u[j * cw + i] = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+            v[j * cw + i] = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+        }
+    }
+
+    return WriteAll(frame, sizeof(frame) - 1)
+        && WriteAll(s_Yuv, w * h + 2 * cw * ch);
+}
+
+static void *WriterThread(void *arg)
+{
+    uint64_t frame;
+    int ok;
+
+    while (1)
+    {
+        pthread_mutex_lock(&s_Mutex);
+
+        while ((frame = LoadSeq(&s_Ring->read_seq))
+            == LoadSeq(&s_Ring->write_seq))
+        {
+            pthread_cond_wait(&s_Cond, &s_Mutex);
+        }
+
+        pthread_mutex_unlock(&s_Mutex);
+
+        if (s_Y4M)
+        {
+            ok = WriteY4MFrame(Slot(frame));
+        }
+        else
+        {
+            ok = WriteAll(Slot(frame), FRAME_SIZE);
+        }
+
+        if (!ok)
+        {
+            // The reader went away; the game stops at the next frame.
+            s_WriteFailed = 1;
+            return NULL;
+        }
+
+        StoreSeq(&s_Ring->read_seq, frame + 1);
+        Notify();
+    }
+
+    return NULL;
+}
+
+// Let the writer finish the frames that are still queued, also when
+// -timedemo ends with I_Error.
+
+static void FlushPipe(void)
+{
+    pthread_mutex_lock(&s_Mutex);
+
+    while (!s_WriteFailed
+        && LoadSeq(&s_Ring->read_seq) != LoadSeq(&s_Ring->write_seq))
+    {
+        pthread_cond_wait(&s_Cond, &s_Mutex);
+    }
+
+    pthread_mutex_unlock(&s_Mutex);
+}
+
+static void OpenOutput(const char *filename, const char *format)
+{
+    char header[128];
+
+    if (!strcmp(format, "y4m"))
+    {
+        s_Y4M = 1;
+    }
+    else if (strcmp(format, "raw") != 0)
+    {
+        I_Error("DG_Init: unknown -pipeformat '%s'", format);
+    }
+
+    if (!strcmp(filename, "-"))
+    {
+        // The engine prints to stdout, so that goes to stderr from now on.
+        s_OutFd = dup(STDOUT_FILENO);
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+    }
+    else
+    {
+        s_OutFd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+
+    if (s_OutFd < 0)
+    {
+        I_Error("DG_Init: can't open %s: %s", filename, strerror(errno));
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    if (s_Y4M)
+    {
+        // Doom pixels are 20% taller than they are wide.
+        snprintf(header, sizeof(header),
+                 "YUV4MPEG2 W%d H%d F%d:1 Ip A5:6 C420jpeg\n",
+                 DOOMGENERIC_RESX, DOOMGENERIC_RESY, PIPE_FPS);
+
+        s_Yuv = malloc(DOOMGENERIC_RESX * DOOMGENERIC_RESY
+                       + 2 * ((DOOMGENERIC_RESX + 1) / 2)
+                           * ((DOOMGENERIC_RESY + 1) / 2));
+
+        if (s_Yuv == NULL || !WriteAll(header, strlen(header)))
+        {
+            I_Error("DG_Init: can't write to %s", filename);
+        }
+    }
+
+    if (pthread_create(&s_Writer, NULL, WriterThread, NULL) != 0)
+    {
+        I_Error("DG_Init: can't start the writer thread");
+    }
+
+    pthread_detach(s_Writer);
+    I_AtExit(FlushPipe, true);
+}
+
+// Move the sound made so far from the ring to the -pipeaudio file.
+
+static int WriteAudio(void)
+{
+    int16_t samples[1024 * 2];
+    int n;
+
+    while ((n = doomgeneric_ReadAudio(DG_AudioRing, samples, 1024)) > 0)
+    {
+        if (fwrite(samples, 4, n, s_AudioFile) != (size_t) n)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// Like FlushPipe, this also runs when -timedemo ends with I_Error.
+
+static void CloseAudio(void)
+{
+    WriteAudio();
+    fclose(s_AudioFile);
+}
+
+//
+// The ring
+//
+
+static void UnlinkShm(void)
+{
+    shm_unlink(s_ShmName);
+}
+
+static void CreateRing(int slots)
+{
+    dg_pipe_header_t header;
+    long page = sysconf(_SC_PAGESIZE);
+    int fd;
+
+    memset(&header, 0, sizeof(header));
+    header.width = DOOMGENERIC_RESX;
+    header.height = DOOMGENERIC_RESY;
+    header.stride = FRAME_STRIDE;
+    header.slots = slots;
+    header.frame_offset = (sizeof(header) + page - 1) / page * page;
+    header.frame_size = (FRAME_SIZE + page - 1) / page * page;
+    header.fps = PIPE_FPS;
+    header.audio_offset = header.frame_offset + slots * header.frame_size;
+
+    s_RingSize = header.audio_offset + sizeof(dg_audioring_t);
+
+    if (s_ShmName != NULL)
+    {
+        // Start from a fresh object so that no consumer sees stale data.
+        shm_unlink(s_ShmName);
+        fd = shm_open(s_ShmName, O_RDWR | O_CREAT | O_EXCL, 0600);
+
+        if (fd < 0 || ftruncate(fd, s_RingSize) < 0)
+        {
+            I_Error("DG_Init: can't create %s: %s",
+                    s_ShmName, strerror(errno));
+        }
+
+        s_Ring = mmap(NULL, s_RingSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+        close(fd);
+        I_AtExit(UnlinkShm, true);
+    }
+    else
+    {
+        s_Ring = mmap(NULL, s_RingSize, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+
+    if (s_Ring == MAP_FAILED)
+    {
+        I_Error("DG_Init: can't map %d frames", slots);
+    }
+
+    memcpy(s_Ring, &header, sizeof(header));
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(s_Ring->magic, DG_PIPE_MAGIC, sizeof(s_Ring->magic));
+
+    // Nobody would read the sound out of a private mapping, unless it is
+    // written to a file.
+    if (s_ShmName != NULL || s_AudioFile != NULL)
+    {
+        DG_AudioRing = (dg_audioring_t *) ((char *) s_Ring
+                                           + header.audio_offset);
+    }
+}
+
+// Wait until the slot for frame `next` is free, or the latency bound is
+// reached.
+
+static int WaitForSlot(uint64_t next)
+{
+    uint32_t start = DG_GetTicksMs();
+    struct timespec deadline;
+
+    if (next - LoadSeq(&s_Ring->read_seq) < s_Ring->slots)
+    {
+        return 1;
+    }
+
+    if (s_OutFd < 0)
+    {
+        // Another process reads the ring; poll it.
+
+        while (next - LoadSeq(&s_Ring->read_seq) >= s_Ring->slots)
+        {
+            if (s_Latency >= 0 && DG_GetTicksMs() - start >= s_Latency)
+            {
+                return 0;
+            }
+
+            usleep(100);
+        }
+
+        return 1;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += s_Latency / 1000;
+    deadline.tv_nsec += (s_Latency % 1000) * 1000000L;
+
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&s_Mutex);
+
+    while (!s_WriteFailed
+        && next - LoadSeq(&s_Ring->read_seq) >= s_Ring->slots)
+    {
+        if (s_Latency < 0)
+        {
+            pthread_cond_wait(&s_Cond, &s_Mutex);
+        }
+        else if (pthread_cond_timedwait(&s_Cond, &s_Mutex,
+                                        &deadline) == ETIMEDOUT)
+        {
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&s_Mutex);
+
+    return next - LoadSeq(&s_Ring->read_seq) < s_Ring->slots;
+}
+
+void DG_Init()
+{
+    char *filename = "-";
+    char *format = "raw";
+    int slots = DEFAULT_SLOTS;
+    int i;
+
+    //!
+    // @arg <file>
+    // @platform pipe
+    //
+    // Write the frames to this file; - is stdout, which is the default.
+    //
+
+    i = M_CheckParmWithArgs("-pipeout", 1);
+
+    if (i > 0)
+    {
+        filename = myargv[i + 1];
+    }
+
+    //!
+    // @arg <name>
+    // @platform pipe
+    //
+    // Publish the frames in this POSIX shared memory object instead of
+    // writing them to a file.
+    //
+
+    i = M_CheckParmWithArgs("-pipeshm", 1);
+
+    if (i > 0)
+    {
+        s_ShmName = myargv[i + 1];
+    }
+
+    //!
+    // @arg <format>
+    // @platform pipe
+    //
+    // Format of the output file: raw (32 bit pixels, the default) or y4m.
+    //
+
+    i = M_CheckParmWithArgs("-pipeformat", 1);
+
+    if (i > 0)
+    {
+        format = myargv[i + 1];
+    }
+
+    //!
+    // @arg <n>
+    // @platform pipe
+    //
+    // Number of frames in the ring (default 4).
+    //
+
+    i = M_CheckParmWithArgs("-pipeslots", 1);
+
+    if (i > 0)
+    {
+        slots = atoi(myargv[i + 1]);
+
+        if (slots < 2)
+        {
+            I_Error("DG_Init: -pipeslots must be at least 2");
+        }
+    }
+
+    //!
+    // @arg <ms>
+    // @platform pipe
+    //
+    // How long to wait for a slow consumer before dropping a frame; -1
+    // waits as long as needed.  The default is -1 when writing a file,
+    // so that no frame is lost, and 0 for shared memory, so that the
+    // game never waits.
+    //
+
+    s_Latency = s_ShmName != NULL ? 0 : -1;
+    i = M_CheckParmWithArgs("-pipelatency", 1);
+
+    if (i > 0)
+    {
+        s_Latency = atoi(myargv[i + 1]);
+    }
+
+    //!
+    // @arg <file>
+    // @platform pipe
+    //
+    // Write the sound to this file, as raw 16 bit stereo samples in the
+    // byte order of the machine at snd_samplerate, 1/35 second for every
+    // tic (see -sndtics).
+    //
+
+    i = M_CheckParmWithArgs("-pipeaudio", 1);
+
+    if (i > 0)
+    {
+        if (s_ShmName != NULL)
+        {
+            I_Error("DG_Init: -pipeaudio can't be used with -pipeshm");
+        }
+
+        s_AudioFile = fopen(myargv[i + 1], "wb");
+
+        if (s_AudioFile == NULL)
+        {
+            I_Error("DG_Init: can't open %s: %s",
+                    myargv[i + 1], strerror(errno));
+        }
+
+        snd_ticsync = true;
+        I_AtExit(CloseAudio, true);
+    }
+
+    CreateRing(slots);
+
+    if (s_ShmName == NULL)
+    {
+        OpenOutput(filename, format);
+    }
+
+    DG_ScreenBuffer = Slot(0);
+}
+
+void DG_DrawFrame()
+{
+    uint64_t frame = LoadSeq(&s_Ring->write_seq);
+
+    if (s_AudioFile != NULL && !WriteAudio())
+    {
+        I_Error("DG_DrawFrame: can't write the sound");
+    }
+
+    if (s_WriteFailed)
+    {
+        I_Quit();
+    }
+
+    if (!WaitForSlot(frame + 1))
+    {
+        // No room for another frame: forget this one, and draw the next
+        // into the same slot.
+        StoreSeq(&s_Ring->dropped, s_Ring->dropped + 1);
+        return;
+    }
+
+    StoreSeq(&s_Ring->write_seq, frame + 1);
+    Notify();
+
+    DG_ScreenBuffer = Slot(frame + 1);
+}
+
+void DG_SleepMs(uint32_t ms)
+{
+    usleep (ms * 1000);
+}
+
+uint32_t DG_GetTicksMs()
+{
+    struct timeval  tp;
+    struct timezone tzp;
+
+    gettimeofday(&tp, &tzp);
+
+    return (tp.tv_sec * 1000) + (tp.tv_usec / 1000); /* return milliseconds */
+}
+
+int DG_GetKey(int* pressed, unsigned char* doomKey)
+{
+    return 0;
+}
+
+void DG_SetWindowTitle(const char * title)
+{
+}
+
+int main(int argc, char **argv)
+{
+    doomgeneric_Create(argc, argv);
+
+    while(1)
+    {
+      doomgeneric_Tick();
+    }
+
+    return 0;
+}
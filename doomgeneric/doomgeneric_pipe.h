@@ -0,0 +1,65 @@
+//doomgeneric frame streaming: shared memory ring layout
+//
+// doomgeneric_pipe.c can publish its frames in a POSIX shared memory
+// object (-pipeshm /name) instead of writing them to a file.  The object
+// starts with a dg_pipe_header_t, followed by `slots` frames of
+// `frame_size` bytes each, the first at `frame_offset`.  A frame is
+// height rows of `stride` bytes; the pixels are 32 bit 0xXXRRGGBB.
+//
+// Frame n lives in slot n % slots.  Frames [read_seq, write_seq) are
+// ready for the consumer, which reads them in order and then advances
+// read_seq.  Use __atomic_load_n/__atomic_store_n with acquire/release
+// ordering (or equivalent) on the sequence counters:
+//
+//   uint64_t r = __atomic_load_n(&h->read_seq, __ATOMIC_ACQUIRE);
+//
+//   if (r < __atomic_load_n(&h->write_seq, __ATOMIC_ACQUIRE))
+//   {
+//       use((char *) h + h->frame_offset + (r % h->slots) * h->frame_size);
+//       __atomic_store_n(&h->read_seq, r + 1, __ATOMIC_RELEASE);
+//   }
+//
+// A consumer that only wants the newest frame may jump read_seq forward
+// to write_seq - 1 first.  The game never writes to a slot that the
+// consumer has not released; it drops frames instead (see `dropped`).
+//
+// The sound goes to a dg_audioring_t (doomgeneric.h) at `audio_offset`,
+// as the mixer of i_mixsound.c makes it.  Its `rate` stays 0 if the game
+// was built without that mixer.  Interleaved 16 bit stereo frames
+// [read, write) are ready, at index n % DG_AUDIO_FRAMES; the consumer
+// advances `read` in the same way as read_seq:
+//
+//   dg_audioring_t *a = (dg_audioring_t *) ((char *) h + h->audio_offset);
+//   int16_t pcm[1024 * 2];
+//   int n = doomgeneric_ReadAudio(a, pcm, 1024);
+//
+// doomgeneric_ReadAudio (doomgeneric.c) only touches the ring, so a
+// consumer can copy it.  Sound that is not taken in time is lost and
+// counted in the ring's `dropped`.
+//
+
+#ifndef DOOMGENERIC_PIPE_H
+#define DOOMGENERIC_PIPE_H
+
+#include <stdint.h>
+
+#define DG_PIPE_MAGIC "DGPIPE1"
+
+typedef struct
+{
+    char magic[8];              // DG_PIPE_MAGIC, set last at startup
+    uint32_t width;             // pixels
+    uint32_t height;
+    uint32_t stride;            // bytes per row
+    uint32_t slots;             // frames in the ring
+    uint32_t frame_offset;      // of slot 0, from the start of the header
+    uint32_t frame_size;        // bytes from one slot to the next
+    uint32_t fps;               // nominal frame rate
+    uint32_t audio_offset;      // of the dg_audioring_t
+
+    uint64_t write_seq;         // frames published by the game
+    uint64_t read_seq;          // frames released by the consumer
+    uint64_t dropped;           // frames not published as the ring was full
+} dg_pipe_header_t;
+
+#endif
@@ -0,0 +1,392 @@
+//doomgeneric for programmatic control through shared memory
+//
+// Nothing is displayed and there is no keyboard.  Instead another
+// process, the controller, plays the game through a POSIX shared memory
+// object:
+//
+//   doomgeneric -shm /doom -warp 1 1 -skill 3
+//
+// Every step the game publishes the frame and a state vector (the
+// player's health, ammo, position, and the things it can see), then
+// waits for the controller to hand it a ticcmd to run.  The frame is
+// drawn straight into shared memory.  See doomgeneric_shm.h for the
+// layout and protocol.
+
+#include "doomkeys.h"
+#include "m_argv.h"
+#include "doomgeneric.h"
+#include "doomgeneric_shm.h"
+#include "i_sound.h"
+#include "i_system.h"
+
+#include "d_player.h"
+#include "doomstat.h"
+#include "p_local.h"
+#include "r_main.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#ifdef CMAP256
+#error doomgeneric_shm.c needs 32 bit pixels
+#endif
+
+#define FRAME_STRIDE (DOOMGENERIC_RESX * 4)
+#define FRAME_SIZE (FRAME_STRIDE * DOOMGENERIC_RESY)
+
+// Polls of cmd_seq before each sched_yield while waiting.
+#define SPIN_COUNT 4096
+
+static dg_shm_header_t *s_Shm = NULL;
+static size_t s_ShmSize;
+static char *s_ShmName = "/doomgeneric";
+
+static uint64_t LoadSeq(uint64_t *seq)
+{
+    return __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+}
+
+static void StoreSeq(uint64_t *seq, uint64_t value)
+{
+    __atomic_store_n(seq, value, __ATOMIC_RELEASE);
+}
+
+static void CloseShm(void)
+{
+    __atomic_store_n(&s_Shm->running, 0, __ATOMIC_RELEASE);
+    shm_unlink(s_ShmName);
+}
+
+//
+// The state vector
+//
+
+// Add mo to the list, which is kept sorted nearest first.  When it is
+// full, the farthest thing makes way.
+
+static void AddMobj(dg_shm_state_t *state, mobj_t *mo, fixed_t distance)
+{
+    dg_shm_mobj_t *m;
+    int i;
+
+    i = state->num_mobjs;
+
+    if (i == DG_SHM_MAX_MOBJS)
+    {
+        if (distance >= state->mobjs[i - 1].distance)
+        {
+            return;
+        }
+
+        --i;
+    }
+    else
+    {
+        ++state->num_mobjs;
+    }
+
+    for (; i > 0 && state->mobjs[i - 1].distance > distance; --i)
+    {
+        state->mobjs[i] = state->mobjs[i - 1];
+    }
+
+    m = &state->mobjs[i];
+    m->type = mo->type;
+    m->health = mo->health;
+    m->flags = mo->flags;
+    m->angle = mo->angle;
+    m->x = mo->x;
+    m->y = mo->y;
+    m->z = mo->z;
+    m->momx = mo->momx;
+    m->momy = mo->momy;
+    m->momz = mo->momz;
+    m->distance = distance;
+}
+
+// Things within the 90 degree field of view that the player has a line
+// of sight to.
+
+static void FindVisibleMobjs(dg_shm_state_t *state, mobj_t *pmo)
+{
+    thinker_t *th;
+    mobj_t *mo;
+    angle_t an;
+
+    state->num_mobjs = 0;
+
+    for (th = thinkercap.next; th != &thinkercap; th = th->next)
+    {
+        if (th->function.acp1 != (actionf_p1) P_MobjThinker)
+        {
+            continue;
+        }
+
+        mo = (mobj_t *) th;
+
+        if (mo == pmo || (mo->flags & MF_NOSECTOR) != 0)
+        {
+            continue;
+        }
+
+        an = R_PointToAngle2(pmo->x, pmo->y, mo->x, mo->y) - pmo->angle;
+
+        if (an > ANG45 && an < (angle_t) -ANG45)
+        {
+            continue;
+        }
+
+        if (!P_CheckSight(pmo, mo))
+        {
+            continue;
+        }
+
+        AddMobj(state, mo, P_AproxDistance(mo->x - pmo->x, mo->y - pmo->y));
+    }
+}
+
+static void UpdateState(void)
+{
+    dg_shm_state_t *state = &s_Shm->state;
+    player_t *player = &players[consoleplayer];
+    mobj_t *pmo = player->mo;
+    int i;
+
+    state->gametic = gametic;
+    state->gamestate = gamestate;
+    state->episode = gameepisode;
+    state->map = gamemap;
+
+    state->playerstate = player->playerstate;
+    state->health = player->health;
+    state->armorpoints = player->armorpoints;
+    state->armortype = player->armortype;
+    state->readyweapon = player->readyweapon;
+
+    for (i = 0; i < NUMAMMO; ++i)
+    {
+        state->ammo[i] = player->ammo[i];
+        state->maxammo[i] = player->maxammo[i];
+    }
+
+    for (i = 0; i < NUMWEAPONS; ++i)
+    {
+        state->weaponowned[i] = player->weaponowned[i];
+    }
+
+    for (i = 0; i < NUMCARDS; ++i)
+    {
+        state->cards[i] = player->cards[i];
+    }
+
+    for (i = 0; i < NUMPOWERS; ++i)
+    {
+        state->powers[i] = player->powers[i];
+    }
+
+    state->killcount = player->killcount;
+    state->itemcount = player->itemcount;
+    state->secretcount = player->secretcount;
+    state->totalkills = totalkills;
+    state->totalitems = totalitems;
+    state->totalsecret = totalsecret;
+    state->damagecount = player->damagecount;
+    state->bonuscount = player->bonuscount;
+
+    if (gamestate == GS_LEVEL && pmo != NULL)
+    {
+        state->x = pmo->x;
+        state->y = pmo->y;
+        state->z = pmo->z;
+        state->viewz = player->viewz;
+        state->momx = pmo->momx;
+        state->momy = pmo->momy;
+        state->momz = pmo->momz;
+        state->angle = pmo->angle;
+
+        FindVisibleMobjs(state, pmo);
+    }
+    else
+    {
+        state->num_mobjs = 0;
+    }
+}
+
+//
+// Talking to the controller
+//
+
+static void Publish(void)
+{
+    UpdateState();
+    StoreSeq(&s_Shm->obs_seq, s_Shm->obs_seq + 1);
+}
+
+// Spin until the controller has answered the last observation.
+
+static void WaitForCommand(void)
+{
+    uint64_t seq = s_Shm->obs_seq;
+    int i;
+
+    while (1)
+    {
+        for (i = 0; i < SPIN_COUNT; ++i)
+        {
+            if (LoadSeq(&s_Shm->cmd_seq) == seq
+             || __atomic_load_n(&s_Shm->quit, __ATOMIC_ACQUIRE))
+            {
+                return;
+            }
+        }
+
+        sched_yield();
+    }
+}
+
+static void RunCommand(void)
+{
+    ticcmd_t cmd;
+    int tics, i;
+
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.forwardmove = s_Shm->cmd.forwardmove;
+    cmd.sidemove = s_Shm->cmd.sidemove;
+    cmd.angleturn = s_Shm->cmd.angleturn;
+    cmd.buttons = s_Shm->cmd.buttons;
+
+    tics = s_Shm->tics > 0 ? s_Shm->tics : 1;
+
+    for (i = 0; i < tics; ++i)
+    {
+        doomgeneric_Step(&cmd, 1);
+    }
+
+    if (s_Shm->render)
+    {
+        doomgeneric_Render();
+    }
+}
+
+void DG_Init()
+{
+    dg_shm_header_t header;
+    long page = sysconf(_SC_PAGESIZE);
+    int fd;
+    int i;
+
+    //!
+    // @arg <name>
+    // @platform shm
+    //
+    // Name of the POSIX shared memory object to create (default
+    // /doomgeneric).
+    //
+
+    i = M_CheckParmWithArgs("-shm", 1);
+
+    if (i > 0)
+    {
+        s_ShmName = myargv[i + 1];
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.width = DOOMGENERIC_RESX;
+    header.height = DOOMGENERIC_RESY;
+    header.stride = FRAME_STRIDE;
+    header.frame_offset = (sizeof(header) + page - 1) / page * page;
+    header.running = 1;
+    header.audio_offset = header.frame_offset + FRAME_SIZE;
+
+    s_ShmSize = header.audio_offset + sizeof(dg_audioring_t);
+
+    // Start from a fresh object so that no controller sees stale data.
+    shm_unlink(s_ShmName);
+    fd = shm_open(s_ShmName, O_RDWR | O_CREAT | O_EXCL, 0600);
+
+    if (fd < 0 || ftruncate(fd, s_ShmSize) < 0)
+    {
+        I_Error("DG_Init: can't create %s: %s", s_ShmName, strerror(errno));
+    }
+
+    s_Shm = mmap(NULL, s_ShmSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (s_Shm == MAP_FAILED)
+    {
+        I_Error("DG_Init: can't map %s", s_ShmName);
+    }
+
+    I_AtExit(CloseShm, true);
+
+    memcpy(s_Shm, &header, sizeof(header));
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(s_Shm->magic, DG_SHM_MAGIC, sizeof(s_Shm->magic));
+
+    DG_ScreenBuffer = (pixel_t *) ((char *) s_Shm + s_Shm->frame_offset);
+
+    // The game only moves when told to, and so does the sound.
+    DG_AudioRing = (dg_audioring_t *) ((char *) s_Shm + s_Shm->audio_offset);
+    snd_ticsync = true;
+}
+
+void DG_DrawFrame()
+{
+    // The frame is already in shared memory; it is published along with
+    // the state once the step is over.
+}
+
+void DG_SleepMs(uint32_t ms)
+{
+    usleep (ms * 1000);
+}
+
+uint32_t DG_GetTicksMs()
+{
+    struct timeval  tp;
+    struct timezone tzp;
+
+    gettimeofday(&tp, &tzp);
+
+    return (tp.tv_sec * 1000) + (tp.tv_usec / 1000); /* return milliseconds */
+}
+
+int DG_GetKey(int* pressed, unsigned char* doomKey)
+{
+    return 0;
+}
+
+void DG_SetWindowTitle(const char * title)
+{
+}
+
+int main(int argc, char **argv)
+{
+    doomgeneric_Create(argc, argv);
+
+    doomgeneric_Render();
+    Publish();
+
+    while (1)
+    {
+        WaitForCommand();
+
+        if (__atomic_load_n(&s_Shm->quit, __ATOMIC_ACQUIRE))
+        {
+            I_Quit();
+        }
+
+        RunCommand();
+        Publish();
+    }
+
+    return 0;
+}
@@ -0,0 +1,127 @@
+//doomgeneric programmatic control: shared memory layout
+//
+// doomgeneric_shm.c runs the game in lockstep with a controller in
+// another process, through a POSIX shared memory object (-shm /name).
+// The object starts with a dg_shm_header_t; the frame the game drew
+// last is at `frame_offset`, height rows of `stride` bytes of 32 bit
+// 0xXXRRGGBB pixels.
+//
+// The game publishes an observation (frame and `state`) and increments
+// obs_seq.  The controller reads it, fills in `cmd`, `tics` and `render`
+// and then sets cmd_seq to obs_seq.  The game runs the command for `tics`
+// tics, draws a frame if `render` is set, and publishes the next
+// observation.  Use __atomic_load_n/__atomic_store_n with acquire/release
+// ordering (or equivalent) on the sequence counters:
+//
+//   while (__atomic_load_n(&h->obs_seq, __ATOMIC_ACQUIRE) == seen)
+//       ;
+//   seen = h->obs_seq;
+//   decide(&h->state, (char *) h + h->frame_offset, &h->cmd);
+//   h->tics = 4;
+//   h->render = 1;
+//   __atomic_store_n(&h->cmd_seq, seen, __ATOMIC_RELEASE);
+//
+// Both sides only spin, so a round trip takes microseconds.  `running`
+// is cleared when the game exits; set `quit` to make it exit.
+//
+// When the game is built with the mixer of i_mixsound.c, the sound of
+// the tics a command ran is in the dg_audioring_t (doomgeneric.h) at
+// `audio_offset` by the time of the next observation: rate / 35 frames
+// a tic, the same every time the same commands are run.  Take it with
+// doomgeneric_ReadAudio (or a copy of it) before sending the next
+// command, or it may be dropped.  Its `rate` stays 0 without the mixer.
+//
+// Positions and momentums are fixed point 16.16 map units, angles are
+// binary angles (0x40000000 is 90 degrees, counterclockwise from east).
+//
+
+#ifndef DOOMGENERIC_SHM_H
+#define DOOMGENERIC_SHM_H
+
+#include <stdint.h>
+
+#define DG_SHM_MAGIC "DGSHM01"
+
+#define DG_SHM_MAX_MOBJS 128
+
+// A ticcmd_t (d_ticcmd.h) without the fields that only matter in net
+// games and the other games of the engine.
+
+typedef struct
+{
+    int8_t forwardmove;         // *2048 for move
+    int8_t sidemove;            // *2048 for move
+    int16_t angleturn;          // <<16 for angle delta
+    uint8_t buttons;            // BT_* in d_event.h
+    uint8_t pad[3];
+} dg_shm_ticcmd_t;
+
+// A thing in sight of the player, in front of it.
+
+typedef struct
+{
+    int32_t type;               // mobjtype_t in info.h
+    int32_t health;
+    uint32_t flags;             // MF_* in p_mobj.h
+    uint32_t angle;
+    int32_t x, y, z;
+    int32_t momx, momy, momz;
+    int32_t distance;           // approximate, in the map plane
+} dg_shm_mobj_t;
+
+typedef struct
+{
+    int32_t gametic;
+    int32_t gamestate;          // gamestate_t in doomdef.h
+    int32_t episode;
+    int32_t map;
+
+    int32_t playerstate;        // playerstate_t in d_player.h
+    int32_t health;
+    int32_t armorpoints;
+    int32_t armortype;
+    int32_t readyweapon;        // weapontype_t in doomdef.h
+    int32_t ammo[4];            // per ammotype_t
+    int32_t maxammo[4];
+    int32_t weaponowned[9];
+    int32_t cards[6];
+    int32_t powers[6];          // tics left per powertype_t
+    int32_t killcount, itemcount, secretcount;
+    int32_t totalkills, totalitems, totalsecret;
+    int32_t damagecount;        // red screen
+    int32_t bonuscount;         // gold screen
+
+    int32_t x, y, z;
+    int32_t viewz;
+    int32_t momx, momy, momz;
+    uint32_t angle;
+
+    int32_t num_mobjs;          // nearest first
+    dg_shm_mobj_t mobjs[DG_SHM_MAX_MOBJS];
+} dg_shm_state_t;
+
+typedef struct
+{
+    char magic[8];              // DG_SHM_MAGIC, set last at startup
+    uint32_t width;             // pixels
+    uint32_t height;
+    uint32_t stride;            // bytes per row
+    uint32_t frame_offset;      // from the start of the header
+    uint32_t running;
+    uint32_t audio_offset;      // of the dg_audioring_t
+
+    // Written by the game
+
+    uint64_t obs_seq;
+    dg_shm_state_t state;
+
+    // Written by the controller
+
+    uint64_t cmd_seq;
+    dg_shm_ticcmd_t cmd;
+    uint32_t tics;              // to run cmd for; 0 is taken as 1
+    uint32_t render;            // draw a frame after them
+    uint32_t quit;
+} dg_shm_header_t;
+
+#endif
@@ -3,6 +3,7 @@
 #include "doomgeneric.h"
 
 #include <ctype.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
@@ -19,11 +20,14 @@ static int s_Screen = 0;
 static GC s_Gc = 0;
 static XImage *s_Image = NULL;
 
-#define KEYQUEUE_SIZE 16
+// Keys are read by a thread of their own, over a second connection to
+// the server, as soon as they arrive.  They only pass through the queue
+// on that thread: the game's thread takes them out in DG_GetKey and posts
+// them as events itself.  If the thread can't be started, keys are read
+// when a frame is drawn.
 
-static unsigned short s_KeyQueue[KEYQUEUE_SIZE];
-static unsigned int s_KeyQueueWriteIndex = 0;
-static unsigned int s_KeyQueueReadIndex = 0;
+static dg_keyqueue_t s_KeyQueue;
+static Display *s_InputDisplay = NULL;
 
 static unsigned char convertToDoomKey(unsigned int key)
 {
@@ -70,16 +74,67 @@ static void addKeyToQueue(int pressed, unsigned int keyCode)
 {
 	unsigned char key = convertToDoomKey(keyCode);
 
-	unsigned short keyData = (pressed << 8) | key;
+	if (!doomgeneric_PushKey(&s_KeyQueue, pressed, key) && s_KeyQueue.dropped == 1)
+	{
+		printf("DG_GetKey: key queue full, dropping keys\n");
+	}
+}
+
+static void handleKeyEvent(Display *display, XEvent *e)
+{
+    if (e->type == KeyPress || e->type == KeyRelease)
+    {
+        KeySym sym = XkbKeycodeToKeysym(display, e->xkey.keycode, 0, 0);
+
+        addKeyToQueue(e->type == KeyPress, sym);
+    }
+}
+
+static void *inputThread(void *arg)
+{
+    XEvent e;
+
+    while (1)
+    {
+        XNextEvent(s_InputDisplay, &e);
+        handleKeyEvent(s_InputDisplay, &e);
+    }
+
+    return NULL;
+}
+
+static void startInputThread()
+{
+    pthread_t thread;
 
-	s_KeyQueue[s_KeyQueueWriteIndex] = keyData;
-	s_KeyQueueWriteIndex++;
-	s_KeyQueueWriteIndex %= KEYQUEUE_SIZE;
+    s_InputDisplay = XOpenDisplay(NULL);
+
+    if (s_InputDisplay == NULL)
+    {
+        return;
+    }
+
+    XSelectInput(s_InputDisplay, s_Window, KeyPressMask | KeyReleaseMask);
+    XkbSetDetectableAutoRepeat(s_InputDisplay, 1, 0);
+    XFlush(s_InputDisplay);
+
+    if (pthread_create(&thread, NULL, inputThread, NULL) != 0)
+    {
+        XCloseDisplay(s_InputDisplay);
+        s_InputDisplay = NULL;
+        return;
+    }
+
+    pthread_detach(thread);
+
+    // Keys no longer need to go to the drawing connection.
+
+    XSelectInput(s_Display, s_Window, StructureNotifyMask);
 }
 
 void DG_Init()
 {
-	memset(s_KeyQueue, 0, KEYQUEUE_SIZE * sizeof(unsigned short));
+	memset(&s_KeyQueue, 0, sizeof(s_KeyQueue));
 
     // window creation
 
@@ -122,6 +177,8 @@ void DG_Init()
     }
 
     s_Image = XCreateImage(s_Display, DefaultVisual(s_Display, s_Screen), depth, ZPixmap, 0, (char *)DG_ScreenBuffer, DOOMGENERIC_RESX, DOOMGENERIC_RESX, 32, 0);
+
+    startInputThread();
 }
 
 
@@ -133,19 +190,7 @@ void DG_DrawFrame()
         {
             XEvent e;
             XNextEvent(s_Display, &e);
-            if (e.type == KeyPress)
-            {
-                KeySym sym = XkbKeycodeToKeysym(s_Display, e.xkey.keycode, 0, 0);
-                //printf("KeyPress:%d sym:%d\n", e.xkey.keycode, sym);
-
-                addKeyToQueue(1, sym);
-            }
-            else if (e.type == KeyRelease)
-            {
-                KeySym sym = XkbKeycodeToKeysym(s_Display, e.xkey.keycode, 0, 0);
-                //printf("KeyRelease:%d sym:%d\n", e.xkey.keycode, sym);
-                addKeyToQueue(0, sym);
-            }
+            handleKeyEvent(s_Display, &e);
         }
 
         XPutImage(s_Display, s_Window, s_Gc, s_Image, 0, 0, 0, 0, DOOMGENERIC_RESX, DOOMGENERIC_RESY);
@@ -173,23 +218,7 @@ uint32_t DG_GetTicksMs()
 
 int DG_GetKey(int* pressed, unsigned char* doomKey)
 {
-	if (s_KeyQueueReadIndex == s_KeyQueueWriteIndex)
-	{
-		//key queue is empty
-
-		return 0;
-	}
-	else
-	{
-		unsigned short keyData = s_KeyQueue[s_KeyQueueReadIndex];
-		s_KeyQueueReadIndex++;
-		s_KeyQueueReadIndex %= KEYQUEUE_SIZE;
-
-		*pressed = keyData >> 8;
-		*doomKey = keyData & 0xFF;
-
-		return 1;
-	}
+	return doomgeneric_PopKey(&s_KeyQueue, pressed, doomKey);
 }
 
 void DG_SetWindowTitle(const char * title)
@@ -22,13 +22,13 @@
 
 
 // Game Mode - identify IWAD as shareware, retail etc.
-GameMode_t gamemode = indetermined;
-GameMission_t	gamemission = doom;
-GameVersion_t   gameversion = exe_final2;
-char *gamedescription;
+THREADLOCAL GameMode_t gamemode = indetermined;
+THREADLOCAL GameMission_t	gamemission = doom;
+THREADLOCAL GameVersion_t   gameversion = exe_final2;
+THREADLOCAL char *gamedescription;
 
 // Set if homebrew PWAD stuff has been added.
-boolean	modifiedgame;
+THREADLOCAL boolean	modifiedgame;
 
 
 
@@ -43,23 +43,23 @@
 // ------------------------
 // Command line parameters.
 //
-extern  boolean	nomonsters;	// checkparm of -nomonsters
-extern  boolean	respawnparm;	// checkparm of -respawn
-extern  boolean	fastparm;	// checkparm of -fast
+extern THREADLOCAL boolean	nomonsters;	// checkparm of -nomonsters
+extern THREADLOCAL boolean	respawnparm;	// checkparm of -respawn
+extern THREADLOCAL boolean	fastparm;	// checkparm of -fast
 
-extern  boolean	devparm;	// DEBUG: launched with -devparm
+extern THREADLOCAL boolean	devparm;	// DEBUG: launched with -devparm
 
 
 // -----------------------------------------------------
 // Game Mode - identify IWAD as shareware, retail etc.
 //
-extern GameMode_t	gamemode;
-extern GameMission_t	gamemission;
-extern GameVersion_t    gameversion;
-extern char            *gamedescription;
+extern THREADLOCAL GameMode_t	gamemode;
+extern THREADLOCAL GameMission_t	gamemission;
+extern THREADLOCAL GameVersion_t    gameversion;
+extern THREADLOCAL char            *gamedescription;
 
 // If true, we're using one of the mangled BFG edition IWADs.
-extern boolean bfgedition;
+extern THREADLOCAL boolean bfgedition;
 
 // Convenience macro.
 // 'gamemission' can be equal to pack_chex or pack_hacx, but these are
@@ -71,7 +71,7 @@ extern boolean bfgedition;
      gamemission == pack_hacx ? doom2 : gamemission)
 
 // Set if homebrew PWAD stuff has been added.
-extern  boolean	modifiedgame;
+extern THREADLOCAL boolean	modifiedgame;
 
 
 // -------------------------------------------
@@ -79,33 +79,33 @@ extern  boolean	modifiedgame;
 //
 
 // Defaults for menu, methinks.
-extern  skill_t		startskill;
-extern  int             startepisode;
-extern	int		startmap;
+extern THREADLOCAL skill_t		startskill;
+extern THREADLOCAL int             startepisode;
+extern THREADLOCAL int		startmap;
 
 // Savegame slot to load on startup.  This is the value provided to
 // the -loadgame option.  If this has not been provided, this is -1.
 
-extern  int             startloadgame;
+extern THREADLOCAL int             startloadgame;
 
-extern  boolean		autostart;
+extern THREADLOCAL boolean		autostart;
 
 // Selected by user. 
-extern  skill_t         gameskill;
-extern  int		gameepisode;
-extern  int		gamemap;
+extern THREADLOCAL skill_t         gameskill;
+extern THREADLOCAL int		gameepisode;
+extern THREADLOCAL int		gamemap;
 
 // If non-zero, exit the level after this number of minutes
-extern  int             timelimit;
+extern THREADLOCAL int             timelimit;
 
 // Nightmare mode flag, single player.
-extern  boolean         respawnmonsters;
+extern THREADLOCAL boolean         respawnmonsters;
 
 // Netgame? Only true if >1 player.
-extern  boolean	netgame;
+extern THREADLOCAL boolean	netgame;
 
 // 0=Cooperative; 1=Deathmatch; 2=Altdeath
-extern int deathmatch;
+extern THREADLOCAL int deathmatch;
 
 // -------------------------
 // Internal parameters for sound rendering.
@@ -117,8 +117,8 @@ extern int deathmatch;
 //  Sound FX volume has default, 0 - 15
 //  Music volume has default, 0 - 15
 // These are multiplied by 8.
-extern int sfxVolume;
-extern int musicVolume;
+extern THREADLOCAL int sfxVolume;
+extern THREADLOCAL int musicVolume;
 
 // Current music/sfx card - index useless
 //  w/o a reference LUT in a sound module.
@@ -140,42 +140,42 @@ extern int snd_DesiredSfxDevice;
 //  status bar explicitely.
 extern  boolean statusbaractive;
 
-extern  boolean automapactive;	// In AutoMap mode?
-extern  boolean	menuactive;	// Menu overlayed?
-extern  boolean	paused;		// Game Pause?
+extern THREADLOCAL boolean automapactive;	// In AutoMap mode?
+extern THREADLOCAL boolean	menuactive;	// Menu overlayed?
+extern THREADLOCAL boolean	paused;		// Game Pause?
 
 
-extern  boolean		viewactive;
+extern THREADLOCAL boolean		viewactive;
 
-extern  boolean		nodrawers;
+extern THREADLOCAL boolean		nodrawers;
 
 
-extern  boolean         testcontrols;
-extern  int             testcontrols_mousespeed;
+extern THREADLOCAL boolean         testcontrols;
+extern THREADLOCAL int             testcontrols_mousespeed;
 
 
 
 
 // This one is related to the 3-screen display mode.
 // ANG90 = left side, ANG270 = right
-extern  int	viewangleoffset;
+extern THREADLOCAL int	viewangleoffset;
 
 // Player taking events, and displaying.
-extern  int	consoleplayer;	
-extern  int	displayplayer;
+extern THREADLOCAL int	consoleplayer;	
+extern THREADLOCAL int	displayplayer;
 
 
 // -------------------------------------
 // Scores, rating.
 // Statistics on a given map, for intermission.
 //
-extern  int	totalkills;
-extern	int	totalitems;
-extern	int	totalsecret;
+extern THREADLOCAL int	totalkills;
+extern THREADLOCAL int	totalitems;
+extern THREADLOCAL int	totalsecret;
 
 // Timer, for scores.
-extern  int	levelstarttic;	// gametic at level start
-extern  int	leveltime;	// tics in game play for par
+extern THREADLOCAL int	levelstarttic;	// gametic at level start
+extern THREADLOCAL int	leveltime;	// tics in game play for par
 
 
 
@@ -183,25 +183,25 @@ extern  int	leveltime;	// tics in game play for par
 // DEMO playback/recording related stuff.
 // No demo, there is a human player in charge?
 // Disable save/end game?
-extern  boolean	usergame;
+extern THREADLOCAL boolean	usergame;
 
 //?
-extern  boolean	demoplayback;
-extern  boolean	demorecording;
+extern THREADLOCAL boolean	demoplayback;
+extern THREADLOCAL boolean	demorecording;
 
 // Round angleturn in ticcmds to the nearest 256.  This is used when
 // recording Vanilla demos in netgames.
 
-extern boolean lowres_turn;
+extern THREADLOCAL boolean lowres_turn;
 
 // Quit after playing a demo from cmdline.
-extern  boolean		singledemo;	
+extern THREADLOCAL boolean		singledemo;	
 
 
 
 
 //?
-extern  gamestate_t     gamestate;
+extern THREADLOCAL gamestate_t     gamestate;
 
 
 
@@ -217,23 +217,23 @@ extern  gamestate_t     gamestate;
 
 
 // Bookkeeping on players - state.
-extern	player_t	players[MAXPLAYERS];
+extern THREADLOCAL player_t	players[MAXPLAYERS];
 
 // Alive? Disconnected?
-extern  boolean		playeringame[MAXPLAYERS];
+extern THREADLOCAL boolean		playeringame[MAXPLAYERS];
 
 
 // Player spawn spots for deathmatch.
 #define MAX_DM_STARTS   10
-extern  mapthing_t      deathmatchstarts[MAX_DM_STARTS];
-extern  mapthing_t*	deathmatch_p;
+extern THREADLOCAL mapthing_t      deathmatchstarts[MAX_DM_STARTS];
+extern THREADLOCAL mapthing_t*	deathmatch_p;
 
 // Player spawn spots.
-extern  mapthing_t      playerstarts[MAXPLAYERS];
+extern THREADLOCAL mapthing_t      playerstarts[MAXPLAYERS];
 
 // Intermission stats.
 // Parameters for world map / intermission.
-extern  wbstartstruct_t		wminfo;	
+extern THREADLOCAL wbstartstruct_t		wminfo;	
 
 
 
@@ -246,36 +246,39 @@ extern  wbstartstruct_t		wminfo;
 //
 
 // File handling stuff.
-extern  char *          savegamedir;
+extern THREADLOCAL char *          savegamedir;
 extern	char		basedefault[1024];
 
 // if true, load all graphics at level load
-extern  boolean         precache;
+extern THREADLOCAL boolean         precache;
 
 
 // wipegamestate can be set to -1
 //  to force a wipe on the next draw
-extern  gamestate_t     wipegamestate;
+extern THREADLOCAL gamestate_t     wipegamestate;
 
-extern  int             mouseSensitivity;
+extern THREADLOCAL int             mouseSensitivity;
 
-extern  int             bodyqueslot;
+#define BODYQUESIZE	32
+
+extern THREADLOCAL mobj_t*         bodyque[BODYQUESIZE];
+extern THREADLOCAL int             bodyqueslot;
 
 
 
 // Needed to store the number of the dummy sky flat.
 // Used for rendering,
 //  as well as tracking projectiles etc.
-extern int		skyflatnum;
+extern THREADLOCAL int		skyflatnum;
 
 
 
 // Netgame stuff (buffers and pointers, i.e. indices).
 
 
-extern	int		rndindex;
+extern THREADLOCAL int		rndindex;
 
-extern  ticcmd_t       *netcmds;
+extern THREADLOCAL ticcmd_t       *netcmds;
 
 
 #endif
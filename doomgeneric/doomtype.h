@@ -52,6 +52,59 @@
 #define PACKEDATTR
 #endif
 
+//
+// Mutable engine state is declared THREADLOCAL.  In a normal build this
+// expands to nothing.  When DOOMGENERIC_REENTRANT is defined every such
+// variable gets one copy per thread, so each thread that creates a
+// doomgeneric instance runs a completely independent game.
+//
+
+#ifdef DOOMGENERIC_REENTRANT
+#if defined(_MSC_VER)
+#define THREADLOCAL __declspec(thread)
+#else
+#define THREADLOCAL __thread
+#endif
+#else
+#define THREADLOCAL
+#endif
+
+//
+// The column and span drawers' state is DRAWLOCAL.  It is also thread
+// local when DOOMGENERIC_RENDER_THREADS is defined, as the drawing can
+// then be handed out to several threads (see r_draw.c).
+//
+
+#if defined(DOOMGENERIC_REENTRANT) || defined(DOOMGENERIC_RENDER_THREADS)
+#if defined(_MSC_VER)
+#define DRAWLOCAL __declspec(thread)
+#else
+#define DRAWLOCAL __thread
+#endif
+#else
+#define DRAWLOCAL
+#endif
+
+//
+// Loads and stores of the indexes of queues that one thread fills while
+// another empties them.  A store makes everything written before it
+// visible to the thread that loads the value.  MSVC gives volatile
+// accesses these semantics on x86.  FETCH_ADD adds to an unsigned int
+// that several threads change at once, and returns the old value.
+//
+
+#if defined(__GNUC__)
+#define LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define FETCH_ADD(p, v) __atomic_fetch_add((p), (v), __ATOMIC_ACQ_REL)
+#else
+#include <intrin.h>
+#define LOAD_ACQUIRE(p) (*(volatile unsigned int *) (p))
+#define STORE_RELEASE(p, v) (*(volatile unsigned int *) (p) = (v))
+#define FETCH_ADD(p, v) \
+    ((unsigned int) _InterlockedExchangeAdd((volatile long *) (p), (v)))
+#endif
+
 // C99 integer types; with gcc we just use this.  Other compilers 
 // should add conditional statements that define the C99 types.
 
@@ -24,9 +24,9 @@
  *  public data                                                        *
  *---------------------------------------------------------------------*/
 
-boolean net_client_connected = false;
+THREADLOCAL boolean net_client_connected = false;
 
-boolean drone = false;
+THREADLOCAL boolean drone = false;
 
 /*---------------------------------------------------------------------*
  *  private data                                                       *
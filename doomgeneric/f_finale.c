@@ -50,9 +50,9 @@ typedef enum
 //#include "f_finale.h"
 
 // Stage of animation:
-finalestage_t finalestage;
+THREADLOCAL finalestage_t finalestage;
 
-unsigned int finalecount;
+THREADLOCAL unsigned int finalecount;
 
 #define	TEXTSPEED	3
 #define	TEXTWAIT	250
@@ -65,7 +65,7 @@ typedef struct
     char *text;
 } textscreen_t;
 
-static textscreen_t textscreens[] =
+static THREADLOCAL textscreen_t textscreens[] =
 {
     { doom,      1, 8,  "FLOOR4_8",  E1TEXT},
     { doom,      2, 8,  "SFLR6_1",   E2TEXT},
@@ -94,8 +94,8 @@ static textscreen_t textscreens[] =
     { pack_plut, 1, 31, "RROCK19",   P6TEXT},
 };
 
-char*	finaletext;
-char*	finaleflat;
+THREADLOCAL char*	finaletext;
+THREADLOCAL char*	finaleflat;
 
 void	F_StartCast (void);
 void	F_CastTicker (void);
@@ -221,7 +221,7 @@ void F_Ticker (void)
 //
 
 #include "hu_stuff.h"
-extern	patch_t *hu_font[HU_FONTSIZE];
+extern THREADLOCAL patch_t *hu_font[HU_FONTSIZE];
 
 
 void F_TextWrite (void)
@@ -242,15 +242,9 @@ void F_TextWrite (void)
 	
     for (y=0 ; y<SCREENHEIGHT ; y++)
     {
-	for (x=0 ; x<SCREENWIDTH/64 ; x++)
+	for (x=0 ; x<SCREENWIDTH ; x++)
 	{
-	    memcpy (dest, src+((y&63)<<6), 64);
-	    dest += 64;
-	}
-	if (SCREENWIDTH&63)
-	{
-	    memcpy (dest, src+((y&63)<<6), SCREENWIDTH&63);
-	    dest += (SCREENWIDTH&63);
+	    *dest++ = src[(((y/SCREENSCALE)&63)<<6) + ((x/SCREENSCALE)&63)];
 	}
     }
 
@@ -284,7 +278,7 @@ void F_TextWrite (void)
 	}
 		
 	w = SHORT (hu_font[c]->width);
-	if (cx+w > SCREENWIDTH)
+	if (cx+w > ORIGWIDTH)
 	    break;
 	V_DrawPatch(cx, cy, hu_font[c]);
 	cx+=w;
@@ -303,7 +297,7 @@ typedef struct
     mobjtype_t	type;
 } castinfo_t;
 
-castinfo_t	castorder[] = {
+THREADLOCAL castinfo_t	castorder[] = {
     {CC_ZOMBIE, MT_POSSESSED},
     {CC_SHOTGUN, MT_SHOTGUY},
     {CC_HEAVY, MT_CHAINGUY},
@@ -325,13 +319,13 @@ castinfo_t	castorder[] = {
     {NULL,0}
 };
 
-int		castnum;
-int		casttics;
-state_t*	caststate;
-boolean		castdeath;
-int		castframes;
-int		castonmelee;
-boolean		castattacking;
+THREADLOCAL int		castnum;
+THREADLOCAL int		casttics;
+THREADLOCAL state_t*	caststate;
+THREADLOCAL boolean		castdeath;
+THREADLOCAL int		castframes;
+THREADLOCAL int		castonmelee;
+THREADLOCAL boolean		castattacking;
 
 
 //
@@ -567,6 +561,7 @@ void F_CastDrawer (void)
 
 //
 // F_DrawPatchCol
+// x is in original screen coordinates.
 //
 void
 F_DrawPatchCol
@@ -579,20 +574,22 @@ F_DrawPatchCol
     byte*	dest;
     byte*	desttop;
     int		count;
+    int		i, j;
 	
     column = (column_t *)((byte *)patch + LONG(patch->columnofs[col]));
-    desttop = I_VideoBuffer + x;
+    desttop = I_VideoBuffer + x*SCREENSCALE;
 
     // step through the posts in a column
     while (column->topdelta != 0xff )
     {
 	source = (byte *)column + 3;
-	dest = desttop + column->topdelta*SCREENWIDTH;
-	count = column->length;
+	dest = desttop + column->topdelta*SCREENWIDTH*SCREENSCALE;
+	count = column->length*SCREENSCALE;
 		
-	while (count--)
+	for (i=0 ; i<count ; i++)
 	{
-	    *dest = *source++;
+	    for (j=0 ; j<SCREENSCALE ; j++)
+		dest[j] = source[i/SCREENSCALE];
 	    dest += SCREENWIDTH;
 	}
 	column = (column_t *)(  (byte *)column + column->length + 4 );
@@ -611,7 +608,7 @@ void F_BunnyScroll (void)
     patch_t*	p2;
     char	name[10];
     int		stage;
-    static int	laststage;
+    static THREADLOCAL int	laststage;
 		
     p1 = W_CacheLumpName (DEH_String("PFUB2"), PU_LEVEL);
     p2 = W_CacheLumpName (DEH_String("PFUB1"), PU_LEVEL);
@@ -624,7 +621,7 @@ void F_BunnyScroll (void)
     if (scrolled < 0)
 	scrolled = 0;
 		
-    for ( x=0 ; x<SCREENWIDTH ; x++)
+    for ( x=0 ; x<ORIGWIDTH ; x++)
     {
 	if (x+scrolled < 320)
 	    F_DrawPatchCol (x, p1, x+scrolled);
@@ -636,8 +633,8 @@ void F_BunnyScroll (void)
 	return;
     if (finalecount < 1180)
     {
-        V_DrawPatch((SCREENWIDTH - 13 * 8) / 2,
-                    (SCREENHEIGHT - 8 * 8) / 2, 
+        V_DrawPatch((ORIGWIDTH - 13 * 8) / 2,
+                    (ORIGHEIGHT - 8 * 8) / 2, 
                     W_CacheLumpName(DEH_String("END0"), PU_CACHE));
 	laststage = 0;
 	return;
@@ -653,8 +650,8 @@ void F_BunnyScroll (void)
     }
 	
     DEH_snprintf(name, 10, "END%i", stage);
-    V_DrawPatch((SCREENWIDTH - 13 * 8) / 2, 
-                (SCREENHEIGHT - 8 * 8) / 2, 
+    V_DrawPatch((ORIGWIDTH - 13 * 8) / 2, 
+                (ORIGHEIGHT - 8 * 8) / 2, 
                 W_CacheLumpName (name,PU_CACHE));
 }
 
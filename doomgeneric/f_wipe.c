@@ -32,11 +32,11 @@
 //
 
 // when zero, stop the wipe
-static boolean	go = 0;
+static THREADLOCAL boolean	go = 0;
 
-static byte*	wipe_scr_start;
-static byte*	wipe_scr_end;
-static byte*	wipe_scr;
+static THREADLOCAL byte*	wipe_scr_start;
+static THREADLOCAL byte*	wipe_scr_end;
+static THREADLOCAL byte*	wipe_scr;
 
 
 void
@@ -127,7 +127,7 @@ wipe_exitColorXForm
 }
 
 
-static int*	y;
+static THREADLOCAL int*	y;
 
 int
 wipe_initMelt
@@ -168,8 +168,12 @@ wipe_doMelt
 {
     int		i;
     int		j;
+    int		k;
     int		dy;
     int		idx;
+    int		col;
+    int		top;
+    int		origheight;
     
     short*	s;
     short*	d;
@@ -177,35 +181,45 @@ wipe_doMelt
 
     width/=2;
 
+    // The columns move in rows of the original screen, and each of
+    // them is SCREENSCALE columns of pixel pairs wide.
+    origheight = height/SCREENSCALE;
+
     while (ticks--)
     {
-	for (i=0;i<width;i++)
+	for (i=0;i<width/SCREENSCALE;i++)
 	{
 	    if (y[i]<0)
 	    {
 		y[i]++; done = false;
 	    }
-	    else if (y[i] < height)
+	    else if (y[i] < origheight)
 	    {
 		dy = (y[i] < 16) ? y[i]+1 : 8;
-		if (y[i]+dy >= height) dy = height - y[i];
-		s = &((short *)wipe_scr_end)[i*height+y[i]];
-		d = &((short *)wipe_scr)[y[i]*width+i];
-		idx = 0;
-		for (j=dy;j;j--)
+		if (y[i]+dy >= origheight) dy = origheight - y[i];
+		for (k=0;k<SCREENSCALE;k++)
 		{
-		    d[idx] = *(s++);
-		    idx += width;
+		    col = i*SCREENSCALE+k;
+		    top = y[i]*SCREENSCALE;
+		    s = &((short *)wipe_scr_end)[col*height+top];
+		    d = &((short *)wipe_scr)[top*width+col];
+		    idx = 0;
+		    for (j=dy*SCREENSCALE;j;j--)
+		    {
+			d[idx] = *(s++);
+			idx += width;
+		    }
+		    top += dy*SCREENSCALE;
+		    s = &((short *)wipe_scr_start)[col*height];
+		    d = &((short *)wipe_scr)[top*width+col];
+		    idx = 0;
+		    for (j=height-top;j;j--)
+		    {
+			d[idx] = *(s++);
+			idx += width;
+		    }
 		}
 		y[i] += dy;
-		s = &((short *)wipe_scr_start)[i*height];
-		d = &((short *)wipe_scr)[y[i]*width+i];
-		idx = 0;
-		for (j=height-y[i];j;j--)
-		{
-		    d[idx] = *(s++);
-		    idx += width;
-		}
 		done = false;
 	    }
 	}
@@ -262,7 +276,7 @@ wipe_ScreenWipe
   int	ticks )
 {
     int rc;
-    static int (*wipes[])(int, int, int) =
+    static THREADLOCAL int (*wipes[])(int, int, int) =
     {
 	wipe_initColorXForm, wipe_doColorXForm, wipe_exitColorXForm,
 	wipe_initMelt, wipe_doMelt, wipe_exitMelt
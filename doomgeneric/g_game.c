@@ -31,6 +31,7 @@
 #include "z_zone.h"
 #include "f_finale.h"
 #include "m_argv.h"
+#include "m_bench.h"
 #include "m_controls.h"
 #include "m_misc.h"
 #include "m_menu.h"
@@ -91,86 +92,75 @@ void	G_DoSaveGame (void);
  
 // Gamestate the last time G_Ticker was called.
 
-gamestate_t     oldgamestate; 
+THREADLOCAL gamestate_t     oldgamestate; 
  
-gameaction_t    gameaction; 
-gamestate_t     gamestate; 
-skill_t         gameskill; 
-boolean		respawnmonsters;
-int             gameepisode; 
-int             gamemap; 
+THREADLOCAL gameaction_t    gameaction; 
+THREADLOCAL gamestate_t     gamestate; 
+THREADLOCAL skill_t         gameskill; 
+THREADLOCAL boolean		respawnmonsters;
+THREADLOCAL int             gameepisode; 
+THREADLOCAL int             gamemap; 
 
 // If non-zero, exit the level after this number of minutes.
 
-int             timelimit;
+THREADLOCAL int             timelimit;
 
-boolean         paused; 
-boolean         sendpause;             	// send a pause event next tic 
-boolean         sendsave;             	// send a save event next tic 
-boolean         usergame;               // ok to save / end game 
+THREADLOCAL boolean         paused; 
+THREADLOCAL boolean         sendpause;             	// send a pause event next tic 
+THREADLOCAL boolean         sendsave;             	// send a save event next tic 
+THREADLOCAL boolean         usergame;               // ok to save / end game 
  
-boolean         timingdemo;             // if true, exit with report on completion 
-boolean         nodrawers;              // for comparative timing purposes 
-int             starttime;          	// for comparative timing purposes  	 
+THREADLOCAL boolean         timingdemo;             // if true, exit with report on completion 
+THREADLOCAL boolean         nodrawers;              // for comparative timing purposes 
+THREADLOCAL int             starttime;          	// for comparative timing purposes  	 
  
-boolean         viewactive; 
+THREADLOCAL boolean         viewactive; 
  
-int             deathmatch;           	// only if started as net death 
-boolean         netgame;                // only true if packets are broadcast 
-boolean         playeringame[MAXPLAYERS]; 
-player_t        players[MAXPLAYERS]; 
+THREADLOCAL int             deathmatch;           	// only if started as net death 
+THREADLOCAL boolean         netgame;                // only true if packets are broadcast 
+THREADLOCAL boolean         playeringame[MAXPLAYERS]; 
+THREADLOCAL player_t        players[MAXPLAYERS]; 
 
-boolean         turbodetected[MAXPLAYERS];
+THREADLOCAL boolean         turbodetected[MAXPLAYERS];
  
-int             consoleplayer;          // player taking events and displaying 
-int             displayplayer;          // view being displayed 
-int             levelstarttic;          // gametic at level start 
-int             totalkills, totalitems, totalsecret;    // for intermission 
+THREADLOCAL int             consoleplayer;          // player taking events and displaying 
+THREADLOCAL int             displayplayer;          // view being displayed 
+THREADLOCAL int             levelstarttic;          // gametic at level start 
+THREADLOCAL int             totalkills, totalitems, totalsecret;    // for intermission 
  
-char           *demoname;
-boolean         demorecording; 
-boolean         longtics;               // cph's doom 1.91 longtics hack
-boolean         lowres_turn;            // low resolution turning for longtics
-boolean         demoplayback; 
-boolean		netdemo; 
-byte*		demobuffer;
-byte*		demo_p;
-byte*		demoend; 
-boolean         singledemo;            	// quit after playing a demo from cmdline 
+THREADLOCAL char           *demoname;
+THREADLOCAL boolean         demorecording; 
+THREADLOCAL boolean         longtics;               // cph's doom 1.91 longtics hack
+THREADLOCAL boolean         lowres_turn;            // low resolution turning for longtics
+THREADLOCAL boolean         demoplayback; 
+THREADLOCAL boolean		netdemo; 
+THREADLOCAL byte*		demobuffer;
+THREADLOCAL byte*		demo_p;
+THREADLOCAL byte*		demoend; 
+THREADLOCAL boolean         singledemo;            	// quit after playing a demo from cmdline 
  
-boolean         precache = true;        // if true, load all graphics at start 
+THREADLOCAL boolean         precache = true;        // if true, load all graphics at start 
 
-boolean         testcontrols = false;    // Invoked by setup to test controls
-int             testcontrols_mousespeed;
+THREADLOCAL boolean         testcontrols = false;    // Invoked by setup to test controls
+THREADLOCAL int             testcontrols_mousespeed;
  
 
  
-wbstartstruct_t wminfo;               	// parms for world map / intermission 
+THREADLOCAL wbstartstruct_t wminfo;               	// parms for world map / intermission 
  
-byte		consistancy[MAXPLAYERS][BACKUPTICS]; 
+THREADLOCAL byte		consistancy[MAXPLAYERS][BACKUPTICS]; 
  
 #define MAXPLMOVE		(forwardmove[1]) 
  
 #define TURBOTHRESHOLD	0x32
 
-fixed_t         forwardmove[2] = {0x19, 0x32}; 
-fixed_t         sidemove[2] = {0x18, 0x28}; 
-fixed_t         angleturn[3] = {640, 1280, 320};    // + slow turn 
-
-static int *weapon_keys[] = {
-    &key_weapon1,
-    &key_weapon2,
-    &key_weapon3,
-    &key_weapon4,
-    &key_weapon5,
-    &key_weapon6,
-    &key_weapon7,
-    &key_weapon8
-};
+THREADLOCAL fixed_t         forwardmove[2] = {0x19, 0x32}; 
+THREADLOCAL fixed_t         sidemove[2] = {0x18, 0x28}; 
+THREADLOCAL fixed_t         angleturn[3] = {640, 1280, 320};    // + slow turn 
 
 // Set to -1 or +1 to switch to the previous or next weapon.
 
-static int next_weapon = 0;
+static THREADLOCAL int next_weapon = 0;
 
 // Used for prev/next weapon keys.
 
@@ -195,40 +185,39 @@ static const struct
 #define NUMKEYS		256 
 #define MAX_JOY_BUTTONS 20
 
-static boolean  gamekeydown[NUMKEYS]; 
-static int      turnheld;		// for accelerative turning 
+static THREADLOCAL boolean  gamekeydown[NUMKEYS]; 
+static THREADLOCAL int      turnheld;		// for accelerative turning 
  
-static boolean  mousearray[MAX_MOUSE_BUTTONS + 1];
-static boolean *mousebuttons = &mousearray[1];  // allow [-1]
+static THREADLOCAL boolean  mousearray[MAX_MOUSE_BUTTONS + 1];
+#define mousebuttons (&mousearray[1])                         // allow [-1]
 
 // mouse values are used once 
-int             mousex;
-int             mousey;         
+THREADLOCAL int             mousex;
+THREADLOCAL int             mousey;         
 
-static int      dclicktime;
-static boolean  dclickstate;
-static int      dclicks; 
-static int      dclicktime2;
-static boolean  dclickstate2;
-static int      dclicks2;
+static THREADLOCAL int      dclicktime;
+static THREADLOCAL boolean  dclickstate;
+static THREADLOCAL int      dclicks; 
+static THREADLOCAL int      dclicktime2;
+static THREADLOCAL boolean  dclickstate2;
+static THREADLOCAL int      dclicks2;
 
 // joystick values are repeated 
-static int      joyxmove;
-static int      joyymove;
-static int      joystrafemove;
-static boolean  joyarray[MAX_JOY_BUTTONS + 1]; 
-static boolean *joybuttons = &joyarray[1];		// allow [-1] 
+static THREADLOCAL int      joyxmove;
+static THREADLOCAL int      joyymove;
+static THREADLOCAL int      joystrafemove;
+static THREADLOCAL boolean  joyarray[MAX_JOY_BUTTONS + 1]; 
+#define joybuttons (&joyarray[1])				// allow [-1] 
  
-static int      savegameslot; 
-static char     savedescription[32]; 
+static THREADLOCAL int      savegameslot; 
+static THREADLOCAL char     savedescription[32]; 
  
-#define	BODYQUESIZE	32
 
-mobj_t*		bodyque[BODYQUESIZE]; 
-int		bodyqueslot; 
+THREADLOCAL mobj_t*		bodyque[BODYQUESIZE]; 
+THREADLOCAL int		bodyqueslot; 
  
-int             vanilla_savegame_limit = 1;
-int             vanilla_demo_limit = 1;
+THREADLOCAL int             vanilla_savegame_limit = 1;
+THREADLOCAL int             vanilla_demo_limit = 1;
  
 int G_CmdChecksum (ticcmd_t* cmd) 
 { 
@@ -453,7 +442,19 @@ void G_BuildTiccmd (ticcmd_t* cmd, int maketic)
     }
     else
     {
-        // Check weapon keys.
+        // Check weapon keys.  The bindings are per-thread in a reentrant
+        // build, so the table can't be a static initializer.
+
+        int *weapon_keys[] = {
+            &key_weapon1,
+            &key_weapon2,
+            &key_weapon3,
+            &key_weapon4,
+            &key_weapon5,
+            &key_weapon6,
+            &key_weapon7,
+            &key_weapon8
+        };
 
         for (i=0; i<arrlen(weapon_keys); ++i)
         {
@@ -579,7 +580,7 @@ void G_BuildTiccmd (ticcmd_t* cmd, int maketic)
 
     if (lowres_turn)
     {
-        static signed short carry = 0;
+        static THREADLOCAL signed short carry = 0;
         signed short desired_angleturn;
 
         desired_angleturn = cmd->angleturn + carry;
@@ -856,6 +857,7 @@ void G_Ticker (void)
     int		i;
     int		buf; 
     ticcmd_t*	cmd;
+    uint64_t	start;
     
     // do player reborns if needed
     for (i=0 ; i<MAXPLAYERS ; i++) 
@@ -935,8 +937,8 @@ void G_Ticker (void)
              && ((gametic >> 5) % MAXPLAYERS) == i
              && turbodetected[i])
             {
-                static char turbomessage[80];
-                extern char *player_names[4];
+                static THREADLOCAL char turbomessage[80];
+                extern THREADLOCAL char *player_names[4];
                 M_snprintf(turbomessage, sizeof(turbomessage),
                            "%s is turbo!", player_names[i]);
                 players[consoleplayer].message = turbomessage;
@@ -1005,7 +1007,9 @@ void G_Ticker (void)
     switch (gamestate) 
     { 
       case GS_LEVEL: 
+	start = M_BenchStart ();
 	P_Ticker (); 
+	M_BenchStop (bench_ticker, start);
 	ST_Ticker (); 
 	AM_Ticker (); 
 	HU_Ticker ();            
@@ -1301,7 +1305,7 @@ void G_ScreenShot (void)
 
 
 // DOOM Par Times
-int pars[4][10] = 
+THREADLOCAL int pars[4][10] = 
 { 
     {0}, 
     {0,30,75,120,90,165,180,180,30,165}, 
@@ -1310,7 +1314,7 @@ int pars[4][10] =
 }; 
 
 // DOOM II Par Times
-int cpars[32] =
+THREADLOCAL int cpars[32] =
 {
     30,90,120,120,90,150,120,120,270,90,	//  1-10
     210,150,150,150,210,150,420,150,210,150,	// 11-20
@@ -1322,8 +1326,8 @@ int cpars[32] =
 //
 // G_DoCompleted 
 //
-boolean		secretexit; 
-extern char*	pagename; 
+THREADLOCAL boolean		secretexit; 
+extern THREADLOCAL char*	pagename; 
  
 void G_ExitLevel (void) 
 { 
@@ -1531,10 +1535,10 @@ void G_DoWorldDone (void)
 // G_InitFromSavegame
 // Can be called by the startup code or the menu task. 
 //
-extern boolean setsizeneeded;
+extern THREADLOCAL boolean setsizeneeded;
 void R_ExecuteSetViewSize (void);
 
-char	savename[256];
+THREADLOCAL char	savename[256];
 
 void G_LoadGame (char* name) 
 { 
@@ -1548,21 +1552,28 @@ void G_LoadGame (char* name)
 void G_DoLoadGame (void) 
 {
     int savedleveltime;
+    byte *buffer;
+    int length;
 	 
     gameaction = ga_nothing; 
-	 
-    save_stream = fopen(savename, "rb");
 
-    if (save_stream == NULL)
+    if (!M_FileExists(savename))
     {
     	return;
     }
 
+    // Read the whole file at once; the savegame code works on it in
+    // memory.
+
+    length = M_ReadFile(savename, &buffer);
+    save_stream = mem_fopen_read(buffer, length);
+
     savegame_error = false;
 
     if (!P_ReadSaveGameHeader())
     {
-        fclose(save_stream);
+        mem_fclose(save_stream);
+        Z_Free(buffer);
         return;
     }
 
@@ -1574,15 +1585,11 @@ void G_DoLoadGame (void)
     leveltime = savedleveltime;
 
     // dearchive all the modifications
-    P_UnArchivePlayers (); 
-    P_UnArchiveWorld (); 
-    P_UnArchiveThinkers (); 
-    P_UnArchiveSpecials (); 
- 
-    if (!P_ReadSaveGameEOF())
+    if (!P_ReadSaveGame() || !P_ReadSaveGameEOF())
 	I_Error ("Bad savegame");
 
-    fclose(save_stream);
+    mem_fclose(save_stream);
+    Z_Free(buffer);
     
     if (setsizeneeded)
     	R_ExecuteSetViewSize ();
@@ -1612,52 +1619,54 @@ void G_DoSaveGame (void)
     char *savegame_file;
     char *temp_savegame_file;
     char *recovery_savegame_file;
+    void *savegame;
+    size_t savegame_length;
 
     recovery_savegame_file = NULL;
     temp_savegame_file = P_TempSaveGameFile();
     savegame_file = P_SaveGameFile(savegameslot);
 
-    // Open the savegame file for writing.  We write to a temporary file
-    // and then rename it at the end if it was successfully written.
-    // This prevents an existing savegame from being overwritten by 
-    // a corrupted one, or if a savegame buffer overrun occurs.
-    save_stream = fopen(temp_savegame_file, "wb");
+    // Build the savegame in memory, so that it goes to the disk with a
+    // single write.
 
-    if (save_stream == NULL)
-    {
-        // Failed to save the game, so we're going to have to abort. But
-        // to be nice, save to somewhere else before we call I_Error().
-        recovery_savegame_file = M_TempFile("recovery.dsg");
-        save_stream = fopen(recovery_savegame_file, "wb");
-        if (save_stream == NULL)
-        {
-            I_Error("Failed to open either '%s' or '%s' to write savegame.",
-                    temp_savegame_file, recovery_savegame_file);
-        }
-    }
+    save_stream = mem_fopen_write();
 
     savegame_error = false;
 
     P_WriteSaveGameHeader(savedescription);
- 
-    P_ArchivePlayers (); 
-    P_ArchiveWorld (); 
-    P_ArchiveThinkers (); 
-    P_ArchiveSpecials (); 
-	 
+    P_WriteSaveGame();
     P_WriteSaveGameEOF();
+
+    mem_get_buf(save_stream, &savegame, &savegame_length);
 	 
     // Enforce the same savegame size limit as in Vanilla Doom, 
     // except if the vanilla_savegame_limit setting is turned off.
+    // Vanilla could not load a bigger savegame; the doomgeneric
+    // format has no limit.
 
-    if (vanilla_savegame_limit && ftell(save_stream) > SAVEGAMESIZE)
+    if (savegame_vanilla && vanilla_savegame_limit
+     && savegame_length > SAVEGAMESIZE)
     {
         I_Error ("Savegame buffer overrun");
     }
-    
-    // Finish up, close the savegame file.
 
-    fclose(save_stream);
+    // We write to a temporary file and then rename it at the end if it
+    // was successfully written.  This prevents an existing savegame
+    // from being overwritten by a corrupted one.
+
+    if (!M_WriteFile(temp_savegame_file, savegame, savegame_length))
+    {
+        // Failed to save the game, so we're going to have to abort. But
+        // to be nice, save to somewhere else before we call I_Error().
+        recovery_savegame_file = M_TempFile("recovery.dsg");
+        if (!M_WriteFile(recovery_savegame_file, savegame, savegame_length))
+        {
+            I_Error("Failed to open either '%s' or '%s' to write savegame.",
+                    temp_savegame_file, recovery_savegame_file);
+        }
+    }
+
+    mem_fclose(save_stream);
 
     if (recovery_savegame_file != NULL)
     {
@@ -1690,9 +1699,9 @@ void G_DoSaveGame (void)
 // Can be called by the startup code or the menu task,
 // consoleplayer, displayplayer, playeringame[] should be set. 
 //
-skill_t	d_skill; 
-int     d_episode; 
-int     d_map; 
+THREADLOCAL skill_t	d_skill; 
+THREADLOCAL int     d_episode; 
+THREADLOCAL int     d_map; 
  
 void
 G_DeferedInitNew
@@ -2102,7 +2111,7 @@ void G_BeginRecording (void)
 // G_PlayDemo 
 //
 
-char*	defdemoname; 
+THREADLOCAL char*	defdemoname; 
  
 void G_DeferedPlayDemo (char* name) 
 { 
@@ -2114,7 +2123,7 @@ void G_DeferedPlayDemo (char* name)
 
 static char *DemoVersionDescription(int version)
 {
-    static char resultbuf[16];
+    static THREADLOCAL char resultbuf[16];
 
     switch (version)
     {
@@ -74,7 +74,7 @@ void G_ScreenShot (void);
 void G_DrawMouseSpeedBox(void);
 int G_VanillaVersionCode(void);
 
-extern int vanilla_savegame_limit;
-extern int vanilla_demo_limit;
+extern THREADLOCAL int vanilla_savegame_limit;
+extern THREADLOCAL int vanilla_demo_limit;
 #endif
 
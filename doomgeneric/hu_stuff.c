@@ -61,7 +61,7 @@
 
 
 
-char *chat_macros[10] =
+THREADLOCAL char *chat_macros[10] =
 {
     HUSTR_CHATMACRO0,
     HUSTR_CHATMACRO1,
@@ -75,7 +75,7 @@ char *chat_macros[10] =
     HUSTR_CHATMACRO9
 };
 
-char*	player_names[] =
+THREADLOCAL char*	player_names[] =
 {
     HUSTR_PLRGREEN,
     HUSTR_PLRINDIGO,
@@ -83,33 +83,33 @@ char*	player_names[] =
     HUSTR_PLRRED
 };
 
-char			chat_char; // remove later.
-static player_t*	plr;
-patch_t*		hu_font[HU_FONTSIZE];
-static hu_textline_t	w_title;
-boolean			chat_on;
-static hu_itext_t	w_chat;
-static boolean		always_off = false;
-static char		chat_dest[MAXPLAYERS];
-static hu_itext_t w_inputbuffer[MAXPLAYERS];
+THREADLOCAL char			chat_char; // remove later.
+static THREADLOCAL player_t*	plr;
+THREADLOCAL patch_t*		hu_font[HU_FONTSIZE];
+static THREADLOCAL hu_textline_t	w_title;
+THREADLOCAL boolean			chat_on;
+static THREADLOCAL hu_itext_t	w_chat;
+static THREADLOCAL boolean		always_off = false;
+static THREADLOCAL char		chat_dest[MAXPLAYERS];
+static THREADLOCAL hu_itext_t w_inputbuffer[MAXPLAYERS];
 
-static boolean		message_on;
-boolean			message_dontfuckwithme;
-static boolean		message_nottobefuckedwith;
+static THREADLOCAL boolean		message_on;
+THREADLOCAL boolean			message_dontfuckwithme;
+static THREADLOCAL boolean		message_nottobefuckedwith;
 
-static hu_stext_t	w_message;
-static int		message_counter;
+static THREADLOCAL hu_stext_t	w_message;
+static THREADLOCAL int		message_counter;
 
-extern int		showMessages;
+extern THREADLOCAL int		showMessages;
 
-static boolean		headsupactive = false;
+static THREADLOCAL boolean		headsupactive = false;
 
 //
 // Builtin map names.
 // The actual names can be found in DStrings.h.
 //
 
-char*	mapnames[] =	// DOOM shareware/registered/retail (Ultimate) names.
+THREADLOCAL char*	mapnames[] =	// DOOM shareware/registered/retail (Ultimate) names.
 {
 
     HUSTR_E1M1,
@@ -169,7 +169,7 @@ char*	mapnames[] =	// DOOM shareware/registered/retail (Ultimate) names.
 // the layout in the Vanilla executable, where it is possible to
 // overflow the end of one array into the next.
 
-char *mapnames_commercial[] =
+THREADLOCAL char *mapnames_commercial[] =
 {
     // DOOM 2 map names.
 
@@ -474,9 +474,9 @@ void HU_Ticker(void)
 
 #define QUEUESIZE		128
 
-static char	chatchars[QUEUESIZE];
-static int	head = 0;
-static int	tail = 0;
+static THREADLOCAL char	chatchars[QUEUESIZE];
+static THREADLOCAL int	head = 0;
+static THREADLOCAL int	tail = 0;
 
 
 void HU_queueChatChar(char c)
@@ -512,15 +512,15 @@ char HU_dequeueChatChar(void)
 boolean HU_Responder(event_t *ev)
 {
 
-    static char		lastmessage[HU_MAXLINELENGTH+1];
+    static THREADLOCAL char		lastmessage[HU_MAXLINELENGTH+1];
     char*		macromessage;
     boolean		eatkey = false;
-    static boolean	altdown = false;
+    static THREADLOCAL boolean	altdown = false;
     unsigned char 	c;
     int			i;
     int			numplayers;
     
-    static int		num_nobrainers = 0;
+    static THREADLOCAL int		num_nobrainers = 0;
 
     numplayers = 0;
     for (i=0 ; i<MAXPLAYERS ; i++)
@@ -53,7 +53,7 @@ void HU_Drawer(void);
 char HU_dequeueChatChar(void);
 void HU_Erase(void);
 
-extern char *chat_macros[10];
+extern THREADLOCAL char *chat_macros[10];
 
 #endif
 
@@ -0,0 +1,893 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	System interface for music.  MUS lumps are played as they are on
+//	a small FM synthesizer modelled on the OPL, with the instruments
+//	of the GENMIDI lump, and mixed in with the sound effects by
+//	i_mixsound.c.
+//
+
+#include "config.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "i_sound.h"
+#include "i_swap.h"
+#include "m_trace.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#include "doomtype.h"
+
+#define GENMIDI_HEADER          "#OPL_II#"
+#define GENMIDI_NUM_INSTRS      128
+#define GENMIDI_NUM_PERCUSSION  47
+#define GENMIDI_FLAG_FIXED      0x0001  // fixed pitch
+#define GENMIDI_FLAG_2VOICE     0x0004  // double voice
+
+#define MUS_HEADER              "MUS\x1a"
+#define MUS_TICRATE             140
+#define MUS_PERCUSSION_CHAN     15
+
+#define NUM_CHANNELS            16
+
+// As many two operator voices as an OPL3 has.  Every sample costs at
+// most this many voices, however busy the song.
+#define NUM_VOICES              18
+
+// Envelopes count attenuation in 16.16 fixed point units of 3/16 dB,
+// like the OPL; 512 of them is silence.
+#define ENV_BITS                16
+#define ENV_OFF                 (512 << ENV_BITS)
+
+#define WAVE_BITS               10
+
+#ifndef M_PI
+#define M_PI                    3.14159265358979323846
+#endif
+
+typedef struct
+{
+    byte tremolo;               // AM, vibrato, sustain, KSR, multiplier
+    byte attack;                // attack rate, decay rate
+    byte sustain;               // sustain level, release rate
+    byte waveform;
+    byte scale;                 // key scale level
+    byte level;                 // total level
+} PACKEDATTR genmidi_op_t;
+
+typedef struct
+{
+    genmidi_op_t modulator;
+    byte feedback;              // feedback, and 1 for additive
+    genmidi_op_t carrier;
+    byte unused;
+    short base_note_offset;
+} PACKEDATTR genmidi_voice_t;
+
+typedef struct
+{
+    unsigned short flags;
+    byte fine_tuning;
+    byte fixed_note;
+    genmidi_voice_t voices[2];
+} PACKEDATTR genmidi_instr_t;
+
+// The instruments are read straight out of the lump, 36 bytes apiece.
+
+typedef char genmidi_instr_size_check[sizeof(genmidi_instr_t) == 36 ? 1 : -1];
+
+typedef enum
+{
+    env_attack,
+    env_decay,
+    env_sustain,
+    env_release,
+    env_off
+} envstate_t;
+
+typedef struct
+{
+    uint32_t phase, step;
+    int multiple;               // frequency, times 2
+    int level;                  // total level, in envelope units
+    const int16_t *wave;
+
+    envstate_t state;
+    int env;
+    int attack, decay, release; // per sample
+    int sustain;
+    boolean hold;               // sustain until released
+} mixop_t;
+
+typedef struct
+{
+    mixop_t mod, car;
+    int feedback;               // shift of the modulator feedback, or 0
+    boolean additive;
+    int out[2];                 // last two outputs of the modulator
+
+    int channel;
+    int note;                   // as in the song, to release it
+    int key;                    // as played
+    int fine;                   // detune, in 1/32 semitones
+    unsigned int age;
+
+    int left, right;
+} mixvoice_t;
+
+typedef struct
+{
+    const genmidi_instr_t *instr;
+    int volume;
+    int pan;
+    int bend;
+    int velocity;               // of the last note
+} muschannel_t;
+
+typedef struct
+{
+    byte *data;
+    unsigned int start, end;
+} mussong_t;
+
+static THREADLOCAL boolean music_initialized = false;
+
+static THREADLOCAL int genmidi_lump;
+static THREADLOCAL const genmidi_instr_t *main_instrs;
+static THREADLOCAL const genmidi_instr_t *percussion_instrs;
+
+static THREADLOCAL int16_t waveforms[4][1 << WAVE_BITS];
+static THREADLOCAL int exptab[32];
+static THREADLOCAL int attack_rates[16];
+static THREADLOCAL int decay_rates[16];
+
+static THREADLOCAL mixvoice_t voices[NUM_VOICES];
+static THREADLOCAL unsigned int voice_age;
+static THREADLOCAL muschannel_t channels[NUM_CHANNELS];
+
+static THREADLOCAL int music_volume = 127;
+
+static THREADLOCAL mussong_t *song;
+static THREADLOCAL unsigned int song_pos;
+static THREADLOCAL boolean song_playing;
+static THREADLOCAL boolean song_looping;
+static THREADLOCAL boolean song_paused;
+
+// MUS tics up to the next event, and the frames mixed since the start.
+static THREADLOCAL uint64_t song_tics;
+static THREADLOCAL uint64_t song_frames;
+
+// song_tics when the song last started from the beginning.
+static THREADLOCAL uint64_t song_looptics;
+
+static const int multiples[16] =
+{
+    1, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 20, 24, 24, 30, 30
+};
+
+
+//
+// The synthesizer
+//
+
+static void InitTables(void)
+{
+    int i, r, n;
+    double s, frames;
+
+    // The OPL2 waveforms: sine, half sine, absolute sine and the first
+    // quarter of every half.
+
+    n = 1 << WAVE_BITS;
+
+    for (i = 0; i < n; ++i)
+    {
+        s = sin(2 * M_PI * i / n) * 32767;
+
+        waveforms[0][i] = s;
+        waveforms[1][i] = i < n / 2 ? s : 0;
+        waveforms[2][i] = fabs(s);
+        waveforms[3][i] = (i & (n / 2 - 1)) < n / 4 ? fabs(s) : 0;
+    }
+
+    for (i = 0; i < 32; ++i)
+    {
+        exptab[i] = pow(2, -i / 32.0) * 32767;
+    }
+
+    // Rate 1 takes 2.8 s to attack and 39 s to decay through 96 dB; each
+    // rate above is twice as fast, and an attack at rate 15 is instant.
+
+    for (r = 0; r < 16; ++r)
+    {
+        if (r == 0)
+        {
+            attack_rates[r] = 0;
+            decay_rates[r] = 0;
+            continue;
+        }
+
+        frames = 2.82624 * snd_samplerate / (1 << (r - 1));
+        attack_rates[r] = r == 15 || frames < 1 ? ENV_OFF : ENV_OFF / frames;
+
+        frames = 39.28064 * snd_samplerate / (1 << (r - 1));
+        decay_rates[r] = frames < 1 ? ENV_OFF : ENV_OFF / frames;
+    }
+}
+
+static void SetOperator(mixop_t *op, const genmidi_op_t *data)
+{
+    op->multiple = multiples[data->tremolo & 0x0f];
+    op->hold = (data->tremolo & 0x20) != 0;
+    op->attack = attack_rates[data->attack >> 4];
+    op->decay = decay_rates[data->attack & 0x0f];
+    op->sustain = (data->sustain >> 4) * (16 << ENV_BITS);
+    op->release = decay_rates[data->sustain & 0x0f];
+    op->wave = waveforms[data->waveform & 3];
+    op->level = (data->level & 0x3f) * 4;
+
+    op->phase = 0;
+    op->env = ENV_OFF;
+    op->state = env_attack;
+}
+
+static void ReleaseOperator(mixop_t *op)
+{
+    if (op->state != env_off)
+    {
+        op->state = env_release;
+    }
+}
+
+static inline void StepEnvelope(mixop_t *op)
+{
+    switch (op->state)
+    {
+        case env_attack:
+            op->env -= op->attack;
+            if (op->env <= 0)
+            {
+                op->env = 0;
+                op->state = env_decay;
+            }
+            break;
+
+        case env_decay:
+            op->env += op->decay;
+            if (op->env >= op->sustain)
+            {
+                op->env = op->sustain;
+                op->state = op->hold ? env_sustain : env_release;
+            }
+            break;
+
+        case env_release:
+            op->env += op->release;
+            if (op->env >= ENV_OFF)
+            {
+                op->env = ENV_OFF;
+                op->state = env_off;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+static inline int Operator(mixop_t *op, uint32_t phase)
+{
+    int att = (op->env >> ENV_BITS) + op->level;
+
+    if (att >= 512)
+    {
+        return 0;
+    }
+
+    return (op->wave[phase >> (32 - WAVE_BITS)]
+            * (exptab[att & 31] >> (att >> 5))) >> 15;
+}
+
+static boolean VoiceActive(mixvoice_t *voice)
+{
+    return voice->car.state != env_off
+        || (voice->additive && voice->mod.state != env_off);
+}
+
+// Mix n frames of a voice into acc.  The modulator feeds back on itself
+// and, unless the voice is additive, modulates the phase of the carrier,
+// in the same proportions as on the OPL.
+
+static void MixVoice(mixvoice_t *voice, int32_t *acc, int n)
+{
+    uint32_t fb;
+    int m, out, i;
+
+    for (i = 0; i < n; ++i)
+    {
+        fb = voice->feedback == 0 ? 0
+           : (uint32_t) (voice->out[0] + voice->out[1]) << voice->feedback;
+
+        m = Operator(&voice->mod, voice->mod.phase + fb);
+        voice->out[1] = voice->out[0];
+        voice->out[0] = m;
+
+        if (voice->additive)
+        {
+            out = m + Operator(&voice->car, voice->car.phase);
+        }
+        else
+        {
+            out = Operator(&voice->car,
+                           voice->car.phase + ((uint32_t) m << 19));
+        }
+
+        voice->mod.phase += voice->mod.step;
+        voice->car.phase += voice->car.step;
+        StepEnvelope(&voice->mod);
+        StepEnvelope(&voice->car);
+
+        acc[i * 2] += (out * voice->left) >> 16;
+        acc[i * 2 + 1] += (out * voice->right) >> 16;
+    }
+}
+
+static void SetVoicePitch(mixvoice_t *voice)
+{
+    double freq, step;
+
+    freq = 440 * pow(2, (voice->key - 69
+                         + (channels[voice->channel].bend - 128) / 64.0
+                         + voice->fine / 32.0) / 12);
+    step = freq * 2147483648.0 / snd_samplerate;
+
+    voice->mod.step = (uint64_t) (step * voice->mod.multiple);
+    voice->car.step = (uint64_t) (step * voice->car.multiple);
+}
+
+static void SetVoiceVolume(mixvoice_t *voice, int velocity)
+{
+    muschannel_t *channel = &channels[voice->channel];
+    int gain;
+
+    gain = (velocity * channel->volume * music_volume) / 64;
+
+    voice->left = (gain * (127 - channel->pan)) / 127;
+    voice->right = (gain * channel->pan) / 127;
+}
+
+// A free voice, or the one that has been playing the longest.
+
+static mixvoice_t *AllocVoice(void)
+{
+    mixvoice_t *oldest = &voices[0];
+    int i;
+
+    for (i = 0; i < NUM_VOICES; ++i)
+    {
+        if (!VoiceActive(&voices[i]))
+        {
+            return &voices[i];
+        }
+
+        if (voices[i].age < oldest->age)
+        {
+            oldest = &voices[i];
+        }
+    }
+
+    return oldest;
+}
+
+
+//
+// The sequencer
+//
+
+static void KeyOnVoice(int ch, int note, const genmidi_instr_t *instr, int i)
+{
+    const genmidi_voice_t *data = &instr->voices[i];
+    mixvoice_t *voice = AllocVoice();
+
+    SetOperator(&voice->mod, &data->modulator);
+    SetOperator(&voice->car, &data->carrier);
+
+    voice->feedback = (data->feedback >> 1) & 7;
+    voice->feedback = voice->feedback ? voice->feedback + 10 : 0;
+    voice->additive = (data->feedback & 1) != 0;
+    voice->out[0] = voice->out[1] = 0;
+
+    voice->channel = ch;
+    voice->note = note;
+
+    if (SHORT(instr->flags) & GENMIDI_FLAG_FIXED)
+    {
+        voice->key = instr->fixed_note;
+    }
+    else
+    {
+        voice->key = note;
+    }
+
+    voice->key += SHORT(data->base_note_offset);
+    voice->fine = i == 1 ? instr->fine_tuning / 2 - 64 : 0;
+    voice->age = ++voice_age;
+
+    SetVoicePitch(voice);
+    SetVoiceVolume(voice, channels[ch].velocity);
+}
+
+static void KeyOn(int ch, int note)
+{
+    const genmidi_instr_t *instr;
+
+    if (ch == MUS_PERCUSSION_CHAN)
+    {
+        if (note < 35 || note >= 35 + GENMIDI_NUM_PERCUSSION)
+        {
+            return;
+        }
+
+        instr = &percussion_instrs[note - 35];
+    }
+    else
+    {
+        instr = channels[ch].instr;
+    }
+
+    KeyOnVoice(ch, note, instr, 0);
+
+    if (SHORT(instr->flags) & GENMIDI_FLAG_2VOICE)
+    {
+        KeyOnVoice(ch, note, instr, 1);
+    }
+}
+
+static void KeyOff(int ch, int note)
+{
+    int i;
+
+    for (i = 0; i < NUM_VOICES; ++i)
+    {
+        if ((ch < 0 || voices[i].channel == ch)
+         && (note < 0 || voices[i].note == note))
+        {
+            ReleaseOperator(&voices[i].mod);
+            ReleaseOperator(&voices[i].car);
+        }
+    }
+}
+
+static void UpdateChannel(int ch, boolean pitch)
+{
+    int i;
+
+    for (i = 0; i < NUM_VOICES; ++i)
+    {
+        if (voices[i].channel == ch && VoiceActive(&voices[i]))
+        {
+            if (pitch)
+            {
+                SetVoicePitch(&voices[i]);
+            }
+            else
+            {
+                SetVoiceVolume(&voices[i], channels[ch].velocity);
+            }
+        }
+    }
+}
+
+static void ResetChannels(void)
+{
+    int i;
+
+    for (i = 0; i < NUM_CHANNELS; ++i)
+    {
+        channels[i].instr = &main_instrs[0];
+        channels[i].volume = 100;
+        channels[i].pan = 64;
+        channels[i].bend = 128;
+        channels[i].velocity = 127;
+    }
+}
+
+static void Controller(int ch, int controller, int value)
+{
+    value &= 0x7f;
+
+    switch (controller)
+    {
+        case 0:                 // instrument
+            channels[ch].instr = &main_instrs[value];
+            break;
+
+        case 3:                 // volume
+            channels[ch].volume = value;
+            UpdateChannel(ch, false);
+            break;
+
+        case 4:                 // pan
+            channels[ch].pan = value;
+            UpdateChannel(ch, false);
+            break;
+
+        default:
+            break;
+    }
+}
+
+static int ReadByte(void)
+{
+    if (song_pos >= song->end)
+    {
+        return -1;
+    }
+
+    return song->data[song_pos++];
+}
+
+// Play the events up to the next delay.
+
+static void ReadEvents(void)
+{
+    int desc, ch, a, b;
+    int delay;
+
+    while (song_playing)
+    {
+        desc = ReadByte();
+        ch = desc & 0x0f;
+        a = 0;
+
+        switch ((desc >> 4) & 7)
+        {
+            case 0:             // release note
+                a = ReadByte();
+                if (a >= 0)
+                {
+                    KeyOff(ch, a & 0x7f);
+                }
+                break;
+
+            case 1:             // play note
+                a = ReadByte();
+                b = a >= 0x80 ? ReadByte() : channels[ch].velocity;
+                if (a >= 0 && b >= 0)
+                {
+                    channels[ch].velocity = b & 0x7f;
+                    KeyOn(ch, a & 0x7f);
+                }
+                a = a < 0 ? a : b;
+                break;
+
+            case 2:             // pitch wheel
+                a = ReadByte();
+                if (a >= 0)
+                {
+                    channels[ch].bend = a;
+                    UpdateChannel(ch, true);
+                }
+                break;
+
+            case 3:             // system event
+                a = ReadByte();
+                if (a == 10 || a == 11)
+                {
+                    KeyOff(ch, -1);
+                }
+                break;
+
+            case 4:             // controller
+                a = ReadByte();
+                b = a < 0 ? a : ReadByte();
+                if (b >= 0)
+                {
+                    Controller(ch, a, b);
+                }
+                a = b;
+                break;
+
+            case 5:             // end of measure
+                break;
+
+            default:            // score end
+                a = -1;
+                break;
+        }
+
+        if (desc < 0 || a < 0)
+        {
+            // Go round again, unless a whole loop took no time at all.
+
+            if (!song_looping || song_tics == song_looptics)
+            {
+                song_playing = false;
+                KeyOff(-1, -1);
+                break;
+            }
+
+            song_pos = song->start;
+            song_looptics = song_tics;
+            continue;
+        }
+
+        if (desc & 0x80)
+        {
+            delay = 0;
+
+            do
+            {
+                b = ReadByte();
+                delay = (delay << 7) | (b & 0x7f);
+            } while (b >= 0x80);
+
+            if (delay > 0)
+            {
+                song_tics += delay;
+                break;
+            }
+        }
+    }
+}
+
+//
+// Called by the mixer of i_mixsound.c for every block of frames it
+// makes.  Without acc, the song goes on without being heard.
+//
+
+void I_MixMusic(int32_t *acc, int frames)
+{
+    uint64_t start;
+    uint64_t due;
+    int i, n;
+
+    if (!music_initialized || song_paused)
+    {
+        return;
+    }
+
+    start = M_TraceBegin();
+
+    while (frames > 0)
+    {
+        n = frames;
+
+        while (song_playing)
+        {
+            due = song_tics * snd_samplerate / MUS_TICRATE;
+
+            if (due > song_frames)
+            {
+                if (due - song_frames < (uint64_t) n)
+                {
+                    n = due - song_frames;
+                }
+                break;
+            }
+
+            ReadEvents();
+        }
+
+        if (acc != NULL)
+        {
+            for (i = 0; i < NUM_VOICES; ++i)
+            {
+                if (VoiceActive(&voices[i]))
+                {
+                    MixVoice(&voices[i], acc, n);
+                }
+            }
+
+            acc += n * 2;
+        }
+
+        song_frames += n;
+        frames -= n;
+    }
+
+    M_TraceEnd(tz_mixmusic, start);
+}
+
+
+//
+// The music module
+//
+
+static boolean I_Mix_InitMusic(void)
+{
+    byte *data;
+    int i;
+
+    genmidi_lump = W_CheckNumForName("GENMIDI");
+
+    if (genmidi_lump < 0
+     || W_LumpLength(genmidi_lump) < 8 + (GENMIDI_NUM_INSTRS
+                                          + GENMIDI_NUM_PERCUSSION)
+                                         * sizeof(genmidi_instr_t))
+    {
+        printf("I_InitMusic: no GENMIDI lump, no music\n");
+        return false;
+    }
+
+    data = W_CacheLumpNum(genmidi_lump, PU_STATIC);
+
+    if (memcmp(data, GENMIDI_HEADER, 8) != 0)
+    {
+        printf("I_InitMusic: bad GENMIDI lump, no music\n");
+        W_ReleaseLumpNum(genmidi_lump);
+        return false;
+    }
+
+    main_instrs = (const genmidi_instr_t *) (data + 8);
+    percussion_instrs = main_instrs + GENMIDI_NUM_INSTRS;
+
+    InitTables();
+    memset(voices, 0, sizeof(voices));
+
+    for (i = 0; i < NUM_VOICES; ++i)
+    {
+        voices[i].car.state = env_off;
+        voices[i].mod.state = env_off;
+    }
+
+    ResetChannels();
+
+    music_initialized = true;
+
+    return true;
+}
+
+static void I_Mix_ShutdownMusic(void)
+{
+    if (!music_initialized)
+    {
+        return;
+    }
+
+    song_playing = false;
+    song = NULL;
+    W_ReleaseLumpNum(genmidi_lump);
+
+    music_initialized = false;
+}
+
+static void I_Mix_SetMusicVolume(int volume)
+{
+    int i;
+
+    music_volume = volume;
+
+    for (i = 0; i < NUM_VOICES; ++i)
+    {
+        SetVoiceVolume(&voices[i], channels[voices[i].channel].velocity);
+    }
+}
+
+static void I_Mix_PauseSong(void)
+{
+    song_paused = true;
+}
+
+static void I_Mix_ResumeSong(void)
+{
+    song_paused = false;
+}
+
+// Only MUS is understood; other songs are silent.
+
+static void *I_Mix_RegisterSong(void *data, int len)
+{
+    byte *d = data;
+    mussong_t *handle;
+    unsigned int length, start;
+
+    if (!music_initialized || len < 16 || memcmp(d, MUS_HEADER, 4) != 0)
+    {
+        return NULL;
+    }
+
+    length = d[4] | (d[5] << 8);
+    start = d[6] | (d[7] << 8);
+
+    handle = malloc(sizeof(mussong_t));
+
+    if (handle == NULL)
+    {
+        return NULL;
+    }
+
+    handle->data = d;
+    handle->start = start;
+    handle->end = start + length < (unsigned int) len ? start + length : len;
+
+    return handle;
+}
+
+static void I_Mix_UnRegisterSong(void *handle)
+{
+    if (handle == song)
+    {
+        song_playing = false;
+        song = NULL;
+    }
+
+    free(handle);
+}
+
+static void I_Mix_PlaySong(void *handle, boolean looping)
+{
+    if (!music_initialized || handle == NULL)
+    {
+        return;
+    }
+
+    KeyOff(-1, -1);
+    ResetChannels();
+
+    song = handle;
+    song_pos = song->start;
+    song_looping = looping;
+    song_tics = 0;
+    song_frames = 0;
+    song_looptics = 0;
+    song_playing = true;
+}
+
+static void I_Mix_StopSong(void)
+{
+    song_playing = false;
+    KeyOff(-1, -1);
+}
+
+static boolean I_Mix_MusicIsPlaying(void)
+{
+    return song_playing;
+}
+
+
+static snddevice_t music_mix_devices[] =
+{
+    SNDDEVICE_ADLIB,
+    SNDDEVICE_SB,
+    SNDDEVICE_PAS,
+    SNDDEVICE_GUS,
+    SNDDEVICE_WAVEBLASTER,
+    SNDDEVICE_SOUNDCANVAS,
+    SNDDEVICE_GENMIDI,
+    SNDDEVICE_AWE32,
+};
+
+
+music_module_t DG_music_module =
+{
+    music_mix_devices,
+    arrlen(music_mix_devices),
+    I_Mix_InitMusic,
+    I_Mix_ShutdownMusic,
+    I_Mix_SetMusicVolume,
+    I_Mix_PauseSong,
+    I_Mix_ResumeSong,
+    I_Mix_RegisterSong,
+    I_Mix_UnRegisterSong,
+    I_Mix_PlaySong,
+    I_Mix_StopSong,
+    I_Mix_MusicIsPlaying,
+    NULL,
+};
@@ -0,0 +1,825 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+// Copyright(C) 2008 David Flater
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	System interface for sound, mixed in software into the
+//	DG_AudioRing of the platform along with the music of
+//	i_mixmusic.c.  Needs no sound library.
+//
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "deh_str.h"
+#include "doomgeneric.h"
+#include "i_sound.h"
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include "m_misc.h"
+#include "sounds.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#include "doomtype.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_MIX_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define HAVE_MIX_NEON
+#include <arm_neon.h>
+#endif
+
+#define NUM_CHANNELS 16
+
+// Frames mixed at a time, into an accumulator on the stack.
+#define MIX_BLOCK 256
+
+// An update mixes at most this many tics worth of sound, however long
+// it has been since the last one, so a worker that falls behind does not
+// spend its next tic catching up.  The sound in between is skipped.
+#define MAX_MIX_TICS 4
+
+// A sound effect, resampled to snd_samplerate.
+
+typedef struct
+{
+    int length;
+    int16_t samples[];
+} mixsound_t;
+
+typedef struct
+{
+    mixsound_t *sound;
+    int position;
+
+    // Gains, 1.0 = 32768
+    int left, right;
+} mixchannel_t;
+
+// Add n mono samples to an accumulator of n stereo frames.
+typedef void (*mixfunc_t)(int32_t *acc, const int16_t *in, int n,
+                          int left, int right);
+
+// Clip n accumulated samples to 16 bits.
+typedef void (*clipfunc_t)(int16_t *out, const int32_t *acc, int n);
+
+static THREADLOCAL boolean sound_initialized = false;
+
+static THREADLOCAL mixchannel_t channels[NUM_CHANNELS];
+
+static THREADLOCAL boolean use_sfx_prefix;
+
+static THREADLOCAL mixfunc_t mixfunc;
+static THREADLOCAL clipfunc_t clipfunc;
+
+// When the mixer started, in us, and the frames it has produced since.
+static THREADLOCAL uint64_t mix_start;
+static THREADLOCAL uint64_t mix_frames;
+
+// Tics mixed so far, with snd_ticsync.
+static THREADLOCAL uint64_t mix_tics;
+
+
+// Libsamplerate is not used, but these have to be here since other
+// code requires them.
+int use_libsamplerate = 0;
+
+float libsamplerate_scale = 0.65f;
+
+
+//
+// Mixing
+//
+
+static void I_Mix_MixScalar(int32_t *acc, const int16_t *in, int n,
+                            int left, int right)
+{
+    int i;
+
+    for (i = 0; i < n; ++i)
+    {
+        acc[i * 2] += (in[i] * left) >> 15;
+        acc[i * 2 + 1] += (in[i] * right) >> 15;
+    }
+}
+
+static void I_Mix_ClipScalar(int16_t *out, const int32_t *acc, int n)
+{
+    int i;
+
+    for (i = 0; i < n; ++i)
+    {
+        out[i] = acc[i] > 32767 ? 32767 : acc[i] < -32768 ? -32768 : acc[i];
+    }
+}
+
+#ifdef HAVE_MIX_X86
+
+// Each sample is doubled up to multiply it by the left and right gains
+// at once.  The 32 bit products are put back together from their low
+// and high halves.
+
+__attribute__((target("sse2")))
+static void I_Mix_MixSSE2(int32_t *acc, const int16_t *in, int n,
+                          int left, int right)
+{
+    __m128i gains = _mm_set1_epi32((right << 16) | left);
+    __m128i s, d, lo, hi;
+    int i, j;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        s = _mm_loadu_si128((const __m128i *) (in + i));
+
+        for (j = 0; j < 2; ++j)
+        {
+            d = j == 0 ? _mm_unpacklo_epi16(s, s) : _mm_unpackhi_epi16(s, s);
+            lo = _mm_mullo_epi16(d, gains);
+            hi = _mm_mulhi_epi16(d, gains);
+
+            _mm_storeu_si128((__m128i *) (acc + i * 2 + j * 8),
+                _mm_add_epi32(
+                    _mm_loadu_si128((__m128i *) (acc + i * 2 + j * 8)),
+                    _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 15)));
+            _mm_storeu_si128((__m128i *) (acc + i * 2 + j * 8 + 4),
+                _mm_add_epi32(
+                    _mm_loadu_si128((__m128i *) (acc + i * 2 + j * 8 + 4)),
+                    _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 15)));
+        }
+    }
+
+    I_Mix_MixScalar(acc + i * 2, in + i, n - i, left, right);
+}
+
+__attribute__((target("sse2")))
+static void I_Mix_ClipSSE2(int16_t *out, const int32_t *acc, int n)
+{
+    __m128i a, b;
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        a = _mm_loadu_si128((const __m128i *) (acc + i));
+        b = _mm_loadu_si128((const __m128i *) (acc + i + 4));
+        _mm_storeu_si128((__m128i *) (out + i), _mm_packs_epi32(a, b));
+    }
+
+    I_Mix_ClipScalar(out + i, acc + i, n - i);
+}
+
+#endif
+
+#ifdef HAVE_MIX_NEON
+
+static void I_Mix_MixNEON(int32_t *acc, const int16_t *in, int n,
+                          int left, int right)
+{
+    const int16_t g[4] = { left, right, left, right };
+    int16x4_t gains = vld1_s16(g);
+    int16x8_t s;
+    int16x8x2_t d;
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        s = vld1q_s16(in + i);
+        d = vzipq_s16(s, s);
+
+        vst1q_s32(acc + i * 2, vaddq_s32(vld1q_s32(acc + i * 2),
+            vshrq_n_s32(vmull_s16(vget_low_s16(d.val[0]), gains), 15)));
+        vst1q_s32(acc + i * 2 + 4, vaddq_s32(vld1q_s32(acc + i * 2 + 4),
+            vshrq_n_s32(vmull_s16(vget_high_s16(d.val[0]), gains), 15)));
+        vst1q_s32(acc + i * 2 + 8, vaddq_s32(vld1q_s32(acc + i * 2 + 8),
+            vshrq_n_s32(vmull_s16(vget_low_s16(d.val[1]), gains), 15)));
+        vst1q_s32(acc + i * 2 + 12, vaddq_s32(vld1q_s32(acc + i * 2 + 12),
+            vshrq_n_s32(vmull_s16(vget_high_s16(d.val[1]), gains), 15)));
+    }
+
+    I_Mix_MixScalar(acc + i * 2, in + i, n - i, left, right);
+}
+
+static void I_Mix_ClipNEON(int16_t *out, const int32_t *acc, int n)
+{
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(vld1q_s32(acc + i)),
+                                        vqmovn_s32(vld1q_s32(acc + i + 4))));
+    }
+
+    I_Mix_ClipScalar(out + i, acc + i, n - i);
+}
+
+#endif
+
+// All of them give the same output.
+
+static const struct
+{
+    char *name;
+    mixfunc_t mix;
+    clipfunc_t clip;
+} mixers[] =
+{
+#ifdef HAVE_MIX_NEON
+    { "neon", I_Mix_MixNEON, I_Mix_ClipNEON },
+#endif
+#ifdef HAVE_MIX_X86
+    { "sse2", I_Mix_MixSSE2, I_Mix_ClipSSE2 },
+#endif
+    { "scalar", I_Mix_MixScalar, I_Mix_ClipScalar },
+};
+
+static boolean I_Mix_Supported(int i)
+{
+#ifdef HAVE_MIX_X86
+    if (mixers[i].mix == I_Mix_MixSSE2)
+    {
+        return __builtin_cpu_supports("sse2");
+    }
+#endif
+
+    return true;
+}
+
+static boolean I_Mix_InitMixer(void)
+{
+    char *name = NULL;
+    int i;
+
+    //!
+    // @arg <name>
+    // @category sound
+    //
+    // Sound mixer to use: sse2, neon or scalar.  The default is the
+    // fastest one the CPU supports.
+    //
+
+    i = M_CheckParmWithArgs("-mixer", 1);
+
+    if (i > 0)
+    {
+        name = myargv[i + 1];
+    }
+
+    for (i = 0; i < arrlen(mixers); ++i)
+    {
+        if (name != NULL && strcmp(name, mixers[i].name) != 0)
+        {
+            continue;
+        }
+
+        if (I_Mix_Supported(i))
+        {
+            mixfunc = mixers[i].mix;
+            clipfunc = mixers[i].clip;
+            printf("I_InitSound: %s mixer at %d Hz\n",
+                   mixers[i].name, snd_samplerate);
+            return true;
+        }
+    }
+
+    fprintf(stderr, "I_InitSound: unsupported -mixer option '%s'\n", name);
+
+    return false;
+}
+
+// Mix the next frames of all channels into out, or only move the
+// channels on if out is NULL.
+
+static void I_Mix_MixFrames(int16_t *out, int frames)
+{
+    int32_t acc[MIX_BLOCK * 2];
+    mixchannel_t *channel;
+    int i, n;
+
+    if (out != NULL)
+    {
+        memset(acc, 0, frames * 2 * sizeof(*acc));
+    }
+
+    for (i = 0; i < NUM_CHANNELS; ++i)
+    {
+        channel = &channels[i];
+
+        if (channel->sound == NULL)
+        {
+            continue;
+        }
+
+        n = channel->sound->length - channel->position;
+
+        if (n > frames)
+        {
+            n = frames;
+        }
+
+        if (out != NULL)
+        {
+            mixfunc(acc, channel->sound->samples + channel->position, n,
+                    channel->left, channel->right);
+        }
+
+        channel->position += n;
+
+        if (channel->position >= channel->sound->length)
+        {
+            channel->sound = NULL;
+        }
+    }
+
+    I_MixMusic(out != NULL ? acc : NULL, frames);
+
+    if (out != NULL)
+    {
+        clipfunc(out, acc, frames * 2);
+    }
+}
+
+// Mix frames into the ring, as far as there is room for them.
+
+static void I_Mix_MixToRing(dg_audioring_t *ring, int frames)
+{
+    unsigned int write, space;
+    int n;
+
+    write = ring->write;
+    space = DG_AUDIO_FRAMES - (write - LOAD_ACQUIRE(&ring->read));
+
+    while (frames > 0 && space > 0)
+    {
+        // Up to the end of the ring
+        n = DG_AUDIO_FRAMES - write % DG_AUDIO_FRAMES;
+
+        if (n > MIX_BLOCK)
+        {
+            n = MIX_BLOCK;
+        }
+        if ((unsigned int) n > space)
+        {
+            n = space;
+        }
+        if (n > frames)
+        {
+            n = frames;
+        }
+
+        I_Mix_MixFrames(ring->samples + (write % DG_AUDIO_FRAMES) * 2, n);
+
+        write += n;
+        space -= n;
+        frames -= n;
+
+        STORE_RELEASE(&ring->write, write);
+    }
+
+    if (frames > 0)
+    {
+        ring->dropped += frames;
+    }
+
+    // The sound goes on, heard or not.
+
+    while (frames > 0)
+    {
+        n = frames < MIX_BLOCK ? frames : MIX_BLOCK;
+        I_Mix_MixFrames(NULL, n);
+        frames -= n;
+    }
+}
+
+
+//
+// Sound effects
+//
+
+// Load a sound effect and resample it to snd_samplerate.
+// Returns true if successful
+
+static boolean CacheSFX(sfxinfo_t *sfxinfo)
+{
+    int lumpnum;
+    unsigned int lumplen;
+    int samplerate;
+    unsigned int length;
+    byte *data;
+    mixsound_t *sound;
+    int16_t a, b;
+    uint64_t step, pos;
+    unsigned int i, j;
+    int frac;
+
+    // need to load the sound
+
+    lumpnum = sfxinfo->lumpnum;
+    data = W_CacheLumpNum(lumpnum, PU_STATIC);
+    lumplen = W_LumpLength(lumpnum);
+
+    // Check the header, and ensure this is a valid sound
+
+    if (lumplen < 8
+     || data[0] != 0x03 || data[1] != 0x00)
+    {
+        // Invalid sound
+
+        W_ReleaseLumpNum(lumpnum);
+
+        return false;
+    }
+
+    // 16 bit sample rate field, 32 bit length field
+
+    samplerate = (data[3] << 8) | data[2];
+    length = (data[7] << 24) | (data[6] << 16) | (data[5] << 8) | data[4];
+
+    // If the header specifies that the length of the sound is greater than
+    // the length of the lump itself, this is an invalid sound lump
+
+    // We also discard sound lumps that are less than 49 samples long,
+    // as this is how DMX behaves.
+
+    if (length > lumplen - 8 || length <= 48 || samplerate == 0)
+    {
+        W_ReleaseLumpNum(lumpnum);
+
+        return false;
+    }
+
+    // The DMX sound library seems to skip the first 16 and last 16
+    // bytes of the lump - reason unknown.
+
+    data += 16;
+    length -= 32;
+
+    // Linear interpolation between the 8 bit samples, stepping through
+    // them in 16.16 fixed point.
+
+    step = ((uint64_t) samplerate << 16) / snd_samplerate;
+
+    sound = malloc(sizeof(mixsound_t) + sizeof(int16_t)
+                 * (((uint64_t) length << 16) / step + 1));
+
+    if (sound == NULL)
+    {
+        W_ReleaseLumpNum(lumpnum);
+
+        return false;
+    }
+
+    for (i = 0, pos = 0; (j = pos >> 16) < length; ++i, pos += step)
+    {
+        frac = pos & 0xffff;
+        a = (data[j] - 128) << 8;
+        b = j + 1 < length ? (data[j + 1] - 128) << 8 : a;
+
+        sound->samples[i] = a + (((b - a) * (int64_t) frac) >> 16);
+    }
+
+    sound->length = i;
+
+    sfxinfo->driver_data = sound;
+
+    // don't need the original lump any more
+
+    W_ReleaseLumpNum(lumpnum);
+
+    return true;
+}
+
+
+static void GetSfxLumpName(sfxinfo_t *sfx, char *buf, size_t buf_len)
+{
+    // Linked sfx lumps? Get the lump number for the sound linked to.
+
+    if (sfx->link != NULL)
+    {
+        sfx = sfx->link;
+    }
+
+    // Doom adds a DS* prefix to sound lumps; Heretic and Hexen don't
+    // do this.
+
+    if (use_sfx_prefix)
+    {
+        M_snprintf(buf, buf_len, "ds%s", DEH_String(sfx->name));
+    }
+    else
+    {
+        M_StringCopy(buf, DEH_String(sfx->name), buf_len);
+    }
+}
+
+
+// Every sound is resampled here once, so that playing one costs no
+// more than mixing it.  Linked sounds share the data of the sound they
+// are linked to.
+
+static void I_Mix_PrecacheSounds(sfxinfo_t *sounds, int num_sounds)
+{
+    char namebuf[9];
+    int i;
+
+    printf("I_Mix_PrecacheSounds: Precaching all sound effects..");
+
+    for (i=0; i<num_sounds; ++i)
+    {
+        if ((i % 6) == 0)
+        {
+            printf(".");
+            fflush(stdout);
+        }
+
+        if (sounds[i].link != NULL || sounds[i].driver_data != NULL)
+        {
+            continue;
+        }
+
+        GetSfxLumpName(&sounds[i], namebuf, sizeof(namebuf));
+
+        sounds[i].lumpnum = W_CheckNumForName(namebuf);
+
+        if (sounds[i].lumpnum != -1)
+        {
+            CacheSFX(&sounds[i]);
+        }
+    }
+
+    for (i=0; i<num_sounds; ++i)
+    {
+        if (sounds[i].link != NULL)
+        {
+            sounds[i].driver_data = sounds[i].link->driver_data;
+        }
+    }
+
+    printf("\n");
+}
+
+
+//
+// Retrieve the raw data lump index
+//  for a given SFX name.
+//
+
+static int I_Mix_GetSfxLumpNum(sfxinfo_t *sfx)
+{
+    char namebuf[9];
+
+    GetSfxLumpName(sfx, namebuf, sizeof(namebuf));
+
+    return W_GetNumForName(namebuf);
+}
+
+static void I_Mix_UpdateSoundParams(int handle, int vol, int sep)
+{
+    int left, right;
+
+    if (!sound_initialized || handle < 0 || handle >= NUM_CHANNELS)
+    {
+        return;
+    }
+
+    left = ((254 - sep) * vol) / 127;
+    right = (sep * vol) / 127;
+
+    if (left < 0) left = 0;
+    else if ( left > 255) left = 255;
+    if (right < 0) right = 0;
+    else if (right > 255) right = 255;
+
+    // Full volume in the middle is half of the gain on each side.
+
+    channels[handle].left = left << 7;
+    channels[handle].right = right << 7;
+}
+
+//
+// Starting a sound means adding it
+//  to the current list of active sounds
+//  in the internal channels.
+//
+
+static int I_Mix_StartSound(sfxinfo_t *sfxinfo, int channel, int vol, int sep)
+{
+    if (!sound_initialized || channel < 0 || channel >= NUM_CHANNELS)
+    {
+        return -1;
+    }
+
+    // Get the sound data
+
+    if (sfxinfo->driver_data == NULL)
+    {
+        if (!CacheSFX(sfxinfo))
+        {
+            return -1;
+        }
+    }
+
+    // Replaces whatever was playing on this channel.
+
+    channels[channel].sound = sfxinfo->driver_data;
+    channels[channel].position = 0;
+
+    I_Mix_UpdateSoundParams(channel, vol, sep);
+
+    return channel;
+}
+
+
+static void I_Mix_StopSound(int handle)
+{
+    if (!sound_initialized || handle < 0 || handle >= NUM_CHANNELS)
+    {
+        return;
+    }
+
+    channels[handle].sound = NULL;
+}
+
+
+static boolean I_Mix_SoundIsPlaying(int handle)
+{
+    if (!sound_initialized || handle < 0 || handle >= NUM_CHANNELS)
+    {
+        return false;
+    }
+
+    return channels[handle].sound != NULL;
+}
+
+//
+// Periodically called to update the sound system.  Mixes the sound
+// due since the last call, or with snd_ticsync the sound of the tic
+// that has just run.
+//
+
+static void I_Mix_UpdateSound(void)
+{
+    uint64_t now, due;
+    int frames;
+
+    if (!sound_initialized)
+    {
+        return;
+    }
+
+    if (snd_ticsync)
+    {
+        // Whole frames that add up to exactly 1/35 s a tic.
+        ++mix_tics;
+        frames = mix_tics * snd_samplerate / TICRATE - mix_frames;
+    }
+    else
+    {
+        now = I_GetTimeNS() / 1000;
+
+        if (mix_start == 0)
+        {
+            mix_start = now;
+        }
+
+        due = (now - mix_start) * snd_samplerate / 1000000 - mix_frames;
+
+        if (due > (uint64_t) MAX_MIX_TICS * snd_samplerate / TICRATE)
+        {
+            frames = MAX_MIX_TICS * snd_samplerate / TICRATE;
+            mix_frames += due - frames;
+        }
+        else
+        {
+            frames = due;
+        }
+    }
+
+    mix_frames += frames;
+
+    if (DG_AudioRing != NULL)
+    {
+        I_Mix_MixToRing(DG_AudioRing, frames);
+    }
+    else
+    {
+        while (frames > 0)
+        {
+            due = frames < MIX_BLOCK ? frames : MIX_BLOCK;
+            I_Mix_MixFrames(NULL, due);
+            frames -= due;
+        }
+    }
+}
+
+
+static void I_Mix_ShutdownSound(void)
+{
+    int i;
+
+    if (!sound_initialized)
+    {
+        return;
+    }
+
+    for (i = 0; i < NUM_CHANNELS; i++)
+    {
+        channels[i].sound = NULL;
+    }
+
+    // Linked sounds may only borrow their data.
+
+    for (i = 0; i < NUMSFX; i++)
+    {
+        if (S_sfx[i].link == NULL
+         || S_sfx[i].driver_data != S_sfx[i].link->driver_data)
+        {
+            free(S_sfx[i].driver_data);
+        }
+    }
+
+    for (i = 0; i < NUMSFX; i++)
+    {
+        S_sfx[i].driver_data = NULL;
+    }
+
+    sound_initialized = false;
+}
+
+
+static boolean I_Mix_InitSound(boolean _use_sfx_prefix)
+{
+    int i;
+
+    use_sfx_prefix = _use_sfx_prefix;
+
+    // No sounds yet
+
+    for (i=0; i<NUM_CHANNELS; ++i)
+    {
+        channels[i].sound = NULL;
+    }
+
+    if (snd_samplerate <= 0 || !I_Mix_InitMixer())
+    {
+        return false;
+    }
+
+    if (DG_AudioRing != NULL)
+    {
+        DG_AudioRing->rate = snd_samplerate;
+    }
+
+    mix_start = 0;
+    mix_frames = 0;
+    mix_tics = 0;
+
+    sound_initialized = true;
+
+    return true;
+}
+
+
+static snddevice_t sound_mix_devices[] =
+{
+    SNDDEVICE_SB,
+    SNDDEVICE_PAS,
+    SNDDEVICE_GUS,
+    SNDDEVICE_WAVEBLASTER,
+    SNDDEVICE_SOUNDCANVAS,
+    SNDDEVICE_AWE32,
+};
+
+
+sound_module_t DG_sound_module =
+{
+    sound_mix_devices,
+    arrlen(sound_mix_devices),
+    I_Mix_InitSound,
+    I_Mix_ShutdownSound,
+    I_Mix_GetSfxLumpNum,
+    I_Mix_UpdateSound,
+    I_Mix_UpdateSoundParams,
+    I_Mix_StartSound,
+    I_Mix_StopSound,
+    I_Mix_SoundIsPlaying,
+    I_Mix_PrecacheSounds,
+};
+
@@ -34,26 +34,26 @@
 
 // Should be I_VideoBuffer
 
-static byte *src_buffer;
+static THREADLOCAL byte *src_buffer;
 
 // Destination buffer, ie. screen->pixels.
 
-static byte *dest_buffer;
+static THREADLOCAL byte *dest_buffer;
 
 // Pitch of destination buffer, ie. screen->pitch.
 
-static int dest_pitch;
+static THREADLOCAL int dest_pitch;
 
 // Lookup tables used for aspect ratio correction stretching code.
 // stretch_tables[0] : 20% / 80%
 // stretch_tables[1] : 40% / 60%
 // All other combinations can be reached from these two tables.
 
-static byte *stretch_tables[2] = { NULL, NULL };
+static THREADLOCAL byte *stretch_tables[2] = { NULL, NULL };
 
 // 50%/50% stretch table, for 800x600 squash mode
 
-static byte *half_stretch_table = NULL;
+static THREADLOCAL byte *half_stretch_table = NULL;
 
 // Called to set the source and destination buffers before doing the
 // scale.
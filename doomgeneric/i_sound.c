@@ -18,10 +18,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#if defined(FEATURE_SOUND) && !defined(__DJGPP__)
-#include <SDL_mixer.h>
-#endif
-
 #include "config.h"
 #include "doomfeatures.h"
 #include "doomtype.h"
@@ -36,42 +32,47 @@
 
 // Sound sample rate to use for digital output (Hz)
 
-int snd_samplerate = 44100;
+THREADLOCAL int snd_samplerate = 44100;
 
 // Maximum number of bytes to dedicate to allocated sound effects.
 // (Default: 64MB)
 
-int snd_cachesize = 64 * 1024 * 1024;
+THREADLOCAL int snd_cachesize = 64 * 1024 * 1024;
 
 // Config variable that controls the sound buffer size.
 // We default to 28ms (1000 / 35fps = 1 buffer per tic).
 
-int snd_maxslicetime_ms = 28;
+THREADLOCAL int snd_maxslicetime_ms = 28;
 
 // External command to invoke to play back music.
 
-char *snd_musiccmd = "";
+THREADLOCAL char *snd_musiccmd = "";
+
+// If true, the sound is updated at the end of every tic and the mixer
+// makes exactly one tic of it, instead of what the clock says.
+
+THREADLOCAL boolean snd_ticsync = false;
 
 // Low-level sound and music modules we are using
 
-static sound_module_t *sound_module = NULL;
-static music_module_t *music_module = NULL;
+static THREADLOCAL sound_module_t *sound_module = NULL;
+static THREADLOCAL music_module_t *music_module = NULL;
 
-int snd_musicdevice = SNDDEVICE_SB;
-int snd_sfxdevice = SNDDEVICE_SB;
+THREADLOCAL int snd_musicdevice = SNDDEVICE_SB;
+THREADLOCAL int snd_sfxdevice = SNDDEVICE_SB;
 
 // DOS-specific options: These are unused but should be maintained
 // so that the config file can be shared between chocolate
 // doom and doom.exe
 
-static int snd_sbport = 0;
-static int snd_sbirq = 0;
-static int snd_sbdma = 0;
-static int snd_mport = 0;
+static THREADLOCAL int snd_sbport = 0;
+static THREADLOCAL int snd_sbirq = 0;
+static THREADLOCAL int snd_sbdma = 0;
+static THREADLOCAL int snd_mport = 0;
 
 // Compiled-in sound modules:
 
-static sound_module_t *sound_modules[] = 
+static THREADLOCAL sound_module_t *sound_modules[] = 
 {
     #ifdef FEATURE_SOUND
     &DG_sound_module,
@@ -169,6 +170,21 @@ void I_InitSound(boolean use_sfx_prefix)
 
     nomusic = M_CheckParm("-nomusic") > 0;
 
+    //!
+    // @category sound
+    //
+    // Make 1/35 second of sound for every tic the game runs, rather
+    // than as much as the clock says, so that the sound keeps in step
+    // with the frames when the game runs faster or slower than real
+    // time (-timedemo, -singletics).  Only the mixer of i_mixsound.c
+    // supports this.
+    //
+
+    if (M_CheckParm("-sndtics") > 0)
+    {
+        snd_ticsync = true;
+    }
+
     // Initialize the sound and music subsystems.
 
     if (!nosound && !screensaver_mode)
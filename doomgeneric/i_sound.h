@@ -225,12 +225,13 @@ void I_PlaySong(void *handle, boolean looping);
 void I_StopSong(void);
 boolean I_MusicIsPlaying(void);
 
-extern int snd_sfxdevice;
-extern int snd_musicdevice;
-extern int snd_samplerate;
-extern int snd_cachesize;
-extern int snd_maxslicetime_ms;
-extern char *snd_musiccmd;
+extern THREADLOCAL int snd_sfxdevice;
+extern THREADLOCAL int snd_musicdevice;
+extern THREADLOCAL int snd_samplerate;
+extern THREADLOCAL int snd_cachesize;
+extern THREADLOCAL int snd_maxslicetime_ms;
+extern THREADLOCAL char *snd_musiccmd;
+extern THREADLOCAL boolean snd_ticsync;
 
 void I_BindSoundVariables(void);
 
@@ -241,6 +242,12 @@ void I_InitTimidityConfig(void);
 extern sound_module_t DG_sound_module;
 extern music_module_t DG_music_module;
 #endif
+
+// For the software mixer: i_mixsound.c adds the music of i_mixmusic.c
+// to each block of 32 bit stereo samples it mixes, or only lets the song
+// go on if acc is NULL.
+
+void I_MixMusic(int32_t *acc, int frames);
 extern sound_module_t sound_pcsound_module;
 extern music_module_t music_opl_module;
 
@@ -68,7 +68,7 @@ struct atexit_listentry_s
     atexit_listentry_t *next;
 };
 
-static atexit_listentry_t *exit_funcs = NULL;
+static THREADLOCAL atexit_listentry_t *exit_funcs = NULL;
 
 void I_AtExit(atexit_func_t func, boolean run_on_error)
 {
@@ -325,7 +325,7 @@ static int ZenityErrorBox(char *message)
     int result;
     char *escaped_message;
     char *errorboxpath;
-    static size_t errorboxpath_size;
+    static THREADLOCAL size_t errorboxpath_size;
 
     if (!ZenityAvailable())
     {
@@ -354,7 +354,7 @@ static int ZenityErrorBox(char *message)
 // I_Error
 //
 
-static boolean already_quitting = false;
+static THREADLOCAL boolean already_quitting = false;
 
 void I_Error (char *error, ...)
 {
@@ -496,13 +496,13 @@ static const unsigned char mem_dump_win98[DOS_MEM_DUMP_SIZE] = {
   0x9E, 0x0F, 0xC9, 0x00, 0x65, 0x04, 0x70, 0x00, 0x16, 0x00};
 static const unsigned char mem_dump_dosbox[DOS_MEM_DUMP_SIZE] = {
   0x00, 0x00, 0x00, 0xF1, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00};
-static unsigned char mem_dump_custom[DOS_MEM_DUMP_SIZE];
+static THREADLOCAL unsigned char mem_dump_custom[DOS_MEM_DUMP_SIZE];
 
-static const unsigned char *dos_mem_dump = mem_dump_dos622;
+static THREADLOCAL const unsigned char *dos_mem_dump = mem_dump_dos622;
 
 boolean I_GetMemoryValue(unsigned int offset, void *value, int size)
 {
-    static boolean firsttime = true;
+    static THREADLOCAL boolean firsttime = true;
 
     if (firsttime)
     {
@@ -23,6 +23,15 @@
 
 #include <stdarg.h>
 
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#if defined(_POSIX_TIMERS)
+#include <time.h>
+#endif
+#endif
+
 //#include <sys/time.h>
 //#include <unistd.h>
 
@@ -32,7 +41,7 @@
 // returns time in 1/35th second tics
 //
 
-static uint32_t basetime = 0;
+static THREADLOCAL uint32_t basetime = 0;
 
 
 int I_GetTicks(void)
@@ -71,6 +80,38 @@ int I_GetTimeMS(void)
     return ticks - basetime;
 }
 
+//
+// I_GetTimeNS
+// A fine grained clock for profiling; only differences between two
+// calls mean anything.  Where there is no such clock it counts in
+// whole milliseconds.
+//
+
+uint64_t I_GetTimeNS(void)
+{
+#if defined(_WIN32)
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+
+    if (freq.QuadPart == 0)
+        QueryPerformanceFrequency(&freq);
+
+    QueryPerformanceCounter(&now);
+
+    return (uint64_t) (now.QuadPart / freq.QuadPart) * 1000000000
+         + (uint64_t) (now.QuadPart % freq.QuadPart) * 1000000000
+           / freq.QuadPart;
+#elif defined(_POSIX_TIMERS) && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+    return (uint64_t) DG_GetTicksMs() * 1000000;
+#endif
+}
+
 // Sleep for a specified number of ms
 
 void I_Sleep(int ms)
@@ -28,10 +28,12 @@ rcsid[] = "$Id: i_x.c,v 1.6 1997/02/03 22:45:10 b1 Exp $";
 #include "config.h"
 #include "v_video.h"
 #include "m_argv.h"
+#include "m_bench.h"
 #include "d_event.h"
 #include "d_main.h"
 #include "i_video.h"
 #include "i_system.h"
+#include "i_timer.h"
 #include "z_zone.h"
 
 #include "tables.h"
@@ -48,6 +50,16 @@ rcsid[] = "$Id: i_x.c,v 1.6 1997/02/03 22:45:10 b1 Exp $";
 
 #include <sys/types.h>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_CONVERTROW_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define HAVE_CONVERTROW_NEON
+#include <arm_neon.h>
+#endif
+
 //#define CMAP256
 
 struct FB_BitField
@@ -72,9 +84,9 @@ struct FB_ScreenInfo
 	struct FB_BitField transp;	/* transparency			*/
 };
 
-static struct FB_ScreenInfo s_Fb;
-int fb_scaling = 1;
-int usemouse = 0;
+static THREADLOCAL struct FB_ScreenInfo s_Fb;
+THREADLOCAL int fb_scaling = 1;
+THREADLOCAL int usemouse = 0;
 
 
 #ifdef CMAP256
@@ -84,7 +96,7 @@ struct color colors[256];
 
 #else  // CMAP256
 
-static struct color colors[256];
+static THREADLOCAL struct color colors[256];
 
 
 #endif  // CMAP256
@@ -94,16 +106,16 @@ void I_GetEvent(void);
 
 // The screen buffer; this is modified to draw things to the screen
 
-byte *I_VideoBuffer = NULL;
+THREADLOCAL byte *I_VideoBuffer = NULL;
 
 // If true, game is running as a screensaver
 
-boolean screensaver_mode = false;
+THREADLOCAL boolean screensaver_mode = false;
 
 // Flag indicating whether the screen is currently visible:
 // when the screen isnt visible, don't render the screen
 
-boolean screenvisible;
+THREADLOCAL boolean screenvisible;
 
 // Mouse acceleration
 //
@@ -114,12 +126,12 @@ boolean screenvisible;
 // the values exceed the value of mouse_threshold, they are multiplied
 // by mouse_acceleration to increase the speed.
 
-float mouse_acceleration = 2.0;
-int mouse_threshold = 10;
+THREADLOCAL float mouse_acceleration = 2.0;
+THREADLOCAL int mouse_threshold = 10;
 
 // Gamma correction level to use
 
-int usegamma = 0;
+THREADLOCAL int usegamma = 0;
 
 typedef struct
 {
@@ -130,7 +142,7 @@ typedef struct
 
 // Palette converted to RGB565
 
-static uint16_t rgb565_palette[256];
+static THREADLOCAL uint16_t rgb565_palette[256];
 
 void cmap_to_rgb565(uint16_t * out, uint8_t * in, int in_pixels)
 {
@@ -202,6 +214,380 @@ void cmap_to_fb(uint8_t *out, uint8_t *in, int in_pixels)
     }
 }
 
+
+#ifndef CMAP256
+
+//
+// Fast conversion for 32 bit framebuffers.  The palette is packed into
+// framebuffer pixels once when it changes, so that a scanline is just a
+// table lookup per pixel.  The lookup has SSE2, AVX2 and NEON versions,
+// of which the best one the CPU supports is picked at startup.
+//
+
+typedef void (*convertrow_t)(uint32_t *out, const byte *in, int n);
+
+static THREADLOCAL uint32_t fb_palette[256];
+static THREADLOCAL boolean fb_palette_changed = true;
+static THREADLOCAL convertrow_t convertrow;
+
+#ifdef HAVE_CONVERTROW_NEON
+// The bytes of the packed palette, in memory order
+static THREADLOCAL uint8_t fb_planes[4][256];
+#endif
+
+static void I_PackPalette(void)
+{
+    int i;
+    uint32_t pix;
+
+    for (i = 0; i < 256; ++i)
+    {
+        pix = (colors[i].r << s_Fb.red.offset) |
+              (colors[i].g << s_Fb.green.offset) |
+              (colors[i].b << s_Fb.blue.offset);
+
+#ifdef SYS_BIG_ENDIAN
+        pix = swapLE32(pix);
+#endif
+        fb_palette[i] = pix;
+
+#ifdef HAVE_CONVERTROW_NEON
+        fb_planes[0][i] = ((byte *) &fb_palette[i])[0];
+        fb_planes[1][i] = ((byte *) &fb_palette[i])[1];
+        fb_planes[2][i] = ((byte *) &fb_palette[i])[2];
+        fb_planes[3][i] = ((byte *) &fb_palette[i])[3];
+#endif
+    }
+
+    fb_palette_changed = false;
+}
+
+static void I_ConvertRowScalar(uint32_t *out, const byte *in, int n)
+{
+    int i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        out[i] = fb_palette[in[i]];
+        out[i + 1] = fb_palette[in[i + 1]];
+        out[i + 2] = fb_palette[in[i + 2]];
+        out[i + 3] = fb_palette[in[i + 3]];
+    }
+
+    for (; i < n; ++i)
+    {
+        out[i] = fb_palette[in[i]];
+    }
+}
+
+#ifdef HAVE_CONVERTROW_X86
+
+// SSE2 has no gather, but four lookups can still be stored at once.
+
+__attribute__((target("sse2")))
+static void I_ConvertRowSSE2(uint32_t *out, const byte *in, int n)
+{
+    const uint32_t *pal = fb_palette;
+    __m128i a, b;
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        a = _mm_setr_epi32(pal[in[i]], pal[in[i + 1]],
+                           pal[in[i + 2]], pal[in[i + 3]]);
+        b = _mm_setr_epi32(pal[in[i + 4]], pal[in[i + 5]],
+                           pal[in[i + 6]], pal[in[i + 7]]);
+        _mm_storeu_si128((__m128i *) (out + i), a);
+        _mm_storeu_si128((__m128i *) (out + i + 4), b);
+    }
+
+    for (; i < n; ++i)
+    {
+        out[i] = pal[in[i]];
+    }
+}
+
+__attribute__((target("avx2")))
+static void I_ConvertRowAVX2(uint32_t *out, const byte *in, int n)
+{
+    const int *pal = (const int *) fb_palette;
+    __m256i idx, a, b;
+    int i;
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (in + i)));
+        a = _mm256_i32gather_epi32(pal, idx, 4);
+        idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (in + i + 8)));
+        b = _mm256_i32gather_epi32(pal, idx, 4);
+        _mm256_storeu_si256((__m256i *) (out + i), a);
+        _mm256_storeu_si256((__m256i *) (out + i + 8), b);
+    }
+
+    for (; i < n; ++i)
+    {
+        out[i] = fb_palette[in[i]];
+    }
+}
+
+#endif
+
+#ifdef HAVE_CONVERTROW_NEON
+
+// NEON looks up each byte of the pixel separately: the palette is split
+// into four 256 byte planes, which take four 64 byte table lookups each.
+// One plane is done for the whole row at a time so that its table stays
+// in registers, then vst4q interleaves the planes into pixels.
+
+static uint8x16x4_t I_LoadTable(const uint8_t *p)
+{
+    uint8x16x4_t t;
+
+    t.val[0] = vld1q_u8(p);
+    t.val[1] = vld1q_u8(p + 16);
+    t.val[2] = vld1q_u8(p + 32);
+    t.val[3] = vld1q_u8(p + 48);
+
+    return t;
+}
+
+static void I_ConvertRowNEON(uint32_t *out, const byte *in, int n)
+{
+    static THREADLOCAL uint8_t row[4][SCREENWIDTH];
+    uint8x16x4_t t0, t1, t2, t3;
+    uint8x16x4_t px;
+    uint8x16_t idx, v;
+    const uint8x16_t k64 = vdupq_n_u8(64);
+    int i, p;
+
+    for (p = 0; p < 4; ++p)
+    {
+        t0 = I_LoadTable(fb_planes[p]);
+        t1 = I_LoadTable(fb_planes[p] + 64);
+        t2 = I_LoadTable(fb_planes[p] + 128);
+        t3 = I_LoadTable(fb_planes[p] + 192);
+
+        for (i = 0; i + 16 <= n; i += 16)
+        {
+            // Out of range indexes give 0 (tbl) or keep the old value
+            // (tbx), so every index is picked up by exactly one lookup.
+            idx = vld1q_u8(in + i);
+            v = vqtbl4q_u8(t0, idx);
+            idx = vsubq_u8(idx, k64);
+            v = vqtbx4q_u8(v, t1, idx);
+            idx = vsubq_u8(idx, k64);
+            v = vqtbx4q_u8(v, t2, idx);
+            idx = vsubq_u8(idx, k64);
+            v = vqtbx4q_u8(v, t3, idx);
+            vst1q_u8(row[p] + i, v);
+        }
+    }
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        px.val[0] = vld1q_u8(row[0] + i);
+        px.val[1] = vld1q_u8(row[1] + i);
+        px.val[2] = vld1q_u8(row[2] + i);
+        px.val[3] = vld1q_u8(row[3] + i);
+        vst4q_u8((uint8_t *) (out + i), px);
+    }
+
+    for (; i < n; ++i)
+    {
+        out[i] = fb_palette[in[i]];
+    }
+}
+
+#endif
+
+static const struct
+{
+    char *name;
+    convertrow_t func;
+} convertrows[] =
+{
+#ifdef HAVE_CONVERTROW_NEON
+    { "neon", I_ConvertRowNEON },
+#endif
+#ifdef HAVE_CONVERTROW_X86
+    { "avx2", I_ConvertRowAVX2 },
+    { "sse2", I_ConvertRowSSE2 },
+#endif
+    { "scalar", I_ConvertRowScalar },
+};
+
+static boolean I_ConvertRowSupported(int i)
+{
+#ifdef HAVE_CONVERTROW_X86
+    if (convertrows[i].func == I_ConvertRowAVX2)
+    {
+        return __builtin_cpu_supports("avx2");
+    }
+    if (convertrows[i].func == I_ConvertRowSSE2)
+    {
+        return __builtin_cpu_supports("sse2");
+    }
+#endif
+
+    return true;
+}
+
+static void I_InitConvertRow(void)
+{
+    char *name = NULL;
+    int i;
+
+    //!
+    // @arg <name>
+    // @category video
+    //
+    // Framebuffer conversion to use: avx2, sse2, neon or scalar.  The
+    // default is the fastest one the CPU supports.
+    //
+
+    i = M_CheckParmWithArgs("-blit", 1);
+
+    if (i > 0)
+    {
+        name = myargv[i + 1];
+    }
+
+    for (i = 0; i < arrlen(convertrows); ++i)
+    {
+        if (name != NULL && strcmp(name, convertrows[i].name) != 0)
+        {
+            continue;
+        }
+
+        if (I_ConvertRowSupported(i))
+        {
+            convertrow = convertrows[i].func;
+            printf("I_InitGraphics: %s framebuffer conversion\n",
+                   convertrows[i].name);
+            return;
+        }
+    }
+
+    I_Error("I_InitGraphics: unsupported -blit option '%s'", name);
+}
+
+// Convert one line of the screen, scaled up by fb_scaling.
+
+static void I_ConvertLine(uint32_t *out, const byte *in)
+{
+    static THREADLOCAL uint32_t row[SCREENWIDTH];
+    int x, k;
+
+    if (fb_scaling == 1)
+    {
+        convertrow(out, in, SCREENWIDTH);
+        return;
+    }
+
+    convertrow(row, in, SCREENWIDTH);
+
+    for (x = 0; x < SCREENWIDTH; ++x)
+    {
+        for (k = 0; k < fb_scaling; ++k)
+        {
+            *out++ = row[x];
+        }
+    }
+}
+
+static void I_BlitScreen (void);
+
+//
+// Time the conversions for -blitbench.  The screen is filled with noise
+// and converted with the plain per pixel loop first, which also gives
+// the reference that the other versions are checked against.
+//
+
+#define BLITBENCH_FRAMES 1000
+
+static void I_BlitBenchmark(void)
+{
+    convertrow_t best = convertrow;
+    size_t size = s_Fb.xres * s_Fb.yres * sizeof(uint32_t);
+    int x_offset = ((s_Fb.xres - SCREENWIDTH * fb_scaling) * 4) / 2;
+    int pitch = s_Fb.xres * 4;
+    uint32_t *reference;
+    byte *line_out;
+    int start, f, i, y, k;
+
+    for (i = 0; i < SCREENWIDTH * SCREENHEIGHT; ++i)
+    {
+        I_VideoBuffer[i] = (i * 2654435761u) >> 24;
+    }
+
+    for (i = 0; i < 256; ++i)
+    {
+        colors[i].r = i;
+        colors[i].g = 255 - i;
+        colors[i].b = i * 3;
+    }
+
+    reference = malloc(size);
+
+    if (reference == NULL)
+    {
+        I_Error("I_BlitBenchmark: out of memory");
+    }
+
+    memset(DG_ScreenBuffer, 0, size);
+    start = I_GetTimeMS();
+
+    for (f = 0; f < BLITBENCH_FRAMES; ++f)
+    {
+        line_out = (byte *) DG_ScreenBuffer + x_offset;
+
+        for (y = 0; y < SCREENHEIGHT; ++y)
+        {
+            for (k = 0; k < fb_scaling; ++k)
+            {
+                cmap_to_fb(line_out, I_VideoBuffer + y * SCREENWIDTH,
+                           SCREENWIDTH);
+                line_out += pitch;
+            }
+        }
+    }
+
+    printf("I_BlitBenchmark: %-6s %7.3f ms/frame\n", "plain",
+           (double) (I_GetTimeMS() - start) / BLITBENCH_FRAMES);
+    memcpy(reference, DG_ScreenBuffer, size);
+
+    for (i = 0; i < arrlen(convertrows); ++i)
+    {
+        if (!I_ConvertRowSupported(i))
+        {
+            continue;
+        }
+
+        convertrow = convertrows[i].func;
+        fb_palette_changed = true;
+        memset(DG_ScreenBuffer, 0, size);
+        start = I_GetTimeMS();
+
+        for (f = 0; f < BLITBENCH_FRAMES; ++f)
+        {
+            I_BlitScreen();
+        }
+
+        printf("I_BlitBenchmark: %-6s %7.3f ms/frame%s\n",
+               convertrows[i].name,
+               (double) (I_GetTimeMS() - start) / BLITBENCH_FRAMES,
+               memcmp(reference, DG_ScreenBuffer, size) ? " MISMATCH" : "");
+    }
+
+    free(reference);
+    convertrow = best;
+    fb_palette_changed = true;
+    memset(I_VideoBuffer, 0, SCREENWIDTH * SCREENHEIGHT);
+    memset(DG_ScreenBuffer, 0, size);
+}
+
+#endif  // CMAP256
+
 void I_InitGraphics (void)
 {
     int i, gfxmodeparm;
@@ -261,6 +647,8 @@ void I_InitGraphics (void)
 	else
 		I_Error("Unknown gfxmode value: %s\n", mode);
 
+	I_InitConvertRow();
+
 
 #endif  // CMAP256
 
@@ -289,6 +677,22 @@ void I_InitGraphics (void)
     /* Allocate screen to draw to */
 	I_VideoBuffer = (byte*)Z_Malloc (SCREENWIDTH * SCREENHEIGHT, PU_STATIC, NULL);  // For DOOM to draw on
 
+#ifndef CMAP256
+
+    //!
+    // @category video
+    //
+    // Time the framebuffer conversions against the plain per pixel
+    // loop, and check that they give the same result.
+    //
+
+    if (M_CheckParm("-blitbench") > 0 && s_Fb.bits_per_pixel == 32)
+    {
+        I_BlitBenchmark();
+    }
+
+#endif  // CMAP256
+
 	screenvisible = true;
 
     extern void I_InitInput(void);
@@ -318,11 +722,14 @@ void I_UpdateNoBlit (void)
 // I_FinishUpdate
 //
 
-void I_FinishUpdate (void)
+static void I_BlitScreen (void)
 {
     int y;
     int x_offset, y_offset, x_offset_end;
     unsigned char *line_in, *line_out;
+#ifndef CMAP256
+    int pitch = s_Fb.xres * s_Fb.bits_per_pixel/8;
+#endif
 
     /* Offsets in case FB is bigger than DOOM */
     /* 600 = s_Fb heigt, 200 screenheight */
@@ -333,6 +740,13 @@ void I_FinishUpdate (void)
     //x_offset     = 0;
     x_offset_end = ((s_Fb.xres - (SCREENWIDTH  * fb_scaling)) * s_Fb.bits_per_pixel/8) - x_offset;
 
+#ifndef CMAP256
+    if (fb_palette_changed)
+    {
+        I_PackPalette();
+    }
+#endif
+
     /* DRAW SCREEN */
     line_in  = (unsigned char *) I_VideoBuffer;
     line_out = (unsigned char *) DG_ScreenBuffer;
@@ -358,15 +772,34 @@ void I_FinishUpdate (void)
                 }
             }
 #else
-            //cmap_to_rgb565((void*)line_out, (void*)line_in, SCREENWIDTH);
-            cmap_to_fb((void*)line_out, (void*)line_in, SCREENWIDTH);
+            if (i > 0) {
+                /* the rest of a scaled up line is a copy of the first */
+                memcpy(line_out, line_out - pitch,
+                       SCREENWIDTH * fb_scaling * (s_Fb.bits_per_pixel/8));
+            } else if (s_Fb.bits_per_pixel == 32) {
+                I_ConvertLine((uint32_t *) line_out, line_in);
+            } else {
+                //cmap_to_rgb565((void*)line_out, (void*)line_in, SCREENWIDTH);
+                cmap_to_fb((void*)line_out, (void*)line_in, SCREENWIDTH);
+            }
 #endif
             line_out += (SCREENWIDTH * fb_scaling * (s_Fb.bits_per_pixel/8)) + x_offset_end;
         }
         line_in += SCREENWIDTH;
     }
+}
+
+void I_FinishUpdate (void)
+{
+    uint64_t start;
+
+    start = M_BenchStart();
+
+    I_BlitScreen();
 
 	DG_DrawFrame();
+
+    M_BenchStop(bench_finishupdate, start);
 }
 
 //
@@ -416,6 +849,10 @@ void I_SetPalette (byte* palette)
 
     palette_changed = true;
 
+#else  // CMAP256
+
+    fb_palette_changed = true;
+
 #endif  // CMAP256
 }
 
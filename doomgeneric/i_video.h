@@ -21,11 +21,36 @@
 #define __I_VIDEO__
 
 #include "doomtype.h"
+#include "doomgeneric.h"
+
+// Screen width and height of the original game.  Menus, the status bar,
+// the intermission and other 2D graphics are laid out in these
+// coordinates; the V_ functions scale them up to the real screen.
+
+#define ORIGWIDTH  320
+#define ORIGHEIGHT 200
+
+// The screen is rendered at the largest whole multiple of the original
+// size that fits in DOOMGENERIC_RESX x DOOMGENERIC_RESY.  Define
+// SCREENSCALE as 1 to get the classic 320x200 buffer that I_FinishUpdate
+// then scales up by itself.
+
+#ifndef SCREENSCALE
+#if DOOMGENERIC_RESX / ORIGWIDTH < DOOMGENERIC_RESY / ORIGHEIGHT
+#define SCREENSCALE (DOOMGENERIC_RESX / ORIGWIDTH)
+#else
+#define SCREENSCALE (DOOMGENERIC_RESY / ORIGHEIGHT)
+#endif
+#endif
+
+#if SCREENSCALE < 1
+#error DOOMGENERIC_RESX x DOOMGENERIC_RESY must be at least 320x200
+#endif
 
 // Screen width and height.
 
-#define SCREENWIDTH  320
-#define SCREENHEIGHT 200
+#define SCREENWIDTH  (ORIGWIDTH * SCREENSCALE)
+#define SCREENHEIGHT (ORIGHEIGHT * SCREENSCALE)
 
 // Screen width used for "squash" scale functions
 
@@ -147,14 +172,14 @@ struct color {
 
 
 extern char *video_driver;
-extern boolean screenvisible;
-
-extern float mouse_acceleration;
-extern int mouse_threshold;
-extern int vanilla_keyboard_mapping;
-extern boolean screensaver_mode;
-extern int usegamma;
-extern byte *I_VideoBuffer;
+extern THREADLOCAL boolean screenvisible;
+
+extern THREADLOCAL float mouse_acceleration;
+extern THREADLOCAL int mouse_threshold;
+extern THREADLOCAL int vanilla_keyboard_mapping;
+extern THREADLOCAL boolean screensaver_mode;
+extern THREADLOCAL int usegamma;
+extern THREADLOCAL byte *I_VideoBuffer;
 
 extern int screen_width;
 extern int screen_height;
@@ -26,8 +26,8 @@
 #include "m_misc.h"
 #include "m_argv.h"  // haleyjd 20110212: warning fix
 
-int		myargc;
-char**		myargv;
+THREADLOCAL int		myargc;
+THREADLOCAL char**		myargv;
 
 
 
@@ -25,8 +25,8 @@
 //
 // MISC
 //
-extern  int	myargc;
-extern  char**	myargv;
+extern THREADLOCAL int	myargc;
+extern THREADLOCAL char**	myargv;
 
 // Returns the position of the given parameter
 // in the arg list (0 if not found).
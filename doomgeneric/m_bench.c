@@ -0,0 +1,69 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Time spent in the main subsystems, for benchmarks.
+//
+
+#include <string.h>
+
+#include "i_timer.h"
+#include "m_bench.h"
+
+THREADLOCAL boolean	benchmarking;
+THREADLOCAL uint64_t	benchtime[NUMBENCHTIMERS];
+
+const char *benchtimernames[NUMBENCHTIMERS] =
+{
+    "P_Ticker",
+    "R_RenderBSPNode",
+    "R_DrawPlanes",
+    "R_DrawMasked",
+    "I_FinishUpdate",
+};
+
+
+//
+// M_BenchStart
+// The clock is only read when benchmarking, so the timers cost a
+// well predicted branch otherwise.
+//
+uint64_t M_BenchStart (void)
+{
+    if (!benchmarking)
+	return 0;
+
+    return I_GetTimeNS ();
+}
+
+
+//
+// M_BenchStop
+//
+void M_BenchStop (benchtimer_t timer, uint64_t start)
+{
+    if (!benchmarking)
+	return;
+
+    benchtime[timer] += I_GetTimeNS () - start;
+}
+
+
+//
+// M_BenchClear
+//
+void M_BenchClear (void)
+{
+    memset (benchtime, 0, sizeof(benchtime));
+}
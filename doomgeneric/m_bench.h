@@ -0,0 +1,51 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Time spent in the main subsystems, for benchmarks.
+//
+
+
+#ifndef __M_BENCH__
+#define __M_BENCH__
+
+#include "doomtype.h"
+
+typedef enum
+{
+    bench_ticker,		// P_Ticker
+    bench_bsp,			// R_RenderBSPNode
+    bench_planes,		// R_DrawPlanes
+    bench_masked,		// R_DrawMasked
+    bench_finishupdate,		// I_FinishUpdate
+
+    NUMBENCHTIMERS
+} benchtimer_t;
+
+// Nothing is timed unless this is set.
+extern THREADLOCAL boolean benchmarking;
+
+// Nanoseconds spent in each subsystem since it was last cleared.
+extern THREADLOCAL uint64_t benchtime[NUMBENCHTIMERS];
+
+extern const char *benchtimernames[NUMBENCHTIMERS];
+
+// Returns the time to pass to M_BenchStop, or 0 when not benchmarking.
+uint64_t M_BenchStart (void);
+
+void M_BenchStop (benchtimer_t timer, uint64_t start);
+
+void M_BenchClear (void);
+
+#endif
@@ -0,0 +1,274 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Compression of blocks of memory.
+//
+//      The data is written in the LZ4 block format: a sequence of
+//      runs of literal bytes, each followed by a copy of earlier
+//      output from at most 64 KB back.  Matches are found through a
+//      small hash table of the last place each four byte sequence
+//      was seen, so it is fast rather than small, which suits game
+//      state with its long runs of zeroes and repeated records.
+//
+
+#include <string.h>
+
+#include "m_compress.h"
+
+#define MINMATCH        4
+#define MAXOFFSET       65535
+
+// The format wants the last five bytes to be literals, and the last
+// match to start twelve bytes before the end at the latest.
+#define LASTLITERALS    5
+#define MFLIMIT         12
+
+#define HASHBITS        12
+
+static unsigned int Read32(const byte *p)
+{
+    unsigned int value;
+
+    memcpy(&value, p, sizeof(value));
+
+    return value;
+}
+
+static unsigned int Hash(unsigned int sequence)
+{
+    return (sequence * 2654435761U) >> (32 - HASHBITS);
+}
+
+// Lengths of 15 and more continue in bytes of up to 255 each.
+
+static byte *WriteLength(byte *out, size_t length)
+{
+    while (length >= 255)
+    {
+        *out++ = 255;
+        length -= 255;
+    }
+
+    *out++ = (byte) length;
+
+    return out;
+}
+
+static byte *WriteSequence(byte *out, const byte *literals,
+                           size_t literal_length, size_t offset,
+                           size_t match_length)
+{
+    byte *token = out++;
+
+    if (literal_length >= 15)
+    {
+        *token = 15 << 4;
+        out = WriteLength(out, literal_length - 15);
+    }
+    else
+    {
+        *token = (byte) (literal_length << 4);
+    }
+
+    memcpy(out, literals, literal_length);
+    out += literal_length;
+
+    // The last sequence is only literals.
+
+    if (match_length == 0)
+    {
+        return out;
+    }
+
+    *out++ = offset & 0xff;
+    *out++ = (offset >> 8) & 0xff;
+
+    match_length -= MINMATCH;
+
+    if (match_length >= 15)
+    {
+        *token |= 15;
+        out = WriteLength(out, match_length - 15);
+    }
+    else
+    {
+        *token |= (byte) match_length;
+    }
+
+    return out;
+}
+
+size_t M_CompressBound(size_t length)
+{
+    return length + length / 255 + 16;
+}
+
+size_t M_Compress(const byte *src, size_t length, byte *dest)
+{
+    int table[1 << HASHBITS];
+    const byte *in = src;
+    const byte *anchor = src;
+    const byte *end = src + length;
+    const byte *match;
+    byte *out = dest;
+    unsigned int sequence;
+    unsigned int h;
+    size_t match_length;
+
+    memset(table, 0, sizeof(table));
+
+    if (length > MFLIMIT)
+    {
+        while (in < end - MFLIMIT)
+        {
+            sequence = Read32(in);
+            h = Hash(sequence);
+            match = src + table[h];
+            table[h] = (int) (in - src);
+
+            if (match >= in || in - match > MAXOFFSET
+             || Read32(match) != sequence)
+            {
+                ++in;
+                continue;
+            }
+
+            // Take in what matches before, too.
+
+            while (in > anchor && match > src && in[-1] == match[-1])
+            {
+                --in;
+                --match;
+            }
+
+            match_length = MINMATCH;
+
+            while (in + match_length < end - LASTLITERALS
+                && in[match_length] == match[match_length])
+            {
+                ++match_length;
+            }
+
+            out = WriteSequence(out, anchor, in - anchor, in - match,
+                                match_length);
+
+            in += match_length;
+            anchor = in;
+        }
+    }
+
+    out = WriteSequence(out, anchor, end - anchor, 0, 0);
+
+    return out - dest;
+}
+
+// Reads the rest of a length of 15 or more.
+
+static boolean ReadLength(const byte **in, const byte *end, size_t *length)
+{
+    byte b;
+
+    do
+    {
+        if (*in >= end)
+        {
+            return false;
+        }
+
+        b = *(*in)++;
+        *length += b;
+    } while (b == 255);
+
+    return true;
+}
+
+boolean M_Decompress(const byte *src, size_t length,
+                     byte *dest, size_t dest_length)
+{
+    const byte *in = src;
+    const byte *end = src + length;
+    const byte *match;
+    byte *out = dest;
+    byte *out_end = dest + dest_length;
+    size_t literal_length;
+    size_t match_length;
+    size_t offset;
+    byte token;
+
+    while (in < end)
+    {
+        token = *in++;
+
+        literal_length = token >> 4;
+
+        if (literal_length == 15 && !ReadLength(&in, end, &literal_length))
+        {
+            return false;
+        }
+
+        if (literal_length > (size_t) (end - in)
+         || literal_length > (size_t) (out_end - out))
+        {
+            return false;
+        }
+
+        memcpy(out, in, literal_length);
+        in += literal_length;
+        out += literal_length;
+
+        if (in == end)
+        {
+            break;
+        }
+
+        if (end - in < 2)
+        {
+            return false;
+        }
+
+        offset = in[0] | (in[1] << 8);
+        in += 2;
+
+        if (offset == 0 || offset > (size_t) (out - dest))
+        {
+            return false;
+        }
+
+        match_length = token & 15;
+
+        if (match_length == 15 && !ReadLength(&in, end, &match_length))
+        {
+            return false;
+        }
+
+        match_length += MINMATCH;
+
+        if (match_length > (size_t) (out_end - out))
+        {
+            return false;
+        }
+
+        // The copy may overlap what it writes, which repeats it.
+
+        match = out - offset;
+
+        while (match_length-- > 0)
+        {
+            *out++ = *match++;
+        }
+    }
+
+    return out == out_end;
+}
@@ -0,0 +1,39 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Compression of blocks of memory.
+//
+
+
+#ifndef __M_COMPRESS__
+#define __M_COMPRESS__
+
+#include <stddef.h>
+
+#include "doomtype.h"
+
+// Most bytes that M_Compress can produce from length bytes.
+size_t M_CompressBound(size_t length);
+
+// Compresses length bytes at src into dest, which must have room for
+// M_CompressBound(length) bytes.  Returns the compressed size.
+size_t M_Compress(const byte *src, size_t length, byte *dest);
+
+// Expands what M_Compress made of exactly dest_length bytes.  Returns
+// false if the data is damaged.
+boolean M_Decompress(const byte *src, size_t length,
+                     byte *dest, size_t dest_length);
+
+#endif
@@ -44,12 +44,12 @@
 // Location where all configuration data is stored - 
 // default.cfg, savegames, etc.
 
-char *configdir;
+THREADLOCAL char *configdir;
 
 // Default filenames for configuration files.
 
-static char *default_main_config;
-static char *default_extra_config;
+static THREADLOCAL char *default_main_config;
+static THREADLOCAL char *default_extra_config;
 
 typedef enum 
 {
@@ -110,7 +110,7 @@ typedef struct
 
 //! @begin_config_file default
 
-static default_t	doom_defaults_list[] =
+static THREADLOCAL default_t	doom_defaults_list[] =
 {
     //!
     // Mouse sensitivity.  This value is used to multiply input mouse
@@ -674,16 +674,19 @@ static default_t	doom_defaults_list[] =
     CONFIG_VARIABLE_INT(comport),
 };
 
-static default_collection_t doom_defaults =
+// The defaults pointers are filled in by M_SetConfigFilenames: the lists
+// are per-thread in a reentrant build and cannot be referenced here.
+
+static THREADLOCAL default_collection_t doom_defaults =
 {
-    doom_defaults_list,
+    NULL,
     arrlen(doom_defaults_list),
     NULL,
 };
 
 //! @begin_config_file extended
 
-static default_t extra_defaults_list[] =
+static THREADLOCAL default_t extra_defaults_list[] =
 {
     //!
     // @game heretic hexen strife
@@ -1553,9 +1556,9 @@ static default_t extra_defaults_list[] =
     CONFIG_VARIABLE_KEY(key_multi_msgplayer8),
 };
 
-static default_collection_t extra_defaults =
+static THREADLOCAL default_collection_t extra_defaults =
 {
-    extra_defaults_list,
+    NULL,
     arrlen(extra_defaults_list),
     NULL,
 };
@@ -1836,10 +1839,14 @@ static void LoadDefaultCollection(default_collection_t *collection)
 #endif
 }
 
-// Set the default filenames to use for configuration files.
+// Set the default filenames to use for configuration files.  This is the
+// first call into the config code, so the collections are set up here too.
 
 void M_SetConfigFilenames(char *main_config, char *extra_config)
 {
+    doom_defaults.defaults = doom_defaults_list;
+    extra_defaults.defaults = extra_defaults_list;
+
     default_main_config = main_config;
     default_extra_config = extra_config;
 }
@@ -34,6 +34,6 @@ float M_GetFloatVariable(char *name);
 void M_SetConfigFilenames(char *main_config, char *extra_config);
 char *M_GetSaveGameDir(char *iwadname);
 
-extern char *configdir;
+extern THREADLOCAL char *configdir;
 
 #endif
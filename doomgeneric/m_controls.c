@@ -26,47 +26,47 @@
 // Keyboard controls
 //
 
-int key_right = KEY_RIGHTARROW;
-int key_left = KEY_LEFTARROW;
-int key_up = KEY_UPARROW;
-int key_down = KEY_DOWNARROW; 
-int key_strafeleft = KEY_STRAFE_L;
-int key_straferight = KEY_STRAFE_R;
-int key_fire = KEY_FIRE;
-int key_use = KEY_USE;
-int key_strafe = KEY_RALT;
-int key_speed = KEY_RSHIFT; 
+THREADLOCAL int key_right = KEY_RIGHTARROW;
+THREADLOCAL int key_left = KEY_LEFTARROW;
+THREADLOCAL int key_up = KEY_UPARROW;
+THREADLOCAL int key_down = KEY_DOWNARROW; 
+THREADLOCAL int key_strafeleft = KEY_STRAFE_L;
+THREADLOCAL int key_straferight = KEY_STRAFE_R;
+THREADLOCAL int key_fire = KEY_FIRE;
+THREADLOCAL int key_use = KEY_USE;
+THREADLOCAL int key_strafe = KEY_RALT;
+THREADLOCAL int key_speed = KEY_RSHIFT; 
 
 // 
 // Heretic keyboard controls
 //
  
-int key_flyup = KEY_PGUP;
-int key_flydown = KEY_INS;
-int key_flycenter = KEY_HOME;
+THREADLOCAL int key_flyup = KEY_PGUP;
+THREADLOCAL int key_flydown = KEY_INS;
+THREADLOCAL int key_flycenter = KEY_HOME;
 
-int key_lookup = KEY_PGDN;
-int key_lookdown = KEY_DEL;
-int key_lookcenter = KEY_END;
+THREADLOCAL int key_lookup = KEY_PGDN;
+THREADLOCAL int key_lookdown = KEY_DEL;
+THREADLOCAL int key_lookcenter = KEY_END;
 
-int key_invleft = '[';
-int key_invright = ']';
-int key_useartifact = KEY_ENTER;
+THREADLOCAL int key_invleft = '[';
+THREADLOCAL int key_invright = ']';
+THREADLOCAL int key_useartifact = KEY_ENTER;
 
 //
 // Hexen key controls
 //
 
-int key_jump = '/';
+THREADLOCAL int key_jump = '/';
 
-int key_arti_all             = KEY_BACKSPACE;
-int key_arti_health          = '\\';
-int key_arti_poisonbag       = '0';
-int key_arti_blastradius     = '9';
-int key_arti_teleport        = '8';
-int key_arti_teleportother   = '7';
-int key_arti_egg             = '6';
-int key_arti_invulnerability = '5';
+THREADLOCAL int key_arti_all             = KEY_BACKSPACE;
+THREADLOCAL int key_arti_health          = '\\';
+THREADLOCAL int key_arti_poisonbag       = '0';
+THREADLOCAL int key_arti_blastradius     = '9';
+THREADLOCAL int key_arti_teleport        = '8';
+THREADLOCAL int key_arti_teleportother   = '7';
+THREADLOCAL int key_arti_egg             = '6';
+THREADLOCAL int key_arti_invulnerability = '5';
 
 //
 // Strife key controls
@@ -77,125 +77,125 @@ int key_arti_invulnerability = '5';
 // Note: Strife also uses key_invleft, key_invright, key_jump, key_lookup, and
 // key_lookdown, but with different default values.
 
-int key_usehealth = 'h';
-int key_invquery  = 'q';
-int key_mission   = 'w';
-int key_invpop    = 'z';
-int key_invkey    = 'k';
-int key_invhome   = KEY_HOME;
-int key_invend    = KEY_END;
-int key_invuse    = KEY_ENTER;
-int key_invdrop   = KEY_BACKSPACE;
+THREADLOCAL int key_usehealth = 'h';
+THREADLOCAL int key_invquery  = 'q';
+THREADLOCAL int key_mission   = 'w';
+THREADLOCAL int key_invpop    = 'z';
+THREADLOCAL int key_invkey    = 'k';
+THREADLOCAL int key_invhome   = KEY_HOME;
+THREADLOCAL int key_invend    = KEY_END;
+THREADLOCAL int key_invuse    = KEY_ENTER;
+THREADLOCAL int key_invdrop   = KEY_BACKSPACE;
 
 
 //
 // Mouse controls
 //
 
-int mousebfire = 0;
-int mousebstrafe = 1;
-int mousebforward = 2;
+THREADLOCAL int mousebfire = 0;
+THREADLOCAL int mousebstrafe = 1;
+THREADLOCAL int mousebforward = 2;
 
-int mousebjump = -1;
+THREADLOCAL int mousebjump = -1;
 
-int mousebstrafeleft = -1;
-int mousebstraferight = -1;
-int mousebbackward = -1;
-int mousebuse = -1;
+THREADLOCAL int mousebstrafeleft = -1;
+THREADLOCAL int mousebstraferight = -1;
+THREADLOCAL int mousebbackward = -1;
+THREADLOCAL int mousebuse = -1;
 
-int mousebprevweapon = -1;
-int mousebnextweapon = -1;
+THREADLOCAL int mousebprevweapon = -1;
+THREADLOCAL int mousebnextweapon = -1;
 
 
-int key_message_refresh = KEY_ENTER;
-int key_pause = KEY_PAUSE;
-int key_demo_quit = 'q';
-int key_spy = KEY_F12;
+THREADLOCAL int key_message_refresh = KEY_ENTER;
+THREADLOCAL int key_pause = KEY_PAUSE;
+THREADLOCAL int key_demo_quit = 'q';
+THREADLOCAL int key_spy = KEY_F12;
 
 // Multiplayer chat keys:
 
-int key_multi_msg = 't';
-int key_multi_msgplayer[8];
+THREADLOCAL int key_multi_msg = 't';
+THREADLOCAL int key_multi_msgplayer[8];
 
 // Weapon selection keys:
 
-int key_weapon1 = '1';
-int key_weapon2 = '2';
-int key_weapon3 = '3';
-int key_weapon4 = '4';
-int key_weapon5 = '5';
-int key_weapon6 = '6';
-int key_weapon7 = '7';
-int key_weapon8 = '8';
-int key_prevweapon = 0;
-int key_nextweapon = 0;
+THREADLOCAL int key_weapon1 = '1';
+THREADLOCAL int key_weapon2 = '2';
+THREADLOCAL int key_weapon3 = '3';
+THREADLOCAL int key_weapon4 = '4';
+THREADLOCAL int key_weapon5 = '5';
+THREADLOCAL int key_weapon6 = '6';
+THREADLOCAL int key_weapon7 = '7';
+THREADLOCAL int key_weapon8 = '8';
+THREADLOCAL int key_prevweapon = 0;
+THREADLOCAL int key_nextweapon = 0;
 
 // Map control keys:
 
-int key_map_north     = KEY_UPARROW;
-int key_map_south     = KEY_DOWNARROW;
-int key_map_east      = KEY_RIGHTARROW;
-int key_map_west      = KEY_LEFTARROW;
-int key_map_zoomin    = '=';
-int key_map_zoomout   = '-';
-int key_map_toggle    = KEY_TAB;
-int key_map_maxzoom   = '0';
-int key_map_follow    = 'f';
-int key_map_grid      = 'g';
-int key_map_mark      = 'm';
-int key_map_clearmark = 'c';
+THREADLOCAL int key_map_north     = KEY_UPARROW;
+THREADLOCAL int key_map_south     = KEY_DOWNARROW;
+THREADLOCAL int key_map_east      = KEY_RIGHTARROW;
+THREADLOCAL int key_map_west      = KEY_LEFTARROW;
+THREADLOCAL int key_map_zoomin    = '=';
+THREADLOCAL int key_map_zoomout   = '-';
+THREADLOCAL int key_map_toggle    = KEY_TAB;
+THREADLOCAL int key_map_maxzoom   = '0';
+THREADLOCAL int key_map_follow    = 'f';
+THREADLOCAL int key_map_grid      = 'g';
+THREADLOCAL int key_map_mark      = 'm';
+THREADLOCAL int key_map_clearmark = 'c';
 
 // menu keys:
 
-int key_menu_activate  = KEY_ESCAPE;
-int key_menu_up        = KEY_UPARROW;
-int key_menu_down      = KEY_DOWNARROW;
-int key_menu_left      = KEY_LEFTARROW;
-int key_menu_right     = KEY_RIGHTARROW;
-int key_menu_back      = KEY_BACKSPACE;
-int key_menu_forward   = KEY_ENTER;
-int key_menu_confirm   = 'y';
-int key_menu_abort     = 'n';
-
-int key_menu_help      = KEY_F1;
-int key_menu_save      = KEY_F2;
-int key_menu_load      = KEY_F3;
-int key_menu_volume    = KEY_F4;
-int key_menu_detail    = KEY_F5;
-int key_menu_qsave     = KEY_F6;
-int key_menu_endgame   = KEY_F7;
-int key_menu_messages  = KEY_F8;
-int key_menu_qload     = KEY_F9;
-int key_menu_quit      = KEY_F10;
-int key_menu_gamma     = KEY_F11;
-
-int key_menu_incscreen = KEY_EQUALS;
-int key_menu_decscreen = KEY_MINUS;
-int key_menu_screenshot = 0;
+THREADLOCAL int key_menu_activate  = KEY_ESCAPE;
+THREADLOCAL int key_menu_up        = KEY_UPARROW;
+THREADLOCAL int key_menu_down      = KEY_DOWNARROW;
+THREADLOCAL int key_menu_left      = KEY_LEFTARROW;
+THREADLOCAL int key_menu_right     = KEY_RIGHTARROW;
+THREADLOCAL int key_menu_back      = KEY_BACKSPACE;
+THREADLOCAL int key_menu_forward   = KEY_ENTER;
+THREADLOCAL int key_menu_confirm   = 'y';
+THREADLOCAL int key_menu_abort     = 'n';
+
+THREADLOCAL int key_menu_help      = KEY_F1;
+THREADLOCAL int key_menu_save      = KEY_F2;
+THREADLOCAL int key_menu_load      = KEY_F3;
+THREADLOCAL int key_menu_volume    = KEY_F4;
+THREADLOCAL int key_menu_detail    = KEY_F5;
+THREADLOCAL int key_menu_qsave     = KEY_F6;
+THREADLOCAL int key_menu_endgame   = KEY_F7;
+THREADLOCAL int key_menu_messages  = KEY_F8;
+THREADLOCAL int key_menu_qload     = KEY_F9;
+THREADLOCAL int key_menu_quit      = KEY_F10;
+THREADLOCAL int key_menu_gamma     = KEY_F11;
+
+THREADLOCAL int key_menu_incscreen = KEY_EQUALS;
+THREADLOCAL int key_menu_decscreen = KEY_MINUS;
+THREADLOCAL int key_menu_screenshot = 0;
 
 //
 // Joystick controls
 //
 
-int joybfire = 0;
-int joybstrafe = 1;
-int joybuse = 3;
-int joybspeed = 2;
+THREADLOCAL int joybfire = 0;
+THREADLOCAL int joybstrafe = 1;
+THREADLOCAL int joybuse = 3;
+THREADLOCAL int joybspeed = 2;
 
-int joybstrafeleft = -1;
-int joybstraferight = -1;
+THREADLOCAL int joybstrafeleft = -1;
+THREADLOCAL int joybstraferight = -1;
 
-int joybjump = -1;
+THREADLOCAL int joybjump = -1;
 
-int joybprevweapon = -1;
-int joybnextweapon = -1;
+THREADLOCAL int joybprevweapon = -1;
+THREADLOCAL int joybnextweapon = -1;
 
-int joybmenu = -1;
+THREADLOCAL int joybmenu = -1;
 
 // Control whether if a mouse button is double clicked, it acts like 
 // "use" has been pressed
 
-int dclick_use = 1;
+THREADLOCAL int dclick_use = 1;
  
 // 
 // Bind all of the common controls used by Doom and all other games.
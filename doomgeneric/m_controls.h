@@ -17,141 +17,141 @@
 #ifndef __M_CONTROLS_H__
 #define __M_CONTROLS_H__
  
-extern int key_right;
-extern int key_left;
-
-extern int key_up;
-extern int key_down;
-extern int key_strafeleft;
-extern int key_straferight;
-extern int key_fire;
-extern int key_use;
-extern int key_strafe;
-extern int key_speed;
-
-extern int key_jump;
+extern THREADLOCAL int key_right;
+extern THREADLOCAL int key_left;
+
+extern THREADLOCAL int key_up;
+extern THREADLOCAL int key_down;
+extern THREADLOCAL int key_strafeleft;
+extern THREADLOCAL int key_straferight;
+extern THREADLOCAL int key_fire;
+extern THREADLOCAL int key_use;
+extern THREADLOCAL int key_strafe;
+extern THREADLOCAL int key_speed;
+
+extern THREADLOCAL int key_jump;
  
-extern int key_flyup;
-extern int key_flydown;
-extern int key_flycenter;
-extern int key_lookup;
-extern int key_lookdown;
-extern int key_lookcenter;
-extern int key_invleft;
-extern int key_invright;
-extern int key_useartifact;
+extern THREADLOCAL int key_flyup;
+extern THREADLOCAL int key_flydown;
+extern THREADLOCAL int key_flycenter;
+extern THREADLOCAL int key_lookup;
+extern THREADLOCAL int key_lookdown;
+extern THREADLOCAL int key_lookcenter;
+extern THREADLOCAL int key_invleft;
+extern THREADLOCAL int key_invright;
+extern THREADLOCAL int key_useartifact;
 
 // villsa [STRIFE] strife keys
-extern int key_usehealth;
-extern int key_invquery;
-extern int key_mission;
-extern int key_invpop;
-extern int key_invkey;
-extern int key_invhome;
-extern int key_invend;
-extern int key_invuse;
-extern int key_invdrop;
-
-extern int key_message_refresh;
-extern int key_pause;
-
-extern int key_multi_msg;
-extern int key_multi_msgplayer[8];
-
-extern int key_weapon1;
-extern int key_weapon2;
-extern int key_weapon3;
-extern int key_weapon4;
-extern int key_weapon5;
-extern int key_weapon6;
-extern int key_weapon7;
-extern int key_weapon8;
-
-extern int key_arti_all;
-extern int key_arti_health;
-extern int key_arti_poisonbag;
-extern int key_arti_blastradius;
-extern int key_arti_teleport;
-extern int key_arti_teleportother;
-extern int key_arti_egg;
-extern int key_arti_invulnerability;
-
-extern int key_demo_quit;
-extern int key_spy;
-extern int key_prevweapon;
-extern int key_nextweapon;
-
-extern int key_map_north;
-extern int key_map_south;
-extern int key_map_east;
-extern int key_map_west;
-extern int key_map_zoomin;
-extern int key_map_zoomout;
-extern int key_map_toggle;
-extern int key_map_maxzoom;
-extern int key_map_follow;
-extern int key_map_grid;
-extern int key_map_mark;
-extern int key_map_clearmark;
+extern THREADLOCAL int key_usehealth;
+extern THREADLOCAL int key_invquery;
+extern THREADLOCAL int key_mission;
+extern THREADLOCAL int key_invpop;
+extern THREADLOCAL int key_invkey;
+extern THREADLOCAL int key_invhome;
+extern THREADLOCAL int key_invend;
+extern THREADLOCAL int key_invuse;
+extern THREADLOCAL int key_invdrop;
+
+extern THREADLOCAL int key_message_refresh;
+extern THREADLOCAL int key_pause;
+
+extern THREADLOCAL int key_multi_msg;
+extern THREADLOCAL int key_multi_msgplayer[8];
+
+extern THREADLOCAL int key_weapon1;
+extern THREADLOCAL int key_weapon2;
+extern THREADLOCAL int key_weapon3;
+extern THREADLOCAL int key_weapon4;
+extern THREADLOCAL int key_weapon5;
+extern THREADLOCAL int key_weapon6;
+extern THREADLOCAL int key_weapon7;
+extern THREADLOCAL int key_weapon8;
+
+extern THREADLOCAL int key_arti_all;
+extern THREADLOCAL int key_arti_health;
+extern THREADLOCAL int key_arti_poisonbag;
+extern THREADLOCAL int key_arti_blastradius;
+extern THREADLOCAL int key_arti_teleport;
+extern THREADLOCAL int key_arti_teleportother;
+extern THREADLOCAL int key_arti_egg;
+extern THREADLOCAL int key_arti_invulnerability;
+
+extern THREADLOCAL int key_demo_quit;
+extern THREADLOCAL int key_spy;
+extern THREADLOCAL int key_prevweapon;
+extern THREADLOCAL int key_nextweapon;
+
+extern THREADLOCAL int key_map_north;
+extern THREADLOCAL int key_map_south;
+extern THREADLOCAL int key_map_east;
+extern THREADLOCAL int key_map_west;
+extern THREADLOCAL int key_map_zoomin;
+extern THREADLOCAL int key_map_zoomout;
+extern THREADLOCAL int key_map_toggle;
+extern THREADLOCAL int key_map_maxzoom;
+extern THREADLOCAL int key_map_follow;
+extern THREADLOCAL int key_map_grid;
+extern THREADLOCAL int key_map_mark;
+extern THREADLOCAL int key_map_clearmark;
 
 // menu keys:
 
-extern int key_menu_activate;
-extern int key_menu_up;
-extern int key_menu_down;
-extern int key_menu_left;
-extern int key_menu_right;
-extern int key_menu_back;
-extern int key_menu_forward;
-extern int key_menu_confirm;
-extern int key_menu_abort;
-
-extern int key_menu_help;
-extern int key_menu_save;
-extern int key_menu_load;
-extern int key_menu_volume;
-extern int key_menu_detail;
-extern int key_menu_qsave;
-extern int key_menu_endgame;
-extern int key_menu_messages;
-extern int key_menu_qload;
-extern int key_menu_quit;
-extern int key_menu_gamma;
-
-extern int key_menu_incscreen;
-extern int key_menu_decscreen;
-extern int key_menu_screenshot;
-
-extern int mousebfire;
-extern int mousebstrafe;
-extern int mousebforward;
-
-extern int mousebjump;
-
-extern int mousebstrafeleft;
-extern int mousebstraferight;
-extern int mousebbackward;
-extern int mousebuse;
-
-extern int mousebprevweapon;
-extern int mousebnextweapon;
-
-extern int joybfire;
-extern int joybstrafe;
-extern int joybuse;
-extern int joybspeed;
-
-extern int joybjump;
-
-extern int joybstrafeleft;
-extern int joybstraferight;
-
-extern int joybprevweapon;
-extern int joybnextweapon;
-
-extern int joybmenu;
-
-extern int dclick_use;
+extern THREADLOCAL int key_menu_activate;
+extern THREADLOCAL int key_menu_up;
+extern THREADLOCAL int key_menu_down;
+extern THREADLOCAL int key_menu_left;
+extern THREADLOCAL int key_menu_right;
+extern THREADLOCAL int key_menu_back;
+extern THREADLOCAL int key_menu_forward;
+extern THREADLOCAL int key_menu_confirm;
+extern THREADLOCAL int key_menu_abort;
+
+extern THREADLOCAL int key_menu_help;
+extern THREADLOCAL int key_menu_save;
+extern THREADLOCAL int key_menu_load;
+extern THREADLOCAL int key_menu_volume;
+extern THREADLOCAL int key_menu_detail;
+extern THREADLOCAL int key_menu_qsave;
+extern THREADLOCAL int key_menu_endgame;
+extern THREADLOCAL int key_menu_messages;
+extern THREADLOCAL int key_menu_qload;
+extern THREADLOCAL int key_menu_quit;
+extern THREADLOCAL int key_menu_gamma;
+
+extern THREADLOCAL int key_menu_incscreen;
+extern THREADLOCAL int key_menu_decscreen;
+extern THREADLOCAL int key_menu_screenshot;
+
+extern THREADLOCAL int mousebfire;
+extern THREADLOCAL int mousebstrafe;
+extern THREADLOCAL int mousebforward;
+
+extern THREADLOCAL int mousebjump;
+
+extern THREADLOCAL int mousebstrafeleft;
+extern THREADLOCAL int mousebstraferight;
+extern THREADLOCAL int mousebbackward;
+extern THREADLOCAL int mousebuse;
+
+extern THREADLOCAL int mousebprevweapon;
+extern THREADLOCAL int mousebnextweapon;
+
+extern THREADLOCAL int joybfire;
+extern THREADLOCAL int joybstrafe;
+extern THREADLOCAL int joybuse;
+extern THREADLOCAL int joybspeed;
+
+extern THREADLOCAL int joybjump;
+
+extern THREADLOCAL int joybstrafeleft;
+extern THREADLOCAL int joybstraferight;
+
+extern THREADLOCAL int joybprevweapon;
+extern THREADLOCAL int joybnextweapon;
+
+extern THREADLOCAL int joybmenu;
+
+extern THREADLOCAL int dclick_use;
 
 void M_BindBaseControls(void);
 void M_BindHereticControls(void);
@@ -59,46 +59,46 @@
 #include "m_menu.h"
 
 
-extern patch_t*		hu_font[HU_FONTSIZE];
-extern boolean		message_dontfuckwithme;
+extern THREADLOCAL patch_t*		hu_font[HU_FONTSIZE];
+extern THREADLOCAL boolean		message_dontfuckwithme;
 
-extern boolean		chat_on;		// in heads-up code
+extern THREADLOCAL boolean		chat_on;		// in heads-up code
 
 //
 // defaulted values
 //
-int			mouseSensitivity = 5;
+THREADLOCAL int			mouseSensitivity = 5;
 
 // Show messages has default, 0 = off, 1 = on
-int			showMessages = 1;
+THREADLOCAL int			showMessages = 1;
 	
 
 // Blocky mode, has default, 0 = high, 1 = normal
-int			detailLevel = 0;
-int			screenblocks = 10;
+THREADLOCAL int			detailLevel = 0;
+THREADLOCAL int			screenblocks = 10;
 
 // temp for screenblocks (0-9)
-int			screenSize;
+THREADLOCAL int			screenSize;
 
 // -1 = no quicksave slot picked!
-int			quickSaveSlot;
+THREADLOCAL int			quickSaveSlot;
 
  // 1 = message to be printed
-int			messageToPrint;
+THREADLOCAL int			messageToPrint;
 // ...and here is the message string!
-char*			messageString;
+THREADLOCAL char*			messageString;
 
 // message x & y
-int			messx;
-int			messy;
-int			messageLastMenuActive;
+THREADLOCAL int			messx;
+THREADLOCAL int			messy;
+THREADLOCAL int			messageLastMenuActive;
 
 // timed message = no input from user
-boolean			messageNeedsInput;
+THREADLOCAL boolean			messageNeedsInput;
 
-void    (*messageRoutine)(int response);
+THREADLOCAL void    (*messageRoutine)(int response);
 
-char gammamsg[5][26] =
+THREADLOCAL char gammamsg[5][26] =
 {
     GAMMALVL0,
     GAMMALVL1,
@@ -108,22 +108,22 @@ char gammamsg[5][26] =
 };
 
 // we are going to be entering a savegame string
-int			saveStringEnter;              
-int             	saveSlot;	// which slot to save in
-int			saveCharIndex;	// which char we're editing
+THREADLOCAL int			saveStringEnter;              
+THREADLOCAL int             	saveSlot;	// which slot to save in
+THREADLOCAL int			saveCharIndex;	// which char we're editing
 // old save description before edit
-char			saveOldString[SAVESTRINGSIZE];  
+THREADLOCAL char			saveOldString[SAVESTRINGSIZE];  
 
-boolean			inhelpscreens;
-boolean			menuactive;
+THREADLOCAL boolean			inhelpscreens;
+THREADLOCAL boolean			menuactive;
 
 #define SKULLXOFF		-32
 #define LINEHEIGHT		16
 
 extern boolean		sendpause;
-char			savegamestrings[10][SAVESTRINGSIZE];
+THREADLOCAL char			savegamestrings[10][SAVESTRINGSIZE];
 
-char	endstring[160];
+THREADLOCAL char	endstring[160];
 
 //static boolean opldev;
 
@@ -159,16 +159,16 @@ typedef struct menu_s
     short		lastOn;		// last item user was on in menu
 } menu_t;
 
-short		itemOn;			// menu item skull is on
-short		skullAnimCounter;	// skull animation counter
-short		whichSkull;		// which skull to draw
+THREADLOCAL short		itemOn;			// menu item skull is on
+THREADLOCAL short		skullAnimCounter;	// skull animation counter
+THREADLOCAL short		whichSkull;		// which skull to draw
 
 // graphic name of skulls
 // warning: initializer-string for array of chars is too long
-char    *skullName[2] = {"M_SKULL1","M_SKULL2"};
+THREADLOCAL char    *skullName[2] = {"M_SKULL1","M_SKULL2"};
 
 // current menudef
-menu_t*	currentMenu;                          
+THREADLOCAL menu_t*	currentMenu;                          
 
 //
 // PROTOTYPES
@@ -239,7 +239,7 @@ enum
     main_end
 } main_e;
 
-menuitem_t MainMenu[]=
+THREADLOCAL menuitem_t MainMenu[]=
 {
     {1,"M_NGAME",M_NewGame,'n'},
     {1,"M_OPTION",M_Options,'o'},
@@ -250,11 +250,11 @@ menuitem_t MainMenu[]=
     {1,"M_QUITG",M_QuitDOOM,'q'}
 };
 
-menu_t  MainDef =
+THREADLOCAL menu_t  MainDef =
 {
     main_end,
     NULL,
-    MainMenu,
+    NULL,
     M_DrawMainMenu,
     97,64,
     0
@@ -273,7 +273,7 @@ enum
     ep_end
 } episodes_e;
 
-menuitem_t EpisodeMenu[]=
+THREADLOCAL menuitem_t EpisodeMenu[]=
 {
     {1,"M_EPI1", M_Episode,'k'},
     {1,"M_EPI2", M_Episode,'t'},
@@ -281,11 +281,11 @@ menuitem_t EpisodeMenu[]=
     {1,"M_EPI4", M_Episode,'t'}
 };
 
-menu_t  EpiDef =
+THREADLOCAL menu_t  EpiDef =
 {
     ep_end,		// # of menu items
-    &MainDef,		// previous menu
-    EpisodeMenu,	// menuitem_t ->
+    NULL,		// previous menu
+    NULL,		// menuitem_t ->
     M_DrawEpisode,	// drawing routine ->
     48,63,              // x,y
     ep1			// lastOn
@@ -304,7 +304,7 @@ enum
     newg_end
 } newgame_e;
 
-menuitem_t NewGameMenu[]=
+THREADLOCAL menuitem_t NewGameMenu[]=
 {
     {1,"M_JKILL",	M_ChooseSkill, 'i'},
     {1,"M_ROUGH",	M_ChooseSkill, 'h'},
@@ -313,11 +313,11 @@ menuitem_t NewGameMenu[]=
     {1,"M_NMARE",	M_ChooseSkill, 'n'}
 };
 
-menu_t  NewDef =
+THREADLOCAL menu_t  NewDef =
 {
     newg_end,		// # of menu items
-    &EpiDef,		// previous menu
-    NewGameMenu,	// menuitem_t ->
+    NULL,		// previous menu
+    NULL,		// menuitem_t ->
     M_DrawNewGame,	// drawing routine ->
     48,63,              // x,y
     hurtme		// lastOn
@@ -341,7 +341,7 @@ enum
     opt_end
 } options_e;
 
-menuitem_t OptionsMenu[]=
+THREADLOCAL menuitem_t OptionsMenu[]=
 {
     {1,"M_ENDGAM",	M_EndGame,'e'},
     {1,"M_MESSG",	M_ChangeMessages,'m'},
@@ -353,11 +353,11 @@ menuitem_t OptionsMenu[]=
     {1,"M_SVOL",	M_Sound,'s'}
 };
 
-menu_t  OptionsDef =
+THREADLOCAL menu_t  OptionsDef =
 {
     opt_end,
-    &MainDef,
-    OptionsMenu,
+    NULL,
+    NULL,
     M_DrawOptions,
     60,37,
     0
@@ -372,16 +372,16 @@ enum
     read1_end
 } read_e;
 
-menuitem_t ReadMenu1[] =
+THREADLOCAL menuitem_t ReadMenu1[] =
 {
     {1,"",M_ReadThis2,0}
 };
 
-menu_t  ReadDef1 =
+THREADLOCAL menu_t  ReadDef1 =
 {
     read1_end,
-    &MainDef,
-    ReadMenu1,
+    NULL,
+    NULL,
     M_DrawReadThis1,
     280,185,
     0
@@ -393,16 +393,16 @@ enum
     read2_end
 } read_e2;
 
-menuitem_t ReadMenu2[]=
+THREADLOCAL menuitem_t ReadMenu2[]=
 {
     {1,"",M_FinishReadThis,0}
 };
 
-menu_t  ReadDef2 =
+THREADLOCAL menu_t  ReadDef2 =
 {
     read2_end,
-    &ReadDef1,
-    ReadMenu2,
+    NULL,
+    NULL,
     M_DrawReadThis2,
     330,175,
     0
@@ -420,7 +420,7 @@ enum
     sound_end
 } sound_e;
 
-menuitem_t SoundMenu[]=
+THREADLOCAL menuitem_t SoundMenu[]=
 {
     {2,"M_SFXVOL",M_SfxVol,'s'},
     {-1,"",0,'\0'},
@@ -428,11 +428,11 @@ menuitem_t SoundMenu[]=
     {-1,"",0,'\0'}
 };
 
-menu_t  SoundDef =
+THREADLOCAL menu_t  SoundDef =
 {
     sound_end,
-    &OptionsDef,
-    SoundMenu,
+    NULL,
+    NULL,
     M_DrawSound,
     80,64,
     0
@@ -452,7 +452,7 @@ enum
     load_end
 } load_e;
 
-menuitem_t LoadMenu[]=
+THREADLOCAL menuitem_t LoadMenu[]=
 {
     {1,"", M_LoadSelect,'1'},
     {1,"", M_LoadSelect,'2'},
@@ -462,11 +462,11 @@ menuitem_t LoadMenu[]=
     {1,"", M_LoadSelect,'6'}
 };
 
-menu_t  LoadDef =
+THREADLOCAL menu_t  LoadDef =
 {
     load_end,
-    &MainDef,
-    LoadMenu,
+    NULL,
+    NULL,
     M_DrawLoad,
     80,54,
     0
@@ -475,7 +475,7 @@ menu_t  LoadDef =
 //
 // SAVE GAME MENU
 //
-menuitem_t SaveMenu[]=
+THREADLOCAL menuitem_t SaveMenu[]=
 {
     {1,"", M_SaveSelect,'1'},
     {1,"", M_SaveSelect,'2'},
@@ -485,17 +485,44 @@ menuitem_t SaveMenu[]=
     {1,"", M_SaveSelect,'6'}
 };
 
-menu_t  SaveDef =
+THREADLOCAL menu_t  SaveDef =
 {
     load_end,
-    &MainDef,
-    SaveMenu,
+    NULL,
+    NULL,
     M_DrawSave,
     80,54,
     0
 };
 
 
+//
+// M_LinkMenus
+// The menus point at each other and at their item lists.  In a
+// reentrant build those are per-thread, so the links can't be made
+// in the static initializers above.
+//
+static void M_LinkMenus(void)
+{
+    MainDef.menuitems = MainMenu;
+    EpiDef.prevMenu = &MainDef;
+    EpiDef.menuitems = EpisodeMenu;
+    NewDef.prevMenu = &EpiDef;
+    NewDef.menuitems = NewGameMenu;
+    OptionsDef.prevMenu = &MainDef;
+    OptionsDef.menuitems = OptionsMenu;
+    ReadDef1.prevMenu = &MainDef;
+    ReadDef1.menuitems = ReadMenu1;
+    ReadDef2.prevMenu = &ReadDef1;
+    ReadDef2.menuitems = ReadMenu2;
+    SoundDef.prevMenu = &OptionsDef;
+    SoundDef.menuitems = SoundMenu;
+    LoadDef.prevMenu = &MainDef;
+    LoadDef.menuitems = LoadMenu;
+    SaveDef.prevMenu = &MainDef;
+    SaveDef.menuitems = SaveMenu;
+}
+
 //
 // M_ReadSaveStrings
 //  read the strings from the savegame files
@@ -667,7 +694,7 @@ void M_SaveGame (int choice)
 //
 //      M_QuickSave
 //
-char    tempstring[80];
+THREADLOCAL char    tempstring[80];
 
 void M_QuickSaveResponse(int key)
 {
@@ -925,7 +952,7 @@ void M_NewGame(int choice)
 //
 //      M_Episode
 //
-int     epi;
+THREADLOCAL int     epi;
 
 void M_DrawEpisode(void)
 {
@@ -981,8 +1008,8 @@ void M_Episode(int choice)
 //
 // M_Options
 //
-static char *detailNames[2] = {"M_GDHIGH","M_GDLOW"};
-static char *msgNames[2] = {"M_MSGOFF","M_MSGON"};
+static THREADLOCAL char *detailNames[2] = {"M_GDHIGH","M_GDLOW"};
+static THREADLOCAL char *msgNames[2] = {"M_MSGOFF","M_MSGON"};
 
 void M_DrawOptions(void)
 {
@@ -1102,7 +1129,7 @@ void M_FinishReadThis(int choice)
 //
 // M_QuitDOOM
 //
-int     quitsounds[8] =
+THREADLOCAL int     quitsounds[8] =
 {
     sfx_pldeth,
     sfx_dmpain,
@@ -1114,7 +1141,7 @@ int     quitsounds[8] =
     sfx_sgtatk
 };
 
-int     quitsounds2[8] =
+THREADLOCAL int     quitsounds2[8] =
 {
     sfx_vilact,
     sfx_getpow,
@@ -1390,7 +1417,7 @@ M_WriteText
 	}
 		
 	w = SHORT (hu_font[c]->width);
-	if (cx+w > SCREENWIDTH)
+	if (cx+w > ORIGWIDTH)
 	    break;
 	V_DrawPatchDirect(cx, cy, hu_font[c]);
 	cx+=w;
@@ -1418,12 +1445,12 @@ boolean M_Responder (event_t* ev)
     int             ch;
     int             key;
     int             i;
-    static  int     joywait = 0;
-    static  int     mousewait = 0;
-    static  int     mousey = 0;
-    static  int     lasty = 0;
-    static  int     mousex = 0;
-    static  int     lastx = 0;
+    static THREADLOCAL int     joywait = 0;
+    static THREADLOCAL int     mousewait = 0;
+    static THREADLOCAL int     mousey = 0;
+    static THREADLOCAL int     lasty = 0;
+    static THREADLOCAL int     mousex = 0;
+    static THREADLOCAL int     lastx = 0;
 
     // In testcontrols mode, none of the function keys should do anything
     // - the only key is escape to quit.
@@ -1950,8 +1977,8 @@ static void M_DrawOPLDev(void)
 //
 void M_Drawer (void)
 {
-    static short	x;
-    static short	y;
+    static THREADLOCAL short	x;
+    static THREADLOCAL short	y;
     unsigned int	i;
     unsigned int	max;
     char		string[80];
@@ -1964,7 +1991,7 @@ void M_Drawer (void)
     if (messageToPrint)
     {
 	start = 0;
-	y = SCREENHEIGHT/2 - M_StringHeight(messageString) / 2;
+	y = ORIGHEIGHT/2 - M_StringHeight(messageString) / 2;
 	while (messageString[start] != '\0')
 	{
 	    int foundnewline = 0;
@@ -1992,7 +2019,7 @@ void M_Drawer (void)
                 start += strlen(string);
             }
 
-	    x = SCREENWIDTH/2 - M_StringWidth(string) / 2;
+	    x = ORIGWIDTH/2 - M_StringWidth(string) / 2;
 	    M_WriteText(x, y, string);
 	    y += SHORT(hu_font[0]->height);
 	}
@@ -2076,6 +2103,8 @@ void M_Ticker (void)
 //
 void M_Init (void)
 {
+    M_LinkMenus();
+
     currentMenu = &MainDef;
     menuactive = 0;
     itemOn = currentMenu->lastOn;
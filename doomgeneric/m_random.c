@@ -16,6 +16,8 @@
 //	Random number LUT.
 //
 
+#include "m_random.h"
+
 //
 // M_Random
 // Returns a 0-255 number
@@ -43,8 +45,8 @@ static const unsigned char rndtable[256] = {
     120, 163, 236, 249
 };
 
-int	rndindex = 0;
-int	prndindex = 0;
+THREADLOCAL int	rndindex = 0;
+THREADLOCAL int	prndindex = 0;
 
 // Which one is deterministic?
 int P_Random (void)
@@ -0,0 +1,305 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Trace zones around hot functions, written out as Chrome trace
+//	events (chrome://tracing, ui.perfetto.dev).
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_trace.h"
+
+// Threads that can record zones.  In a reentrant build that is one per
+// instance.
+#define MAXTRACETHREADS		64
+
+#define DEFAULTTRACESIZE	65536
+
+typedef struct
+{
+    uint64_t		start;
+    uint32_t		duration;	// ns
+    uint32_t		zone;
+} traceevent_t;
+
+//
+// A ring of the last `size` zones a thread has finished.  Only the
+// thread writes to it.  It stores `head` after each event, so a thread
+// that loads head can read the events before it; the ones the writer
+// may have overwritten by then are thrown away.
+//
+typedef struct
+{
+    unsigned int	ready;		// events and size are set
+    unsigned int	head;		// events written so far
+    unsigned int	full;		// head has gone round once
+    unsigned int	size;		// a power of two
+    traceevent_t*	events;
+} tracebuffer_t;
+
+volatile boolean		tracing;
+
+static tracebuffer_t		tracebuffers[MAXTRACETHREADS];
+static unsigned int		numtracebuffers;
+static unsigned int		tracesize = DEFAULTTRACESIZE;
+static uint64_t			tracestart;
+
+static THREADLOCAL tracebuffer_t*	tracebuffer;
+static THREADLOCAL boolean		tracefailed;
+
+static const char *tracezonenames[NUMTRACEZONES] =
+{
+    "TryRunTics",
+    "P_RunThinkers",
+    "P_MobjThinker",
+    "P_CheckPosition",
+    "R_RenderPlayerView",
+    "R_DrawPlanes",
+    "R_DrawMasked",
+    "W_CacheLumpNum",
+    "Z_Malloc",
+    "I_MixMusic",
+};
+
+// -trace
+static THREADLOCAL char*	tracefile;
+
+
+//
+// M_TraceBuffer
+// The calling thread's buffer, set up the first time it records a zone.
+//
+static tracebuffer_t* M_TraceBuffer (void)
+{
+    tracebuffer_t*	buf;
+    unsigned int	i;
+
+    i = FETCH_ADD (&numtracebuffers, 1);
+
+    if (i >= MAXTRACETHREADS)
+    {
+	fprintf (stderr, "M_TraceBuffer: more than %i threads traced\n",
+		 MAXTRACETHREADS);
+	tracefailed = true;
+	return NULL;
+    }
+
+    buf = &tracebuffers[i];
+    buf->size = tracesize;
+    buf->events = malloc (tracesize * sizeof(traceevent_t));
+
+    if (buf->events == NULL)
+    {
+	fprintf (stderr, "M_TraceBuffer: out of memory\n");
+	tracefailed = true;
+	return NULL;
+    }
+
+    STORE_RELEASE (&buf->ready, 1);
+
+    return buf;
+}
+
+
+//
+// M_TraceZone
+//
+void M_TraceZone (tracezone_t zone, uint64_t start)
+{
+    traceevent_t*	event;
+    uint64_t		duration;
+    unsigned int	head;
+
+    duration = I_GetTimeNS () - start;
+
+    if (tracebuffer == NULL)
+    {
+	if (tracefailed)
+	    return;
+
+	tracebuffer = M_TraceBuffer ();
+
+	if (tracebuffer == NULL)
+	    return;
+    }
+
+    head = tracebuffer->head;
+    event = &tracebuffer->events[head & (tracebuffer->size - 1)];
+
+    event->start = start;
+    event->duration = duration < 0xffffffff ? duration : 0xffffffff;
+    event->zone = zone;
+
+    if (head + 1 == tracebuffer->size)
+	tracebuffer->full = 1;
+
+    STORE_RELEASE (&tracebuffer->head, head + 1);
+}
+
+
+//
+// M_TraceEnable
+//
+void M_TraceEnable (boolean enable)
+{
+    if (enable && tracestart == 0)
+	tracestart = I_GetTimeNS ();
+
+    tracing = enable;
+}
+
+
+//
+// M_TraceDumpBuffer
+// Writes out the events of one thread that are still there.
+//
+static void M_TraceDumpBuffer (FILE* f, int tid, boolean* first)
+{
+    tracebuffer_t*	buf = &tracebuffers[tid];
+    traceevent_t*	events;
+    traceevent_t*	event;
+    unsigned int	head, newhead;
+    unsigned int	count;
+    unsigned int	i, n;
+
+    if (!LOAD_ACQUIRE (&buf->ready))
+	return;
+
+    head = LOAD_ACQUIRE (&buf->head);
+    count = buf->full ? buf->size : head;
+
+    events = malloc (count * sizeof(traceevent_t) + 1);
+
+    if (events == NULL)
+	return;
+
+    for (i = 0; i < count; i++)
+	events[i] = buf->events[(head - count + i) & (buf->size - 1)];
+
+    // Events that have been overwritten while they were copied, or that
+    // are being overwritten now, are no good.
+    newhead = LOAD_ACQUIRE (&buf->head);
+
+    fprintf (f, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+		"\"tid\":%i,\"args\":{\"name\":\"thread %i\"}}",
+	     *first ? "" : ",", tid, tid);
+    *first = false;
+
+    for (i = 0; i < count; i++)
+    {
+	n = head - count + i;
+
+	if (newhead - n >= buf->size)
+	    continue;
+
+	event = &events[i];
+
+	fprintf (f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%i,"
+		    "\"ts\":%.3f,\"dur\":%.3f}",
+		 tracezonenames[event->zone], tid,
+		 (int64_t) (event->start - tracestart) / 1000.0,
+		 event->duration / 1000.0);
+    }
+
+    free (events);
+}
+
+
+//
+// M_TraceDump
+//
+boolean M_TraceDump (const char *filename)
+{
+    FILE*		f;
+    boolean		first;
+    unsigned int	count;
+    unsigned int	i;
+
+    f = fopen (filename, "w");
+
+    if (f == NULL)
+	return false;
+
+    count = LOAD_ACQUIRE (&numtracebuffers);
+
+    if (count > MAXTRACETHREADS)
+	count = MAXTRACETHREADS;
+
+    fprintf (f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+    first = true;
+
+    for (i = 0; i < count; i++)
+	M_TraceDumpBuffer (f, i, &first);
+
+    fprintf (f, "\n]}\n");
+    fclose (f);
+
+    return true;
+}
+
+
+static void M_TraceDumpAtExit (void)
+{
+    if (!M_TraceDump (tracefile))
+	fprintf (stderr, "M_TraceDump: can't write %s\n", tracefile);
+}
+
+
+//
+// M_TraceInit
+//
+void M_TraceInit (void)
+{
+    int		p;
+
+    //!
+    // @arg <n>
+    // @category obscure
+    //
+    // Keep the last n trace zones of each thread (default 65536).
+    //
+
+    p = M_CheckParmWithArgs ("-tracesize", 1);
+
+    if (p)
+    {
+	tracesize = 1;
+
+	while (tracesize < (unsigned int) atoi (myargv[p+1])
+	    && tracesize < 0x10000000)
+	    tracesize <<= 1;
+    }
+
+    //!
+    // @arg <file>
+    // @category obscure
+    //
+    // Record trace zones in the hot functions of the engine from the
+    // start, and write them to file as Chrome trace events on exit.
+    //
+
+    p = M_CheckParmWithArgs ("-trace", 1);
+
+    if (p)
+    {
+	tracefile = myargv[p+1];
+	M_TraceEnable (true);
+	I_AtExit (M_TraceDumpAtExit, true);
+    }
+}
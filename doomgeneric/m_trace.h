@@ -0,0 +1,71 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Trace zones around hot functions, written out as Chrome trace
+//	events (chrome://tracing, ui.perfetto.dev).
+//
+
+
+#ifndef __M_TRACE__
+#define __M_TRACE__
+
+#include "doomtype.h"
+#include "i_timer.h"
+
+typedef enum
+{
+    tz_tryruntics,
+    tz_runthinkers,
+    tz_mobjthinker,
+    tz_checkposition,
+    tz_renderplayerview,
+    tz_drawplanes,
+    tz_drawmasked,
+    tz_cachelumpnum,
+    tz_malloc,
+    tz_mixmusic,
+
+    NUMTRACEZONES
+} tracezone_t;
+
+// Set while zones are recorded.  It is shared by all threads, so that
+// any of them can start and stop tracing.
+extern volatile boolean tracing;
+
+// A zone is timed with
+//
+//   start = M_TraceBegin ();
+//   ...
+//   M_TraceEnd (tz_malloc, start);
+//
+// When not tracing that is a load and two branches.  Each thread
+// records its zones in a buffer of its own, without locks.
+
+#define M_TraceBegin() (tracing ? I_GetTimeNS () : 0)
+
+#define M_TraceEnd(zone, start) \
+    ((start) != 0 ? M_TraceZone ((zone), (start)) : (void) 0)
+
+void M_TraceZone (tracezone_t zone, uint64_t start);
+
+void M_TraceInit (void);
+
+void M_TraceEnable (boolean enable);
+
+// Write the zones recorded by every thread so far.  May be called from
+// any thread while the others carry on.
+boolean M_TraceDump (const char *filename);
+
+#endif
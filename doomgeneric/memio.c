@@ -182,7 +182,9 @@ int mem_fseek(MEMFILE *stream, signed long position, mem_rel_t whence)
 			return -1;
 	}
 
-	if (newpos < stream->buflen)
+	// Seeking to the end is fine: it is where writes append.
+
+	if (newpos <= stream->buflen)
 	{
 		stream->position = newpos;
 		return 0;
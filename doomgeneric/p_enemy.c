@@ -60,13 +60,13 @@ typedef enum
 //
 // P_NewChaseDir related LUT.
 //
-dirtype_t opposite[] =
+THREADLOCAL dirtype_t opposite[] =
 {
   DI_WEST, DI_SOUTHWEST, DI_SOUTH, DI_SOUTHEAST,
   DI_EAST, DI_NORTHEAST, DI_NORTH, DI_NORTHWEST, DI_NODIR
 };
 
-dirtype_t diags[] =
+THREADLOCAL dirtype_t diags[] =
 {
     DI_NORTHWEST, DI_NORTHEAST, DI_SOUTHWEST, DI_SOUTHEAST
 };
@@ -93,7 +93,7 @@ void A_Fall (mobj_t *actor);
 // sound blocking lines cut off traversal.
 //
 
-mobj_t*		soundtarget;
+THREADLOCAL mobj_t*		soundtarget;
 
 void
 P_RecursiveSound
@@ -254,8 +254,8 @@ boolean P_CheckMissileRange (mobj_t* actor)
 // Move in the current direction,
 // returns false if the move is blocked.
 //
-fixed_t	xspeed[8] = {FRACUNIT,47000,0,-47000,-FRACUNIT,-47000,0,47000};
-fixed_t yspeed[8] = {0,47000,FRACUNIT,47000,0,-47000,-FRACUNIT,-47000};
+THREADLOCAL fixed_t	xspeed[8] = {FRACUNIT,47000,0,-47000,-FRACUNIT,-47000,0,47000};
+THREADLOCAL fixed_t yspeed[8] = {0,47000,FRACUNIT,47000,0,-47000,-FRACUNIT,-47000};
 
 boolean P_Move (mobj_t*	actor)
 {
@@ -1001,7 +1001,7 @@ void A_SkelMissile (mobj_t* actor)
     mo->tracer = actor->target;
 }
 
-int	TRACEANGLE = 0xc000000;
+THREADLOCAL int	TRACEANGLE = 0xc000000;
 
 void A_Tracer (mobj_t* actor)
 {
@@ -1106,10 +1106,10 @@ void A_SkelFist (mobj_t*	actor)
 // PIT_VileCheck
 // Detect a corpse that could be raised.
 //
-mobj_t*		corpsehit;
-mobj_t*		vileobj;
-fixed_t		viletryx;
-fixed_t		viletryy;
+THREADLOCAL mobj_t*		corpsehit;
+THREADLOCAL mobj_t*		vileobj;
+THREADLOCAL fixed_t		viletryx;
+THREADLOCAL fixed_t		viletryy;
 
 boolean PIT_VileCheck (mobj_t*	thing)
 {
@@ -1804,9 +1804,12 @@ A_CloseShotgun2
 
 
 
-mobj_t*		braintargets[32];
-int		numbraintargets;
-int		braintargeton = 0;
+THREADLOCAL mobj_t*		braintargets[32];
+THREADLOCAL int		numbraintargets;
+THREADLOCAL int		braintargeton = 0;
+
+// On easy skills A_BrainSpit only shoots every other time.
+THREADLOCAL int		braineasy = 0;
 
 void A_BrainAwake (mobj_t* mo)
 {
@@ -1901,10 +1904,8 @@ void A_BrainSpit (mobj_t*	mo)
     mobj_t*	targ;
     mobj_t*	newmobj;
     
-    static int	easy = 0;
-	
-    easy ^= 1;
-    if (gameskill <= sk_easy && (!easy))
+    braineasy ^= 1;
+    if (gameskill <= sk_easy && (!braineasy))
 	return;
 		
     // shoot a cube at current target
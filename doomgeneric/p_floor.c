@@ -38,8 +38,8 @@
 //
 // Move a plane (floor or ceiling) and check for crushing
 //
-result_e
-T_MovePlane
+static result_e
+P_MovePlane
 ( sector_t*	sector,
   fixed_t	speed,
   fixed_t	dest,
@@ -196,6 +196,40 @@ T_MovePlane
 }
 
 
+//
+// T_MovePlane
+// Sight checks that went past the sector are forgotten
+// if it has really moved, not just stayed put at its
+// destination or been pushed back by a thing in the way.
+//
+result_e
+T_MovePlane
+( sector_t*	sector,
+  fixed_t	speed,
+  fixed_t	dest,
+  boolean	crush,
+  int		floorOrCeiling,
+  int		direction )
+{
+    fixed_t	floorheight;
+    fixed_t	ceilingheight;
+    result_e	res;
+
+    floorheight = sector->floorheight;
+    ceilingheight = sector->ceilingheight;
+
+    res = P_MovePlane (sector, speed, dest, crush, floorOrCeiling, direction);
+
+    if (sector->floorheight != floorheight
+	|| sector->ceilingheight != ceilingheight)
+    {
+	P_FlushSightSector (sector);
+    }
+
+    return res;
+}
+
+
 //
 // MOVE A FLOOR TO IT'S DESTINATION (UP OR DOWN)
 //
@@ -270,7 +304,7 @@ EV_DoFloor
 	
 	// new floor thinker
 	rtn = 1;
-	floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+	floor = P_AllocThinker (tp_floor);
 	P_AddThinker (&floor->thinker);
 	sec->specialdata = floor;
 	floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
@@ -473,7 +507,7 @@ EV_BuildStairs
 	
 	// new floor thinker
 	rtn = 1;
-	floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+	floor = P_AllocThinker (tp_floor);
 	P_AddThinker (&floor->thinker);
 	sec->specialdata = floor;
 	floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
@@ -526,7 +560,7 @@ EV_BuildStairs
 					
 		sec = tsec;
 		secnum = newsecnum;
-		floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+		floor = P_AllocThinker (tp_floor);
 
 		P_AddThinker (&floor->thinker);
 
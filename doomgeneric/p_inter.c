@@ -47,8 +47,8 @@
 
 // a weapon is found with two clip loads,
 // a big item has five clip loads
-int	maxammo[NUMAMMO] = {200, 50, 300, 50};
-int	clipammo[NUMAMMO] = {10, 4, 20, 1};
+THREADLOCAL int	maxammo[NUMAMMO] = {200, 50, 300, 50};
+THREADLOCAL int	clipammo[NUMAMMO] = {10, 4, 20, 1};
 
 
 //
@@ -64,13 +64,58 @@
 //
 
 // both the head and tail of the thinker list
-extern	thinker_t	thinkercap;	
+extern THREADLOCAL thinker_t	thinkercap;	
 
 
 void P_InitThinkers (void);
 void P_AddThinker (thinker_t* thinker);
 void P_RemoveThinker (thinker_t* thinker);
 
+// Thinkers live in slab pools, one per type.  Slabs are PU_LEVEL zone
+// memory, so P_ClearThinkerPools must follow Z_FreeTags of that tag.
+typedef enum
+{
+    tp_mobj,
+    tp_ceiling,
+    tp_door,
+    tp_floor,
+    tp_plat,
+    tp_fireflicker,
+    tp_lightflash,
+    tp_strobe,
+    tp_glow,
+    NUMTHINKERPOOLS
+} thinkerpool_t;
+
+void* P_AllocThinker (thinkerpool_t pool);
+void P_FreeThinker (thinker_t* thinker);
+void P_ClearThinkerPools (void);
+
+// Raw copies of the pools, for snapshots (p_snap.c).
+size_t P_ThinkerPoolsSize (void);
+byte* P_SaveThinkerPools (byte* p);
+byte* P_RestoreThinkerPools (byte* p);
+void P_FinishThinkerPools (boolean relocate);
+
+// Moving pointers of a snapshot restored elsewhere (p_snap.c).
+void P_AddRelocation (void* from, void* to, size_t size);
+void* P_Relocate (void* p);
+void P_RelocateThinker (thinker_t* thinker, thinkerpool_t pool);
+
+// Per pool counts, and with -thinkerstats, the time spent running
+// them.  They are printed at exit.
+typedef struct
+{
+    int		count;		// allocated now
+    int		peak;		// most allocated at once
+    uint64_t	runs;		// thinker calls
+    uint64_t	time;		// in ns
+} thinkerstats_t;
+
+extern THREADLOCAL thinkerstats_t	thinkerstats[NUMTHINKERPOOLS];
+
+void P_InitThinkerStats (void);
+
 
 //
 // P_PSPR
@@ -95,10 +140,10 @@ void	P_PlayerThink (player_t* player);
 // Time interval for item respawning.
 #define ITEMQUESIZE		128
 
-extern mapthing_t	itemrespawnque[ITEMQUESIZE];
-extern int		itemrespawntime[ITEMQUESIZE];
-extern int		iquehead;
-extern int		iquetail;
+extern THREADLOCAL mapthing_t	itemrespawnque[ITEMQUESIZE];
+extern THREADLOCAL int		itemrespawntime[ITEMQUESIZE];
+extern THREADLOCAL int		iquehead;
+extern THREADLOCAL int		iquetail;
 
 
 void P_RespawnSpecials (void);
@@ -154,8 +199,8 @@ typedef struct
 #define MAXINTERCEPTS_ORIGINAL 128
 #define MAXINTERCEPTS          (MAXINTERCEPTS_ORIGINAL + 61)
 
-extern intercept_t	intercepts[MAXINTERCEPTS];
-extern intercept_t*	intercept_p;
+extern THREADLOCAL intercept_t	intercepts[MAXINTERCEPTS];
+extern THREADLOCAL intercept_t*	intercept_p;
 
 typedef boolean (*traverser_t) (intercept_t *in);
 
@@ -166,21 +211,22 @@ void 	P_MakeDivline (line_t* li, divline_t* dl);
 fixed_t P_InterceptVector (divline_t* v2, divline_t* v1);
 int 	P_BoxOnLineSide (fixed_t* tmbox, line_t* ld);
 
-extern fixed_t		opentop;
-extern fixed_t 		openbottom;
-extern fixed_t		openrange;
-extern fixed_t		lowfloor;
+extern THREADLOCAL fixed_t		opentop;
+extern THREADLOCAL fixed_t 		openbottom;
+extern THREADLOCAL fixed_t		openrange;
+extern THREADLOCAL fixed_t		lowfloor;
 
 void 	P_LineOpening (line_t* linedef);
 
 boolean P_BlockLinesIterator (int x, int y, boolean(*func)(line_t*) );
+boolean P_BlockLinesInBox (int x, int y, fixed_t* box, boolean(*func)(line_t*) );
 boolean P_BlockThingsIterator (int x, int y, boolean(*func)(mobj_t*) );
 
 #define PT_ADDLINES		1
 #define PT_ADDTHINGS	2
 #define PT_EARLYOUT		4
 
-extern divline_t	trace;
+extern THREADLOCAL divline_t	trace;
 
 boolean
 P_PathTraverse
@@ -201,12 +247,12 @@ void P_SetThingPosition (mobj_t* thing);
 
 // If "floatok" true, move would be ok
 // if within "tmfloorz - tmceilingz".
-extern boolean		floatok;
-extern fixed_t		tmfloorz;
-extern fixed_t		tmceilingz;
+extern THREADLOCAL boolean		floatok;
+extern THREADLOCAL fixed_t		tmfloorz;
+extern THREADLOCAL fixed_t		tmceilingz;
 
 
-extern	line_t*		ceilingline;
+extern THREADLOCAL line_t*		ceilingline;
 
 // fraggle: I have increased the size of this buffer.  In the original Doom,
 // overrunning past this limit caused other bits of memory to be overwritten,
@@ -219,19 +265,22 @@ extern	line_t*		ceilingline;
 #define MAXSPECIALCROSS 		20
 #define MAXSPECIALCROSS_ORIGINAL	8
 
-extern	line_t*	spechit[MAXSPECIALCROSS];
-extern	int	numspechit;
+extern THREADLOCAL line_t*	spechit[MAXSPECIALCROSS];
+extern THREADLOCAL int	numspechit;
 
 boolean P_CheckPosition (mobj_t *thing, fixed_t x, fixed_t y);
 boolean P_TryMove (mobj_t* thing, fixed_t x, fixed_t y);
 boolean P_TeleportMove (mobj_t* thing, fixed_t x, fixed_t y);
 void	P_SlideMove (mobj_t* mo);
 boolean P_CheckSight (mobj_t* t1, mobj_t* t2);
+void	P_FlushSightMemo (void);
+void	P_FlushSightSector (sector_t* sec);
+void	P_BuildReject (void);
 void 	P_UseLines (player_t* player);
 
 boolean P_ChangeSector (sector_t* sector, boolean crunch);
 
-extern mobj_t*	linetarget;	// who got hit (or NULL)
+extern THREADLOCAL mobj_t*	linetarget;	// who got hit (or NULL)
 
 fixed_t
 P_AimLineAttack
@@ -258,22 +307,29 @@ P_RadiusAttack
 //
 // P_SETUP
 //
-extern byte*		rejectmatrix;	// for fast sight rejection
-extern short*		blockmaplump;	// offsets in blockmap are from here
-extern short*		blockmap;
-extern int		bmapwidth;
-extern int		bmapheight;	// in mapblocks
-extern fixed_t		bmaporgx;
-extern fixed_t		bmaporgy;	// origin of block map
-extern mobj_t**		blocklinks;	// for thing chains
+extern THREADLOCAL byte*		rejectmatrix;	// for fast sight rejection
+extern THREADLOCAL int		bmapwidth;
+extern THREADLOCAL int		bmapheight;	// in mapblocks
+extern THREADLOCAL fixed_t		bmaporgx;
+extern THREADLOCAL fixed_t		bmaporgy;	// origin of block map
+extern THREADLOCAL mobj_t**		blocklinks;	// for thing chains
+
+// Lines are kept in a grid of their own, with the same origin.
+extern THREADLOCAL int		lbmapwidth;
+extern THREADLOCAL int		lbmapheight;	// in line blocks
+extern THREADLOCAL int		lbmapshift;	// MAPBLOCKSHIFT or less
+extern THREADLOCAL int		numlineblocks;	// as loaded
+extern THREADLOCAL int*		blocklinestart;	// first entry of each block
+extern THREADLOCAL int*		blocklinenum;	// line of each entry
+extern THREADLOCAL fixed_t*		blocklinebox[4];	// bbox of each entry
 
 
 
 //
 // P_INTER
 //
-extern int		maxammo[NUMAMMO];
-extern int		clipammo[NUMAMMO];
+extern THREADLOCAL int		maxammo[NUMAMMO];
+extern THREADLOCAL int		clipammo[NUMAMMO];
 
 void
 P_TouchSpecialThing
@@ -29,6 +29,7 @@
 #include "doomdef.h"
 #include "m_argv.h"
 #include "m_misc.h"
+#include "m_trace.h"
 #include "p_local.h"
 
 #include "s_sound.h"
@@ -60,30 +61,30 @@
 //#define DEFAULT_SPECHIT_MAGIC 0x84f968e8
 
 
-fixed_t		tmbbox[4];
-mobj_t*		tmthing;
-int		tmflags;
-fixed_t		tmx;
-fixed_t		tmy;
+THREADLOCAL fixed_t		tmbbox[4];
+THREADLOCAL mobj_t*		tmthing;
+THREADLOCAL int		tmflags;
+THREADLOCAL fixed_t		tmx;
+THREADLOCAL fixed_t		tmy;
 
 
 // If "floatok" true, move would be ok
 // if within "tmfloorz - tmceilingz".
-boolean		floatok;
+THREADLOCAL boolean		floatok;
 
-fixed_t		tmfloorz;
-fixed_t		tmceilingz;
-fixed_t		tmdropoffz;
+THREADLOCAL fixed_t		tmfloorz;
+THREADLOCAL fixed_t		tmceilingz;
+THREADLOCAL fixed_t		tmdropoffz;
 
 // keep track of the line that lowers the ceiling,
 // so missiles don't explode against sky hack walls
-line_t*		ceilingline;
+THREADLOCAL line_t*		ceilingline;
 
 // keep track of special lines as they are hit,
 // but don't process them until the move is proven valid
 
-line_t*		spechit[MAXSPECIALCROSS];
-int		numspechit;
+THREADLOCAL line_t*		spechit[MAXSPECIALCROSS];
+THREADLOCAL int		numspechit;
 
 
 
@@ -398,8 +399,8 @@ boolean PIT_CheckThing (mobj_t* thing)
 //  speciallines[]
 //  numspeciallines
 //
-boolean
-P_CheckPosition
+static boolean
+CheckPosition
 ( mobj_t*	thing,
   fixed_t	x,
   fixed_t	y )
@@ -455,19 +456,37 @@ P_CheckPosition
 		return false;
     
     // check lines
-    xl = (tmbbox[BOXLEFT] - bmaporgx)>>MAPBLOCKSHIFT;
-    xh = (tmbbox[BOXRIGHT] - bmaporgx)>>MAPBLOCKSHIFT;
-    yl = (tmbbox[BOXBOTTOM] - bmaporgy)>>MAPBLOCKSHIFT;
-    yh = (tmbbox[BOXTOP] - bmaporgy)>>MAPBLOCKSHIFT;
+    xl = (tmbbox[BOXLEFT] - bmaporgx)>>lbmapshift;
+    xh = (tmbbox[BOXRIGHT] - bmaporgx)>>lbmapshift;
+    yl = (tmbbox[BOXBOTTOM] - bmaporgy)>>lbmapshift;
+    yh = (tmbbox[BOXTOP] - bmaporgy)>>lbmapshift;
 
+    // PIT_CheckLine ignores lines clear of tmbbox,
+    // so they need not be looked at.
     for (bx=xl ; bx<=xh ; bx++)
 	for (by=yl ; by<=yh ; by++)
-	    if (!P_BlockLinesIterator (bx,by,PIT_CheckLine))
+	    if (!P_BlockLinesInBox (bx,by,tmbbox,PIT_CheckLine))
 		return false;
 
     return true;
 }
 
+boolean
+P_CheckPosition
+( mobj_t*	thing,
+  fixed_t	x,
+  fixed_t	y )
+{
+    uint64_t	trace;
+    boolean	result;
+
+    trace = M_TraceBegin ();
+    result = CheckPosition (thing, x, y);
+    M_TraceEnd (tz_checkposition, trace);
+
+    return result;
+}
+
 
 //
 // P_TryMove
@@ -590,16 +609,16 @@ boolean P_ThingHeightClip (mobj_t* thing)
 // SLIDE MOVE
 // Allows the player to slide along any angled walls.
 //
-fixed_t		bestslidefrac;
-fixed_t		secondslidefrac;
+THREADLOCAL fixed_t		bestslidefrac;
+THREADLOCAL fixed_t		secondslidefrac;
 
-line_t*		bestslideline;
-line_t*		secondslideline;
+THREADLOCAL line_t*		bestslideline;
+THREADLOCAL line_t*		secondslideline;
 
-mobj_t*		slidemo;
+THREADLOCAL mobj_t*		slidemo;
 
-fixed_t		tmxmove;
-fixed_t		tmymove;
+THREADLOCAL fixed_t		tmxmove;
+THREADLOCAL fixed_t		tmymove;
 
 
 
@@ -818,21 +837,21 @@ void P_SlideMove (mobj_t* mo)
 //
 // P_LineAttack
 //
-mobj_t*		linetarget;	// who got hit (or NULL)
-mobj_t*		shootthing;
+THREADLOCAL mobj_t*		linetarget;	// who got hit (or NULL)
+THREADLOCAL mobj_t*		shootthing;
 
 // Height if not aiming up or down
 // ???: use slope for monsters?
-fixed_t		shootz;	
+THREADLOCAL fixed_t		shootz;	
 
-int		la_damage;
-fixed_t		attackrange;
+THREADLOCAL int		la_damage;
+THREADLOCAL fixed_t		attackrange;
 
-fixed_t		aimslope;
+THREADLOCAL fixed_t		aimslope;
 
 // slopes to top and bottom of target
-extern fixed_t	topslope;
-extern fixed_t	bottomslope;	
+extern THREADLOCAL fixed_t	topslope;
+extern THREADLOCAL fixed_t	bottomslope;	
 
 
 //
@@ -1137,7 +1156,7 @@ P_LineAttack
 //
 // USE LINES
 //
-mobj_t*		usething;
+THREADLOCAL mobj_t*		usething;
 
 boolean	PTR_UseTraverse (intercept_t* in)
 {
@@ -1198,9 +1217,9 @@ void P_UseLines (player_t*	player)
 //
 // RADIUS ATTACK
 //
-mobj_t*		bombsource;
-mobj_t*		bombspot;
-int		bombdamage;
+THREADLOCAL mobj_t*		bombsource;
+THREADLOCAL mobj_t*		bombspot;
+THREADLOCAL int		bombdamage;
 
 
 //
@@ -1294,8 +1313,8 @@ P_RadiusAttack
 //  the way it was and call P_ChangeSector again
 //  to undo the changes.
 //
-boolean		crushchange;
-boolean		nofit;
+THREADLOCAL boolean		crushchange;
+THREADLOCAL boolean		nofit;
 
 
 //
@@ -1390,7 +1409,7 @@ P_ChangeSector
 
 static void SpechitOverrun(line_t *ld)
 {
-    static unsigned int baseaddr = 0;
+    static THREADLOCAL unsigned int baseaddr = 0;
     unsigned int addr;
    
     if (baseaddr == 0)
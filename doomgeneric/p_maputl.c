@@ -286,10 +286,10 @@ P_InterceptVector
 // through a two sided line.
 // OPTIMIZE: keep this precalculated
 //
-fixed_t opentop;
-fixed_t openbottom;
-fixed_t openrange;
-fixed_t	lowfloor;
+THREADLOCAL fixed_t opentop;
+THREADLOCAL fixed_t openbottom;
+THREADLOCAL fixed_t openrange;
+THREADLOCAL fixed_t	lowfloor;
 
 
 void P_LineOpening (line_t* linedef)
@@ -462,6 +462,7 @@ P_SetThingPosition (mobj_t* thing)
 // so increment validcount before the first call
 // to P_BlockLinesIterator, then make one or more calls
 // to it.
+// x and y are in line blocks, which may be smaller than mapblocks.
 //
 boolean
 P_BlockLinesIterator
@@ -470,24 +471,84 @@ P_BlockLinesIterator
   boolean(*func)(line_t*) )
 {
     int			offset;
-    short*		list;
+    int			end;
     line_t*		ld;
 	
     if (x<0
 	|| y<0
-	|| x>=bmapwidth
-	|| y>=bmapheight)
+	|| x>=lbmapwidth
+	|| y>=lbmapheight)
     {
 	return true;
     }
     
-    offset = y*bmapwidth+x;
+    offset = y*lbmapwidth+x;
+
+    // Only if an intercepts overrun has changed the size.
+    if ((unsigned int) offset >= (unsigned int) numlineblocks)
+	return true;
+
+    end = blocklinestart[offset+1];
+
+    for (offset = blocklinestart[offset] ; offset < end ; offset++)
+    {
+	ld = &lines[blocklinenum[offset]];
+
+	if (ld->validcount == validcount)
+	    continue; 	// line has already been checked
+
+	ld->validcount = validcount;
+		
+	if ( !func(ld) )
+	    return false;
+    }
+    return true;	// everything was checked
+}
+
+
+//
+// P_BlockLinesInBox
+// Like P_BlockLinesIterator, but passes over the lines
+// whose bounding box does not overlap box, without
+// touching them.  The boxes of a block are stored
+// together, so that is cheap.
+//
+boolean
+P_BlockLinesInBox
+( int			x,
+  int			y,
+  fixed_t*		box,
+  boolean(*func)(line_t*) )
+{
+    int			offset;
+    int			end;
+    line_t*		ld;
 	
-    offset = *(blockmap+offset);
+    if (x<0
+	|| y<0
+	|| x>=lbmapwidth
+	|| y>=lbmapheight)
+    {
+	return true;
+    }
+    
+    offset = y*lbmapwidth+x;
+
+    // Only if an intercepts overrun has changed the size.
+    if ((unsigned int) offset >= (unsigned int) numlineblocks)
+	return true;
 
-    for ( list = blockmaplump+offset ; *list != -1 ; list++)
+    end = blocklinestart[offset+1];
+
+    for (offset = blocklinestart[offset] ; offset < end ; offset++)
     {
-	ld = &lines[*list];
+	if (box[BOXRIGHT] <= blocklinebox[BOXLEFT][offset]
+	    || box[BOXLEFT] >= blocklinebox[BOXRIGHT][offset]
+	    || box[BOXTOP] <= blocklinebox[BOXBOTTOM][offset]
+	    || box[BOXBOTTOM] >= blocklinebox[BOXTOP][offset])
+	    continue;
+
+	ld = &lines[blocklinenum[offset]];
 
 	if (ld->validcount == validcount)
 	    continue; 	// line has already been checked
@@ -536,12 +597,12 @@ P_BlockThingsIterator
 //
 // INTERCEPT ROUTINES
 //
-intercept_t	intercepts[MAXINTERCEPTS];
-intercept_t*	intercept_p;
+THREADLOCAL intercept_t	intercepts[MAXINTERCEPTS];
+THREADLOCAL intercept_t*	intercept_p;
 
-divline_t 	trace;
-boolean 	earlyout;
-int		ptflags;
+THREADLOCAL divline_t 	trace;
+THREADLOCAL boolean 	earlyout;
+THREADLOCAL int		ptflags;
 
 static void InterceptsOverrun(int num_intercepts, intercept_t *intercept);
 
@@ -728,7 +789,7 @@ P_TraverseIntercepts
     return true;		// everything was traversed
 }
 
-extern fixed_t bulletslope;
+extern THREADLOCAL fixed_t bulletslope;
 
 // Intercepts Overrun emulation, from PrBoom-plus.
 // Thanks to Andrey Budko (entryway) for researching this and his 
@@ -742,45 +803,48 @@ typedef struct
     boolean int16_array;
 } intercepts_overrun_t;
 
-// Intercepts memory table.  This is where various variables are located
-// in memory in Vanilla Doom.  When the intercepts table overflows, we
-// need to write to them.
-//
-// Almost all of the values to overwrite are 32-bit integers, except for
-// playerstarts, which is effectively an array of 16-bit integers and
-// must be treated differently.
-
-static intercepts_overrun_t intercepts_overrun[] =
-{
-    {4,   NULL,                          false},
-    {4,   NULL, /* &earlyout, */         false},
-    {4,   NULL, /* &intercept_p, */      false},
-    {4,   &lowfloor,                     false},
-    {4,   &openbottom,                   false},
-    {4,   &opentop,                      false},
-    {4,   &openrange,                    false},
-    {4,   NULL,                          false},
-    {120, NULL, /* &activeplats, */      false},
-    {8,   NULL,                          false},
-    {4,   &bulletslope,                  false},
-    {4,   NULL, /* &swingx, */           false},
-    {4,   NULL, /* &swingy, */           false},
-    {4,   NULL,                          false},
-    {40,  &playerstarts,                 true},
-    {4,   NULL, /* &blocklinks, */       false},
-    {4,   &bmapwidth,                    false},
-    {4,   NULL, /* &blockmap, */         false},
-    {4,   &bmaporgx,                     false},
-    {4,   &bmaporgy,                     false},
-    {4,   NULL, /* &blockmaplump, */     false},
-    {4,   &bmapheight,                   false},
-    {0,   NULL,                          false},
-};
-
 // Overwrite a specific memory location with a value.
 
 static void InterceptsMemoryOverrun(int location, int value)
 {
+    // Intercepts memory table.  This is where various variables are located
+    // in memory in Vanilla Doom.  When the intercepts table overflows, we
+    // need to write to them.
+    //
+    // Almost all of the values to overwrite are 32-bit integers, except for
+    // playerstarts, which is effectively an array of 16-bit integers and
+    // must be treated differently.
+    //
+    // The table is built on the stack so that it refers to this
+    // thread's variables when the engine is built reentrant.
+
+    intercepts_overrun_t intercepts_overrun[] =
+    {
+        {4,   NULL,                          false},
+        {4,   NULL, /* &earlyout, */         false},
+        {4,   NULL, /* &intercept_p, */      false},
+        {4,   &lowfloor,                     false},
+        {4,   &openbottom,                   false},
+        {4,   &opentop,                      false},
+        {4,   &openrange,                    false},
+        {4,   NULL,                          false},
+        {120, NULL, /* &activeplats, */      false},
+        {8,   NULL,                          false},
+        {4,   &bulletslope,                  false},
+        {4,   NULL, /* &swingx, */           false},
+        {4,   NULL, /* &swingy, */           false},
+        {4,   NULL,                          false},
+        {40,  &playerstarts,                 true},
+        {4,   NULL, /* &blocklinks, */       false},
+        {4,   &bmapwidth,                    false},
+        {4,   NULL, /* &blockmap, */         false},
+        {4,   &bmaporgx,                     false},
+        {4,   &bmaporgy,                     false},
+        {4,   NULL, /* &blockmaplump, */     false},
+        {4,   &bmapheight,                   false},
+        {0,   NULL,                          false},
+    };
+
     int i, offset;
     int index;
     void *addr;
@@ -847,24 +911,35 @@ static void InterceptsOverrun(int num_intercepts, intercept_t *intercept)
     InterceptsMemoryOverrun(location, intercept->frac);
     InterceptsMemoryOverrun(location + 4, intercept->isaline);
     InterceptsMemoryOverrun(location + 8, (int) intercept->d.thing);
+
+    // Vanilla looked up lines in the mapblock grid.  Unless they
+    // have been put in smaller blocks, the line grid is that grid,
+    // and an overrun that changes its size changes both.
+
+    if (lbmapshift == MAPBLOCKSHIFT)
+    {
+        lbmapwidth = bmapwidth;
+        lbmapheight = bmapheight;
+    }
 }
 
 
 //
-// P_PathTraverse
-// Traces a line from x1,y1 to x2,y2,
-// calling the traverser function for each.
-// Returns true if the traverser function returns true
-// for all lines.
+// P_TraverseBlocks
+// Steps through the blocks of size 1<<shift under the
+// line from x1,y1 to x2,y2 (relative to the blockmap
+// origin), adding the lines and/or things in them to
+// the intercepts as flags say.
+// Returns false on an early out.
 //
-boolean
-P_PathTraverse
+static boolean
+P_TraverseBlocks
 ( fixed_t		x1,
   fixed_t		y1,
   fixed_t		x2,
   fixed_t		y2,
-  int			flags,
-  boolean (*trav) (intercept_t *))
+  int			shift,
+  int			flags )
 {
     fixed_t	xt1;
     fixed_t	yt1;
@@ -885,44 +960,27 @@ P_PathTraverse
     int		mapxstep;
     int		mapystep;
 
+    int		tofrac;
     int		count;
 		
-    earlyout = flags & PT_EARLYOUT;
-		
-    validcount++;
-    intercept_p = intercepts;
-	
-    if ( ((x1-bmaporgx)&(MAPBLOCKSIZE-1)) == 0)
-	x1 += FRACUNIT;	// don't side exactly on a line
-    
-    if ( ((y1-bmaporgy)&(MAPBLOCKSIZE-1)) == 0)
-	y1 += FRACUNIT;	// don't side exactly on a line
-
-    trace.x = x1;
-    trace.y = y1;
-    trace.dx = x2 - x1;
-    trace.dy = y2 - y1;
+    tofrac = shift - FRACBITS;
 
-    x1 -= bmaporgx;
-    y1 -= bmaporgy;
-    xt1 = x1>>MAPBLOCKSHIFT;
-    yt1 = y1>>MAPBLOCKSHIFT;
+    xt1 = x1>>shift;
+    yt1 = y1>>shift;
 
-    x2 -= bmaporgx;
-    y2 -= bmaporgy;
-    xt2 = x2>>MAPBLOCKSHIFT;
-    yt2 = y2>>MAPBLOCKSHIFT;
+    xt2 = x2>>shift;
+    yt2 = y2>>shift;
 
     if (xt2 > xt1)
     {
 	mapxstep = 1;
-	partial = FRACUNIT - ((x1>>MAPBTOFRAC)&(FRACUNIT-1));
+	partial = FRACUNIT - ((x1>>tofrac)&(FRACUNIT-1));
 	ystep = FixedDiv (y2-y1,abs(x2-x1));
     }
     else if (xt2 < xt1)
     {
 	mapxstep = -1;
-	partial = (x1>>MAPBTOFRAC)&(FRACUNIT-1);
+	partial = (x1>>tofrac)&(FRACUNIT-1);
 	ystep = FixedDiv (y2-y1,abs(x2-x1));
     }
     else
@@ -932,19 +990,19 @@ P_PathTraverse
 	ystep = 256*FRACUNIT;
     }	
 
-    yintercept = (y1>>MAPBTOFRAC) + FixedMul (partial, ystep);
+    yintercept = (y1>>tofrac) + FixedMul (partial, ystep);
 
 	
     if (yt2 > yt1)
     {
 	mapystep = 1;
-	partial = FRACUNIT - ((y1>>MAPBTOFRAC)&(FRACUNIT-1));
+	partial = FRACUNIT - ((y1>>tofrac)&(FRACUNIT-1));
 	xstep = FixedDiv (x2-x1,abs(y2-y1));
     }
     else if (yt2 < yt1)
     {
 	mapystep = -1;
-	partial = (y1>>MAPBTOFRAC)&(FRACUNIT-1);
+	partial = (y1>>tofrac)&(FRACUNIT-1);
 	xstep = FixedDiv (x2-x1,abs(y2-y1));
     }
     else
@@ -953,15 +1011,16 @@ P_PathTraverse
 	partial = FRACUNIT;
 	xstep = 256*FRACUNIT;
     }	
-    xintercept = (x1>>MAPBTOFRAC) + FixedMul (partial, xstep);
+    xintercept = (x1>>tofrac) + FixedMul (partial, xstep);
     
     // Step through map blocks.
     // Count is present to prevent a round off error
-    // from skipping the break.
+    // from skipping the break.  It allows as long a
+    // line in smaller blocks as in mapblocks.
     mapx = xt1;
     mapy = yt1;
 	
-    for (count = 0 ; count < 64 ; count++)
+    for (count = 0 ; count < (64 << (MAPBLOCKSHIFT - shift)) ; count++)
     {
 	if (flags & PT_ADDLINES)
 	{
@@ -981,18 +1040,82 @@ P_PathTraverse
 	    break;
 	}
 	
+	// Round off can leave neither intercept in this
+	// block, and the walk stuck in it.  Smaller blocks
+	// would see that often, so they take the y step.
 	if ( (yintercept >> FRACBITS) == mapy)
 	{
 	    yintercept += ystep;
 	    mapx += mapxstep;
 	}
-	else if ( (xintercept >> FRACBITS) == mapx)
+	else if ( (xintercept >> FRACBITS) == mapx
+		  || shift != MAPBLOCKSHIFT)
 	{
 	    xintercept += xstep;
 	    mapy += mapystep;
 	}
 		
     }
+
+    return true;
+}
+
+
+//
+// P_PathTraverse
+// Traces a line from x1,y1 to x2,y2,
+// calling the traverser function for each.
+// Returns true if the traverser function returns true
+// for all lines.
+//
+boolean
+P_PathTraverse
+( fixed_t		x1,
+  fixed_t		y1,
+  fixed_t		x2,
+  fixed_t		y2,
+  int			flags,
+  boolean (*trav) (intercept_t *))
+{
+    earlyout = flags & PT_EARLYOUT;
+		
+    validcount++;
+    intercept_p = intercepts;
+	
+    // Line blocks are never bigger than mapblocks, so
+    // this keeps off the edges of both.
+    if ( ((x1-bmaporgx)&((1<<lbmapshift)-1)) == 0)
+	x1 += FRACUNIT;	// don't side exactly on a line
+    
+    if ( ((y1-bmaporgy)&((1<<lbmapshift)-1)) == 0)
+	y1 += FRACUNIT;	// don't side exactly on a line
+
+    trace.x = x1;
+    trace.y = y1;
+    trace.dx = x2 - x1;
+    trace.dy = y2 - y1;
+
+    x1 -= bmaporgx;
+    y1 -= bmaporgy;
+    x2 -= bmaporgx;
+    y2 -= bmaporgy;
+
+    if (lbmapshift == MAPBLOCKSHIFT)
+    {
+	if (!P_TraverseBlocks (x1, y1, x2, y2, MAPBLOCKSHIFT, flags))
+	    return false;	// early out
+    }
+    else
+    {
+	if ((flags & PT_ADDLINES)
+	    && !P_TraverseBlocks (x1, y1, x2, y2, lbmapshift, PT_ADDLINES))
+	    return false;	// early out
+
+	if ((flags & PT_ADDTHINGS)
+	    && !P_TraverseBlocks (x1, y1, x2, y2, MAPBLOCKSHIFT, PT_ADDTHINGS))
+	    return false;	// early out
+    }
+
     // go through the sorted list
     return P_TraverseIntercepts ( trav, FRACUNIT );
 }
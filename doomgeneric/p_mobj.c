@@ -21,6 +21,7 @@
 #include "i_system.h"
 #include "z_zone.h"
 #include "m_random.h"
+#include "m_trace.h"
 
 #include "doomdef.h"
 #include "p_local.h"
@@ -42,7 +43,7 @@ void P_SpawnMapThing (mapthing_t*	mthing);
 // P_SetMobjState
 // Returns true if the mobj is still present.
 //
-int test;
+THREADLOCAL int test;
 
 boolean
 P_SetMobjState
@@ -436,9 +437,9 @@ P_NightmareRespawn (mobj_t* mobj)
 
 
 //
-// P_MobjThinker
+// MobjThinker
 //
-void P_MobjThinker (mobj_t* mobj)
+static void MobjThinker (mobj_t* mobj)
 {
     // momentum movement
     if (mobj->momx
@@ -499,6 +500,19 @@ void P_MobjThinker (mobj_t* mobj)
 }
 
 
+//
+// P_MobjThinker
+//
+void P_MobjThinker (mobj_t* mobj)
+{
+    uint64_t	trace;
+
+    trace = M_TraceBegin ();
+    MobjThinker (mobj);
+    M_TraceEnd (tz_mobjthinker, trace);
+}
+
+
 //
 // P_SpawnMobj
 //
@@ -513,8 +527,7 @@ P_SpawnMobj
     state_t*	st;
     mobjinfo_t*	info;
 	
-    mobj = Z_Malloc (sizeof(*mobj), PU_LEVEL, NULL);
-    memset (mobj, 0, sizeof (*mobj));
+    mobj = P_AllocThinker (tp_mobj);
     info = &mobjinfo[type];
 	
     mobj->type = type;
@@ -552,6 +565,11 @@ P_SpawnMobj
     else 
 	mobj->z = z;
 
+    mobj->oldx = mobj->x;
+    mobj->oldy = mobj->y;
+    mobj->oldz = mobj->z;
+    mobj->oldangle = mobj->angle;
+
     mobj->thinker.function.acp1 = (actionf_p1)P_MobjThinker;
 	
     P_AddThinker (&mobj->thinker);
@@ -563,10 +581,10 @@ P_SpawnMobj
 //
 // P_RemoveMobj
 //
-mapthing_t	itemrespawnque[ITEMQUESIZE];
-int		itemrespawntime[ITEMQUESIZE];
-int		iquehead;
-int		iquetail;
+THREADLOCAL mapthing_t	itemrespawnque[ITEMQUESIZE];
+THREADLOCAL int		itemrespawntime[ITEMQUESIZE];
+THREADLOCAL int		iquehead;
+THREADLOCAL int		iquetail;
 
 
 void P_RemoveMobj (mobj_t* mobj)
@@ -845,7 +863,7 @@ void P_SpawnMapThing (mapthing_t* mthing)
 //
 // P_SpawnPuff
 //
-extern fixed_t attackrange;
+extern THREADLOCAL fixed_t attackrange;
 
 void
 P_SpawnPuff
@@ -930,7 +948,7 @@ mobj_t *P_SubstNullMobj(mobj_t *mobj)
 {
     if (mobj == NULL)
     {
-        static mobj_t dummy_mobj;
+        static THREADLOCAL mobj_t dummy_mobj;
 
         dummy_mobj.x = 0;
         dummy_mobj.y = 0;
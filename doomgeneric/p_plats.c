@@ -35,7 +35,7 @@
 #include "sounds.h"
 
 
-plat_t*		activeplats[MAXPLATS];
+THREADLOCAL plat_t*		activeplats[MAXPLATS];
 
 
 
@@ -160,7 +160,7 @@ EV_DoPlat
 	
 	// Find lowest & highest floors around sector
 	rtn = 1;
-	plat = Z_Malloc( sizeof(*plat), PU_LEVSPEC, 0);
+	plat = P_AllocThinker (tp_plat);
 	P_AddThinker(&plat->thinker);
 		
 	plat->type = type;
@@ -97,8 +97,8 @@ P_SetPsprite
 //
 // P_CalcSwing
 //	
-fixed_t		swingx;
-fixed_t		swingy;
+THREADLOCAL fixed_t		swingx;
+THREADLOCAL fixed_t		swingy;
 
 void P_CalcSwing (player_t*	player)
 {
@@ -604,7 +604,7 @@ A_FirePlasma
 // Sets a slope so a near miss is at aproximately
 // the height of the intended target
 //
-fixed_t		bulletslope;
+THREADLOCAL fixed_t		bulletslope;
 
 
 void P_BulletSlope (mobj_t*	mo)
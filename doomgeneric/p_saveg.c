@@ -24,6 +24,8 @@
 #include "deh_main.h"
 #include "i_system.h"
 #include "z_zone.h"
+#include "m_argv.h"
+#include "m_compress.h"
 #include "p_local.h"
 #include "p_saveg.h"
 
@@ -36,9 +38,10 @@
 #define SAVEGAME_EOF 0x1d
 #define VERSIONSIZE 16 
 
-FILE *save_stream;
-int savegamelength;
-boolean savegame_error;
+THREADLOCAL MEMFILE *save_stream;
+THREADLOCAL int savegamelength;
+THREADLOCAL boolean savegame_error;
+THREADLOCAL boolean savegame_vanilla;
 
 // Get the filename of a temporary file to write the savegame to.  After
 // the file has been successfully saved, it will be renamed to the 
@@ -46,7 +49,7 @@ boolean savegame_error;
 
 char *P_TempSaveGameFile(void)
 {
-    static char *filename = NULL;
+    static THREADLOCAL char *filename = NULL;
 
     if (filename == NULL)
     {
@@ -60,8 +63,8 @@ char *P_TempSaveGameFile(void)
 
 char *P_SaveGameFile(int slot)
 {
-    static char *filename = NULL;
-    static size_t filename_size = 0;
+    static THREADLOCAL char *filename = NULL;
+    static THREADLOCAL size_t filename_size = 0;
     char basename[32];
 
     if (filename == NULL)
@@ -80,9 +83,9 @@ char *P_SaveGameFile(int slot)
 
 static byte saveg_read8(void)
 {
-    byte result;
+    byte result = 0;
 
-    if (fread(&result, 1, 1, save_stream) < 1)
+    if (mem_fread(&result, 1, 1, save_stream) < 1)
     {
         if (!savegame_error)
         {
@@ -98,7 +101,7 @@ static byte saveg_read8(void)
 
 static void saveg_write8(byte value)
 {
-    if (fwrite(&value, 1, 1, save_stream) < 1)
+    if (mem_fwrite(&value, 1, 1, save_stream) < 1)
     {
         if (!savegame_error)
         {
@@ -153,7 +156,7 @@ static void saveg_read_pad(void)
     int padding;
     int i;
 
-    pos = ftell(save_stream);
+    pos = mem_ftell(save_stream);
 
     padding = (4 - (pos & 3)) & 3;
 
@@ -169,7 +172,7 @@ static void saveg_write_pad(void)
     int padding;
     int i;
 
-    pos = ftell(save_stream);
+    pos = mem_ftell(save_stream);
 
     padding = (4 - (pos & 3)) & 3;
 
@@ -1340,6 +1343,376 @@ static void saveg_write_glow_t(glow_t *str)
     saveg_write32(str->direction);
 }
 
+//
+// The doomgeneric savegame format
+//
+// The description comes first, as in Vanilla, for the menu to show,
+// followed by a version string that is not Vanilla's.  Then:
+//
+//   byte    flags           SAVEGAME_COMPRESSED
+//   byte    pad[3]
+//   int     length          of the body
+//   int     stored length   of what follows
+//   byte    body[stored length]
+//   byte    SAVEGAME_EOF
+//
+// The body is built in memory and written in one go, compressed with
+// M_Compress unless -nosavecompress is given.  It is a list of
+// sections, each an array of records of one type, and starts with the
+// tag of the section, the number of records and the size of one.  A
+// later version may add sections, or fields at the end of records;
+// readers skip what they do not know about.
+//
+
+#define SAVEGAME_VERSION "dgsave 1"
+
+#define SAVEGAME_COMPRESSED 1
+
+#define SECTIONTAG(a, b, c, d) ((a) | ((b) << 8) | ((c) << 16) | ((d) << 24))
+
+enum
+{
+    sec_game = SECTIONTAG('G', 'A', 'M', 'E'),
+    sec_players = SECTIONTAG('P', 'L', 'Y', 'R'),
+    sec_sectors = SECTIONTAG('S', 'E', 'C', 'T'),
+    sec_lines = SECTIONTAG('L', 'I', 'N', 'E'),
+    sec_sides = SECTIONTAG('S', 'I', 'D', 'E'),
+    sec_mobjs = SECTIONTAG('M', 'O', 'B', 'J'),
+    sec_specials = SECTIONTAG('S', 'P', 'E', 'C'),
+    sec_ceilings = SECTIONTAG('C', 'E', 'I', 'L'),
+    sec_doors = SECTIONTAG('D', 'O', 'O', 'R'),
+    sec_floors = SECTIONTAG('F', 'L', 'O', 'R'),
+    sec_plats = SECTIONTAG('P', 'L', 'A', 'T'),
+    sec_flashes = SECTIONTAG('F', 'L', 'S', 'H'),
+    sec_strobes = SECTIONTAG('S', 'T', 'R', 'B'),
+    sec_glows = SECTIONTAG('G', 'L', 'O', 'W'),
+    sec_end = SECTIONTAG('E', 'N', 'D', ' '),
+};
+
+#define SECTIONHEADERSIZE 12
+#define MAXSAVESECTIONS 32
+
+typedef struct
+{
+    int tag;
+    int count;
+    int size;                   // of a record
+    long offset;                // of the first record
+} savesection_t;
+
+// The file, while save_stream is its body.
+
+static THREADLOCAL MEMFILE *file_stream;
+
+// The body, when it had to be decompressed.
+
+static THREADLOCAL byte *body_buffer;
+
+static THREADLOCAL savesection_t savesections[MAXSAVESECTIONS];
+static THREADLOCAL int numsavesections;
+
+// Start a section.  The counts are filled in by saveg_end_section.
+
+static long saveg_begin_section(int tag)
+{
+    long start;
+
+    start = mem_ftell(save_stream);
+
+    saveg_write32(tag);
+    saveg_write32(0);
+    saveg_write32(0);
+
+    return start;
+}
+
+static void saveg_end_section(long start, int count)
+{
+    long end;
+
+    end = mem_ftell(save_stream);
+
+    mem_fseek(save_stream, start + 4, MEM_SEEK_SET);
+    saveg_write32(count);
+    saveg_write32(count > 0 ? (end - start - SECTIONHEADERSIZE) / count : 0);
+    mem_fseek(save_stream, end, MEM_SEEK_SET);
+}
+
+// Find the sections of the body, up to the end marker.
+
+static boolean saveg_read_sections(void)
+{
+    savesection_t *section;
+    void *buf;
+    size_t buflen;
+
+    numsavesections = 0;
+
+    while (numsavesections < MAXSAVESECTIONS)
+    {
+        section = &savesections[numsavesections];
+        section->tag = saveg_read32();
+        section->count = saveg_read32();
+        section->size = saveg_read32();
+        section->offset = mem_ftell(save_stream);
+
+        if (savegame_error || section->count < 0 || section->size < 0)
+        {
+            return false;
+        }
+
+        if (section->tag == sec_end)
+        {
+            return true;
+        }
+
+        // The records must fit in what is left of the buffer.
+
+        mem_get_buf(save_stream, &buf, &buflen);
+
+        if (section->size != 0
+         && (size_t) section->count
+              > (buflen - section->offset) / section->size)
+        {
+            return false;
+        }
+
+        if (mem_fseek(save_stream,
+                      section->offset + (long) section->count * section->size,
+                      MEM_SEEK_SET) != 0)
+        {
+            return false;
+        }
+
+        ++numsavesections;
+    }
+
+    return false;
+}
+
+static savesection_t *saveg_find_section(int tag)
+{
+    int i;
+
+    for (i=0; i<numsavesections; ++i)
+    {
+        if (savesections[i].tag == tag)
+        {
+            return &savesections[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Go to record i of a section.
+
+static boolean saveg_seek_record(savesection_t *section, int i)
+{
+    if (i >= section->count)
+    {
+        return false;
+    }
+
+    return mem_fseek(save_stream, section->offset + (long) i * section->size,
+                     MEM_SEEK_SET) == 0;
+}
+
+// Check that reading record i did not run into the next one.
+
+static boolean saveg_record_fits(savesection_t *section, int i)
+{
+    return !savegame_error
+        && mem_ftell(save_stream)
+               <= section->offset + (long) (i + 1) * section->size;
+}
+
+// Make save_stream the body that follows the header of the file.
+
+static void saveg_close_body(void);
+
+static boolean saveg_open_body(void)
+{
+    void *buf;
+    size_t buflen;
+    byte *body;
+    byte flags;
+    int length;
+    int stored;
+    long pos;
+
+    flags = saveg_read8();
+    saveg_read8();
+    saveg_read8();
+    saveg_read8();
+    length = saveg_read32();
+    stored = saveg_read32();
+
+    pos = mem_ftell(save_stream);
+    mem_get_buf(save_stream, &buf, &buflen);
+
+    if (savegame_error || length <= 0 || stored <= 0
+     || (size_t) stored > buflen - pos)
+    {
+        return false;
+    }
+
+    body = (byte *) buf + pos;
+
+    if (flags & SAVEGAME_COMPRESSED)
+    {
+        body_buffer = Z_Malloc(length, PU_STATIC, NULL);
+
+        if (!M_Decompress(body, stored, body_buffer, length))
+        {
+            Z_Free(body_buffer);
+            body_buffer = NULL;
+            return false;
+        }
+
+        body = body_buffer;
+    }
+    else if (stored != length)
+    {
+        return false;
+    }
+
+    mem_fseek(save_stream, pos + stored, MEM_SEEK_SET);
+
+    file_stream = save_stream;
+    save_stream = mem_fopen_read(body, length);
+
+    if (!saveg_read_sections())
+    {
+        saveg_close_body();
+        return false;
+    }
+
+    return true;
+}
+
+static void saveg_close_body(void)
+{
+    mem_fclose(save_stream);
+    save_stream = file_stream;
+    file_stream = NULL;
+
+    if (body_buffer != NULL)
+    {
+        Z_Free(body_buffer);
+        body_buffer = NULL;
+    }
+}
+
+// Write the body to the file, after its length and flags.
+
+static void saveg_write_body(void)
+{
+    MEMFILE *body_stream;
+    void *body;
+    size_t length;
+    byte *compressed;
+    byte *stored;
+    size_t stored_length;
+    byte flags;
+
+    body_stream = save_stream;
+    mem_get_buf(body_stream, &body, &length);
+
+    flags = 0;
+    compressed = NULL;
+    stored = body;
+    stored_length = length;
+
+    //!
+    // @category obscure
+    //
+    // Do not compress savegames.
+    //
+
+    if (!M_CheckParm("-nosavecompress"))
+    {
+        compressed = Z_Malloc(M_CompressBound(length), PU_STATIC, NULL);
+        stored_length = M_Compress(body, length, compressed);
+
+        if (stored_length < length)
+        {
+            flags |= SAVEGAME_COMPRESSED;
+            stored = compressed;
+        }
+        else
+        {
+            stored_length = length;
+        }
+    }
+
+    save_stream = file_stream;
+    file_stream = NULL;
+
+    saveg_write8(flags);
+    saveg_write8(0);
+    saveg_write8(0);
+    saveg_write8(0);
+    saveg_write32(length);
+    saveg_write32(stored_length);
+
+    mem_fwrite(stored, 1, stored_length, save_stream);
+
+    if (compressed != NULL)
+    {
+        Z_Free(compressed);
+    }
+
+    mem_fclose(body_stream);
+}
+
+//
+// The game section: what Vanilla has in the header.
+//
+
+static void saveg_write_game(void)
+{
+    long start;
+    int i;
+
+    start = saveg_begin_section(sec_game);
+
+    saveg_write8(gameskill);
+    saveg_write8(gameepisode);
+    saveg_write8(gamemap);
+
+    for (i=0 ; i<MAXPLAYERS ; i++) 
+        saveg_write8(playeringame[i]);
+
+    saveg_write32(leveltime);
+
+    saveg_end_section(start, 1);
+}
+
+static boolean saveg_read_game(void)
+{
+    savesection_t *section;
+    int i;
+
+    section = saveg_find_section(sec_game);
+
+    if (section == NULL || !saveg_seek_record(section, 0))
+    {
+        return false;
+    }
+
+    gameskill = saveg_read8();
+    gameepisode = saveg_read8();
+    gamemap = saveg_read8();
+
+    for (i=0 ; i<MAXPLAYERS ; i++) 
+        playeringame[i] = saveg_read8();
+
+    leveltime = saveg_read32();
+
+    return saveg_record_fits(section, 0);
+}
+
 //
 // Write the header for a savegame
 //
@@ -1348,6 +1721,15 @@ void P_WriteSaveGameHeader(char *description)
 {
     char name[VERSIONSIZE]; 
     int i; 
+
+    //!
+    // @category compat
+    //
+    // Write savegames in the format of Vanilla Doom, which it can
+    // load, rather than in the doomgeneric format.
+    //
+
+    savegame_vanilla = M_CheckParm("-vanillasave") > 0;
 	
     for (i=0; description[i] != '\0'; ++i)
         saveg_write8(description[i]);
@@ -1355,10 +1737,28 @@ void P_WriteSaveGameHeader(char *description)
         saveg_write8(0);
 
     memset(name, 0, sizeof(name));
-    M_snprintf(name, sizeof(name), "version %i", G_VanillaVersionCode());
+
+    if (savegame_vanilla)
+    {
+        M_snprintf(name, sizeof(name), "version %i", G_VanillaVersionCode());
+    }
+    else
+    {
+        M_StringCopy(name, SAVEGAME_VERSION, sizeof(name));
+    }
 
     for (i=0; i<VERSIONSIZE; ++i)
         saveg_write8(name[i]);
+
+    if (!savegame_vanilla)
+    {
+        // The rest goes in the body.
+
+        file_stream = save_stream;
+        save_stream = mem_fopen_write();
+        saveg_write_game();
+        return;
+    }
 	 
     saveg_write8(gameskill);
     saveg_write8(gameepisode);
@@ -1391,6 +1791,26 @@ boolean P_ReadSaveGameHeader(void)
     for (i=0; i<VERSIONSIZE; ++i)
         read_vcheck[i] = saveg_read8();
 
+    if (strncmp(read_vcheck, SAVEGAME_VERSION, VERSIONSIZE) == 0)
+    {
+        savegame_vanilla = false;
+
+        if (!saveg_open_body())
+        {
+            return false;
+        }
+
+        if (!saveg_read_game())
+        {
+            saveg_close_body();
+            return false;
+        }
+
+        return true;
+    }
+
+    savegame_vanilla = true;
+
     memset(vcheck, 0, sizeof(vcheck));
     M_snprintf(vcheck, sizeof(vcheck), "version %i", G_VanillaVersionCode());
     if (strcmp(read_vcheck, vcheck) != 0)
@@ -1614,17 +2034,14 @@ void P_ArchiveThinkers (void)
 
 
 
-//
-// P_UnArchiveThinkers
-//
-void P_UnArchiveThinkers (void)
+// Remove the thinkers of the level that has just been set up, to make
+// way for the saved ones.
+
+static void saveg_remove_thinkers(void)
 {
-    byte		tclass;
     thinker_t*		currentthinker;
     thinker_t*		next;
-    mobj_t*		mobj;
-    
-    // remove all the current thinkers
+
     currentthinker = thinkercap.next;
     while (currentthinker != &thinkercap)
     {
@@ -1633,11 +2050,39 @@ void P_UnArchiveThinkers (void)
 	if (currentthinker->function.acp1 == (actionf_p1)P_MobjThinker)
 	    P_RemoveMobj ((mobj_t *)currentthinker);
 	else
-	    Z_Free (currentthinker);
+	    P_FreeThinker (currentthinker);
 
 	currentthinker = next;
     }
     P_InitThinkers ();
+}
+
+static void saveg_unarchive_mobj(void)
+{
+    mobj_t*		mobj;
+
+    mobj = P_AllocThinker (tp_mobj);
+    saveg_read_mobj_t(mobj);
+
+    mobj->target = NULL;
+    mobj->tracer = NULL;
+    P_SetThingPosition (mobj);
+    mobj->info = &mobjinfo[mobj->type];
+    mobj->floorz = mobj->subsector->sector->floorheight;
+    mobj->ceilingz = mobj->subsector->sector->ceilingheight;
+    mobj->thinker.function.acp1 = (actionf_p1)P_MobjThinker;
+    P_AddThinker (&mobj->thinker);
+}
+
+//
+// P_UnArchiveThinkers
+//
+void P_UnArchiveThinkers (void)
+{
+    byte		tclass;
+    
+    // remove all the current thinkers
+    saveg_remove_thinkers();
     
     // read in saved thinkers
     while (1)
@@ -1650,17 +2095,7 @@ void P_UnArchiveThinkers (void)
 			
 	  case tc_mobj:
 	    saveg_read_pad();
-	    mobj = Z_Malloc (sizeof(*mobj), PU_LEVEL, NULL);
-            saveg_read_mobj_t(mobj);
-
-	    mobj->target = NULL;
-            mobj->tracer = NULL;
-	    P_SetThingPosition (mobj);
-	    mobj->info = &mobjinfo[mobj->type];
-	    mobj->floorz = mobj->subsector->sector->floorheight;
-	    mobj->ceilingz = mobj->subsector->sector->ceilingheight;
-	    mobj->thinker.function.acp1 = (actionf_p1)P_MobjThinker;
-	    P_AddThinker (&mobj->thinker);
+	    saveg_unarchive_mobj();
 	    break;
 
 	  default:
@@ -1701,84 +2136,164 @@ enum
 // T_Glow, (glow_t: sector_t *),
 // T_PlatRaise, (plat_t: sector_t *), - active list
 //
+// Returns the class of a thinker, or -1 if it is not saved.
+//
+static int saveg_special_class(thinker_t *th)
+{
+    int			i;
+
+    if (th->function.acv == (actionf_v)NULL)
+    {
+	for (i = 0; i < MAXCEILINGS;i++)
+	    if (activeceilings[i] == (ceiling_t *)th)
+		return tc_ceiling;
+
+	return -1;
+    }
+
+    if (th->function.acp1 == (actionf_p1)T_MoveCeiling)
+	return tc_ceiling;
+    if (th->function.acp1 == (actionf_p1)T_VerticalDoor)
+	return tc_door;
+    if (th->function.acp1 == (actionf_p1)T_MoveFloor)
+	return tc_floor;
+    if (th->function.acp1 == (actionf_p1)T_PlatRaise)
+	return tc_plat;
+    if (th->function.acp1 == (actionf_p1)T_LightFlash)
+	return tc_flash;
+    if (th->function.acp1 == (actionf_p1)T_StrobeFlash)
+	return tc_strobe;
+    if (th->function.acp1 == (actionf_p1)T_Glow)
+	return tc_glow;
+
+    return -1;
+}
+
+static void saveg_archive_special(thinker_t *th, int tclass)
+{
+    switch (tclass)
+    {
+      case tc_ceiling:
+	saveg_write_ceiling_t((ceiling_t *) th);
+	break;
+
+      case tc_door:
+	saveg_write_vldoor_t((vldoor_t *) th);
+	break;
+
+      case tc_floor:
+	saveg_write_floormove_t((floormove_t *) th);
+	break;
+
+      case tc_plat:
+	saveg_write_plat_t((plat_t *) th);
+	break;
+
+      case tc_flash:
+	saveg_write_lightflash_t((lightflash_t *) th);
+	break;
+
+      case tc_strobe:
+	saveg_write_strobe_t((strobe_t *) th);
+	break;
+
+      case tc_glow:
+	saveg_write_glow_t((glow_t *) th);
+	break;
+    }
+}
+
+static void saveg_unarchive_special(int tclass)
+{
+    ceiling_t*		ceiling;
+    vldoor_t*		door;
+    floormove_t*	floor;
+    plat_t*		plat;
+    lightflash_t*	flash;
+    strobe_t*		strobe;
+    glow_t*		glow;
+
+    switch (tclass)
+    {
+      case tc_ceiling:
+	ceiling = P_AllocThinker (tp_ceiling);
+	saveg_read_ceiling_t(ceiling);
+	ceiling->sector->specialdata = ceiling;
+
+	if (ceiling->thinker.function.acp1)
+	    ceiling->thinker.function.acp1 = (actionf_p1)T_MoveCeiling;
+
+	P_AddThinker (&ceiling->thinker);
+	P_AddActiveCeiling(ceiling);
+	break;
+				
+      case tc_door:
+	door = P_AllocThinker (tp_door);
+	saveg_read_vldoor_t(door);
+	door->sector->specialdata = door;
+	door->thinker.function.acp1 = (actionf_p1)T_VerticalDoor;
+	P_AddThinker (&door->thinker);
+	break;
+				
+      case tc_floor:
+	floor = P_AllocThinker (tp_floor);
+	saveg_read_floormove_t(floor);
+	floor->sector->specialdata = floor;
+	floor->thinker.function.acp1 = (actionf_p1)T_MoveFloor;
+	P_AddThinker (&floor->thinker);
+	break;
+				
+      case tc_plat:
+	plat = P_AllocThinker (tp_plat);
+	saveg_read_plat_t(plat);
+	plat->sector->specialdata = plat;
+
+	if (plat->thinker.function.acp1)
+	    plat->thinker.function.acp1 = (actionf_p1)T_PlatRaise;
+
+	P_AddThinker (&plat->thinker);
+	P_AddActivePlat(plat);
+	break;
+				
+      case tc_flash:
+	flash = P_AllocThinker (tp_lightflash);
+	saveg_read_lightflash_t(flash);
+	flash->thinker.function.acp1 = (actionf_p1)T_LightFlash;
+	P_AddThinker (&flash->thinker);
+	break;
+				
+      case tc_strobe:
+	strobe = P_AllocThinker (tp_strobe);
+	saveg_read_strobe_t(strobe);
+	strobe->thinker.function.acp1 = (actionf_p1)T_StrobeFlash;
+	P_AddThinker (&strobe->thinker);
+	break;
+				
+      case tc_glow:
+	glow = P_AllocThinker (tp_glow);
+	saveg_read_glow_t(glow);
+	glow->thinker.function.acp1 = (actionf_p1)T_Glow;
+	P_AddThinker (&glow->thinker);
+	break;
+    }
+}
+
 void P_ArchiveSpecials (void)
 {
     thinker_t*		th;
-    int			i;
+    int			tclass;
 	
     // save off the current thinkers
     for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
     {
-	if (th->function.acv == (actionf_v)NULL)
-	{
-	    for (i = 0; i < MAXCEILINGS;i++)
-		if (activeceilings[i] == (ceiling_t *)th)
-		    break;
-	    
-	    if (i<MAXCEILINGS)
-	    {
-                saveg_write8(tc_ceiling);
-		saveg_write_pad();
-                saveg_write_ceiling_t((ceiling_t *) th);
-	    }
-	    continue;
-	}
-			
-	if (th->function.acp1 == (actionf_p1)T_MoveCeiling)
-	{
-            saveg_write8(tc_ceiling);
-	    saveg_write_pad();
-            saveg_write_ceiling_t((ceiling_t *) th);
-	    continue;
-	}
-			
-	if (th->function.acp1 == (actionf_p1)T_VerticalDoor)
-	{
-            saveg_write8(tc_door);
-	    saveg_write_pad();
-            saveg_write_vldoor_t((vldoor_t *) th);
-	    continue;
-	}
-			
-	if (th->function.acp1 == (actionf_p1)T_MoveFloor)
-	{
-            saveg_write8(tc_floor);
-	    saveg_write_pad();
-            saveg_write_floormove_t((floormove_t *) th);
-	    continue;
-	}
-			
-	if (th->function.acp1 == (actionf_p1)T_PlatRaise)
-	{
-            saveg_write8(tc_plat);
-	    saveg_write_pad();
-            saveg_write_plat_t((plat_t *) th);
-	    continue;
-	}
-			
-	if (th->function.acp1 == (actionf_p1)T_LightFlash)
-	{
-            saveg_write8(tc_flash);
-	    saveg_write_pad();
-            saveg_write_lightflash_t((lightflash_t *) th);
-	    continue;
-	}
-			
-	if (th->function.acp1 == (actionf_p1)T_StrobeFlash)
-	{
-            saveg_write8(tc_strobe);
-	    saveg_write_pad();
-            saveg_write_strobe_t((strobe_t *) th);
-	    continue;
-	}
-			
-	if (th->function.acp1 == (actionf_p1)T_Glow)
-	{
-            saveg_write8(tc_glow);
-	    saveg_write_pad();
-            saveg_write_glow_t((glow_t *) th);
+	tclass = saveg_special_class(th);
+
+	if (tclass < 0)
 	    continue;
-	}
+
+	saveg_write8(tclass);
+	saveg_write_pad();
+	saveg_archive_special(th, tclass);
     }
 	
     // add a terminating marker
@@ -1793,99 +2308,370 @@ void P_ArchiveSpecials (void)
 void P_UnArchiveSpecials (void)
 {
     byte		tclass;
-    ceiling_t*		ceiling;
-    vldoor_t*		door;
-    floormove_t*	floor;
-    plat_t*		plat;
-    lightflash_t*	flash;
-    strobe_t*		strobe;
-    glow_t*		glow;
-	
 	
     // read in saved thinkers
     while (1)
     {
 	tclass = saveg_read8();
 
-	switch (tclass)
-	{
-	  case tc_endspecials:
+	if (tclass == tc_endspecials)
 	    return;	// end of list
-			
-	  case tc_ceiling:
-	    saveg_read_pad();
-	    ceiling = Z_Malloc (sizeof(*ceiling), PU_LEVEL, NULL);
-            saveg_read_ceiling_t(ceiling);
-	    ceiling->sector->specialdata = ceiling;
 
-	    if (ceiling->thinker.function.acp1)
-		ceiling->thinker.function.acp1 = (actionf_p1)T_MoveCeiling;
+	if (tclass > tc_endspecials)
+	    I_Error ("P_UnarchiveSpecials:Unknown tclass %i "
+		     "in savegame",tclass);
 
-	    P_AddThinker (&ceiling->thinker);
-	    P_AddActiveCeiling(ceiling);
-	    break;
-				
-	  case tc_door:
-	    saveg_read_pad();
-	    door = Z_Malloc (sizeof(*door), PU_LEVEL, NULL);
-            saveg_read_vldoor_t(door);
-	    door->sector->specialdata = door;
-	    door->thinker.function.acp1 = (actionf_p1)T_VerticalDoor;
-	    P_AddThinker (&door->thinker);
-	    break;
-				
-	  case tc_floor:
-	    saveg_read_pad();
-	    floor = Z_Malloc (sizeof(*floor), PU_LEVEL, NULL);
-            saveg_read_floormove_t(floor);
-	    floor->sector->specialdata = floor;
-	    floor->thinker.function.acp1 = (actionf_p1)T_MoveFloor;
-	    P_AddThinker (&floor->thinker);
-	    break;
-				
-	  case tc_plat:
-	    saveg_read_pad();
-	    plat = Z_Malloc (sizeof(*plat), PU_LEVEL, NULL);
-            saveg_read_plat_t(plat);
-	    plat->sector->specialdata = plat;
+	saveg_read_pad();
+	saveg_unarchive_special(tclass);
+    }
 
-	    if (plat->thinker.function.acp1)
-		plat->thinker.function.acp1 = (actionf_p1)T_PlatRaise;
+}
 
-	    P_AddThinker (&plat->thinker);
-	    P_AddActivePlat(plat);
-	    break;
-				
-	  case tc_flash:
-	    saveg_read_pad();
-	    flash = Z_Malloc (sizeof(*flash), PU_LEVEL, NULL);
-            saveg_read_lightflash_t(flash);
-	    flash->thinker.function.acp1 = (actionf_p1)T_LightFlash;
-	    P_AddThinker (&flash->thinker);
-	    break;
-				
-	  case tc_strobe:
-	    saveg_read_pad();
-	    strobe = Z_Malloc (sizeof(*strobe), PU_LEVEL, NULL);
-            saveg_read_strobe_t(strobe);
-	    strobe->thinker.function.acp1 = (actionf_p1)T_StrobeFlash;
-	    P_AddThinker (&strobe->thinker);
-	    break;
-				
-	  case tc_glow:
-	    saveg_read_pad();
-	    glow = Z_Malloc (sizeof(*glow), PU_LEVEL, NULL);
-            saveg_read_glow_t(glow);
-	    glow->thinker.function.acp1 = (actionf_p1)T_Glow;
-	    P_AddThinker (&glow->thinker);
-	    break;
-				
-	  default:
-	    I_Error ("P_UnarchiveSpecials:Unknown tclass %i "
-		     "in savegame",tclass);
+
+//
+// The sections of the doomgeneric format
+//
+
+static const int specialsections[tc_endspecials] =
+{
+    sec_ceilings,
+    sec_doors,
+    sec_floors,
+    sec_plats,
+    sec_flashes,
+    sec_strobes,
+    sec_glows,
+};
+
+static void saveg_write_players(void)
+{
+    long start;
+    int count;
+    int i;
+
+    start = saveg_begin_section(sec_players);
+    count = 0;
+
+    for (i=0 ; i<MAXPLAYERS ; i++)
+    {
+	if (playeringame[i])
+	{
+	    saveg_write_player_t(&players[i]);
+	    ++count;
 	}
-	
     }
 
+    saveg_end_section(start, count);
+}
+
+static boolean saveg_read_players(void)
+{
+    savesection_t *section;
+    int count;
+    int i;
+
+    section = saveg_find_section(sec_players);
+
+    if (section == NULL)
+    {
+	return false;
+    }
+
+    count = 0;
+
+    for (i=0 ; i<MAXPLAYERS ; i++)
+    {
+	if (!playeringame[i])
+	    continue;
+
+	if (!saveg_seek_record(section, count))
+	    return false;
+
+	saveg_read_player_t(&players[i]);
+
+	// will be set when the mobjs are read
+	players[i].mo = NULL;
+	players[i].message = NULL;
+	players[i].attacker = NULL;
+
+	if (!saveg_record_fits(section, count))
+	    return false;
+
+	++count;
+    }
+
+    return count == section->count;
+}
+
+// Unlike in Vanilla, heights and texture offsets are saved whole.
+
+static void saveg_write_world(void)
+{
+    long		start;
+    int			i;
+    sector_t*		sec;
+    line_t*		li;
+    side_t*		si;
+
+    start = saveg_begin_section(sec_sectors);
+    for (i=0, sec = sectors ; i<numsectors ; i++,sec++)
+    {
+	saveg_write32(sec->floorheight);
+	saveg_write32(sec->ceilingheight);
+	saveg_write16(sec->floorpic);
+	saveg_write16(sec->ceilingpic);
+	saveg_write16(sec->lightlevel);
+	saveg_write16(sec->special);
+	saveg_write16(sec->tag);
+    }
+    saveg_end_section(start, numsectors);
+
+    start = saveg_begin_section(sec_lines);
+    for (i=0, li = lines ; i<numlines ; i++,li++)
+    {
+	saveg_write16(li->flags);
+	saveg_write16(li->special);
+	saveg_write16(li->tag);
+    }
+    saveg_end_section(start, numlines);
+
+    start = saveg_begin_section(sec_sides);
+    for (i=0, si = sides ; i<numsides ; i++,si++)
+    {
+	saveg_write32(si->textureoffset);
+	saveg_write32(si->rowoffset);
+	saveg_write16(si->toptexture);
+	saveg_write16(si->bottomtexture);
+	saveg_write16(si->midtexture);
+    }
+    saveg_end_section(start, numsides);
+}
+
+static boolean saveg_read_world(void)
+{
+    savesection_t*	section;
+    int			i;
+    sector_t*		sec;
+    line_t*		li;
+    side_t*		si;
+
+    section = saveg_find_section(sec_sectors);
+    if (section == NULL || section->count != numsectors)
+	return false;
+
+    for (i=0, sec = sectors ; i<numsectors ; i++,sec++)
+    {
+	if (!saveg_seek_record(section, i))
+	    return false;
+
+	sec->floorheight = saveg_read32();
+	sec->ceilingheight = saveg_read32();
+	sec->floorpic = saveg_read16();
+	sec->ceilingpic = saveg_read16();
+	sec->lightlevel = saveg_read16();
+	sec->special = saveg_read16();
+	sec->tag = saveg_read16();
+	sec->specialdata = 0;
+	sec->soundtarget = 0;
+
+	if (!saveg_record_fits(section, i))
+	    return false;
+    }
+
+    section = saveg_find_section(sec_lines);
+    if (section == NULL || section->count != numlines)
+	return false;
+
+    for (i=0, li = lines ; i<numlines ; i++,li++)
+    {
+	if (!saveg_seek_record(section, i))
+	    return false;
+
+	li->flags = saveg_read16();
+	li->special = saveg_read16();
+	li->tag = saveg_read16();
+
+	if (!saveg_record_fits(section, i))
+	    return false;
+    }
+
+    section = saveg_find_section(sec_sides);
+    if (section == NULL || section->count != numsides)
+	return false;
+
+    for (i=0, si = sides ; i<numsides ; i++,si++)
+    {
+	if (!saveg_seek_record(section, i))
+	    return false;
+
+	si->textureoffset = saveg_read32();
+	si->rowoffset = saveg_read32();
+	si->toptexture = saveg_read16();
+	si->bottomtexture = saveg_read16();
+	si->midtexture = saveg_read16();
+
+	if (!saveg_record_fits(section, i))
+	    return false;
+    }
+
+    return true;
+}
+
+// The mobjs, then the class of each special in the order of the
+// thinker list, then a section of each class.
+
+static void saveg_write_thinkers(void)
+{
+    thinker_t*		th;
+    long		start;
+    int			count;
+    int			tclass;
+
+    start = saveg_begin_section(sec_mobjs);
+    count = 0;
+    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    {
+	if (th->function.acp1 == (actionf_p1)P_MobjThinker)
+	{
+	    saveg_write_mobj_t((mobj_t *) th);
+	    ++count;
+	}
+    }
+    saveg_end_section(start, count);
+
+    start = saveg_begin_section(sec_specials);
+    count = 0;
+    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    {
+	tclass = saveg_special_class(th);
+
+	if (tclass >= 0)
+	{
+	    saveg_write8(tclass);
+	    ++count;
+	}
+    }
+    saveg_end_section(start, count);
+
+    for (tclass = 0; tclass < tc_endspecials; ++tclass)
+    {
+	start = saveg_begin_section(specialsections[tclass]);
+	count = 0;
+	for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+	{
+	    if (saveg_special_class(th) == tclass)
+	    {
+		saveg_archive_special(th, tclass);
+		++count;
+	    }
+	}
+	saveg_end_section(start, count);
+    }
+}
+
+static boolean saveg_read_thinkers(void)
+{
+    savesection_t*	section;
+    savesection_t*	order;
+    savesection_t*	classes[tc_endspecials];
+    int			read[tc_endspecials];
+    int			tclass;
+    int			i;
+
+    section = saveg_find_section(sec_mobjs);
+    order = saveg_find_section(sec_specials);
+
+    if (section == NULL || order == NULL)
+	return false;
+
+    for (tclass = 0; tclass < tc_endspecials; ++tclass)
+    {
+	classes[tclass] = saveg_find_section(specialsections[tclass]);
+	read[tclass] = 0;
+    }
+
+    saveg_remove_thinkers();
+
+    for (i=0; i<section->count; ++i)
+    {
+	if (!saveg_seek_record(section, i))
+	    return false;
+
+	saveg_unarchive_mobj();
+
+	if (!saveg_record_fits(section, i))
+	    return false;
+    }
+
+    for (i=0; i<order->count; ++i)
+    {
+	if (!saveg_seek_record(order, i))
+	    return false;
+
+	tclass = saveg_read8();
+
+	if (savegame_error || tclass >= tc_endspecials
+	 || classes[tclass] == NULL
+	 || !saveg_seek_record(classes[tclass], read[tclass]))
+	    return false;
+
+	saveg_unarchive_special(tclass);
+
+	if (!saveg_record_fits(classes[tclass], read[tclass]))
+	    return false;
+
+	++read[tclass];
+    }
+
+    return true;
+}
+
+//
+// P_WriteSaveGame
+//
+void P_WriteSaveGame (void)
+{
+    if (savegame_vanilla)
+    {
+	P_ArchivePlayers ();
+	P_ArchiveWorld ();
+	P_ArchiveThinkers ();
+	P_ArchiveSpecials ();
+	return;
+    }
+
+    saveg_write_players();
+    saveg_write_world();
+    saveg_write_thinkers();
+    saveg_end_section(saveg_begin_section(sec_end), 0);
+
+    saveg_write_body();
+}
+
+//
+// P_ReadSaveGame
+//
+boolean P_ReadSaveGame (void)
+{
+    boolean result;
+
+    P_FlushSightMemo ();
+
+    if (savegame_vanilla)
+    {
+	P_UnArchivePlayers ();
+	P_UnArchiveWorld ();
+	P_UnArchiveThinkers ();
+	P_UnArchiveSpecials ();
+	return !savegame_error;
+    }
+
+    result = saveg_read_players()
+          && saveg_read_world()
+          && saveg_read_thinkers();
+
+    saveg_close_body();
+
+    return result;
 }
 
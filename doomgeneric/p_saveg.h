@@ -22,6 +22,8 @@
 
 #include <stdio.h>
 
+#include "memio.h"
+
 // maximum size of a savegame description
 
 #define SAVESTRINGSIZE 24
@@ -39,6 +41,12 @@ char *P_SaveGameFile(int slot);
 boolean P_ReadSaveGameHeader(void);
 void P_WriteSaveGameHeader(char *description);
 
+// Everything between the header and the end-of-file marker, in the
+// format the header was read or written in.
+
+boolean P_ReadSaveGame(void);
+void P_WriteSaveGame(void);
+
 // Savegame end-of-file read/write functions
 
 boolean P_ReadSaveGameEOF(void);
@@ -55,8 +63,12 @@ void P_UnArchiveThinkers (void);
 void P_ArchiveSpecials (void);
 void P_UnArchiveSpecials (void);
 
-extern FILE *save_stream;
-extern boolean savegame_error;
+extern THREADLOCAL MEMFILE *save_stream;
+extern THREADLOCAL boolean savegame_error;
+
+// Whether the savegame is in the Vanilla format, which has a size limit
+// and keeps heights and offsets to whole map units.
+extern THREADLOCAL boolean savegame_vanilla;
 
 
 #endif
@@ -20,6 +20,11 @@
 
 
 #include <math.h>
+#include <stdlib.h>
+
+#ifdef DOOMGENERIC_LOAD_THREADS
+#include <pthread.h>
+#endif
 
 #include "z_zone.h"
 
@@ -35,6 +40,7 @@
 
 #include "doomdef.h"
 #include "p_local.h"
+#include "p_tick.h"
 
 #include "s_sound.h"
 
@@ -48,28 +54,31 @@ void	P_SpawnMapThing (mapthing_t*	mthing);
 // MAP related Lookup tables.
 // Store VERTEXES, LINEDEFS, SIDEDEFS, etc.
 //
-int		numvertexes;
-vertex_t*	vertexes;
+THREADLOCAL int		numvertexes;
+THREADLOCAL vertex_t*	vertexes;
+
+THREADLOCAL int		numsegs;
+THREADLOCAL seg_t*		segs;
 
-int		numsegs;
-seg_t*		segs;
+THREADLOCAL int		numsectors;
+THREADLOCAL sector_t*	sectors;
 
-int		numsectors;
-sector_t*	sectors;
+THREADLOCAL int		numsubsectors;
+THREADLOCAL subsector_t*	subsectors;
 
-int		numsubsectors;
-subsector_t*	subsectors;
+THREADLOCAL int		numnodes;
+THREADLOCAL node_t*		nodes;
 
-int		numnodes;
-node_t*		nodes;
+THREADLOCAL int		numlines;
+THREADLOCAL line_t*		lines;
 
-int		numlines;
-line_t*		lines;
+THREADLOCAL int		numsides;
+THREADLOCAL side_t*		sides;
 
-int		numsides;
-side_t*		sides;
+THREADLOCAL int		totallines;
 
-static int      totallines;
+// Line lists of all sectors, built by P_GroupLines.
+THREADLOCAL line_t**	linebuffer;
 
 // BLOCKMAP
 // Created from axis aligned bounding box
@@ -79,16 +88,32 @@ static int      totallines;
 // by spatial subdivision in 2D.
 //
 // Blockmap size.
-int		bmapwidth;
-int		bmapheight;	// size in mapblocks
-short*		blockmap;	// int for larger maps
-// offsets in blockmap are from here
-short*		blockmaplump;		
+THREADLOCAL int		bmapwidth;
+THREADLOCAL int		bmapheight;	// size in mapblocks
+// the BLOCKMAP lump, while the level is being loaded
+static THREADLOCAL short*	blockmaplump;		
+static THREADLOCAL int		blockmapcount;
 // origin of block map
-fixed_t		bmaporgx;
-fixed_t		bmaporgy;
+THREADLOCAL fixed_t		bmaporgx;
+THREADLOCAL fixed_t		bmaporgy;
 // for thing chains
-mobj_t**	blocklinks;		
+THREADLOCAL mobj_t**	blocklinks;		
+
+// The lines in each block, which may be smaller than
+// a mapblock.  Those of block i are the entries from
+// blocklinestart[i] up to blocklinestart[i+1], stored
+// as an array of line numbers and one for each side of
+// their bounding boxes.
+THREADLOCAL int		lbmapwidth;
+THREADLOCAL int		lbmapheight;
+THREADLOCAL int		lbmapshift;
+THREADLOCAL int		numlineblocks;
+THREADLOCAL int*		blocklinestart;
+THREADLOCAL int*		blocklinenum;
+THREADLOCAL fixed_t*	blocklinebox[4];
+static THREADLOCAL int		blocklinecount;
+// blocklinebox points in here
+static THREADLOCAL fixed_t*	blocklineboxes;
 
 
 // REJECT
@@ -98,53 +123,90 @@ mobj_t**	blocklinks;
 // Without special effect, this could be
 //  used as a PVS lookup as well.
 //
-byte*		rejectmatrix;
+THREADLOCAL byte*		rejectmatrix;
 
 
 // Maintain single and multi player starting spots.
 #define MAX_DEATHMATCH_STARTS	10
 
-mapthing_t	deathmatchstarts[MAX_DEATHMATCH_STARTS];
-mapthing_t*	deathmatch_p;
-mapthing_t	playerstarts[MAXPLAYERS];
+THREADLOCAL mapthing_t	deathmatchstarts[MAX_DEATHMATCH_STARTS];
+THREADLOCAL mapthing_t*	deathmatch_p;
+THREADLOCAL mapthing_t	playerstarts[MAXPLAYERS];
 
 
 
 
 
+//
+// LEVEL LOADING
+//
+// The map lumps are decoded by jobs that only read the raw lumps and
+// write their own array: a linedef finds its vertexes and sectors in
+// the VERTEXES and SIDEDEFS lumps rather than in the decoded arrays.
+// So the jobs do not depend on each other, and with
+// DOOMGENERIC_LOAD_THREADS and -loadthreads they run in parallel.
+// They see nothing but their levelload_t; whatever needs the WAD
+// directory or the zone stays on the main thread.
+//
+
+typedef struct
+{
+    mapvertex_t*	mapvertexes;
+    mapsector_t*	mapsectors;
+    mapsidedef_t*	mapsides;
+    maplinedef_t*	maplines;
+    mapsubsector_t*	mapsubsectors;
+    mapnode_t*		mapnodes;
+    mapseg_t*		mapsegs;
+
+    int			numvertexes;
+    vertex_t*		vertexes;
+    int			numsectors;
+    sector_t*		sectors;
+    int			numsides;
+    side_t*		sides;
+    int			numlines;
+    line_t*		lines;
+    int			numsubsectors;
+    subsector_t*	subsectors;
+    int			numnodes;
+    node_t*		nodes;
+    int			numsegs;
+    seg_t*		segs;
+    int			blockmapcount;
+    short*		blockmaplump;
+
+    // Back sector of glass hack segs.
+    sector_t*		nullsector;
+} levelload_t;
+
+typedef void (*loadjob_t) (levelload_t *load);
+
+// Sector that a sidedef faces, from the SIDEDEFS lump.
+static sector_t *SideSector (levelload_t *load, int side)
+{
+    return &load->sectors[SHORT(load->mapsides[side].sector)];
+}
+
 //
 // P_LoadVertexes
 //
-void P_LoadVertexes (int lump)
+static void P_LoadVertexes (levelload_t *load)
 {
-    byte*		data;
     int			i;
     mapvertex_t*	ml;
     vertex_t*		li;
 
-    // Determine number of lumps:
-    //  total lump length / vertex record length.
-    numvertexes = W_LumpLength (lump) / sizeof(mapvertex_t);
-
-    // Allocate zone memory for buffer.
-    vertexes = Z_Malloc (numvertexes*sizeof(vertex_t),PU_LEVEL,0);	
-
-    // Load data into cache.
-    data = W_CacheLumpNum (lump, PU_STATIC);
-	
-    ml = (mapvertex_t *)data;
-    li = vertexes;
+    ml = load->mapvertexes;
+    li = load->vertexes;
 
     // Copy and convert vertex coordinates,
     // internal representation as fixed.
-    for (i=0 ; i<numvertexes ; i++, li++, ml++)
+    for (i=0 ; i<load->numvertexes ; i++, li++, ml++)
     {
 	li->x = SHORT(ml->x)<<FRACBITS;
 	li->y = SHORT(ml->y)<<FRACBITS;
     }
-
-    // Free buffer memory.
-    W_ReleaseLumpNum(lump);
 }
 
 //
@@ -152,8 +214,8 @@ void P_LoadVertexes (int lump)
 //
 sector_t* GetSectorAtNullAddress(void)
 {
-    static boolean null_sector_is_initialized = false;
-    static sector_t null_sector;
+    static THREADLOCAL boolean null_sector_is_initialized = false;
+    static THREADLOCAL sector_t null_sector;
 
     if (!null_sector_is_initialized)
     {
@@ -169,41 +231,36 @@ sector_t* GetSectorAtNullAddress(void)
 //
 // P_LoadSegs
 //
-void P_LoadSegs (int lump)
+static void P_LoadSegs (levelload_t *load)
 {
-    byte*		data;
     int			i;
     mapseg_t*		ml;
     seg_t*		li;
-    line_t*		ldef;
+    maplinedef_t*	mld;
     int			linedef;
     int			side;
     int                 sidenum;
 	
-    numsegs = W_LumpLength (lump) / sizeof(mapseg_t);
-    segs = Z_Malloc (numsegs*sizeof(seg_t),PU_LEVEL,0);	
-    memset (segs, 0, numsegs*sizeof(seg_t));
-    data = W_CacheLumpNum (lump,PU_STATIC);
-	
-    ml = (mapseg_t *)data;
-    li = segs;
-    for (i=0 ; i<numsegs ; i++, li++, ml++)
+    ml = load->mapsegs;
+    li = load->segs;
+    for (i=0 ; i<load->numsegs ; i++, li++, ml++)
     {
-	li->v1 = &vertexes[SHORT(ml->v1)];
-	li->v2 = &vertexes[SHORT(ml->v2)];
+	li->v1 = &load->vertexes[SHORT(ml->v1)];
+	li->v2 = &load->vertexes[SHORT(ml->v2)];
 
 	li->angle = (SHORT(ml->angle))<<16;
 	li->offset = (SHORT(ml->offset))<<16;
 	linedef = SHORT(ml->linedef);
-	ldef = &lines[linedef];
-	li->linedef = ldef;
+	mld = &load->maplines[linedef];
+	li->linedef = &load->lines[linedef];
 	side = SHORT(ml->side);
-	li->sidedef = &sides[ldef->sidenum[side]];
-	li->frontsector = sides[ldef->sidenum[side]].sector;
+	sidenum = SHORT(mld->sidenum[side]);
+	li->sidedef = &load->sides[sidenum];
+	li->frontsector = SideSector(load, sidenum);
 
-        if (ldef-> flags & ML_TWOSIDED)
+        if (SHORT(mld->flags) & ML_TWOSIDED)
         {
-            sidenum = ldef->sidenum[side ^ 1];
+            sidenum = SHORT(mld->sidenum[side ^ 1]);
 
             // If the sidenum is out of range, this may be a "glass hack"
             // impassible window.  Point at side #0 (this may not be
@@ -211,13 +268,13 @@ void P_LoadSegs (int lump)
             // OTTAWAU.WAD, which is the one place I've seen this trick
             // used).
 
-            if (sidenum < 0 || sidenum >= numsides)
+            if (sidenum < 0 || sidenum >= load->numsides)
             {
-                li->backsector = GetSectorAtNullAddress();
+                li->backsector = load->nullsector;
             }
             else
             {
-                li->backsector = sides[sidenum].sector;
+                li->backsector = SideSector(load, sidenum);
             }
         }
         else
@@ -225,61 +282,48 @@ void P_LoadSegs (int lump)
 	    li->backsector = 0;
         }
     }
-	
-    W_ReleaseLumpNum(lump);
 }
 
 
 //
 // P_LoadSubsectors
 //
-void P_LoadSubsectors (int lump)
+static void P_LoadSubsectors (levelload_t *load)
 {
-    byte*		data;
     int			i;
     mapsubsector_t*	ms;
     subsector_t*	ss;
 	
-    numsubsectors = W_LumpLength (lump) / sizeof(mapsubsector_t);
-    subsectors = Z_Malloc (numsubsectors*sizeof(subsector_t),PU_LEVEL,0);	
-    data = W_CacheLumpNum (lump,PU_STATIC);
-	
-    ms = (mapsubsector_t *)data;
-    memset (subsectors,0, numsubsectors*sizeof(subsector_t));
-    ss = subsectors;
+    ms = load->mapsubsectors;
+    ss = load->subsectors;
     
-    for (i=0 ; i<numsubsectors ; i++, ss++, ms++)
+    for (i=0 ; i<load->numsubsectors ; i++, ss++, ms++)
     {
 	ss->numlines = SHORT(ms->numsegs);
 	ss->firstline = SHORT(ms->firstseg);
     }
-	
-    W_ReleaseLumpNum(lump);
 }
 
 
 
 //
 // P_LoadSectors
+// Runs on the main thread, for R_FlatNumForName.
 //
-void P_LoadSectors (int lump)
+static void P_LoadSectors (levelload_t *load)
 {
-    byte*		data;
     int			i;
     mapsector_t*	ms;
     sector_t*		ss;
 	
-    numsectors = W_LumpLength (lump) / sizeof(mapsector_t);
-    sectors = Z_Malloc (numsectors*sizeof(sector_t),PU_LEVEL,0);	
-    memset (sectors, 0, numsectors*sizeof(sector_t));
-    data = W_CacheLumpNum (lump,PU_STATIC);
-	
-    ms = (mapsector_t *)data;
-    ss = sectors;
-    for (i=0 ; i<numsectors ; i++, ss++, ms++)
+    ms = load->mapsectors;
+    ss = load->sectors;
+    for (i=0 ; i<load->numsectors ; i++, ss++, ms++)
     {
 	ss->floorheight = SHORT(ms->floorheight)<<FRACBITS;
 	ss->ceilingheight = SHORT(ms->ceilingheight)<<FRACBITS;
+	ss->oldfloorheight = ss->floorheight;
+	ss->oldceilingheight = ss->ceilingheight;
 	ss->floorpic = R_FlatNumForName(ms->floorpic);
 	ss->ceilingpic = R_FlatNumForName(ms->ceilingpic);
 	ss->lightlevel = SHORT(ms->lightlevel);
@@ -287,31 +331,24 @@ void P_LoadSectors (int lump)
 	ss->tag = SHORT(ms->tag);
 	ss->thinglist = NULL;
     }
-	
-    W_ReleaseLumpNum(lump);
 }
 
 
 //
 // P_LoadNodes
 //
-void P_LoadNodes (int lump)
+static void P_LoadNodes (levelload_t *load)
 {
-    byte*	data;
     int		i;
     int		j;
     int		k;
     mapnode_t*	mn;
     node_t*	no;
 	
-    numnodes = W_LumpLength (lump) / sizeof(mapnode_t);
-    nodes = Z_Malloc (numnodes*sizeof(node_t),PU_LEVEL,0);	
-    data = W_CacheLumpNum (lump,PU_STATIC);
-	
-    mn = (mapnode_t *)data;
-    no = nodes;
+    mn = load->mapnodes;
+    no = load->nodes;
     
-    for (i=0 ; i<numnodes ; i++, no++, mn++)
+    for (i=0 ; i<load->numnodes ; i++, no++, mn++)
     {
 	no->x = SHORT(mn->x)<<FRACBITS;
 	no->y = SHORT(mn->y)<<FRACBITS;
@@ -324,11 +361,8 @@ void P_LoadNodes (int lump)
 		no->bbox[j][k] = SHORT(mn->bbox[j][k])<<FRACBITS;
 	}
     }
-	
-    W_ReleaseLumpNum(lump);
 }
 
-
 //
 // P_LoadThings
 //
@@ -389,31 +423,32 @@ void P_LoadThings (int lump)
 // P_LoadLineDefs
 // Also counts secret lines for intermissions.
 //
-void P_LoadLineDefs (int lump)
+static void P_LoadLineDefs (levelload_t *load)
 {
-    byte*		data;
     int			i;
     maplinedef_t*	mld;
     line_t*		ld;
-    vertex_t*		v1;
-    vertex_t*		v2;
-	
-    numlines = W_LumpLength (lump) / sizeof(maplinedef_t);
-    lines = Z_Malloc (numlines*sizeof(line_t),PU_LEVEL,0);	
-    memset (lines, 0, numlines*sizeof(line_t));
-    data = W_CacheLumpNum (lump,PU_STATIC);
+    vertex_t		v1;
+    vertex_t		v2;
 	
-    mld = (maplinedef_t *)data;
-    ld = lines;
-    for (i=0 ; i<numlines ; i++, mld++, ld++)
+    mld = load->maplines;
+    ld = load->lines;
+    for (i=0 ; i<load->numlines ; i++, mld++, ld++)
     {
 	ld->flags = SHORT(mld->flags);
 	ld->special = SHORT(mld->special);
 	ld->tag = SHORT(mld->tag);
-	v1 = ld->v1 = &vertexes[SHORT(mld->v1)];
-	v2 = ld->v2 = &vertexes[SHORT(mld->v2)];
-	ld->dx = v2->x - v1->x;
-	ld->dy = v2->y - v1->y;
+	ld->v1 = &load->vertexes[SHORT(mld->v1)];
+	ld->v2 = &load->vertexes[SHORT(mld->v2)];
+
+	// The vertexes may not be decoded yet.
+	v1.x = SHORT(load->mapvertexes[SHORT(mld->v1)].x)<<FRACBITS;
+	v1.y = SHORT(load->mapvertexes[SHORT(mld->v1)].y)<<FRACBITS;
+	v2.x = SHORT(load->mapvertexes[SHORT(mld->v2)].x)<<FRACBITS;
+	v2.y = SHORT(load->mapvertexes[SHORT(mld->v2)].y)<<FRACBITS;
+
+	ld->dx = v2.x - v1.x;
+	ld->dy = v2.y - v1.y;
 	
 	if (!ld->dx)
 	    ld->slopetype = ST_VERTICAL;
@@ -427,114 +462,695 @@ void P_LoadLineDefs (int lump)
 		ld->slopetype = ST_NEGATIVE;
 	}
 		
-	if (v1->x < v2->x)
+	if (v1.x < v2.x)
 	{
-	    ld->bbox[BOXLEFT] = v1->x;
-	    ld->bbox[BOXRIGHT] = v2->x;
+	    ld->bbox[BOXLEFT] = v1.x;
+	    ld->bbox[BOXRIGHT] = v2.x;
 	}
 	else
 	{
-	    ld->bbox[BOXLEFT] = v2->x;
-	    ld->bbox[BOXRIGHT] = v1->x;
+	    ld->bbox[BOXLEFT] = v2.x;
+	    ld->bbox[BOXRIGHT] = v1.x;
 	}
 
-	if (v1->y < v2->y)
+	if (v1.y < v2.y)
 	{
-	    ld->bbox[BOXBOTTOM] = v1->y;
-	    ld->bbox[BOXTOP] = v2->y;
+	    ld->bbox[BOXBOTTOM] = v1.y;
+	    ld->bbox[BOXTOP] = v2.y;
 	}
 	else
 	{
-	    ld->bbox[BOXBOTTOM] = v2->y;
-	    ld->bbox[BOXTOP] = v1->y;
+	    ld->bbox[BOXBOTTOM] = v2.y;
+	    ld->bbox[BOXTOP] = v1.y;
 	}
 
 	ld->sidenum[0] = SHORT(mld->sidenum[0]);
 	ld->sidenum[1] = SHORT(mld->sidenum[1]);
 
 	if (ld->sidenum[0] != -1)
-	    ld->frontsector = sides[ld->sidenum[0]].sector;
+	    ld->frontsector = SideSector(load, ld->sidenum[0]);
 	else
 	    ld->frontsector = 0;
 
 	if (ld->sidenum[1] != -1)
-	    ld->backsector = sides[ld->sidenum[1]].sector;
+	    ld->backsector = SideSector(load, ld->sidenum[1]);
 	else
 	    ld->backsector = 0;
     }
-
-    W_ReleaseLumpNum(lump);
 }
 
 
 //
 // P_LoadSideDefs
+// Runs on the main thread, for R_TextureNumForName.
 //
-void P_LoadSideDefs (int lump)
+static void P_LoadSideDefs (levelload_t *load)
 {
-    byte*		data;
     int			i;
     mapsidedef_t*	msd;
     side_t*		sd;
 	
-    numsides = W_LumpLength (lump) / sizeof(mapsidedef_t);
-    sides = Z_Malloc (numsides*sizeof(side_t),PU_LEVEL,0);	
-    memset (sides, 0, numsides*sizeof(side_t));
-    data = W_CacheLumpNum (lump,PU_STATIC);
-	
-    msd = (mapsidedef_t *)data;
-    sd = sides;
-    for (i=0 ; i<numsides ; i++, msd++, sd++)
+    msd = load->mapsides;
+    sd = load->sides;
+    for (i=0 ; i<load->numsides ; i++, msd++, sd++)
     {
 	sd->textureoffset = SHORT(msd->textureoffset)<<FRACBITS;
 	sd->rowoffset = SHORT(msd->rowoffset)<<FRACBITS;
 	sd->toptexture = R_TextureNumForName(msd->toptexture);
 	sd->bottomtexture = R_TextureNumForName(msd->bottomtexture);
 	sd->midtexture = R_TextureNumForName(msd->midtexture);
-	sd->sector = &sectors[SHORT(msd->sector)];
+	sd->sector = SideSector(load, i);
     }
-
-    W_ReleaseLumpNum(lump);
 }
 
 
 //
 // P_LoadBlockMap
+// Swaps all short integers to native byte ordering.
 //
-void P_LoadBlockMap (int lump)
+static void P_LoadBlockMap (levelload_t *load)
 {
     int i;
+
+    for (i=0; i<load->blockmapcount; i++)
+    {
+	load->blockmaplump[i] = SHORT(load->blockmaplump[i]);
+    }
+}
+
+
+//
+// P_SetupBlockMap
+// Clears out the mobj chains.
+//
+static void P_SetupBlockMap (void)
+{
     int count;
+
+    count = sizeof(*blocklinks) * bmapwidth * bmapheight;
+    blocklinks = Z_Malloc(count, PU_LEVEL, 0);
+    memset(blocklinks, 0, count);
+}
+
+
+// Biggest first, so that the threads finish together.
+
+static loadjob_t loadjobs[] =
+{
+    P_LoadSegs,
+    P_LoadLineDefs,
+    P_LoadNodes,
+    P_LoadVertexes,
+    P_LoadSubsectors,
+    P_LoadBlockMap,
+};
+
+#define NUMLOADJOBS ((int) (sizeof(loadjobs) / sizeof(*loadjobs)))
+
+#ifdef DOOMGENERIC_LOAD_THREADS
+
+typedef struct
+{
+    pthread_mutex_t	lock;
+    pthread_cond_t	start;
+    pthread_cond_t	done;
+
+    // Bumped to start the threads on a new level.
+    int			batch;
+
+    // Threads still working on the current level.
+    int			busy;
+    int			numthreads;
+
+    int			nextjob;
+    levelload_t*	load;
+} loadpool_t;
+
+static THREADLOCAL loadpool_t *loadpool = NULL;
+
+// Runs jobs until there are none left.
+
+static void P_TakeLoadJobs (loadpool_t *pool)
+{
+    int job;
+
+    for (;;)
+    {
+	pthread_mutex_lock(&pool->lock);
+	job = pool->nextjob++;
+	pthread_mutex_unlock(&pool->lock);
+
+	if (job >= NUMLOADJOBS)
+	    return;
+
+	loadjobs[job] (pool->load);
+    }
+}
+
+static void *P_LoadThread (void *arg)
+{
+    loadpool_t*	pool = arg;
+    int		batch = 0;
+
+    for (;;)
+    {
+	pthread_mutex_lock(&pool->lock);
+
+	while (pool->batch == batch)
+	{
+	    pthread_cond_wait(&pool->start, &pool->lock);
+	}
+
+	batch = pool->batch;
+	pthread_mutex_unlock(&pool->lock);
+
+	P_TakeLoadJobs (pool);
+
+	pthread_mutex_lock(&pool->lock);
+
+	if (--pool->busy == 0)
+	{
+	    pthread_cond_signal(&pool->done);
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+    }
+
+    return NULL;
+}
+
+#endif
+
+
+//
+// P_InitLoadThreads
+//
+static void P_InitLoadThreads (void)
+{
+#ifdef DOOMGENERIC_LOAD_THREADS
+    pthread_t	thread;
+    int		numthreads;
+    int		i;
+    int		p;
+
+    //!
+    // @arg <n>
+    //
+    // Decode the map lumps with n threads besides the main one.
+    //
+
+    p = M_CheckParmWithArgs("-loadthreads", 1);
+
+    if (p <= 0)
+	return;
+
+    numthreads = atoi(myargv[p+1]);
+
+    if (numthreads < 1)
+	return;
+
+    if (numthreads > NUMLOADJOBS)
+	numthreads = NUMLOADJOBS;
+
+    loadpool = calloc(1, sizeof(*loadpool));
+
+    if (loadpool == NULL)
+    {
+	I_Error ("P_InitLoadThreads: out of memory");
+    }
+
+    pthread_mutex_init(&loadpool->lock, NULL);
+    pthread_cond_init(&loadpool->start, NULL);
+    pthread_cond_init(&loadpool->done, NULL);
+    loadpool->numthreads = numthreads;
+
+    for (i=0 ; i<numthreads ; i++)
+    {
+	if (pthread_create(&thread, NULL, P_LoadThread, loadpool) != 0)
+	{
+	    I_Error ("P_InitLoadThreads: failed to start thread");
+	}
+
+	pthread_detach(thread);
+    }
+#endif
+}
+
+
+//
+// P_DecodeLevel
+// Runs the jobs, on the load threads if there are any.  The main
+// thread does the sectors and sidedefs meanwhile, then helps out.
+//
+static void P_DecodeLevel (levelload_t *load)
+{
+    int i;
+
+#ifdef DOOMGENERIC_LOAD_THREADS
+    if (loadpool != NULL)
+    {
+	pthread_mutex_lock(&loadpool->lock);
+	loadpool->load = load;
+	loadpool->nextjob = 0;
+	loadpool->busy = loadpool->numthreads;
+	loadpool->batch++;
+	pthread_cond_broadcast(&loadpool->start);
+	pthread_mutex_unlock(&loadpool->lock);
+
+	P_LoadSectors (load);
+	P_LoadSideDefs (load);
+	P_TakeLoadJobs (loadpool);
+
+	pthread_mutex_lock(&loadpool->lock);
+
+	while (loadpool->busy > 0)
+	{
+	    pthread_cond_wait(&loadpool->done, &loadpool->lock);
+	}
+
+	pthread_mutex_unlock(&loadpool->lock);
+	return;
+    }
+#endif
+
+    P_LoadSectors (load);
+    P_LoadSideDefs (load);
+
+    for (i=0 ; i<NUMLOADJOBS ; i++)
+	loadjobs[i] (load);
+}
+
+
+//
+// P_ReadLevel
+// Caches the map lumps and allocates the arrays they decode into.
+//
+static void P_ReadLevel (int lumpnum, levelload_t *load)
+{
     int lumplen;
 
-    lumplen = W_LumpLength(lump);
-    count = lumplen / 2;
-	
-    blockmaplump = Z_Malloc(lumplen, PU_LEVEL, NULL);
-    W_ReadLump(lump, blockmaplump);
-    blockmap = blockmaplump + 4;
+    numvertexes = W_LumpLength (lumpnum+ML_VERTEXES) / sizeof(mapvertex_t);
+    vertexes = Z_Malloc (numvertexes*sizeof(vertex_t),PU_LEVEL,0);	
+    load->mapvertexes = W_CacheLumpNum (lumpnum+ML_VERTEXES,PU_STATIC);
+
+    numsectors = W_LumpLength (lumpnum+ML_SECTORS) / sizeof(mapsector_t);
+    sectors = Z_Malloc (numsectors*sizeof(sector_t),PU_LEVEL,0);	
+    memset (sectors, 0, numsectors*sizeof(sector_t));
+    load->mapsectors = W_CacheLumpNum (lumpnum+ML_SECTORS,PU_STATIC);
+
+    numsides = W_LumpLength (lumpnum+ML_SIDEDEFS) / sizeof(mapsidedef_t);
+    sides = Z_Malloc (numsides*sizeof(side_t),PU_LEVEL,0);	
+    memset (sides, 0, numsides*sizeof(side_t));
+    load->mapsides = W_CacheLumpNum (lumpnum+ML_SIDEDEFS,PU_STATIC);
+
+    numlines = W_LumpLength (lumpnum+ML_LINEDEFS) / sizeof(maplinedef_t);
+    lines = Z_Malloc (numlines*sizeof(line_t),PU_LEVEL,0);	
+    memset (lines, 0, numlines*sizeof(line_t));
+    load->maplines = W_CacheLumpNum (lumpnum+ML_LINEDEFS,PU_STATIC);
+
+    numsubsectors = W_LumpLength (lumpnum+ML_SSECTORS) / sizeof(mapsubsector_t);
+    subsectors = Z_Malloc (numsubsectors*sizeof(subsector_t),PU_LEVEL,0);	
+    memset (subsectors,0, numsubsectors*sizeof(subsector_t));
+    load->mapsubsectors = W_CacheLumpNum (lumpnum+ML_SSECTORS,PU_STATIC);
 
-    // Swap all short integers to native byte ordering.
-  
-    for (i=0; i<count; i++)
+    numnodes = W_LumpLength (lumpnum+ML_NODES) / sizeof(mapnode_t);
+    nodes = Z_Malloc (numnodes*sizeof(node_t),PU_LEVEL,0);	
+    load->mapnodes = W_CacheLumpNum (lumpnum+ML_NODES,PU_STATIC);
+
+    numsegs = W_LumpLength (lumpnum+ML_SEGS) / sizeof(mapseg_t);
+    segs = Z_Malloc (numsegs*sizeof(seg_t),PU_LEVEL,0);	
+    memset (segs, 0, numsegs*sizeof(seg_t));
+    load->mapsegs = W_CacheLumpNum (lumpnum+ML_SEGS,PU_STATIC);
+
+    lumplen = W_LumpLength(lumpnum+ML_BLOCKMAP);
+    blockmapcount = lumplen / 2;
+    blockmaplump = NULL;
+
+    if (blockmapcount > 0)
     {
-	blockmaplump[i] = SHORT(blockmaplump[i]);
+	blockmaplump = Z_Malloc(lumplen, PU_STATIC, NULL);
+	W_ReadLump(lumpnum+ML_BLOCKMAP, blockmaplump);
     }
-		
-    // Read the header
+
+    load->numvertexes = numvertexes;
+    load->vertexes = vertexes;
+    load->numsectors = numsectors;
+    load->sectors = sectors;
+    load->numsides = numsides;
+    load->sides = sides;
+    load->numlines = numlines;
+    load->lines = lines;
+    load->numsubsectors = numsubsectors;
+    load->subsectors = subsectors;
+    load->numnodes = numnodes;
+    load->nodes = nodes;
+    load->numsegs = numsegs;
+    load->segs = segs;
+    load->blockmapcount = blockmapcount;
+    load->blockmaplump = blockmaplump;
+    load->nullsector = GetSectorAtNullAddress();
+}
+
+static void P_ReleaseLevel (int lumpnum)
+{
+    W_ReleaseLumpNum(lumpnum+ML_VERTEXES);
+    W_ReleaseLumpNum(lumpnum+ML_SECTORS);
+    W_ReleaseLumpNum(lumpnum+ML_SIDEDEFS);
+    W_ReleaseLumpNum(lumpnum+ML_LINEDEFS);
+    W_ReleaseLumpNum(lumpnum+ML_SSECTORS);
+    W_ReleaseLumpNum(lumpnum+ML_NODES);
+    W_ReleaseLumpNum(lumpnum+ML_SEGS);
+}
+
+
+
+//
+// LINE BLOCKS
+// Blocks of lines are read from the BLOCKMAP lump as they
+// are, so that lines are found in the same order as in
+// vanilla.  The lump stores each list as short offsets,
+// which big maps overflow; a map whose lump is missing or
+// broken, or every map with -blockmap, gets its blocks
+// built from the lines instead, in smaller blocks.
+//
+
+#define MINBLOCKSHIFT	(FRACBITS+4)
+#define DEFBLOCKCELL	64
+
+// in blocks
+#define BLOCKEPSILON	(1.0 / 4096)
+
+//
+// P_AllocBlockLines
+// Makes room for count entries in the blocks of the line
+// grid.  blocklinestart is left to the caller to fill in.
+//
+static void P_AllocBlockLines (int count)
+{
+    int	i;
+
+    blocklinecount = count;
+    numlineblocks = lbmapwidth * lbmapheight;
+    blocklinestart = Z_Malloc ((numlineblocks+1) * sizeof(int),
+			     PU_LEVEL, 0);
+    blocklinenum = Z_Malloc (count * sizeof(int), PU_LEVEL, 0);
+    blocklineboxes = Z_Malloc (4 * count * sizeof(fixed_t), PU_LEVEL, 0);
+
+    for (i=0 ; i<4 ; i++)
+	blocklinebox[i] = blocklineboxes + i*count;
+}
+
+static void P_SetBlockLine (int entry, int linenum)
+{
+    int	i;
+
+    blocklinenum[entry] = linenum;
+
+    for (i=0 ; i<4 ; i++)
+	blocklinebox[i][entry] = lines[linenum].bbox[i];
+}
+
+//
+// P_CountBlockMapLump
+// Returns the number of line entries in the BLOCKMAP
+// lump, or -1 if it is not fit to use.  Offsets are read
+// as unsigned, which lets lumps of up to 64K shorts work.
+//
+static int P_CountBlockMapLump (void)
+{
+    int			numblocks;
+    int			count;
+    int			i;
+    unsigned int	offset;
+
+    if (blockmapcount < 4
+     || blockmaplump[2] <= 0
+     || blockmaplump[3] <= 0)
+    {
+	return -1;
+    }
+
+    numblocks = blockmaplump[2] * blockmaplump[3];
+
+    if (blockmapcount < 4 + numblocks)
+	return -1;
+
+    count = 0;
+
+    for (i=0 ; i<numblocks ; i++)
+    {
+	for (offset = (unsigned short) blockmaplump[4+i] ; ; offset++)
+	{
+	    if (offset >= (unsigned int) blockmapcount)
+		return -1;
+
+	    if (blockmaplump[offset] == -1)
+		break;
+
+	    if ((unsigned short) blockmaplump[offset] >= numlines)
+		return -1;
+
+	    count++;
+	}
+    }
+
+    return count;
+}
+
+//
+// P_BlockMapFromLump
+// Copies the blocks of the BLOCKMAP lump, which has count
+// entries, into the line grid.
+//
+static void P_BlockMapFromLump (int count)
+{
+    short*	list;
+    int		numblocks;
+    int		entry;
+    int		i;
 
     bmaporgx = blockmaplump[0]<<FRACBITS;
     bmaporgy = blockmaplump[1]<<FRACBITS;
     bmapwidth = blockmaplump[2];
     bmapheight = blockmaplump[3];
-	
-    // Clear out mobj chains
 
-    count = sizeof(*blocklinks) * bmapwidth * bmapheight;
-    blocklinks = Z_Malloc(count, PU_LEVEL, 0);
-    memset(blocklinks, 0, count);
+    lbmapwidth = bmapwidth;
+    lbmapheight = bmapheight;
+    lbmapshift = MAPBLOCKSHIFT;
+
+    P_AllocBlockLines (count);
+
+    numblocks = lbmapwidth * lbmapheight;
+    entry = 0;
+
+    for (i=0 ; i<numblocks ; i++)
+    {
+	blocklinestart[i] = entry;
+
+	for (list = blockmaplump + (unsigned short) blockmaplump[4+i] ;
+	     *list != -1 ;
+	     list++)
+	{
+	    P_SetBlockLine (entry++, (unsigned short) *list);
+	}
+    }
+
+    blocklinestart[numblocks] = entry;
+}
+
+//
+// P_AddLineBlocks
+// Goes through the blocks that a line passes through,
+// a row at a time, counting it in cursor or, if fill,
+// storing it at the entries cursor points to.  A line
+// that is on or near the edge of a block, within round
+// off, goes in the blocks on both sides.
+//
+static void P_AddLineBlocks (int linenum, int* cursor, boolean fill)
+{
+    line_t*	ld;
+    double	size;
+    double	x1, y1, x2, y2;
+    double	xa, xb, t;
+    int		row, lastrow;
+    int		bx, lastbx;
+
+    ld = &lines[linenum];
+    size = (double) (1 << lbmapshift);
+
+    x1 = (ld->v1->x - bmaporgx) / size;
+    y1 = (ld->v1->y - bmaporgy) / size;
+    x2 = (ld->v2->x - bmaporgx) / size;
+    y2 = (ld->v2->y - bmaporgy) / size;
+
+    if (y1 > y2)
+    {
+	t = x1; x1 = x2; x2 = t;
+	t = y1; y1 = y2; y2 = t;
+    }
+
+    row = (int) floor (y1 - BLOCKEPSILON);
+    lastrow = (int) floor (y2 + BLOCKEPSILON);
+
+    if (row < 0)
+	row = 0;
+
+    if (lastrow >= lbmapheight)
+	lastrow = lbmapheight - 1;
+
+    for ( ; row <= lastrow ; row++)
+    {
+	if (y1 == y2)
+	{
+	    xa = x1;
+	    xb = x2;
+	}
+	else
+	{
+	    t = row > y1 ? row : y1;
+	    xa = x1 + (x2 - x1) * (t - y1) / (y2 - y1);
+	    t = row + 1 < y2 ? row + 1 : y2;
+	    xb = x1 + (x2 - x1) * (t - y1) / (y2 - y1);
+	}
+
+	if (xa > xb)
+	{
+	    t = xa; xa = xb; xb = t;
+	}
+
+	bx = (int) floor (xa - BLOCKEPSILON);
+	lastbx = (int) floor (xb + BLOCKEPSILON);
+
+	if (bx < 0)
+	    bx = 0;
+
+	if (lastbx >= lbmapwidth)
+	    lastbx = lbmapwidth - 1;
+
+	for ( ; bx <= lastbx ; bx++)
+	{
+	    if (fill)
+		P_SetBlockLine (cursor[row*lbmapwidth+bx]++, linenum);
+	    else
+		cursor[row*lbmapwidth+bx]++;
+	}
+    }
 }
 
+//
+// P_BuildBlockMap
+// Works out the blocks from the lines, in blocks of
+// 1<<shift.  Mapblocks start at the bottom left corner
+// of the map as well.
+//
+static void P_BuildBlockMap (int shift)
+{
+    fixed_t	bbox[4];
+    int*	cursor;
+    int		numblocks;
+    int		count;
+    int		i;
+
+    M_ClearBox (bbox);
+
+    for (i=0 ; i<numvertexes ; i++)
+	M_AddToBox (bbox, vertexes[i].x, vertexes[i].y);
+
+    bmaporgx = bbox[BOXLEFT] & ~(FRACUNIT-1);
+    bmaporgy = bbox[BOXBOTTOM] & ~(FRACUNIT-1);
+    bmapwidth = ((bbox[BOXRIGHT] - bmaporgx) >> MAPBLOCKSHIFT) + 1;
+    bmapheight = ((bbox[BOXTOP] - bmaporgy) >> MAPBLOCKSHIFT) + 1;
+
+    lbmapshift = shift;
+    lbmapwidth = ((bbox[BOXRIGHT] - bmaporgx) >> shift) + 1;
+    lbmapheight = ((bbox[BOXTOP] - bmaporgy) >> shift) + 1;
+    numblocks = lbmapwidth * lbmapheight;
+
+    // Count the lines in each block, then lay the
+    // blocks out one after another and fill them in.
+    cursor = Z_Malloc ((numblocks+1) * sizeof(int), PU_STATIC, 0);
+    memset (cursor, 0, (numblocks+1) * sizeof(int));
+
+    for (i=0 ; i<numlines ; i++)
+	P_AddLineBlocks (i, cursor, false);
+
+    count = 0;
+
+    for (i=0 ; i<numblocks ; i++)
+    {
+	count += cursor[i];
+	cursor[i] = count - cursor[i];
+    }
+
+    cursor[numblocks] = count;
+
+    P_AllocBlockLines (count);
+    memcpy (blocklinestart, cursor, (numblocks+1) * sizeof(int));
+
+    for (i=0 ; i<numlines ; i++)
+	P_AddLineBlocks (i, cursor, true);
+
+    Z_Free (cursor);
+}
+
+//
+// P_MakeBlockMap
+// Sets up the line grid from the BLOCKMAP lump, or from
+// the lines, and lets go of the lump.
+//
+static void P_MakeBlockMap (void)
+{
+    int	count;
+    int	units;
+    int	shift;
+    int	p;
+
+    count = P_CountBlockMapLump ();
+
+    //!
+    // @category obscure
+    //
+    // Build the blockmap of each level from its lines, in
+    // blocks smaller than the BLOCKMAP lump has.  Collision
+    // checks look at fewer lines, but demos may go out of
+    // sync.
+    //
+
+    if (count < 0 || M_CheckParm("-blockmap"))
+    {
+	units = DEFBLOCKCELL;
+
+	//!
+	// @arg <n>
+	// @category obscure
+	//
+	// Size of the blocks of a blockmap built from the lines:
+	// 16, 32, 64 or 128 units.  The default is 64.
+	//
+
+	p = M_CheckParmWithArgs("-blockcell", 1);
+
+	if (p)
+	    units = atoi(myargv[p+1]);
+
+	shift = MINBLOCKSHIFT;
+
+	while (shift < MAPBLOCKSHIFT && (1 << (shift-FRACBITS)) < units)
+	    shift++;
+
+	P_BuildBlockMap (shift);
+    }
+    else
+    {
+	P_BlockMapFromLump (count);
+    }
+
+    if (blockmaplump != NULL)
+    {
+	Z_Free (blockmaplump);
+	blockmaplump = NULL;
+    }
+}
 
 
 //
@@ -544,7 +1160,7 @@ void P_LoadBlockMap (int lump)
 //
 void P_GroupLines (void)
 {
-    line_t**		linebuffer;
+    line_t**		lines_p;
     int			i;
     int			j;
     line_t*		li;
@@ -579,13 +1195,14 @@ void P_GroupLines (void)
 
     // build line tables for each sector	
     linebuffer = Z_Malloc (totallines*sizeof(line_t *), PU_LEVEL, 0);
+    lines_p = linebuffer;
 
     for (i=0; i<numsectors; ++i)
     {
         // Assign the line buffer for this sector
 
-        sectors[i].lines = linebuffer;
-        linebuffer += sectors[i].linecount;
+        sectors[i].lines = lines_p;
+        lines_p += sectors[i].linecount;
 
         // Reset linecount to zero so in the next stage we can count
         // lines into the list.
@@ -709,6 +1326,21 @@ static void PadRejectArray(byte *array, unsigned int len)
     }
 }
 
+static boolean RejectsNothing(byte *array, int len)
+{
+    int i;
+
+    for (i=0; i<len; ++i)
+    {
+        if (array[i] != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 static void P_LoadReject(int lumpnum)
 {
     int minlength;
@@ -735,8 +1367,343 @@ static void P_LoadReject(int lumpnum)
 
         PadRejectArray(rejectmatrix + lumplen, minlength - lumplen);
     }
+
+    //!
+    // @category obscure
+    //
+    // Use REJECT lumps as they are.  A lump that rejects nothing is
+    // otherwise replaced by one the engine works out from the lines
+    // of the map, which makes sight checks cheaper.
+    //
+
+    if (!M_CheckParm("-nobuildreject")
+     && RejectsNothing(rejectmatrix, lumplen < minlength ? lumplen : minlength))
+    {
+        // The lump may be shared, so build in a copy.
+
+        if (lumplen >= minlength)
+        {
+            W_ReleaseLumpNum(lumpnum);
+            rejectmatrix = Z_Malloc(minlength, PU_LEVEL, &rejectmatrix);
+            memset(rejectmatrix, 0, minlength);
+        }
+
+        P_BuildReject();
+    }
+}
+
+//
+// LEVEL CACHE
+//
+// A program that drives the game may reset the same map thousands of
+// times, so the built level (everything but the things) is kept after
+// the first load: the arrays back to back in one block, with their
+// pointers moved into it.  P_LoadCachedLevel copies the block into a
+// single PU_LEVEL block and moves the pointers again.  -nolevelcache
+// turns this off.
+//
+
+typedef struct
+{
+    vertex_t*		vertexes;
+    sector_t*		sectors;
+    side_t*		sides;
+    line_t*		lines;
+    subsector_t*	subsectors;
+    node_t*		nodes;
+    seg_t*		segs;
+    line_t**		linebuffer;
+    int*		blocklinestart;
+    int*		blocklinenum;
+    fixed_t*		blocklineboxes;
+    byte*		rejectmatrix;
+} levelarrays_t;
+
+typedef struct levelcache_s
+{
+    struct levelcache_s*	next;
+    int			lumpnum;
+
+    int			numvertexes;
+    int			numsectors;
+    int			numsides;
+    int			numlines;
+    int			numsubsectors;
+    int			numnodes;
+    int			numsegs;
+    int			totallines;
+
+    fixed_t		bmaporgx;
+    fixed_t		bmaporgy;
+    int			bmapwidth;
+    int			bmapheight;
+    int			lbmapwidth;
+    int			lbmapheight;
+    int			lbmapshift;
+    int			blocklinecount;
+
+    levelarrays_t	arrays;
+} levelcache_t;
+
+static THREADLOCAL levelcache_t *levelcache = NULL;
+
+#define REJECTSIZE	((numsectors * numsectors + 7) / 8)
+
+#define LEVELALIGN(n)	(((n) + 7) & ~(size_t) 7)
+
+#define PLACE(field, count)						\
+    arrays->field = base != NULL ? (void *) (base + size) : NULL;	\
+    size += LEVELALIGN((count) * sizeof(*arrays->field));
+
+//
+// P_LayOutLevel
+// Places the arrays of the current level sizes in base, and returns
+// the size of the block.  base may be NULL to get the size only.
+//
+static size_t P_LayOutLevel (levelarrays_t *arrays, byte *base)
+{
+    size_t size = 0;
+
+    PLACE (vertexes, numvertexes);
+    PLACE (sectors, numsectors);
+    PLACE (sides, numsides);
+    PLACE (lines, numlines);
+    PLACE (subsectors, numsubsectors);
+    PLACE (nodes, numnodes);
+    PLACE (segs, numsegs);
+    PLACE (linebuffer, totallines);
+    PLACE (blocklinestart, numlineblocks + 1);
+    PLACE (blocklinenum, blocklinecount);
+    PLACE (blocklineboxes, 4 * blocklinecount);
+    PLACE (rejectmatrix, REJECTSIZE);
+
+    return size;
+}
+
+#define COPY(field, count)						\
+    memcpy (to->field, from->field, (count) * sizeof(*to->field));
+
+static void P_CopyLevel (levelarrays_t *from, levelarrays_t *to)
+{
+    COPY (vertexes, numvertexes);
+    COPY (sectors, numsectors);
+    COPY (sides, numsides);
+    COPY (lines, numlines);
+    COPY (subsectors, numsubsectors);
+    COPY (nodes, numnodes);
+    COPY (segs, numsegs);
+    COPY (linebuffer, totallines);
+    COPY (blocklinestart, numlineblocks + 1);
+    COPY (blocklinenum, blocklinecount);
+    COPY (blocklineboxes, 4 * blocklinecount);
+    COPY (rejectmatrix, REJECTSIZE);
+}
+
+#define RELOCATE(p, field)	((p) = to->field + ((p) - from->field))
+
+// Leaves NULL and the glass hack null sector alone.
+
+static sector_t *RelocateSector (sector_t *sector,
+				 levelarrays_t *from, levelarrays_t *to)
+{
+    if (sector >= from->sectors && sector < from->sectors + numsectors)
+	return to->sectors + (sector - from->sectors);
+
+    return sector;
+}
+
+//
+// P_RelocateLevel
+// Moves the pointers in the arrays of to, which point into the
+// arrays of from, into to.
+//
+static void P_RelocateLevel (levelarrays_t *from, levelarrays_t *to)
+{
+    seg_t*		seg;
+    line_t*		li;
+    int			i;
+
+    for (i=0, seg=to->segs ; i<numsegs ; i++, seg++)
+    {
+	RELOCATE (seg->v1, vertexes);
+	RELOCATE (seg->v2, vertexes);
+	RELOCATE (seg->sidedef, sides);
+	RELOCATE (seg->linedef, lines);
+	seg->frontsector = RelocateSector (seg->frontsector, from, to);
+	seg->backsector = RelocateSector (seg->backsector, from, to);
+    }
+
+    for (i=0, li=to->lines ; i<numlines ; i++, li++)
+    {
+	RELOCATE (li->v1, vertexes);
+	RELOCATE (li->v2, vertexes);
+	li->frontsector = RelocateSector (li->frontsector, from, to);
+	li->backsector = RelocateSector (li->backsector, from, to);
+    }
+
+    for (i=0 ; i<numsides ; i++)
+	RELOCATE (to->sides[i].sector, sectors);
+
+    for (i=0 ; i<numsubsectors ; i++)
+	RELOCATE (to->subsectors[i].sector, sectors);
+
+    for (i=0 ; i<numsectors ; i++)
+	RELOCATE (to->sectors[i].lines, linebuffer);
+
+    for (i=0 ; i<totallines ; i++)
+	RELOCATE (to->linebuffer[i], lines);
 }
 
+//
+// P_CacheLevel
+// Keeps a copy of the level that has just been built.
+//
+static void P_CacheLevel (int lumpnum)
+{
+    levelcache_t*	cache;
+    levelarrays_t	live;
+    levelarrays_t	layout;
+
+    live.vertexes = vertexes;
+    live.sectors = sectors;
+    live.sides = sides;
+    live.lines = lines;
+    live.subsectors = subsectors;
+    live.nodes = nodes;
+    live.segs = segs;
+    live.linebuffer = linebuffer;
+    live.blocklinestart = blocklinestart;
+    live.blocklinenum = blocklinenum;
+    live.blocklineboxes = blocklineboxes;
+    live.rejectmatrix = rejectmatrix;
+
+    cache = malloc(sizeof(*cache) + P_LayOutLevel(&layout, NULL));
+
+    if (cache == NULL)
+	return;
+
+    P_LayOutLevel (&cache->arrays, (byte *) (cache + 1));
+    P_CopyLevel (&live, &cache->arrays);
+    P_RelocateLevel (&live, &cache->arrays);
+
+    cache->lumpnum = lumpnum;
+    cache->numvertexes = numvertexes;
+    cache->numsectors = numsectors;
+    cache->numsides = numsides;
+    cache->numlines = numlines;
+    cache->numsubsectors = numsubsectors;
+    cache->numnodes = numnodes;
+    cache->numsegs = numsegs;
+    cache->totallines = totallines;
+    cache->bmaporgx = bmaporgx;
+    cache->bmaporgy = bmaporgy;
+    cache->bmapwidth = bmapwidth;
+    cache->bmapheight = bmapheight;
+    cache->lbmapwidth = lbmapwidth;
+    cache->lbmapheight = lbmapheight;
+    cache->lbmapshift = lbmapshift;
+    cache->blocklinecount = blocklinecount;
+
+    cache->next = levelcache;
+    levelcache = cache;
+}
+
+//
+// P_LoadCachedLevel
+// Returns false if the level is not in the cache.
+//
+static boolean P_LoadCachedLevel (int lumpnum)
+{
+    levelcache_t*	cache;
+    levelarrays_t	arrays;
+    byte*		block;
+    int			i;
+
+    for (cache = levelcache; cache != NULL; cache = cache->next)
+    {
+	if (cache->lumpnum == lumpnum)
+	    break;
+    }
+
+    if (cache == NULL)
+	return false;
+
+    numvertexes = cache->numvertexes;
+    numsectors = cache->numsectors;
+    numsides = cache->numsides;
+    numlines = cache->numlines;
+    numsubsectors = cache->numsubsectors;
+    numnodes = cache->numnodes;
+    numsegs = cache->numsegs;
+    totallines = cache->totallines;
+    bmaporgx = cache->bmaporgx;
+    bmaporgy = cache->bmaporgy;
+    bmapwidth = cache->bmapwidth;
+    bmapheight = cache->bmapheight;
+    lbmapwidth = cache->lbmapwidth;
+    lbmapheight = cache->lbmapheight;
+    lbmapshift = cache->lbmapshift;
+    numlineblocks = lbmapwidth * lbmapheight;
+    blocklinecount = cache->blocklinecount;
+
+    block = Z_Malloc (P_LayOutLevel(&arrays, NULL), PU_LEVEL, 0);
+    P_LayOutLevel (&arrays, block);
+    P_CopyLevel (&cache->arrays, &arrays);
+    P_RelocateLevel (&cache->arrays, &arrays);
+
+    vertexes = arrays.vertexes;
+    sectors = arrays.sectors;
+    sides = arrays.sides;
+    lines = arrays.lines;
+    subsectors = arrays.subsectors;
+    nodes = arrays.nodes;
+    segs = arrays.segs;
+    linebuffer = arrays.linebuffer;
+    blocklinestart = arrays.blocklinestart;
+    blocklinenum = arrays.blocklinenum;
+    blocklineboxes = arrays.blocklineboxes;
+    rejectmatrix = arrays.rejectmatrix;
+
+    for (i=0 ; i<4 ; i++)
+	blocklinebox[i] = blocklineboxes + i*blocklinecount;
+
+    P_SetupBlockMap ();
+
+    return true;
+}
+
+//
+// P_LoadLevel
+// Builds the level from the map lumps, or from the cache.
+//
+static void P_LoadLevel (int lumpnum)
+{
+    levelload_t	load;
+
+    //!
+    // @category obscure
+    //
+    // Build every level from the WAD, even one that has been loaded
+    // before.
+    //
+
+    if (!M_CheckParm("-nolevelcache") && P_LoadCachedLevel(lumpnum))
+	return;
+
+    P_ReadLevel (lumpnum, &load);
+    P_DecodeLevel (&load);
+    P_ReleaseLevel (lumpnum);
+
+    P_MakeBlockMap ();
+    P_SetupBlockMap ();
+    P_GroupLines ();
+    P_LoadReject (lumpnum+ML_REJECT);
+
+    if (!M_CheckParm("-nolevelcache"))
+	P_CacheLevel (lumpnum);
+}
+
+
 //
 // P_SetupLevel
 //
@@ -767,6 +1734,8 @@ P_SetupLevel
     S_Start ();			
 
     Z_FreeTags (PU_LEVEL, PU_PURGELEVEL-1);
+    P_ClearThinkerPools ();
+    interpolationtic = -1;
 
     // UNUSED W_Profile ();
     P_InitThinkers ();
@@ -793,18 +1762,8 @@ P_SetupLevel
     leveltime = 0;
 	
     // note: most of this ordering is important	
-    P_LoadBlockMap (lumpnum+ML_BLOCKMAP);
-    P_LoadVertexes (lumpnum+ML_VERTEXES);
-    P_LoadSectors (lumpnum+ML_SECTORS);
-    P_LoadSideDefs (lumpnum+ML_SIDEDEFS);
-
-    P_LoadLineDefs (lumpnum+ML_LINEDEFS);
-    P_LoadSubsectors (lumpnum+ML_SSECTORS);
-    P_LoadNodes (lumpnum+ML_NODES);
-    P_LoadSegs (lumpnum+ML_SEGS);
-
-    P_GroupLines ();
-    P_LoadReject (lumpnum+ML_REJECT);
+    P_LoadLevel (lumpnum);
+    P_FlushSightMemo ();
 
     bodyqueslot = 0;
     deathmatch_p = deathmatchstarts;
@@ -849,6 +1808,8 @@ void P_Init (void)
     P_InitSwitchList ();
     P_InitPicAnims ();
     R_InitSprites (sprnames);
+    P_InitThinkerStats ();
+    P_InitLoadThreads ();
 }
 
 
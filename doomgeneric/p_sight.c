@@ -18,10 +18,14 @@
 
 
 
+#include <math.h>
+#include <string.h>
+
 #include "doomdef.h"
 
 #include "i_system.h"
 #include "p_local.h"
+#include "z_zone.h"
 
 // State.
 #include "r_state.h"
@@ -29,15 +33,45 @@
 //
 // P_CheckSight
 //
-fixed_t		sightzstart;		// eye z of looker
-fixed_t		topslope;
-fixed_t		bottomslope;		// slopes to top and bottom of target
+THREADLOCAL fixed_t		sightzstart;		// eye z of looker
+THREADLOCAL fixed_t		topslope;
+THREADLOCAL fixed_t		bottomslope;		// slopes to top and bottom of target
+
+THREADLOCAL divline_t	strace;			// from t1 to t2
+THREADLOCAL fixed_t		t2x;
+THREADLOCAL fixed_t		t2y;
+
+THREADLOCAL int		sightcounts[2];
 
-divline_t	strace;			// from t1 to t2
-fixed_t		t2x;
-fixed_t		t2y;
+//
+// Sight checks that have been traced.  The outcome only depends on
+// where the two things are and how high the sectors are that the trace
+// went past, so it is kept until one of those sectors moves a floor or
+// ceiling: monsters that stand still look at the same target over and
+// over, even while a lift runs elsewhere.  Sectors are told apart by
+// their number modulo SIGHTGROUPS, so a move now and then forgets a
+// check it did not need to.
+//
+#define SIGHTMEMOBITS	10
+#define SIGHTMEMOSIZE	(1 << SIGHTMEMOBITS)
+#define SIGHTGROUPS	64
+#define SIGHTGROUP(sec)	((uint64_t) 1 << (((sec) - sectors) & (SIGHTGROUPS-1)))
 
-int		sightcounts[2];
+typedef struct
+{
+    fixed_t		x1, y1, z1, height1;
+    fixed_t		x2, y2, z2, height2;
+    uint64_t		groups;		// sector groups the trace read
+    unsigned int	stamp;		// sightclock when traced
+    boolean		result;
+} sightmemo_t;
+
+static THREADLOCAL sightmemo_t	sightmemo[SIGHTMEMOSIZE];
+static THREADLOCAL unsigned int	sightclock = 1;
+static THREADLOCAL unsigned int	sightflushed = 1;	// older stamps are stale
+static THREADLOCAL unsigned int	sightmoved[SIGHTGROUPS];	// last move
+static THREADLOCAL uint64_t	sightmovedgroups;	// moved since flushed
+static THREADLOCAL uint64_t	sighttraced;		// read by current trace
 
 
 //
@@ -202,6 +236,7 @@ boolean P_CrossSubsector (int num)
 	// crosses a two sided line
 	front = seg->frontsector;
 	back = seg->backsector;
+	sighttraced |= SIGHTGROUP(front) | SIGHTGROUP(back);
 
 	// no wall to block sight with?
 	if (front->floorheight == back->floorheight
@@ -307,6 +342,10 @@ P_CheckSight
     int		pnum;
     int		bytenum;
     int		bitnum;
+    sightmemo_t*	memo;
+    unsigned int	hash;
+    uint64_t		moved;
+    int			i;
     
     // First check for trivial rejection.
 
@@ -326,6 +365,31 @@ P_CheckSight
 	return false;	
     }
 
+    // Traced before, with everything where it is now?
+    hash = ((unsigned int) t1->x * 0x9e3779b1u
+	    ^ (unsigned int) t1->y * 0x85ebca6bu
+	    ^ (unsigned int) t2->x * 0xc2b2ae35u
+	    ^ (unsigned int) t2->y * 0x27d4eb2fu
+	    ^ (unsigned int) (t1->z ^ t2->z) * 0x165667b1u);
+    memo = &sightmemo[hash >> (32 - SIGHTMEMOBITS)];
+
+    if (memo->stamp >= sightflushed
+	&& memo->x1 == t1->x && memo->y1 == t1->y
+	&& memo->z1 == t1->z && memo->height1 == t1->height
+	&& memo->x2 == t2->x && memo->y2 == t2->y
+	&& memo->z2 == t2->z && memo->height2 == t2->height)
+    {
+	// unless a sector it went past has moved since
+	moved = memo->groups & sightmovedgroups;
+
+	for (i = 0 ; moved ; i++, moved >>= 1)
+	    if ((moved & 1) && sightmoved[i] > memo->stamp)
+		break;
+
+	if (!moved)
+	    return memo->result;
+    }
+
     // An unobstructed LOS is possible.
     // Now look from eyes of t1 to any part of t2.
     sightcounts[1]++;
@@ -343,8 +407,467 @@ P_CheckSight
     strace.dx = t2->x - t1->x;
     strace.dy = t2->y - t1->y;
 
+    memo->x1 = t1->x;
+    memo->y1 = t1->y;
+    memo->z1 = t1->z;
+    memo->height1 = t1->height;
+    memo->x2 = t2->x;
+    memo->y2 = t2->y;
+    memo->z2 = t2->z;
+    memo->height2 = t2->height;
+    memo->stamp = sightclock;
+
     // the head node is the last node output
-    return P_CrossBSPNode (numnodes-1);	
+    sighttraced = 0;
+    memo->result = P_CrossBSPNode (numnodes-1);
+    memo->groups = sighttraced;
+
+    return memo->result;
+}
+
+
+//
+// P_SightStamp
+// Advances the clock that sight checks and moves are stamped with.
+// Everything is forgotten when it wraps around.
+//
+static unsigned int P_SightStamp (void)
+{
+    if (++sightclock == 0)
+    {
+	memset (sightmemo, 0, sizeof(sightmemo));
+	memset (sightmoved, 0, sizeof(sightmoved));
+	sightmovedgroups = 0;
+	sightclock = sightflushed = 1;
+    }
+    return sightclock;
+}
+
+
+//
+// P_FlushSightMemo
+// Forgets the sight checks traced so far, when the level they were
+// traced in has been replaced.
+//
+void P_FlushSightMemo (void)
+{
+    sightflushed = P_SightStamp ();
+    sightmovedgroups = 0;
+}
+
+
+//
+// P_FlushSightSector
+// Forgets the sight checks that went past a sector
+// whose floor or ceiling has moved.
+//
+void P_FlushSightSector (sector_t* sec)
+{
+    int		group;
+
+    group = (sec - sectors) & (SIGHTGROUPS-1);
+    sightmoved[group] = P_SightStamp ();
+    sightmovedgroups |= (uint64_t) 1 << group;
+}
+
+
+
+
+//
+// REJECT BUILDER
+//
+// Many PWADs come with a REJECT lump that rejects nothing, so that
+// every sight check traces through the BSP.  A line of sight between
+// two sectors only crosses two sided lines, whatever the heights are,
+// so P_BuildReject follows the chains of two sided lines out of every
+// sector, cutting each line down to the part that can still be seen
+// through the ones before it, and rejects the sectors it never gets
+// to.  The lines are made a little longer at both ends, for the
+// rounding in P_CrossSubsector.
+//
+
+// Map units added to both ends of a two sided line.
+#define PORTALSLACK	2.0
+
+// How far off a line a point may be and still be on it.
+#define SIGHTEPSILON	(1.0 / FRACUNIT)
+
+// Lines followed from one sector, and from all of them, before it
+// gives up and takes every sector joined to it to be in sight.  Open
+// maps have ways through without end, and little to reject anyway.
+#define MAXPORTALFLOW	20000
+#define MAXREJECTFLOW	4000000
+
+// Bits of a matrix of sectors, laid out as in REJECT.
+#define SIGHTBIT(m, s1, s2) \
+    ((m)[((s1)*numsectors + (s2)) >> 3] & (1 << (((s1)*numsectors + (s2)) & 7)))
+#define SETSIGHTBIT(m, s1, s2) \
+    ((m)[((s1)*numsectors + (s2)) >> 3] |= 1 << (((s1)*numsectors + (s2)) & 7))
+
+typedef struct
+{
+    double	x1, y1;
+    double	x2, y2;
+} sightseg_t;
+
+// A two sided line, as seen from one of its sides: the sector on the
+// other side is on the left of the seg.
+
+typedef struct
+{
+    sightseg_t	seg;
+    int		line;
+    int		sector;		// the one it leads into
+} portal_t;
+
+typedef struct
+{
+    portal_t*	portals;
+    int*	firstportal;	// of each sector, numsectors+1 of them
+    int*	group;		// sectors joined by two sided lines
+    byte*	onpath;		// lines on the way from the source
+    byte*	seen;		// sectors in sight of the source
+    int		unseen;		// sectors of the group not seen yet
+    int		budget;		// lines to follow before giving up
+} rejectbuild_t;
+
+
+// Signed distance of x,y from the line through seg, positive on the
+// left.
+
+static double SegSide (const sightseg_t *seg, double x, double y)
+{
+    double	dx = seg->x2 - seg->x1;
+    double	dy = seg->y2 - seg->y1;
+    double	len = sqrt (dx*dx + dy*dy);
+
+    if (len == 0)
+	return 0;
+
+    return (dx * (y - seg->y1) - dy * (x - seg->x1)) / len;
+}
+
+
+//
+// ClipSeg
+// Cuts off the part of seg on the right of line, or on the left if
+// side is negative.  Returns false if nothing is left.
+//
+static boolean ClipSeg (sightseg_t *seg, const sightseg_t *line, int side)
+{
+    double	d1, d2;
+    double	frac, x, y;
+
+    d1 = side * SegSide (line, seg->x1, seg->y1);
+    d2 = side * SegSide (line, seg->x2, seg->y2);
+
+    // points on the line stay
+    if (d1 >= -SIGHTEPSILON && d2 >= -SIGHTEPSILON)
+	return true;
+
+    if (d1 < -SIGHTEPSILON && d2 < -SIGHTEPSILON)
+	return false;
+
+    frac = d1 / (d1 - d2);
+    x = seg->x1 + frac * (seg->x2 - seg->x1);
+    y = seg->y1 + frac * (seg->y2 - seg->y1);
+
+    if (d1 < 0)
+    {
+	seg->x1 = x;
+	seg->y1 = y;
+    }
+    else
+    {
+	seg->x2 = x;
+	seg->y2 = y;
+    }
+
+    return true;
+}
+
+
+//
+// ClipToView
+// Cuts seg down to what can be seen from src through pass: the lines
+// through an end of src and an end of pass, with the rest of src on
+// one side and the rest of pass on the other, bound it.
+//
+static boolean ClipToView (sightseg_t *seg,
+			   const sightseg_t *src,
+			   const sightseg_t *pass)
+{
+    sightseg_t	line;
+    double	s[2][2] = { { src->x1, src->y1 }, { src->x2, src->y2 } };
+    double	p[2][2] = { { pass->x1, pass->y1 }, { pass->x2, pass->y2 } };
+    double	ds, dp;
+    int		i, j;
+
+    // src and pass on one line see everything
+    if (fabs (SegSide (pass, s[0][0], s[0][1])) < SIGHTEPSILON
+     && fabs (SegSide (pass, s[1][0], s[1][1])) < SIGHTEPSILON)
+	return true;
+
+    for (i = 0; i < 2; i++)
+    {
+	for (j = 0; j < 2; j++)
+	{
+	    line.x1 = s[i][0];
+	    line.y1 = s[i][1];
+	    line.x2 = p[j][0];
+	    line.y2 = p[j][1];
+
+	    if (line.x1 == line.x2 && line.y1 == line.y2)
+		continue;
+
+	    ds = SegSide (&line, s[i^1][0], s[i^1][1]);
+	    dp = SegSide (&line, p[j^1][0], p[j^1][1]);
+
+	    if (ds * dp > 0
+	     || (fabs (ds) < SIGHTEPSILON && fabs (dp) < SIGHTEPSILON))
+		continue;
+
+	    // keep the side pass is on
+	    if (!ClipSeg (seg, &line,
+			  fabs (dp) >= SIGHTEPSILON ? (dp > 0 ? 1 : -1)
+						     : (ds > 0 ? -1 : 1)))
+		return false;
+	}
+    }
+
+    return true;
+}
+
+
+//
+// P_FlowPortal
+// Marks the sector behind pass, and goes on through the two sided
+// lines of that sector that can be seen from src through pass.
+//
+static void P_FlowPortal (rejectbuild_t *build,
+			  const sightseg_t *src,
+			  const portal_t *pass)
+{
+    portal_t*	portal;
+    portal_t	next;
+    sightseg_t	from;
+    int		i;
+
+    if (!build->seen[pass->sector])
+    {
+	build->seen[pass->sector] = 1;
+	build->unseen--;
+    }
+
+    // nothing more to see, or no time to look
+    if (build->unseen == 0 || --build->budget < 0)
+	return;
+
+    build->onpath[pass->line] = 1;
+
+    for (i = build->firstportal[pass->sector];
+	 i < build->firstportal[pass->sector + 1];
+	 i++)
+    {
+	portal = &build->portals[i];
+
+	if (build->onpath[portal->line])
+	    continue;
+
+	// past both src and pass, and in view of src through pass
+	next = *portal;
+
+	if (!ClipSeg (&next.seg, &pass->seg, 1)
+	 || !ClipSeg (&next.seg, src, 1)
+	 || !ClipToView (&next.seg, src, &pass->seg))
+	    continue;
+
+	// the part of src that sees what is left of it
+	from = *src;
+
+	if (!ClipSeg (&from, &next.seg, -1)
+	 || !ClipToView (&from, &next.seg, &pass->seg))
+	    continue;
+
+	P_FlowPortal (build, &from, &next);
+
+	if (build->unseen == 0 || build->budget < 0)
+	    break;
+    }
+
+    build->onpath[pass->line] = 0;
+}
+
+
+static int P_SightGroup (int *group, int sector)
+{
+    while (group[sector] != sector)
+    {
+	group[sector] = group[group[sector]];
+	sector = group[sector];
+    }
+
+    return sector;
+}
+
+static boolean P_SightPassable (line_t *line)
+{
+    return line->backsector != NULL && (line->flags & ML_TWOSIDED);
+}
+
+static void P_SetPortal (portal_t *portal, line_t *line, boolean back)
+{
+    vertex_t*	v1 = back ? line->v2 : line->v1;
+    vertex_t*	v2 = back ? line->v1 : line->v2;
+    double	dx = (double) (v2->x - v1->x) / FRACUNIT;
+    double	dy = (double) (v2->y - v1->y) / FRACUNIT;
+    double	len = sqrt (dx*dx + dy*dy);
+
+    portal->seg.x1 = (double) v1->x / FRACUNIT;
+    portal->seg.y1 = (double) v1->y / FRACUNIT;
+    portal->seg.x2 = (double) v2->x / FRACUNIT;
+    portal->seg.y2 = (double) v2->y / FRACUNIT;
+
+    if (len > 0)
+    {
+	portal->seg.x1 -= dx * PORTALSLACK / len;
+	portal->seg.y1 -= dy * PORTALSLACK / len;
+	portal->seg.x2 += dx * PORTALSLACK / len;
+	portal->seg.y2 += dy * PORTALSLACK / len;
+    }
+
+    portal->line = line - lines;
+    portal->sector = (back ? line->frontsector : line->backsector) - sectors;
 }
 
 
+//
+// P_BuildReject
+// Sets the bits in rejectmatrix of the sectors that can't possibly see
+// each other.
+//
+void P_BuildReject (void)
+{
+    rejectbuild_t	build;
+    line_t*		li;
+    int*		fill;
+    int*		groupsize;
+    byte*		visible;
+    int			numportals;
+    int			flowleft;
+    int			s1, s2;
+    int			i;
+
+    build.firstportal = Z_Malloc ((numsectors + 1) * sizeof(int),
+				  PU_STATIC, NULL);
+    fill = Z_Malloc (numsectors * sizeof(int), PU_STATIC, NULL);
+    build.group = Z_Malloc (numsectors * sizeof(int), PU_STATIC, NULL);
+    groupsize = Z_Malloc (numsectors * sizeof(int), PU_STATIC, NULL);
+    memset (build.firstportal, 0, (numsectors + 1) * sizeof(int));
+    memset (groupsize, 0, numsectors * sizeof(int));
+
+    for (i=0 ; i<numsectors ; i++)
+	build.group[i] = i;
+
+    // a portal out of each side of every line sight goes through
+    for (i=0, li=lines ; i<numlines ; i++, li++)
+    {
+	if (P_SightPassable (li))
+	{
+	    s1 = P_SightGroup (build.group, li->frontsector - sectors);
+	    s2 = P_SightGroup (build.group, li->backsector - sectors);
+	    build.group[s1] = s2;
+
+	    build.firstportal[li->frontsector - sectors + 1]++;
+	    build.firstportal[li->backsector - sectors + 1]++;
+	}
+    }
+
+    for (i=0 ; i<numsectors ; i++)
+	groupsize[P_SightGroup (build.group, i)]++;
+
+    for (i=0 ; i<numsectors ; i++)
+    {
+	build.firstportal[i+1] += build.firstportal[i];
+	fill[i] = build.firstportal[i];
+    }
+
+    numportals = build.firstportal[numsectors];
+    build.portals = Z_Malloc (numportals * sizeof(portal_t) + 1,
+			      PU_STATIC, NULL);
+
+    for (i=0, li=lines ; i<numlines ; i++, li++)
+    {
+	if (P_SightPassable (li))
+	{
+	    P_SetPortal (&build.portals[fill[li->frontsector - sectors]++],
+			 li, false);
+	    P_SetPortal (&build.portals[fill[li->backsector - sectors]++],
+			 li, true);
+	}
+    }
+
+    build.onpath = Z_Malloc (numlines + 1, PU_STATIC, NULL);
+    build.seen = Z_Malloc (numsectors, PU_STATIC, NULL);
+    visible = Z_Malloc ((numsectors * numsectors + 7) / 8, PU_STATIC, NULL);
+    memset (build.onpath, 0, numlines + 1);
+    memset (visible, 0, (numsectors * numsectors + 7) / 8);
+
+    flowleft = MAXREJECTFLOW;
+
+    for (s1=0 ; s1<numsectors ; s1++)
+    {
+	memset (build.seen, 0, numsectors);
+	build.seen[s1] = 1;
+	build.unseen = groupsize[P_SightGroup (build.group, s1)] - 1;
+	build.budget = flowleft < MAXPORTALFLOW ? flowleft : MAXPORTALFLOW;
+	flowleft -= build.budget;
+
+	for (i = build.firstportal[s1];
+	     i < build.firstportal[s1 + 1]
+	     && build.unseen > 0 && build.budget >= 0;
+	     i++)
+	{
+	    P_FlowPortal (&build, &build.portals[i].seg, &build.portals[i]);
+	}
+
+	if (build.budget > 0)
+	    flowleft += build.budget;
+
+	// too many ways through to follow them all
+	if (build.budget < 0)
+	{
+	    for (s2=0 ; s2<numsectors ; s2++)
+	    {
+		if (P_SightGroup (build.group, s2)
+		    == P_SightGroup (build.group, s1))
+		    build.seen[s2] = 1;
+	    }
+	}
+
+	for (s2=0 ; s2<numsectors ; s2++)
+	{
+	    if (build.seen[s2])
+		SETSIGHTBIT (visible, s1, s2);
+	}
+    }
+
+    // sight is the same both ways, so whichever way was seen counts
+    for (s1=0 ; s1<numsectors ; s1++)
+    {
+	for (s2=0 ; s2<numsectors ; s2++)
+	{
+	    if (!SIGHTBIT (visible, s1, s2) && !SIGHTBIT (visible, s2, s1))
+		SETSIGHTBIT (rejectmatrix, s1, s2);
+	}
+    }
+
+    Z_Free (visible);
+    Z_Free (build.seen);
+    Z_Free (build.onpath);
+    Z_Free (build.portals);
+    Z_Free (groupsize);
+    Z_Free (build.group);
+    Z_Free (fill);
+    Z_Free (build.firstportal);
+}
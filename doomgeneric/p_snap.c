@@ -0,0 +1,527 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	In-memory snapshots of the play simulation.
+//
+//	Unlike a savegame, nothing is converted.  The pools that
+//	thinkers are allocated from, the level arrays and the playsim
+//	globals are copied byte for byte.  Restored where they were
+//	taken, every pointer is still valid and a restore costs no
+//	more than a few memcpys.  Restored anywhere else, in another
+//	instance or after the level has been loaded again, pointers
+//	into the level, the pools and the players are moved by the
+//	distance their target has moved.
+//
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "i_system.h"
+#include "d_loop.h"
+#include "d_main.h"
+#include "g_game.h"
+#include "p_local.h"
+#include "p_spec.h"
+#include "p_snap.h"
+#include "r_main.h"
+
+#include "doomstat.h"
+
+
+extern THREADLOCAL int		prndindex;
+extern THREADLOCAL boolean	secretexit;
+
+extern THREADLOCAL mobj_t*	braintargets[32];
+extern THREADLOCAL int		numbraintargets;
+extern THREADLOCAL int		braintargeton;
+extern THREADLOCAL int		braineasy;
+
+extern THREADLOCAL int		totallines;
+extern THREADLOCAL line_t**	linebuffer;
+
+sector_t* GetSectorAtNullAddress (void);
+
+struct snapshot_s
+{
+    byte*	data;
+    size_t	size;
+    size_t	allocated;
+
+    // The level it was taken in.
+    skill_t	skill;
+    int		episode;
+    int		map;
+    int		numvertexes;
+    int		numsectors;
+    int		numsides;
+    int		numlines;
+    int		numsubsectors;
+    int		totallines;
+    int		numblocks;
+    int		validcount;
+
+    // Where what is pointed to was.
+    vertex_t*	vertexes;
+    sector_t*	sectors;
+    side_t*	sides;
+    line_t*	lines;
+    subsector_t* subsectors;
+    line_t**	linebuffer;
+    sector_t*	nullsector;
+    player_t*	players;
+    thinker_t*	thinkercap;
+};
+
+typedef struct
+{
+    void*	data;
+    size_t	size;
+} snapregion_t;
+
+#define MAXSNAPREGIONS	32
+
+typedef struct
+{
+    byte*	from;
+    byte*	to;
+    size_t	size;
+} relocation_t;
+
+// Blocks that are not where the snapshot being restored found them,
+// sorted by from.
+static THREADLOCAL relocation_t*	relocations;
+static THREADLOCAL int			numrelocations;
+static THREADLOCAL int			maxrelocations;
+
+#define REGION(p, len)				\
+    regions[count].data = (p);			\
+    regions[count].size = (len);		\
+    count++
+
+//
+// P_SnapshotRegions
+// Everything the playsim changes, other than the thinker pools.
+// What only lasts for the duration of a call (tmthing, spechit,
+// the intercepts) is left out.
+//
+static int P_SnapshotRegions (snapregion_t *regions)
+{
+    int	count = 0;
+
+    REGION (&gametic, sizeof(gametic));
+    REGION (&leveltime, sizeof(leveltime));
+    REGION (&rndindex, sizeof(rndindex));
+    REGION (&prndindex, sizeof(prndindex));
+    REGION (&gamestate, sizeof(gamestate));
+    REGION (&gameaction, sizeof(gameaction));
+    REGION (&secretexit, sizeof(secretexit));
+    REGION (&viewactive, sizeof(viewactive));
+
+    REGION (players, sizeof(players));
+    REGION (&totalkills, sizeof(totalkills));
+    REGION (&totalitems, sizeof(totalitems));
+    REGION (&totalsecret, sizeof(totalsecret));
+    REGION (bodyque, sizeof(bodyque));
+    REGION (&bodyqueslot, sizeof(bodyqueslot));
+
+    REGION (itemrespawnque, sizeof(itemrespawnque));
+    REGION (itemrespawntime, sizeof(itemrespawntime));
+    REGION (&iquehead, sizeof(iquehead));
+    REGION (&iquetail, sizeof(iquetail));
+
+    REGION (activeceilings, sizeof(activeceilings));
+    REGION (activeplats, sizeof(activeplats));
+    REGION (buttonlist, sizeof(buttonlist));
+    REGION (&levelTimeCount, sizeof(levelTimeCount));
+
+    REGION (braintargets, sizeof(braintargets));
+    REGION (&numbraintargets, sizeof(numbraintargets));
+    REGION (&braintargeton, sizeof(braintargeton));
+    REGION (&braineasy, sizeof(braineasy));
+
+    REGION (&thinkercap, sizeof(thinkercap));
+    REGION (sectors, numsectors * sizeof(*sectors));
+    REGION (lines, numlines * sizeof(*lines));
+    REGION (sides, numsides * sizeof(*sides));
+    REGION (blocklinks, bmapwidth * bmapheight * sizeof(*blocklinks));
+
+    return count;
+}
+
+
+//
+// P_AddRelocation
+//
+void P_AddRelocation (void* from, void* to, size_t size)
+{
+    if (from == to || size == 0)
+	return;
+
+    if (numrelocations == maxrelocations)
+    {
+	maxrelocations = maxrelocations ? maxrelocations * 2 : 64;
+	relocations = realloc (relocations,
+			       maxrelocations * sizeof(*relocations));
+
+	if (relocations == NULL)
+	    I_Error ("P_AddRelocation: out of memory");
+    }
+
+    relocations[numrelocations].from = from;
+    relocations[numrelocations].to = to;
+    relocations[numrelocations].size = size;
+    numrelocations++;
+}
+
+
+static int CompareRelocations (const void* a, const void* b)
+{
+    const relocation_t*	ra = a;
+    const relocation_t*	rb = b;
+
+    if (ra->from < rb->from)
+	return -1;
+
+    return ra->from > rb->from;
+}
+
+
+//
+// P_Relocate
+// Returns where the thing p pointed to is now.  Pointers outside of
+// the relocated blocks, like NULL and those into the info tables,
+// are returned as they are.
+//
+void* P_Relocate (void* p)
+{
+    byte*	b = p;
+    int		low = 0;
+    int		high = numrelocations - 1;
+    int		mid;
+
+    while (low <= high)
+    {
+	mid = (low + high) / 2;
+
+	if (b < relocations[mid].from)
+	    high = mid - 1;
+	else if (b >= relocations[mid].from + relocations[mid].size)
+	    low = mid + 1;
+	else
+	    return relocations[mid].to + (b - relocations[mid].from);
+    }
+
+    return p;
+}
+
+#define RELOCATE(p)	((p) = P_Relocate (p))
+
+
+//
+// P_RelocateThinker
+// Fixes up an object of a pool, used or not.  What is in a free
+// object does not matter, so it does not hurt to move it too.
+//
+void P_RelocateThinker (thinker_t* thinker, thinkerpool_t pool)
+{
+    mobj_t*	mo;
+
+    RELOCATE (thinker->next);
+    RELOCATE (thinker->prev);
+
+    switch (pool)
+    {
+      case tp_mobj:
+	mo = (mobj_t *) thinker;
+	RELOCATE (mo->snext);
+	RELOCATE (mo->sprev);
+	RELOCATE (mo->bnext);
+	RELOCATE (mo->bprev);
+	RELOCATE (mo->subsector);
+	RELOCATE (mo->target);
+	RELOCATE (mo->player);
+	RELOCATE (mo->tracer);
+	break;
+
+      case tp_ceiling:
+	RELOCATE (((ceiling_t *) thinker)->sector);
+	break;
+
+      case tp_door:
+	RELOCATE (((vldoor_t *) thinker)->sector);
+	break;
+
+      case tp_floor:
+	RELOCATE (((floormove_t *) thinker)->sector);
+	break;
+
+      case tp_plat:
+	RELOCATE (((plat_t *) thinker)->sector);
+	break;
+
+      case tp_fireflicker:
+	RELOCATE (((fireflicker_t *) thinker)->sector);
+	break;
+
+      case tp_lightflash:
+	RELOCATE (((lightflash_t *) thinker)->sector);
+	break;
+
+      case tp_strobe:
+	RELOCATE (((strobe_t *) thinker)->sector);
+	break;
+
+      case tp_glow:
+	RELOCATE (((glow_t *) thinker)->sector);
+	break;
+
+      default:
+	break;
+    }
+}
+
+
+//
+// P_RelocateRegions
+// Fixes up the pointers in what P_SnapshotRegions copies.
+//
+static void P_RelocateRegions (void)
+{
+    sector_t*	sec;
+    line_t*	li;
+    int		i;
+
+    for (i = 0, sec = sectors; i < numsectors; i++, sec++)
+    {
+	RELOCATE (sec->soundtarget);
+	RELOCATE (sec->thinglist);
+	RELOCATE (sec->specialdata);
+	RELOCATE (sec->lines);
+    }
+
+    for (i = 0, li = lines; i < numlines; i++, li++)
+    {
+	RELOCATE (li->v1);
+	RELOCATE (li->v2);
+	RELOCATE (li->frontsector);
+	RELOCATE (li->backsector);
+	RELOCATE (li->specialdata);
+    }
+
+    for (i = 0; i < numsides; i++)
+	RELOCATE (sides[i].sector);
+
+    for (i = 0; i < bmapwidth * bmapheight; i++)
+	RELOCATE (blocklinks[i]);
+
+    for (i = 0; i < MAXPLAYERS; i++)
+    {
+	RELOCATE (players[i].mo);
+	RELOCATE (players[i].attacker);
+
+	// It may be in a buffer of the other instance.
+	players[i].message = NULL;
+    }
+
+    for (i = 0; i < BODYQUESIZE; i++)
+	RELOCATE (bodyque[i]);
+
+    for (i = 0; i < MAXCEILINGS; i++)
+	RELOCATE (activeceilings[i]);
+
+    for (i = 0; i < MAXPLATS; i++)
+	RELOCATE (activeplats[i]);
+
+    for (i = 0; i < MAXBUTTONS; i++)
+    {
+	RELOCATE (buttonlist[i].line);
+	RELOCATE (buttonlist[i].soundorg);
+    }
+
+    for (i = 0; i < numbraintargets; i++)
+	RELOCATE (braintargets[i]);
+
+    RELOCATE (thinkercap.next);
+    RELOCATE (thinkercap.prev);
+}
+
+
+//
+// P_SnapshotFits
+// Whether the level being played is the one of the snapshot.
+//
+static boolean P_SnapshotFits (snapshot_t *snapshot)
+{
+    return gamestate == GS_LEVEL
+	&& gameskill == snapshot->skill
+	&& gameepisode == snapshot->episode
+	&& gamemap == snapshot->map;
+}
+
+
+//
+// P_SaveSnapshot
+//
+snapshot_t *P_SaveSnapshot (snapshot_t *snapshot)
+{
+    snapregion_t	regions[MAXSNAPREGIONS];
+    int			numregions;
+    size_t		size;
+    byte*		p;
+    int			i;
+
+    if (gamestate != GS_LEVEL)
+	return NULL;
+
+    numregions = P_SnapshotRegions (regions);
+    size = P_ThinkerPoolsSize ();
+
+    for (i = 0; i < numregions; i++)
+	size += regions[i].size;
+
+    if (snapshot == NULL)
+    {
+	snapshot = calloc (1, sizeof(*snapshot));
+
+	if (snapshot == NULL)
+	    I_Error ("P_SaveSnapshot: out of memory");
+    }
+
+    if (size > snapshot->allocated)
+    {
+	free (snapshot->data);
+	snapshot->data = malloc (size);
+	snapshot->allocated = size;
+
+	if (snapshot->data == NULL)
+	    I_Error ("P_SaveSnapshot: out of memory");
+    }
+
+    snapshot->skill = gameskill;
+    snapshot->episode = gameepisode;
+    snapshot->map = gamemap;
+    snapshot->numvertexes = numvertexes;
+    snapshot->numsectors = numsectors;
+    snapshot->numsides = numsides;
+    snapshot->numlines = numlines;
+    snapshot->numsubsectors = numsubsectors;
+    snapshot->totallines = totallines;
+    snapshot->numblocks = bmapwidth * bmapheight;
+    snapshot->validcount = validcount;
+
+    snapshot->vertexes = vertexes;
+    snapshot->sectors = sectors;
+    snapshot->sides = sides;
+    snapshot->lines = lines;
+    snapshot->subsectors = subsectors;
+    snapshot->linebuffer = linebuffer;
+    snapshot->nullsector = GetSectorAtNullAddress ();
+    snapshot->players = players;
+    snapshot->thinkercap = &thinkercap;
+
+    p = P_SaveThinkerPools (snapshot->data);
+
+    for (i = 0; i < numregions; i++)
+    {
+	memcpy (p, regions[i].data, regions[i].size);
+	p += regions[i].size;
+    }
+
+    snapshot->size = size;
+
+    return snapshot;
+}
+
+
+//
+// P_RestoreSnapshot
+//
+boolean P_RestoreSnapshot (snapshot_t *snapshot)
+{
+    snapregion_t	regions[MAXSNAPREGIONS];
+    int			numregions;
+    byte*		p;
+    int			i;
+
+    if (!P_SnapshotFits (snapshot))
+	G_InitNew (snapshot->skill, snapshot->episode, snapshot->map);
+
+    if (!P_SnapshotFits (snapshot)
+     || numvertexes != snapshot->numvertexes
+     || numsectors != snapshot->numsectors
+     || numsides != snapshot->numsides
+     || numlines != snapshot->numlines
+     || numsubsectors != snapshot->numsubsectors
+     || totallines != snapshot->totallines
+     || bmapwidth * bmapheight != snapshot->numblocks)
+    {
+	return false;
+    }
+
+    numrelocations = 0;
+
+    P_AddRelocation (snapshot->vertexes, vertexes,
+		     numvertexes * sizeof(*vertexes));
+    P_AddRelocation (snapshot->sectors, sectors,
+		     numsectors * sizeof(*sectors));
+    P_AddRelocation (snapshot->sides, sides, numsides * sizeof(*sides));
+    P_AddRelocation (snapshot->lines, lines, numlines * sizeof(*lines));
+    P_AddRelocation (snapshot->subsectors, subsectors,
+		     numsubsectors * sizeof(*subsectors));
+    P_AddRelocation (snapshot->linebuffer, linebuffer,
+		     totallines * sizeof(*linebuffer));
+    P_AddRelocation (snapshot->nullsector, GetSectorAtNullAddress (),
+		     sizeof(sector_t));
+    P_AddRelocation (snapshot->players, players, sizeof(players));
+    P_AddRelocation (snapshot->thinkercap, &thinkercap, sizeof(thinkercap));
+
+    p = P_RestoreThinkerPools (snapshot->data);
+
+    numregions = P_SnapshotRegions (regions);
+
+    for (i = 0; i < numregions; i++)
+    {
+	memcpy (regions[i].data, p, regions[i].size);
+	p += regions[i].size;
+    }
+
+    if (numrelocations > 0)
+    {
+	qsort (relocations, numrelocations, sizeof(*relocations),
+	       CompareRelocations);
+	P_RelocateRegions ();
+    }
+
+    P_FinishThinkerPools (numrelocations > 0);
+
+    // Whatever was checked in the snapshot must not look checked here.
+    if (validcount <= snapshot->validcount)
+	validcount = snapshot->validcount + 1;
+
+    P_FlushSightMemo ();
+
+    return true;
+}
+
+
+void P_FreeSnapshot (snapshot_t *snapshot)
+{
+    if (snapshot != NULL)
+    {
+	free (snapshot->data);
+	free (snapshot);
+    }
+}
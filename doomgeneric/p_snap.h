@@ -0,0 +1,44 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	In-memory snapshots of the play simulation.
+//
+
+
+#ifndef __P_SNAP__
+#define __P_SNAP__
+
+#include "doomtype.h"
+
+// A snapshot holds everything the playsim changes while a level is
+// played: thinkers, sectors, lines, sides, players, the random number
+// indexes and gametic.  It can be restored into any instance that
+// plays the same game; the snapshot is only read then, so several
+// threads may restore it at once.
+
+typedef struct snapshot_s snapshot_t;
+
+// Saves the current level into snapshot, or into a new one if snapshot
+// is NULL.  Returns NULL if no level is being played.
+snapshot_t *P_SaveSnapshot(snapshot_t *snapshot);
+
+// Loads the level of the snapshot first if another one, or none, is
+// being played.  Returns false if the level does not match that of
+// the snapshot even so, as when another IWAD is in use.
+boolean P_RestoreSnapshot(snapshot_t *snapshot);
+
+void P_FreeSnapshot(snapshot_t *snapshot);
+
+#endif
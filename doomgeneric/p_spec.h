@@ -27,8 +27,8 @@
 //
 // End-level timer (-TIMER option)
 //
-extern	boolean levelTimer;
-extern	int	levelTimeCount;
+extern THREADLOCAL boolean levelTimer;
+extern THREADLOCAL int	levelTimeCount;
 
 
 //      Define values for map objects
@@ -176,6 +176,7 @@ typedef struct
 #define SLOWDARK			35
 
 void    P_SpawnFireFlicker (sector_t* sector);
+void    T_FireFlicker (fireflicker_t* flick);
 void    T_LightFlash (lightflash_t* flash);
 void    P_SpawnLightFlash (sector_t* sector);
 void    T_StrobeFlash (strobe_t* flash);
@@ -243,7 +244,7 @@ typedef struct
  // 1 second, in ticks. 
 #define BUTTONTIME      35             
 
-extern button_t	buttonlist[MAXBUTTONS]; 
+extern THREADLOCAL button_t	buttonlist[MAXBUTTONS]; 
 
 void
 P_ChangeSwitchTexture
@@ -303,7 +304,7 @@ typedef struct
 #define MAXPLATS		30
 
 
-extern plat_t*	activeplats[MAXPLATS];
+extern THREADLOCAL plat_t*	activeplats[MAXPLATS];
 
 void    T_PlatRaise(plat_t*	plat);
 
@@ -514,7 +515,7 @@ typedef struct
 #define CEILWAIT		150
 #define MAXCEILINGS		30
 
-extern ceiling_t*	activeceilings[MAXCEILINGS];
+extern THREADLOCAL ceiling_t*	activeceilings[MAXCEILINGS];
 
 int
 EV_DoCeiling
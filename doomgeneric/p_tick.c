@@ -18,17 +18,27 @@
 //
 
 
+#include <string.h>
+
 #include "z_zone.h"
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include "m_trace.h"
 #include "p_local.h"
+#include "p_tick.h"
 
+#include "d_loop.h"
 #include "doomstat.h"
 
 
-int	leveltime;
+THREADLOCAL int	leveltime;
+
+THREADLOCAL int	interpolationtic = -1;
 
 //
 // THINKERS
-// All thinkers should be allocated by Z_Malloc
+// All thinkers should be allocated by P_AllocThinker
 // so they can be operated on uniformly.
 // The actual structures will vary in size,
 // but the first element must be thinker_t.
@@ -37,7 +47,313 @@ int	leveltime;
 
 
 // Both the head and tail of the thinker list.
-thinker_t	thinkercap;
+THREADLOCAL thinker_t	thinkercap;
+
+
+//
+// THINKER POOLS
+// Every type of thinker has its own pool of equally sized objects,
+// carved out of slabs of zone memory.  Objects start on a cache line
+// and free ones are chained through thinker.next, so allocating and
+// freeing take constant time, and thinkers spawned one after another
+// sit next to each other in memory.
+//
+
+#define POOL_ALIGN	64
+#define SLAB_SIZE	16384
+
+// Object sizes, to be rounded up to POOL_ALIGN.
+static const int poolobjsize[NUMTHINKERPOOLS] =
+{
+    sizeof(mobj_t),
+    sizeof(ceiling_t),
+    sizeof(vldoor_t),
+    sizeof(floormove_t),
+    sizeof(plat_t),
+    sizeof(fireflicker_t),
+    sizeof(lightflash_t),
+    sizeof(strobe_t),
+    sizeof(glow_t),
+};
+
+static const char *poolnames[NUMTHINKERPOOLS] =
+{
+    "mobj",
+    "ceiling",
+    "door",
+    "floor",
+    "plat",
+    "fireflicker",
+    "lightflash",
+    "strobe",
+    "glow",
+};
+
+typedef struct slab_s
+{
+    struct slab_s*	next;
+    byte*		objects;
+    int			count;
+} slab_t;
+
+// Slabs of each pool, newest first.
+static THREADLOCAL slab_t*	poolslabs[NUMTHINKERPOOLS];
+static THREADLOCAL int		numslabs[NUMTHINKERPOOLS];
+
+// Free objects of each pool.
+static THREADLOCAL thinker_t*	poolfree[NUMTHINKERPOOLS];
+
+THREADLOCAL thinkerstats_t	thinkerstats[NUMTHINKERPOOLS];
+
+// -thinkerstats
+static THREADLOCAL boolean	timethinkers;
+static THREADLOCAL int		timedtics;
+
+#define POOLSIZE(i)	((poolobjsize[i] + POOL_ALIGN - 1) & ~(POOL_ALIGN - 1))
+
+
+//
+// P_ClearThinkerPools
+// Forget all slabs; their zone memory has been freed already.
+//
+void P_ClearThinkerPools (void)
+{
+    int		i;
+
+    for (i = 0; i < NUMTHINKERPOOLS; i++)
+    {
+	poolslabs[i] = NULL;
+	numslabs[i] = 0;
+	poolfree[i] = NULL;
+	thinkerstats[i].count = 0;
+    }
+}
+
+
+static void P_AddSlab (thinkerpool_t pool)
+{
+    int		size = POOLSIZE(pool);
+    slab_t*	slab;
+    thinker_t*	object;
+    int		count;
+    int		i;
+
+    count = SLAB_SIZE / size;
+
+    if (count < 1)
+	count = 1;
+
+    slab = Z_Malloc (sizeof(slab_t) + count * size + POOL_ALIGN - 1,
+		     PU_LEVEL, NULL);
+    slab->objects = (byte *) (((uintptr_t) (slab + 1) + POOL_ALIGN - 1)
+			      & ~(uintptr_t) (POOL_ALIGN - 1));
+    slab->count = count;
+    slab->next = poolslabs[pool];
+    poolslabs[pool] = slab;
+    numslabs[pool]++;
+
+    // Chain them up so that they are handed out in address order.
+    for (i = count - 1; i >= 0; i--)
+    {
+	object = (thinker_t *) (slab->objects + i * size);
+	object->next = poolfree[pool];
+	poolfree[pool] = object;
+    }
+}
+
+
+//
+// P_AllocThinker
+// Returns a zeroed object of the pool's type.
+//
+void* P_AllocThinker (thinkerpool_t pool)
+{
+    thinker_t*	thinker;
+
+    if (poolfree[pool] == NULL)
+	P_AddSlab (pool);
+
+    thinker = poolfree[pool];
+    poolfree[pool] = thinker->next;
+
+    memset (thinker, 0, POOLSIZE(pool));
+    thinker->pool = pool;
+
+    if (++thinkerstats[pool].count > thinkerstats[pool].peak)
+	thinkerstats[pool].peak = thinkerstats[pool].count;
+
+    return thinker;
+}
+
+
+//
+// P_FreeThinker
+// Puts an object, unlinked already, back in its pool.
+//
+void P_FreeThinker (thinker_t* thinker)
+{
+    thinker->next = poolfree[thinker->pool];
+    poolfree[thinker->pool] = thinker;
+
+    thinkerstats[thinker->pool].count--;
+}
+
+
+//
+// P_ThinkerPoolsSize
+// Bytes that P_SaveThinkerPools writes.
+//
+size_t P_ThinkerPoolsSize (void)
+{
+    slab_t*	slab;
+    size_t	size;
+    int		i;
+
+    size = 0;
+
+    for (i = 0; i < NUMTHINKERPOOLS; i++)
+    {
+	size += sizeof(int) + sizeof(thinker_t *) + sizeof(int);
+
+	for (slab = poolslabs[i]; slab != NULL; slab = slab->next)
+	    size += sizeof(byte *) + slab->count * POOLSIZE(i);
+    }
+
+    return size;
+}
+
+
+//
+// P_SaveThinkerPools
+// Copies every object, used or free, to p and returns the end.  The
+// address of each slab goes along, for P_RestoreThinkerPools.
+//
+byte* P_SaveThinkerPools (byte* p)
+{
+    slab_t*	slab;
+    int		i;
+
+    for (i = 0; i < NUMTHINKERPOOLS; i++)
+    {
+	memcpy (p, &numslabs[i], sizeof(int));
+	p += sizeof(int);
+	memcpy (p, &poolfree[i], sizeof(thinker_t *));
+	p += sizeof(thinker_t *);
+	memcpy (p, &thinkerstats[i].count, sizeof(int));
+	p += sizeof(int);
+
+	for (slab = poolslabs[i]; slab != NULL; slab = slab->next)
+	{
+	    memcpy (p, &slab->objects, sizeof(byte *));
+	    p += sizeof(byte *);
+	    memcpy (p, slab->objects, slab->count * POOLSIZE(i));
+	    p += slab->count * POOLSIZE(i);
+	}
+    }
+
+    return p;
+}
+
+
+// Slabs filled by the last P_RestoreThinkerPools.  Those in front of
+// them, if any, are spare.
+static THREADLOCAL int		restoredslabs[NUMTHINKERPOOLS];
+
+//
+// P_RestoreThinkerPools
+// Copies the objects of a save into the slabs of this level, oldest
+// to oldest, adding slabs if there are too few.  Every slab that is
+// not where the save found it is passed to P_AddRelocation; until
+// P_FinishThinkerPools has run, pointers in the objects are those of
+// the save.
+//
+byte* P_RestoreThinkerPools (byte* p)
+{
+    slab_t*	slab;
+    byte*	objects;
+    int		count;
+    int		i;
+    int		j;
+
+    for (i = 0; i < NUMTHINKERPOOLS; i++)
+    {
+	memcpy (&count, p, sizeof(int));
+	p += sizeof(int);
+
+	while (numslabs[i] < count)
+	    P_AddSlab (i);
+
+	memcpy (&poolfree[i], p, sizeof(thinker_t *));
+	p += sizeof(thinker_t *);
+	memcpy (&thinkerstats[i].count, p, sizeof(int));
+	p += sizeof(int);
+
+	for (slab = poolslabs[i], j = numslabs[i]; j > count; j--)
+	    slab = slab->next;
+
+	for ( ; slab != NULL; slab = slab->next)
+	{
+	    memcpy (&objects, p, sizeof(byte *));
+	    p += sizeof(byte *);
+	    P_AddRelocation (objects, slab->objects,
+			     slab->count * POOLSIZE(i));
+	    memcpy (slab->objects, p, slab->count * POOLSIZE(i));
+	    p += slab->count * POOLSIZE(i);
+	}
+
+	restoredslabs[i] = count;
+    }
+
+    return p;
+}
+
+
+//
+// P_FinishThinkerPools
+// Moves the pointers in the restored objects to where things are now,
+// if relocate is set, and hands out the objects of spare slabs.
+//
+void P_FinishThinkerPools (boolean relocate)
+{
+    slab_t*	slab;
+    slab_t*	spare;
+    thinker_t*	object;
+    int		size;
+    int		i;
+    int		j;
+
+    for (i = 0; i < NUMTHINKERPOOLS; i++)
+    {
+	size = POOLSIZE(i);
+	spare = poolslabs[i];
+
+	for (slab = spare, j = numslabs[i]; j > restoredslabs[i]; j--)
+	    slab = slab->next;
+
+	if (relocate)
+	{
+	    poolfree[i] = P_Relocate (poolfree[i]);
+
+	    for ( ; slab != NULL; slab = slab->next)
+	    {
+		for (j = 0; j < slab->count; j++)
+		    P_RelocateThinker ((thinker_t *) (slab->objects + j * size),
+				       i);
+	    }
+	}
+
+	for (j = numslabs[i]; j > restoredslabs[i]; j--, spare = spare->next)
+	{
+	    for (object = (thinker_t *) spare->objects;
+		 object < (thinker_t *) (spare->objects + spare->count * size);
+		 object = (thinker_t *) ((byte *) object + size))
+	    {
+		object->next = poolfree[i];
+		poolfree[i] = object;
+	    }
+	}
+    }
+}
 
 
 //
@@ -88,12 +404,113 @@ void P_AllocateThinker (thinker_t*	thinker)
 
 
 
+//
+// P_PrintThinkerStats
+//
+static void P_PrintThinkerStats (void)
+{
+    thinkerstats_t*	stats;
+    int			i;
+
+    if (timedtics == 0)
+	return;
+
+    printf ("thinker stats over %i tics:\n", timedtics);
+    printf ("%-12s %8s %12s %10s %10s\n",
+	    "type", "peak", "calls/tic", "us/tic", "ns/call");
+
+    for (i = 0; i < NUMTHINKERPOOLS; i++)
+    {
+	stats = &thinkerstats[i];
+
+	printf ("%-12s %8i %12.1f %10.1f %10.1f\n",
+		poolnames[i], stats->peak,
+		(double) stats->runs / timedtics,
+		stats->time / 1000.0 / timedtics,
+		stats->runs ? (double) stats->time / stats->runs : 0.0);
+    }
+}
+
+
+//
+// P_InitThinkerStats
+//
+void P_InitThinkerStats (void)
+{
+    //!
+    // @category obscure
+    //
+    // Time the thinkers of each type, and print the results on exit.
+    //
+
+    if (M_CheckParm ("-thinkerstats"))
+    {
+	timethinkers = true;
+	I_AtExit (P_PrintThinkerStats, false);
+    }
+}
+
+
+//
+// P_RunThinker
+// The usual action of each pool is called directly.  Anything
+// else, such as a ceiling in stasis, goes through the pointer.
+//
+static void P_RunThinker (thinker_t* thinker)
+{
+    actionf_p1	func = thinker->function.acp1;
+
+#define DIRECT(pool, type, action)				\
+      case pool:						\
+	if (func == (actionf_p1) action)			\
+	{							\
+	    action ((type *) thinker);				\
+	    return;						\
+	}							\
+	break
+
+    switch (thinker->pool)
+    {
+	DIRECT (tp_mobj, mobj_t, P_MobjThinker);
+	DIRECT (tp_ceiling, ceiling_t, T_MoveCeiling);
+	DIRECT (tp_door, vldoor_t, T_VerticalDoor);
+	DIRECT (tp_floor, floormove_t, T_MoveFloor);
+	DIRECT (tp_plat, plat_t, T_PlatRaise);
+	DIRECT (tp_fireflicker, fireflicker_t, T_FireFlicker);
+	DIRECT (tp_lightflash, lightflash_t, T_LightFlash);
+	DIRECT (tp_strobe, strobe_t, T_StrobeFlash);
+	DIRECT (tp_glow, glow_t, T_Glow);
+      default:
+	break;
+    }
+
+#undef DIRECT
+
+    if (func)
+	func (thinker);
+}
+
+
 //
 // P_RunThinkers
+// Thinkers run in the order of the list, whatever their type, as
+// demos depend on it.
 //
 void P_RunThinkers (void)
 {
     thinker_t*	currentthinker;
+    thinker_t*	next;
+    uint64_t	lasttime = 0;
+    uint64_t	now;
+    uint64_t	trace;
+
+    trace = M_TraceBegin ();
+
+    if (timethinkers)
+    {
+	lasttime = I_GetTimeNS ();
+	timedtics++;
+    }
 
     currentthinker = thinkercap.next;
     while (currentthinker != &thinkercap)
@@ -103,19 +520,66 @@ void P_RunThinkers (void)
 	    // time to remove it
 	    currentthinker->next->prev = currentthinker->prev;
 	    currentthinker->prev->next = currentthinker->next;
-	    Z_Free (currentthinker);
+	    next = currentthinker->next;
+	    P_FreeThinker (currentthinker);
 	}
 	else
 	{
-	    if (currentthinker->function.acp1)
-		currentthinker->function.acp1 (currentthinker);
+	    P_RunThinker (currentthinker);
+	    next = currentthinker->next;
+
+	    if (timethinkers)
+	    {
+		now = I_GetTimeNS ();
+		thinkerstats[currentthinker->pool].runs++;
+		thinkerstats[currentthinker->pool].time += now - lasttime;
+		lasttime = now;
+	    }
 	}
-	currentthinker = currentthinker->next;
+	currentthinker = next;
     }
+
+    M_TraceEnd (tz_runthinkers, trace);
 }
 
 
 
+//
+// P_StoreInterpolation
+// Remember where everything is before the tic moves it, for
+// R_RenderPlayerView to draw frames in between.
+//
+static void P_StoreInterpolation (void)
+{
+    thinker_t*	th;
+    mobj_t*	mo;
+    sector_t*	sec;
+    int		i;
+
+    for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
+    {
+	if (th->function.acp1 != (actionf_p1) P_MobjThinker)
+	    continue;
+
+	mo = (mobj_t *) th;
+	mo->oldx = mo->x;
+	mo->oldy = mo->y;
+	mo->oldz = mo->z;
+	mo->oldangle = mo->angle;
+    }
+
+    for (i=0, sec = sectors ; i<numsectors ; i++, sec++)
+    {
+	sec->oldfloorheight = sec->floorheight;
+	sec->oldceilingheight = sec->ceilingheight;
+    }
+
+    for (i=0 ; i<MAXPLAYERS ; i++)
+	players[i].oldviewz = players[i].viewz;
+
+    interpolationtic = gametic;
+}
+
 //
 // P_Ticker
 //
@@ -137,6 +601,8 @@ void P_Ticker (void)
 	return;
     }
     
+    if (uncapped)
+	P_StoreInterpolation ();
 		
     for (i=0 ; i<MAXPLAYERS ; i++)
 	if (playeringame[i])
@@ -28,6 +28,11 @@
 // Carries out all thinking of monsters and players.
 void P_Ticker (void);
 
+// The gametic at whose start the old positions and heights were last
+// stored, or -1.  They are only stored when frames are drawn in between
+// tics.
+extern THREADLOCAL int interpolationtic;
+
 
 
 #endif
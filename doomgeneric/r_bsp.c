@@ -37,14 +37,14 @@
 
 
 
-seg_t*		curline;
-side_t*		sidedef;
-line_t*		linedef;
-sector_t*	frontsector;
-sector_t*	backsector;
+THREADLOCAL seg_t*		curline;
+THREADLOCAL side_t*		sidedef;
+THREADLOCAL line_t*		linedef;
+THREADLOCAL sector_t*	frontsector;
+THREADLOCAL sector_t*	backsector;
 
-drawseg_t	drawsegs[MAXDRAWSEGS];
-drawseg_t*	ds_p;
+THREADLOCAL drawseg_t	drawsegs[MAXDRAWSEGS];
+THREADLOCAL drawseg_t*	ds_p;
 
 
 void
@@ -81,8 +81,8 @@ typedef	struct
 #define MAXSEGS		32
 
 // newend is one past the last valid seg
-cliprange_t*	newend;
-cliprange_t	solidsegs[MAXSEGS];
+THREADLOCAL cliprange_t*	newend;
+THREADLOCAL cliprange_t	solidsegs[MAXSEGS];
 
 
 
@@ -355,7 +355,7 @@ void R_AddLine (seg_t*	line)
 // Returns true
 //  if some part of the bbox might be visible.
 //
-int	checkcoord[12][4] =
+THREADLOCAL int	checkcoord[12][4] =
 {
     {3,0,2,1},
     {3,0,2,0},
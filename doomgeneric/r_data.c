@@ -19,6 +19,15 @@
 
 #include <stdio.h>
 
+#include "config.h"
+
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #include "deh_main.h"
 #include "i_swap.h"
 #include "i_system.h"
@@ -35,6 +44,9 @@
 #include "doomstat.h"
 #include "r_sky.h"
 
+#include "m_argv.h"
+#include "m_config.h"
+#include "w_checksum.h"
 
 #include "r_data.h"
 
@@ -126,41 +138,41 @@ struct texture_s
 
 
 
-int		firstflat;
-int		lastflat;
-int		numflats;
+THREADLOCAL int		firstflat;
+THREADLOCAL int		lastflat;
+THREADLOCAL int		numflats;
 
-int		firstpatch;
-int		lastpatch;
-int		numpatches;
+THREADLOCAL int		firstpatch;
+THREADLOCAL int		lastpatch;
+THREADLOCAL int		numpatches;
 
-int		firstspritelump;
-int		lastspritelump;
-int		numspritelumps;
+THREADLOCAL int		firstspritelump;
+THREADLOCAL int		lastspritelump;
+THREADLOCAL int		numspritelumps;
 
-int		numtextures;
-texture_t**	textures;
-texture_t**     textures_hashtable;
+THREADLOCAL int		numtextures;
+THREADLOCAL texture_t**	textures;
+THREADLOCAL texture_t**     textures_hashtable;
 
 
-int*			texturewidthmask;
+THREADLOCAL int*			texturewidthmask;
 // needed for texture pegging
-fixed_t*		textureheight;		
-int*			texturecompositesize;
-short**			texturecolumnlump;
-unsigned short**	texturecolumnofs;
-byte**			texturecomposite;
+THREADLOCAL fixed_t*		textureheight;		
+THREADLOCAL int*			texturecompositesize;
+THREADLOCAL short**			texturecolumnlump;
+THREADLOCAL unsigned short**	texturecolumnofs;
+THREADLOCAL byte**			texturecomposite;
 
 // for global animation
-int*		flattranslation;
-int*		texturetranslation;
+THREADLOCAL int*		flattranslation;
+THREADLOCAL int*		texturetranslation;
 
 // needed for pre rendering
-fixed_t*	spritewidth;	
-fixed_t*	spriteoffset;
-fixed_t*	spritetopoffset;
+THREADLOCAL fixed_t*	spritewidth;	
+THREADLOCAL fixed_t*	spriteoffset;
+THREADLOCAL fixed_t*	spritetopoffset;
 
-lighttable_t	*colormaps;
+THREADLOCAL lighttable_t	*colormaps;
 
 
 //
@@ -392,10 +404,14 @@ R_GetColumn
     ofs = texturecolumnofs[tex][col];
     
     if (lump > 0)
-	return (byte *)W_CacheLumpNum(lump,PU_CACHE)+ofs;
+	return (byte *)R_CacheDrawLump(lump,PU_CACHE)+ofs;
 
     if (!texturecomposite[tex])
+    {
+	// Queued columns may point into composites that this purges.
+	R_FinishDrawing ();
 	R_GenerateComposite (tex);
+    }
 
     return texturecomposite[tex] + ofs;
 }
@@ -443,6 +459,327 @@ static void GenerateTextureHashTable(void)
 }
 
 
+#ifdef HAVE_MMAP
+
+//
+// Texture cache.
+// Compositing every multi-patch texture and building the column
+//  lookups is the bulk of R_InitTextures, and composites are built
+//  again whenever the zone purges them.  The results only depend on
+//  the WADs, so they are written to a file named after the WAD
+//  directory checksum and mapped read-only on later runs.  The
+//  mapped composites are never purged.
+//
+// Layout, all in native byte order:
+//  texcache_t header
+//  int width[numtextures], height[numtextures]
+//  int compositesize[numtextures], compositeofs[numtextures]
+//  short collump[sum of widths]
+//  unsigned short colofs[sum of widths]
+//  composite data
+//
+#define TEXCACHE_MAGIC 0x31435854	// "TXC1"
+
+typedef struct
+{
+    int			magic;
+    int			headersize;
+    sha1_digest_t	checksum;
+    int			numtextures;
+    int			totalwidth;
+    int			datasize;
+} texcache_t;
+
+static THREADLOCAL byte*	texcache = NULL;
+static THREADLOCAL size_t	texcachesize;
+
+static char *TextureCachePath(sha1_digest_t checksum)
+{
+    char	name[64];
+    int		i;
+
+    //!
+    // @arg <file>
+    // @category obscure
+    //
+    // Use the specified file as the texture cache.
+    //
+
+    i = M_CheckParmWithArgs("-texcache", 1);
+
+    if (i > 0)
+    {
+        return M_StringDuplicate(myargv[i + 1]);
+    }
+
+    M_StringCopy(name, "texcache-", sizeof(name));
+
+    for (i = 0; i < sizeof(sha1_digest_t); ++i)
+    {
+        M_snprintf(name + 9 + i * 2, sizeof(name) - 9 - i * 2,
+                   "%02x", checksum[i]);
+    }
+
+    M_StringConcat(name, ".bin", sizeof(name));
+
+    return M_StringJoin(configdir, DIR_SEPARATOR_S, name, NULL);
+}
+
+//
+// R_LoadTextureCache
+// Maps the cache file and points the column lookups and
+//  composites into it.  Returns false if there is no usable cache.
+//
+static boolean R_LoadTextureCache (char *path, sha1_digest_t checksum)
+{
+    texcache_t*		header;
+    struct stat		st;
+    byte*		data;
+    int*		width;
+    int*		height;
+    int*		compositesize;
+    int*		compositeofs;
+    short*		collump;
+    unsigned short*	colofs;
+    size_t		tablesize;
+    int			totalwidth;
+    int			handle;
+    int			i;
+
+    handle = open(path, O_RDONLY);
+
+    if (handle < 0)
+	return false;
+
+    if (fstat(handle, &st) < 0 || st.st_size < sizeof(texcache_t))
+    {
+	close(handle);
+	return false;
+    }
+
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, handle, 0);
+    close(handle);
+
+    if (data == MAP_FAILED)
+	return false;
+
+    header = (texcache_t *) data;
+    tablesize = (size_t) numtextures * 4 * sizeof(int)
+	      + (size_t) header->totalwidth
+		* (sizeof(*collump) + sizeof(*colofs));
+
+    if (header->magic != TEXCACHE_MAGIC
+     || header->headersize != sizeof(texcache_t)
+     || memcmp(header->checksum, checksum, sizeof(sha1_digest_t)) != 0
+     || header->numtextures != numtextures
+     || sizeof(texcache_t) + tablesize + header->datasize != st.st_size)
+    {
+	munmap(data, st.st_size);
+	return false;
+    }
+
+    width = (int *) (header + 1);
+    height = width + numtextures;
+    compositesize = height + numtextures;
+    compositeofs = compositesize + numtextures;
+    collump = (short *) (compositeofs + numtextures);
+    colofs = (unsigned short *) (collump + header->totalwidth);
+
+    // The checksum covers the WAD directory only; make sure the
+    //  texture definitions still agree before trusting the rest.
+    for (i=0, totalwidth=0 ; i<numtextures ; i++)
+    {
+	if (width[i] != textures[i]->width
+	 || height[i] != textures[i]->height
+	 || compositeofs[i] + compositesize[i] > header->datasize)
+	{
+	    break;
+	}
+
+	totalwidth += width[i];
+    }
+
+    if (i < numtextures || totalwidth != header->totalwidth)
+    {
+	munmap(data, st.st_size);
+	return false;
+    }
+
+    texcache = data;
+    texcachesize = st.st_size;
+    data = (byte *) (colofs + header->totalwidth);
+
+    for (i=0 ; i<numtextures ; i++)
+    {
+	Z_Free(texturecolumnlump[i]);
+	Z_Free(texturecolumnofs[i]);
+
+	// Composites generated while writing the cache are in the zone;
+	//  Z_Free clears the pointer, so a later purge can not.
+	if (texturecomposite[i] != NULL)
+	    Z_Free(texturecomposite[i]);
+
+	texturecolumnlump[i] = collump;
+	texturecolumnofs[i] = colofs;
+	texturecompositesize[i] = compositesize[i];
+	texturecomposite[i] = data + compositeofs[i];
+
+	collump += width[i];
+	colofs += width[i];
+    }
+
+    return true;
+}
+
+//
+// R_SaveTextureCache
+// Generates every composite and writes the cache.  The file is
+//  written under a temporary name and renamed, so that another
+//  instance never maps half a cache.
+//
+static void R_SaveTextureCache (char *path, sha1_digest_t checksum)
+{
+    texcache_t	header;
+    FILE*	handle;
+    char*	tmppath;
+    char	pid[16];
+    boolean	ok;
+    int		ofs;
+    int		i;
+
+    M_snprintf(pid, sizeof(pid), ".%d", (int) getpid());
+    tmppath = M_StringJoin(path, pid, NULL);
+    handle = fopen(tmppath, "wb");
+
+    if (handle == NULL)
+    {
+	free(tmppath);
+	return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = TEXCACHE_MAGIC;
+    header.headersize = sizeof(header);
+    memcpy(header.checksum, checksum, sizeof(sha1_digest_t));
+    header.numtextures = numtextures;
+
+    for (i=0 ; i<numtextures ; i++)
+    {
+	header.totalwidth += textures[i]->width;
+	header.datasize += texturecompositesize[i];
+    }
+
+    ok = fwrite(&header, sizeof(header), 1, handle) == 1;
+
+    for (i=0 ; i<numtextures ; i++)
+    {
+	int width = textures[i]->width;
+	ok = ok && fwrite(&width, sizeof(int), 1, handle) == 1;
+    }
+
+    for (i=0 ; i<numtextures ; i++)
+    {
+	int height = textures[i]->height;
+	ok = ok && fwrite(&height, sizeof(int), 1, handle) == 1;
+    }
+
+    ok = ok && fwrite(texturecompositesize, sizeof(int),
+		      numtextures, handle) == numtextures;
+
+    for (i=0, ofs=0 ; i<numtextures ; i++)
+    {
+	ok = ok && fwrite(&ofs, sizeof(int), 1, handle) == 1;
+	ofs += texturecompositesize[i];
+    }
+
+    for (i=0 ; i<numtextures ; i++)
+    {
+	ok = ok && fwrite(texturecolumnlump[i], sizeof(short),
+			  textures[i]->width, handle) == textures[i]->width;
+    }
+
+    for (i=0 ; i<numtextures ; i++)
+    {
+	ok = ok && fwrite(texturecolumnofs[i], sizeof(unsigned short),
+			  textures[i]->width, handle) == textures[i]->width;
+    }
+
+    // Each composite is written as soon as it is built; it is purgable
+    //  and the next one may well push it out of the zone.
+    for (i=0 ; ok && i<numtextures ; i++)
+    {
+	if (texturecompositesize[i] == 0)
+	    continue;
+
+	if (!texturecomposite[i])
+	    R_GenerateComposite (i);
+
+	ok = fwrite(texturecomposite[i], 1, texturecompositesize[i],
+		    handle) == texturecompositesize[i];
+    }
+
+    if (fclose(handle) != 0)
+	ok = false;
+
+    if (!ok || rename(tmppath, path) != 0)
+    {
+	fprintf(stderr, "R_SaveTextureCache: Unable to write %s\n", path);
+	remove(tmppath);
+    }
+
+    free(tmppath);
+}
+
+//
+// R_InitTextureCache
+// Fills in the column lookups and composites, from the cache if
+//  there is one.
+//
+static void R_InitTextureCache (void)
+{
+    sha1_digest_t	checksum;
+    char*		path;
+    int			i;
+
+    if (texcache != NULL)
+    {
+	munmap(texcache, texcachesize);
+	texcache = NULL;
+    }
+
+    //!
+    // @category obscure
+    //
+    // Don't use or write the texture cache.
+    //
+
+    if (M_CheckParm("-notexcache"))
+    {
+	for (i=0 ; i<numtextures ; i++)
+	    R_GenerateLookup (i);
+	return;
+    }
+
+    memset(texturecomposite, 0, numtextures * sizeof(*texturecomposite));
+
+    W_Checksum(checksum);
+    path = TextureCachePath(checksum);
+
+    if (!R_LoadTextureCache(path, checksum))
+    {
+	for (i=0 ; i<numtextures ; i++)
+	    R_GenerateLookup (i);
+
+	R_SaveTextureCache(path, checksum);
+	R_LoadTextureCache(path, checksum);
+    }
+
+    free(path);
+}
+
+#endif /* #ifdef HAVE_MMAP */
+
+
 //
 // R_InitTextures
 // Initializes the texture list
@@ -613,8 +950,12 @@ void R_InitTextures (void)
     
     // Precalculate whatever possible.	
 
+#ifdef HAVE_MMAP
+    R_InitTextureCache ();
+#else
     for (i=0 ; i<numtextures ; i++)
 	R_GenerateLookup (i);
+#endif
     
     // Create translation table for global animation.
     texturetranslation = Z_Malloc ((numtextures+1)*sizeof(*texturetranslation), PU_STATIC, 0);
@@ -793,9 +1134,9 @@ int	R_TextureNumForName (char* name)
 // R_PrecacheLevel
 // Preloads all relevant graphics for the level.
 //
-int		flatmemory;
-int		texturememory;
-int		spritememory;
+THREADLOCAL int		flatmemory;
+THREADLOCAL int		texturememory;
+THREADLOCAL int		spritememory;
 
 void R_PrecacheLevel (void)
 {
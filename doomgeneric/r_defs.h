@@ -127,6 +127,10 @@ typedef	struct
 
     int			linecount;
     struct line_s**	lines;	// [linecount] size
+
+    // Heights when the tic started, for drawing in between tics.
+    fixed_t	oldfloorheight;
+    fixed_t	oldceilingheight;
     
 } sector_t;
 
@@ -430,15 +434,17 @@ typedef struct
   
   // leave pads for [minx-1]/[maxx+1]
   
-  byte		pad1;
+  unsigned short	pad1;
   // Here lies the rub for all
   //  dynamic resize/change of resolution.
-  byte		top[SCREENWIDTH];
-  byte		pad2;
-  byte		pad3;
+  // Rows are shorts as the screen can be taller than 255 pixels;
+  //  0xffff marks an unused column.
+  unsigned short	top[SCREENWIDTH];
+  unsigned short	pad2;
+  unsigned short	pad3;
   // See above.
-  byte		bottom[SCREENWIDTH];
-  byte		pad4;
+  unsigned short	bottom[SCREENWIDTH];
+  unsigned short	pad4;
 
 } visplane_t;
 
@@ -21,10 +21,18 @@
 
 
 
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef DOOMGENERIC_RENDER_THREADS
+#include <pthread.h>
+#endif
+
 #include "doomdef.h"
 #include "deh_main.h"
 
 #include "i_system.h"
+#include "m_argv.h"
 #include "z_zone.h"
 #include "w_wad.h"
 
@@ -38,11 +46,11 @@
 
 
 // ?
-#define MAXWIDTH			1120
-#define MAXHEIGHT			832
+#define MAXWIDTH			SCREENWIDTH
+#define MAXHEIGHT			SCREENHEIGHT
 
 // status bar height at bottom of screen
-#define SBARHEIGHT		32
+#define SBARHEIGHT		(32 * SCREENSCALE)
 
 //
 // All drawing to the view buffer is accomplished in this file.
@@ -54,43 +62,43 @@
 //
 
 
-byte*		viewimage; 
-int		viewwidth;
-int		scaledviewwidth;
-int		viewheight;
-int		viewwindowx;
-int		viewwindowy; 
-byte*		ylookup[MAXHEIGHT]; 
-int		columnofs[MAXWIDTH]; 
+THREADLOCAL byte*		viewimage; 
+THREADLOCAL int		viewwidth;
+THREADLOCAL int		scaledviewwidth;
+THREADLOCAL int		viewheight;
+THREADLOCAL int		viewwindowx;
+THREADLOCAL int		viewwindowy; 
+THREADLOCAL byte*		ylookup[MAXHEIGHT]; 
+THREADLOCAL int		columnofs[MAXWIDTH]; 
 
 // Color tables for different players,
 //  translate a limited part to another
 //  (color ramps used for  suit colors).
 //
-byte		translations[3][256];	
+THREADLOCAL byte		translations[3][256];	
  
 // Backing buffer containing the bezel drawn around the screen and 
 // surrounding background.
 
-static byte *background_buffer = NULL;
+static THREADLOCAL byte *background_buffer = NULL;
 
 
 //
 // R_DrawColumn
 // Source is the top of the column to scale.
 //
-lighttable_t*		dc_colormap; 
-int			dc_x; 
-int			dc_yl; 
-int			dc_yh; 
-fixed_t			dc_iscale; 
-fixed_t			dc_texturemid;
+DRAWLOCAL lighttable_t*		dc_colormap; 
+DRAWLOCAL int			dc_x; 
+DRAWLOCAL int			dc_yl; 
+DRAWLOCAL int			dc_yh; 
+DRAWLOCAL fixed_t			dc_iscale; 
+DRAWLOCAL fixed_t			dc_texturemid;
 
 // first pixel in a column (possibly virtual) 
-byte*			dc_source;		
+DRAWLOCAL byte*			dc_source;		
 
 // just for profiling 
-int			dccount;
+DRAWLOCAL int			dccount;
 
 //
 // A column is a vertical slice/span from a wall texture that,
@@ -258,7 +266,7 @@ void R_DrawColumnLow (void)
 #define FUZZOFF	(SCREENWIDTH)
 
 
-int	fuzzoffset[FUZZTABLE] =
+THREADLOCAL int	fuzzoffset[FUZZTABLE] =
 {
     FUZZOFF,-FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,
     FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,
@@ -269,7 +277,7 @@ int	fuzzoffset[FUZZTABLE] =
     FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF 
 }; 
 
-int	fuzzpos = 0; 
+DRAWLOCAL int	fuzzpos = 0; 
 
 
 //
@@ -418,8 +426,8 @@ void R_DrawFuzzColumnLow (void)
 //  of the BaronOfHell, the HellKnight, uses
 //  identical sprites, kinda brightened up.
 //
-byte*	dc_translation;
-byte*	translationtables;
+DRAWLOCAL byte*	dc_translation;
+THREADLOCAL byte*	translationtables;
 
 void R_DrawTranslatedColumn (void) 
 { 
@@ -567,22 +575,22 @@ void R_InitTranslationTables (void)
 // In consequence, flats are not stored by column (like walls),
 //  and the inner loop has to step in texture space u and v.
 //
-int			ds_y; 
-int			ds_x1; 
-int			ds_x2;
+DRAWLOCAL int			ds_y; 
+DRAWLOCAL int			ds_x1; 
+DRAWLOCAL int			ds_x2;
 
-lighttable_t*		ds_colormap; 
+DRAWLOCAL lighttable_t*		ds_colormap; 
 
-fixed_t			ds_xfrac; 
-fixed_t			ds_yfrac; 
-fixed_t			ds_xstep; 
-fixed_t			ds_ystep;
+DRAWLOCAL fixed_t			ds_xfrac; 
+DRAWLOCAL fixed_t			ds_yfrac; 
+DRAWLOCAL fixed_t			ds_xstep; 
+DRAWLOCAL fixed_t			ds_ystep;
 
 // start of a 64*64 tile image 
-byte*			ds_source;	
+DRAWLOCAL byte*			ds_source;	
 
 // just for profiling
-int			dscount;
+DRAWLOCAL int			dscount;
 
 
 //
@@ -815,6 +823,7 @@ void R_FillBackScreen (void)
     byte*	dest; 
     int		x;
     int		y; 
+    int		viewx, viewy, vieww, viewh;
     patch_t*	patch;
 
     // DOOM border patch.
@@ -855,57 +864,57 @@ void R_FillBackScreen (void)
     src = W_CacheLumpName(name, PU_CACHE); 
     dest = background_buffer;
 	 
+    // The flat is scaled up like the rest of the screen.
     for (y=0 ; y<SCREENHEIGHT-SBARHEIGHT ; y++) 
     { 
-	for (x=0 ; x<SCREENWIDTH/64 ; x++) 
+	for (x=0 ; x<SCREENWIDTH ; x++) 
 	{ 
-	    memcpy (dest, src+((y&63)<<6), 64); 
-	    dest += 64; 
-	} 
-
-	if (SCREENWIDTH&63) 
-	{ 
-	    memcpy (dest, src+((y&63)<<6), SCREENWIDTH&63); 
-	    dest += (SCREENWIDTH&63); 
+	    *dest++ = src[(((y/SCREENSCALE)&63)<<6) + ((x/SCREENSCALE)&63)];
 	} 
     } 
      
     // Draw screen and bezel; this is done to a separate screen buffer.
+    // The patches are placed in original screen coordinates.
 
     V_UseBuffer(background_buffer);
 
+    viewx = viewwindowx / SCREENSCALE;
+    viewy = viewwindowy / SCREENSCALE;
+    vieww = scaledviewwidth / SCREENSCALE;
+    viewh = viewheight / SCREENSCALE;
+
     patch = W_CacheLumpName(DEH_String("brdr_t"),PU_CACHE);
 
-    for (x=0 ; x<scaledviewwidth ; x+=8)
-	V_DrawPatch(viewwindowx+x, viewwindowy-8, patch);
+    for (x=0 ; x<vieww ; x+=8)
+	V_DrawPatch(viewx+x, viewy-8, patch);
     patch = W_CacheLumpName(DEH_String("brdr_b"),PU_CACHE);
 
-    for (x=0 ; x<scaledviewwidth ; x+=8)
-	V_DrawPatch(viewwindowx+x, viewwindowy+viewheight, patch);
+    for (x=0 ; x<vieww ; x+=8)
+	V_DrawPatch(viewx+x, viewy+viewh, patch);
     patch = W_CacheLumpName(DEH_String("brdr_l"),PU_CACHE);
 
-    for (y=0 ; y<viewheight ; y+=8)
-	V_DrawPatch(viewwindowx-8, viewwindowy+y, patch);
+    for (y=0 ; y<viewh ; y+=8)
+	V_DrawPatch(viewx-8, viewy+y, patch);
     patch = W_CacheLumpName(DEH_String("brdr_r"),PU_CACHE);
 
-    for (y=0 ; y<viewheight ; y+=8)
-	V_DrawPatch(viewwindowx+scaledviewwidth, viewwindowy+y, patch);
+    for (y=0 ; y<viewh ; y+=8)
+	V_DrawPatch(viewx+vieww, viewy+y, patch);
 
     // Draw beveled edge. 
-    V_DrawPatch(viewwindowx-8,
-                viewwindowy-8,
+    V_DrawPatch(viewx-8,
+                viewy-8,
                 W_CacheLumpName(DEH_String("brdr_tl"),PU_CACHE));
     
-    V_DrawPatch(viewwindowx+scaledviewwidth,
-                viewwindowy-8,
+    V_DrawPatch(viewx+vieww,
+                viewy-8,
                 W_CacheLumpName(DEH_String("brdr_tr"),PU_CACHE));
     
-    V_DrawPatch(viewwindowx-8,
-                viewwindowy+viewheight,
+    V_DrawPatch(viewx-8,
+                viewy+viewh,
                 W_CacheLumpName(DEH_String("brdr_bl"),PU_CACHE));
     
-    V_DrawPatch(viewwindowx+scaledviewwidth,
-                viewwindowy+viewheight,
+    V_DrawPatch(viewx+vieww,
+                viewy+viewh,
                 W_CacheLumpName(DEH_String("brdr_br"),PU_CACHE));
 
     V_RestoreBuffer();
@@ -973,3 +982,505 @@ void R_DrawViewBorder (void)
 } 
  
  
+
+
+
+//
+// MULTITHREADED DRAWING
+//
+// With DOOMGENERIC_RENDER_THREADS and -drawthreads, the view is split
+// into vertical strips, one per draw thread.  While the BSP is walked,
+// colfunc and spanfunc only record what they would have drawn into the
+// queue of every strip they touch; R_FinishDrawing then has the threads
+// draw their strips in parallel.
+//
+// The walk itself stays on one thread: how walls, spans and the fuzz
+// effect step across the screen depends on where they were clipped,
+// so the output would not match the single threaded renderer if every
+// strip did its own clipping.  Each pixel belongs to exactly one strip
+// and its strip draws it in the original order, so the result is
+// identical to drawing directly.
+//
+
+#ifdef DOOMGENERIC_RENDER_THREADS
+
+#define MAXDRAWTHREADS		16
+
+typedef struct
+{
+    int			x;
+    int			yl;
+    int			yh;
+    fixed_t		iscale;
+    fixed_t		texturemid;
+    byte*		source;
+    lighttable_t*	colormap;
+    byte*		translation;
+    int			fuzzpos;
+} drawcolumn_t;
+
+typedef struct
+{
+    int			y;
+    int			x1;
+    int			x2;
+    fixed_t		xfrac;
+    fixed_t		yfrac;
+    fixed_t		xstep;
+    fixed_t		ystep;
+    byte*		source;
+    lighttable_t*	colormap;
+} drawspan_t;
+
+typedef struct
+{
+    void		(*func) (void);
+    boolean		isspan;
+
+    union
+    {
+	drawcolumn_t	column;
+	drawspan_t	span;
+    } u;
+} drawcmd_t;
+
+typedef struct drawpool_s drawpool_t;
+
+typedef struct
+{
+    drawpool_t*		pool;
+
+    // Columns x1 to x2 of the view, in detail units.
+    int			x1;
+    int			x2;
+
+    drawcmd_t*		cmds;
+    int			numcmds;
+    int			maxcmds;
+} drawstrip_t;
+
+struct drawpool_s
+{
+    pthread_mutex_t	lock;
+    pthread_cond_t	start;
+    pthread_cond_t	done;
+
+    // Bumped to start the threads on a new batch.
+    int			batch;
+
+    // Threads still drawing the current batch.
+    int			busy;
+
+    drawstrip_t		strips[MAXDRAWTHREADS];
+    int			numstrips;
+
+#ifdef DOOMGENERIC_REENTRANT
+    // The drawers' lookup tables belong to the instance that owns
+    // the pool, so the threads copy them before every batch.
+    byte**		ylookup;
+    int*		columnofs;
+    int			centery;
+    int			viewheight;
+    lighttable_t*	colormaps;
+#endif
+};
+
+static THREADLOCAL drawpool_t *drawpool = NULL;
+
+// Strip that each view column is drawn by.
+static THREADLOCAL byte stripforcolumn[MAXWIDTH];
+
+//
+// R_DrawStrip
+// Runs the queued columns and spans of one strip.
+//
+static void R_DrawStrip (drawstrip_t* strip)
+{
+    drawcmd_t*	cmd;
+    int		i;
+
+#ifdef DOOMGENERIC_REENTRANT
+    drawpool_t*	pool = strip->pool;
+
+    memcpy(ylookup, pool->ylookup, sizeof(ylookup));
+    memcpy(columnofs, pool->columnofs, sizeof(columnofs));
+    centery = pool->centery;
+    viewheight = pool->viewheight;
+    colormaps = pool->colormaps;
+#endif
+
+    for (i=0 ; i<strip->numcmds ; i++)
+    {
+	cmd = &strip->cmds[i];
+
+	if (cmd->isspan)
+	{
+	    ds_y = cmd->u.span.y;
+	    ds_x1 = cmd->u.span.x1;
+	    ds_x2 = cmd->u.span.x2;
+	    ds_xfrac = cmd->u.span.xfrac;
+	    ds_yfrac = cmd->u.span.yfrac;
+	    ds_xstep = cmd->u.span.xstep;
+	    ds_ystep = cmd->u.span.ystep;
+	    ds_source = cmd->u.span.source;
+	    ds_colormap = cmd->u.span.colormap;
+	}
+	else
+	{
+	    dc_x = cmd->u.column.x;
+	    dc_yl = cmd->u.column.yl;
+	    dc_yh = cmd->u.column.yh;
+	    dc_iscale = cmd->u.column.iscale;
+	    dc_texturemid = cmd->u.column.texturemid;
+	    dc_source = cmd->u.column.source;
+	    dc_colormap = cmd->u.column.colormap;
+	    dc_translation = cmd->u.column.translation;
+	    fuzzpos = cmd->u.column.fuzzpos;
+	}
+
+	cmd->func ();
+    }
+}
+
+static void *R_DrawThread (void *arg)
+{
+    drawstrip_t*	strip = arg;
+    drawpool_t*		pool = strip->pool;
+    int			batch = 0;
+
+    for (;;)
+    {
+	pthread_mutex_lock(&pool->lock);
+
+	while (pool->batch == batch)
+	{
+	    pthread_cond_wait(&pool->start, &pool->lock);
+	}
+
+	batch = pool->batch;
+	pthread_mutex_unlock(&pool->lock);
+
+	R_DrawStrip (strip);
+
+	pthread_mutex_lock(&pool->lock);
+
+	if (--pool->busy == 0)
+	{
+	    pthread_cond_signal(&pool->done);
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+    }
+
+    return NULL;
+}
+
+static drawcmd_t *R_NewDrawCmd (drawstrip_t* strip)
+{
+    if (strip->numcmds == strip->maxcmds)
+    {
+	strip->maxcmds = strip->maxcmds ? strip->maxcmds * 2 : 1024;
+	strip->cmds = realloc(strip->cmds,
+			      strip->maxcmds * sizeof(*strip->cmds));
+
+	if (strip->cmds == NULL)
+	{
+	    I_Error ("R_NewDrawCmd: out of memory");
+	}
+    }
+
+    return &strip->cmds[strip->numcmds++];
+}
+
+static void R_QueueColumn (void (*func) (void))
+{
+    drawcmd_t*	cmd;
+
+    cmd = R_NewDrawCmd (&drawpool->strips[stripforcolumn[dc_x]]);
+    cmd->func = func;
+    cmd->isspan = false;
+    cmd->u.column.x = dc_x;
+    cmd->u.column.yl = dc_yl;
+    cmd->u.column.yh = dc_yh;
+    cmd->u.column.iscale = dc_iscale;
+    cmd->u.column.texturemid = dc_texturemid;
+    cmd->u.column.source = dc_source;
+    cmd->u.column.colormap = dc_colormap;
+    cmd->u.column.translation = dc_translation;
+    cmd->u.column.fuzzpos = fuzzpos;
+}
+
+//
+// R_QueueSpan
+// A span is cut at the strip edges.  The drawers step the packed
+// position, so each piece gets the packed position the whole span
+// would have had at its first pixel.
+//
+static void R_QueueSpan (void (*func) (void))
+{
+    drawcmd_t*		cmd;
+    drawstrip_t*	strip;
+    unsigned int	position;
+    unsigned int	step;
+    unsigned int	piece;
+    int			i;
+
+    position = ((ds_xfrac << 10) & 0xffff0000)
+             | ((ds_yfrac >> 6)  & 0x0000ffff);
+    step = ((ds_xstep << 10) & 0xffff0000)
+         | ((ds_ystep >> 6)  & 0x0000ffff);
+
+    for (i=stripforcolumn[ds_x1] ; i<=stripforcolumn[ds_x2] ; i++)
+    {
+	strip = &drawpool->strips[i];
+
+	cmd = R_NewDrawCmd (strip);
+	cmd->func = func;
+	cmd->isspan = true;
+	cmd->u.span.y = ds_y;
+	cmd->u.span.x1 = ds_x1 > strip->x1 ? ds_x1 : strip->x1;
+	cmd->u.span.x2 = ds_x2 < strip->x2 ? ds_x2 : strip->x2;
+	cmd->u.span.xstep = ds_xstep;
+	cmd->u.span.ystep = ds_ystep;
+	cmd->u.span.source = ds_source;
+	cmd->u.span.colormap = ds_colormap;
+
+	if (cmd->u.span.x1 == ds_x1)
+	{
+	    cmd->u.span.xfrac = ds_xfrac;
+	    cmd->u.span.yfrac = ds_yfrac;
+	}
+	else
+	{
+	    piece = position + step * (cmd->u.span.x1 - ds_x1);
+	    cmd->u.span.xfrac = (piece >> 16) << 6;
+	    cmd->u.span.yfrac = (piece & 0xffff) << 6;
+	}
+    }
+}
+
+//
+// R_SkipFuzz
+// Advances fuzzpos past a queued fuzz column, as drawing it would.
+//
+static void R_SkipFuzz (void)
+{
+    int		count;
+
+    if (!dc_yl)
+	dc_yl = 1;
+
+    if (dc_yh == viewheight-1)
+	dc_yh = viewheight - 2;
+
+    count = dc_yh - dc_yl;
+
+    if (count >= 0)
+	fuzzpos = (fuzzpos + count + 1) % FUZZTABLE;
+}
+
+static void R_QueueDrawColumn (void)
+{
+    R_QueueColumn (R_DrawColumn);
+}
+
+static void R_QueueDrawColumnLow (void)
+{
+    R_QueueColumn (R_DrawColumnLow);
+}
+
+static void R_QueueDrawFuzzColumn (void)
+{
+    R_QueueColumn (R_DrawFuzzColumn);
+    R_SkipFuzz ();
+}
+
+static void R_QueueDrawFuzzColumnLow (void)
+{
+    R_QueueColumn (R_DrawFuzzColumnLow);
+    R_SkipFuzz ();
+}
+
+static void R_QueueDrawTranslatedColumn (void)
+{
+    R_QueueColumn (R_DrawTranslatedColumn);
+}
+
+static void R_QueueDrawTranslatedColumnLow (void)
+{
+    R_QueueColumn (R_DrawTranslatedColumnLow);
+}
+
+static void R_QueueDrawSpan (void)
+{
+    R_QueueSpan (R_DrawSpan);
+}
+
+static void R_QueueDrawSpanLow (void)
+{
+    R_QueueSpan (R_DrawSpanLow);
+}
+
+#endif
+
+
+//
+// R_InitDrawThreads
+//
+void R_InitDrawThreads (void)
+{
+#ifdef DOOMGENERIC_RENDER_THREADS
+    pthread_t	thread;
+    int		numthreads;
+    int		i;
+    int		p;
+
+    //!
+    // @arg <n>
+    //
+    // Draw the view with n threads.
+    //
+
+    p = M_CheckParmWithArgs("-drawthreads", 1);
+
+    if (p <= 0)
+	return;
+
+    numthreads = atoi(myargv[p+1]);
+
+    if (numthreads <= 1)
+	return;
+
+    if (numthreads > MAXDRAWTHREADS)
+	numthreads = MAXDRAWTHREADS;
+
+    drawpool = calloc(1, sizeof(*drawpool));
+
+    if (drawpool == NULL)
+    {
+	I_Error ("R_InitDrawThreads: out of memory");
+    }
+
+    pthread_mutex_init(&drawpool->lock, NULL);
+    pthread_cond_init(&drawpool->start, NULL);
+    pthread_cond_init(&drawpool->done, NULL);
+    drawpool->numstrips = numthreads;
+
+    for (i=0 ; i<numthreads ; i++)
+    {
+	drawpool->strips[i].pool = drawpool;
+
+	if (pthread_create(&thread, NULL, R_DrawThread,
+			   &drawpool->strips[i]) != 0)
+	{
+	    I_Error ("R_InitDrawThreads: failed to start thread");
+	}
+
+	pthread_detach(thread);
+    }
+#endif
+}
+
+
+//
+// R_InitDrawStrips
+// Called after a view size change.  Cuts the view into strips and
+// points the drawing functions at the queues.
+//
+void R_InitDrawStrips (void)
+{
+#ifdef DOOMGENERIC_RENDER_THREADS
+    drawstrip_t*	strip;
+    int			i;
+    int			x;
+
+    if (drawpool == NULL)
+	return;
+
+    for (i=0 ; i<drawpool->numstrips ; i++)
+    {
+	strip = &drawpool->strips[i];
+	strip->x1 = viewwidth * i / drawpool->numstrips;
+	strip->x2 = viewwidth * (i+1) / drawpool->numstrips - 1;
+
+	for (x=strip->x1 ; x<=strip->x2 ; x++)
+	    stripforcolumn[x] = i;
+    }
+
+    if (!detailshift)
+    {
+	colfunc = basecolfunc = R_QueueDrawColumn;
+	fuzzcolfunc = R_QueueDrawFuzzColumn;
+	transcolfunc = R_QueueDrawTranslatedColumn;
+	spanfunc = R_QueueDrawSpan;
+    }
+    else
+    {
+	colfunc = basecolfunc = R_QueueDrawColumnLow;
+	fuzzcolfunc = R_QueueDrawFuzzColumnLow;
+	transcolfunc = R_QueueDrawTranslatedColumnLow;
+	spanfunc = R_QueueDrawSpanLow;
+    }
+#endif
+}
+
+
+//
+// R_FinishDrawing
+// Draws everything queued so far, and waits until it is done.
+//
+void R_FinishDrawing (void)
+{
+#ifdef DOOMGENERIC_RENDER_THREADS
+    int		i;
+
+    if (drawpool == NULL)
+	return;
+
+#ifdef DOOMGENERIC_REENTRANT
+    drawpool->ylookup = ylookup;
+    drawpool->columnofs = columnofs;
+    drawpool->centery = centery;
+    drawpool->viewheight = viewheight;
+    drawpool->colormaps = colormaps;
+#endif
+
+    pthread_mutex_lock(&drawpool->lock);
+
+    drawpool->busy = drawpool->numstrips;
+    drawpool->batch++;
+    pthread_cond_broadcast(&drawpool->start);
+
+    while (drawpool->busy > 0)
+    {
+	pthread_cond_wait(&drawpool->done, &drawpool->lock);
+    }
+
+    pthread_mutex_unlock(&drawpool->lock);
+
+    for (i=0 ; i<drawpool->numstrips ; i++)
+	drawpool->strips[i].numcmds = 0;
+#endif
+}
+
+
+//
+// R_CacheDrawLump
+// W_CacheLumpNum for lumps that the drawers read from.  Queued columns
+// and spans may point into lumps that loading another lump purges, so
+// they are drawn first.
+//
+void *R_CacheDrawLump (int lump, int tag)
+{
+#ifdef DOOMGENERIC_RENDER_THREADS
+    if (drawpool != NULL
+     && (unsigned) lump < numlumps
+     && lumpinfo[lump].cache == NULL
+     && lumpinfo[lump].wad_file->mapped == NULL)
+    {
+	R_FinishDrawing ();
+    }
+#endif
+
+    return W_CacheLumpNum(lump, tag);
+}
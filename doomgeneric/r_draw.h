@@ -23,15 +23,15 @@
 
 
 
-extern lighttable_t*	dc_colormap;
-extern int		dc_x;
-extern int		dc_yl;
-extern int		dc_yh;
-extern fixed_t		dc_iscale;
-extern fixed_t		dc_texturemid;
+extern DRAWLOCAL lighttable_t*	dc_colormap;
+extern DRAWLOCAL int		dc_x;
+extern DRAWLOCAL int		dc_yl;
+extern DRAWLOCAL int		dc_yh;
+extern DRAWLOCAL fixed_t		dc_iscale;
+extern DRAWLOCAL fixed_t		dc_texturemid;
 
 // first pixel in a column
-extern byte*		dc_source;		
+extern DRAWLOCAL byte*		dc_source;		
 
 
 // The span blitting interface.
@@ -55,22 +55,22 @@ R_VideoErase
 ( unsigned	ofs,
   int		count );
 
-extern int		ds_y;
-extern int		ds_x1;
-extern int		ds_x2;
+extern DRAWLOCAL int		ds_y;
+extern DRAWLOCAL int		ds_x1;
+extern DRAWLOCAL int		ds_x2;
 
-extern lighttable_t*	ds_colormap;
+extern DRAWLOCAL lighttable_t*	ds_colormap;
 
-extern fixed_t		ds_xfrac;
-extern fixed_t		ds_yfrac;
-extern fixed_t		ds_xstep;
-extern fixed_t		ds_ystep;
+extern DRAWLOCAL fixed_t		ds_xfrac;
+extern DRAWLOCAL fixed_t		ds_yfrac;
+extern DRAWLOCAL fixed_t		ds_xstep;
+extern DRAWLOCAL fixed_t		ds_ystep;
 
 // start of a 64*64 tile image
-extern byte*		ds_source;		
+extern DRAWLOCAL byte*		ds_source;		
 
-extern byte*		translationtables;
-extern byte*		dc_translation;
+extern THREADLOCAL byte*		translationtables;
+extern DRAWLOCAL byte*		dc_translation;
 
 
 // Span blitting for rows, floor/ceiling.
@@ -93,6 +93,12 @@ void	R_InitTranslationTables (void);
 
 
 
+// Multithreaded drawing.
+void	R_InitDrawThreads (void);
+void	R_InitDrawStrips (void);
+void	R_FinishDrawing (void);
+void*	R_CacheDrawLump (int lump, int tag);
+
 // Rendering function.
 void R_FillBackScreen (void);
 
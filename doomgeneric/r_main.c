@@ -27,11 +27,17 @@
 
 
 #include "doomdef.h"
+#include "doomstat.h"
 #include "d_loop.h"
+#include "z_zone.h"
 
 #include "m_bbox.h"
+#include "m_bench.h"
 #include "m_menu.h"
+#include "m_trace.h"
 
+#include "p_local.h"
+#include "p_tick.h"
 #include "r_local.h"
 #include "r_sky.h"
 
@@ -44,73 +50,79 @@
 
 
 
-int			viewangleoffset;
+THREADLOCAL int			viewangleoffset;
 
 // increment every time a check is made
-int			validcount = 1;		
+THREADLOCAL int			validcount = 1;		
 
+THREADLOCAL fixed_t		fractionaltic = FRACUNIT;
 
-lighttable_t*		fixedcolormap;
-extern lighttable_t**	walllights;
+// What the view interpolation replaced, to put back afterwards.
+static THREADLOCAL fixed_t*	interpsaved;
+static THREADLOCAL int		interpsavedsize;
 
-int			centerx;
-int			centery;
 
-fixed_t			centerxfrac;
-fixed_t			centeryfrac;
-fixed_t			projection;
+THREADLOCAL lighttable_t*		fixedcolormap;
+extern THREADLOCAL lighttable_t**	walllights;
+
+THREADLOCAL int			centerx;
+THREADLOCAL int			centery;
+
+THREADLOCAL fixed_t			centerxfrac;
+THREADLOCAL fixed_t			centeryfrac;
+THREADLOCAL fixed_t			projection;
 
 // just for profiling purposes
-int			framecount;	
+THREADLOCAL int			framecount;	
 
-int			sscount;
-int			linecount;
-int			loopcount;
+THREADLOCAL int			sscount;
+THREADLOCAL int			linecount;
+THREADLOCAL int			loopcount;
 
-fixed_t			viewx;
-fixed_t			viewy;
-fixed_t			viewz;
+THREADLOCAL fixed_t			viewx;
+THREADLOCAL fixed_t			viewy;
+THREADLOCAL fixed_t			viewz;
 
-angle_t			viewangle;
+THREADLOCAL angle_t			viewangle;
 
-fixed_t			viewcos;
-fixed_t			viewsin;
+THREADLOCAL fixed_t			viewcos;
+THREADLOCAL fixed_t			viewsin;
 
-player_t*		viewplayer;
+THREADLOCAL player_t*		viewplayer;
 
 // 0 = high, 1 = low
-int			detailshift;	
+THREADLOCAL int			detailshift;	
 
 //
 // precalculated math tables
 //
-angle_t			clipangle;
+THREADLOCAL angle_t			clipangle;
 
 // The viewangletox[viewangle + FINEANGLES/4] lookup
 // maps the visible view angles to screen X coordinates,
 // flattening the arc to a flat projection plane.
 // There will be many angles mapped to the same X. 
-int			viewangletox[FINEANGLES/2];
+THREADLOCAL int			viewangletox[FINEANGLES/2];
 
 // The xtoviewangleangle[] table maps a screen pixel
 // to the lowest viewangle that maps back to x ranges
 // from clipangle to -clipangle.
-angle_t			xtoviewangle[SCREENWIDTH+1];
+THREADLOCAL angle_t			xtoviewangle[SCREENWIDTH+1];
 
-lighttable_t*		scalelight[LIGHTLEVELS][MAXLIGHTSCALE];
-lighttable_t*		scalelightfixed[MAXLIGHTSCALE];
-lighttable_t*		zlight[LIGHTLEVELS][MAXLIGHTZ];
+THREADLOCAL lighttable_t*		scalelight[LIGHTLEVELS][MAXLIGHTSCALE];
+THREADLOCAL lighttable_t*		scalelightfixed[MAXLIGHTSCALE];
+THREADLOCAL lighttable_t*		zlight[LIGHTLEVELS][MAXLIGHTZ];
 
 // bumped light from gun blasts
-int			extralight;			
+THREADLOCAL int			extralight;			
 
 
 
-void (*colfunc) (void);
-void (*basecolfunc) (void);
-void (*fuzzcolfunc) (void);
-void (*transcolfunc) (void);
-void (*spanfunc) (void);
+THREADLOCAL void (*colfunc) (void);
+THREADLOCAL void (*basecolfunc) (void);
+THREADLOCAL void (*fuzzcolfunc) (void);
+THREADLOCAL void (*transcolfunc) (void);
+THREADLOCAL void (*spanfunc) (void);
 
 
 
@@ -622,7 +634,7 @@ void R_InitLightTables (void)
 	startmap = ((LIGHTLEVELS-1-i)*2)*NUMCOLORMAPS/LIGHTLEVELS;
 	for (j=0 ; j<MAXLIGHTZ ; j++)
 	{
-	    scale = FixedDiv ((SCREENWIDTH/2*FRACUNIT), (j+1)<<LIGHTZSHIFT);
+	    scale = FixedDiv ((ORIGWIDTH/2*FRACUNIT), (j+1)<<LIGHTZSHIFT);
 	    scale >>= LIGHTSCALESHIFT;
 	    level = startmap - scale/DISTMAP;
 	    
@@ -645,9 +657,9 @@ void R_InitLightTables (void)
 //  because it might be in the middle of a refresh.
 // The change will take effect next refresh.
 //
-boolean		setsizeneeded;
-int		setblocks;
-int		setdetail;
+THREADLOCAL boolean		setsizeneeded;
+THREADLOCAL int		setblocks;
+THREADLOCAL int		setdetail;
 
 
 void
@@ -682,8 +694,8 @@ void R_ExecuteSetViewSize (void)
     }
     else
     {
-	scaledviewwidth = setblocks*32;
-	viewheight = (setblocks*168/10)&~7;
+	scaledviewwidth = setblocks*32*SCREENSCALE;
+	viewheight = ((setblocks*168/10)&~7)*SCREENSCALE;
     }
     
     detailshift = setdetail;
@@ -710,13 +722,15 @@ void R_ExecuteSetViewSize (void)
 	spanfunc = R_DrawSpanLow;
     }
 
+    R_InitDrawStrips ();
+
     R_InitBuffer (scaledviewwidth, viewheight);
 	
     R_InitTextureMapping ();
     
     // psprite scales
-    pspritescale = FRACUNIT*viewwidth/SCREENWIDTH;
-    pspriteiscale = FRACUNIT*SCREENWIDTH/viewwidth;
+    pspritescale = FRACUNIT*viewwidth/ORIGWIDTH;
+    pspriteiscale = FRACUNIT*ORIGWIDTH/viewwidth;
     
     // thing clipping
     for (i=0 ; i<viewwidth ; i++)
@@ -738,6 +752,8 @@ void R_ExecuteSetViewSize (void)
     
     // Calculate the light levels to use
     //  for each level / scale combination.
+    // Scales are SCREENSCALE times larger than on the original screen,
+    //  so the users divide their index by it.
     for (i=0 ; i< LIGHTLEVELS ; i++)
     {
 	startmap = ((LIGHTLEVELS-1-i)*2)*NUMCOLORMAPS/LIGHTLEVELS;
@@ -781,6 +797,7 @@ void R_Init (void)
     printf (".");
     R_InitSkyMap ();
     R_InitTranslationTables ();
+    R_InitDrawThreads ();
     printf (".");
 	
     framecount = 0;
@@ -860,8 +877,124 @@ void R_SetupFrame (player_t* player)
 //
 // R_RenderView
 //
+//
+// R_InterpolateView
+// Move things, sector heights and view heights to where they are
+// fractionaltic of the way through the tic, saving where they really
+// are for R_RestoreView.
+//
+static fixed_t R_Interpolate (fixed_t old, fixed_t cur)
+{
+    return old + FixedMul(cur - old, fractionaltic);
+}
+
+static void R_InterpolateView (void)
+{
+    thinker_t*	th;
+    mobj_t*	mo;
+    sector_t*	sec;
+    fixed_t*	saved;
+    int		count;
+    int		i;
+
+    count = numsectors * 2 + MAXPLAYERS;
+
+    for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
+	if (th->function.acp1 == (actionf_p1) P_MobjThinker)
+	    count += 4;
+
+    if (count > interpsavedsize)
+    {
+	if (interpsaved != NULL)
+	    Z_Free (interpsaved);
+
+	interpsavedsize = count * 2;
+	interpsaved = Z_Malloc (interpsavedsize * sizeof(*interpsaved),
+				PU_STATIC, NULL);
+    }
+
+    saved = interpsaved;
+
+    for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
+    {
+	if (th->function.acp1 != (actionf_p1) P_MobjThinker)
+	    continue;
+
+	mo = (mobj_t *) th;
+	*saved++ = mo->x;
+	*saved++ = mo->y;
+	*saved++ = mo->z;
+	*saved++ = mo->angle;
+	mo->x = R_Interpolate (mo->oldx, mo->x);
+	mo->y = R_Interpolate (mo->oldy, mo->y);
+	mo->z = R_Interpolate (mo->oldz, mo->z);
+	mo->angle = mo->oldangle
+	          + FixedMul((int) (mo->angle - mo->oldangle), fractionaltic);
+    }
+
+    for (i=0, sec = sectors ; i<numsectors ; i++, sec++)
+    {
+	*saved++ = sec->floorheight;
+	*saved++ = sec->ceilingheight;
+	sec->floorheight = R_Interpolate (sec->oldfloorheight, sec->floorheight);
+	sec->ceilingheight = R_Interpolate (sec->oldceilingheight,
+					    sec->ceilingheight);
+    }
+
+    for (i=0 ; i<MAXPLAYERS ; i++)
+    {
+	*saved++ = players[i].viewz;
+	players[i].viewz = R_Interpolate (players[i].oldviewz, players[i].viewz);
+    }
+}
+
+static void R_RestoreView (void)
+{
+    thinker_t*	th;
+    mobj_t*	mo;
+    sector_t*	sec;
+    fixed_t*	saved;
+    int		i;
+
+    saved = interpsaved;
+
+    for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
+    {
+	if (th->function.acp1 != (actionf_p1) P_MobjThinker)
+	    continue;
+
+	mo = (mobj_t *) th;
+	mo->x = *saved++;
+	mo->y = *saved++;
+	mo->z = *saved++;
+	mo->angle = *saved++;
+    }
+
+    for (i=0, sec = sectors ; i<numsectors ; i++, sec++)
+    {
+	sec->floorheight = *saved++;
+	sec->ceilingheight = *saved++;
+    }
+
+    for (i=0 ; i<MAXPLAYERS ; i++)
+	players[i].viewz = *saved++;
+}
+
 void R_RenderPlayerView (player_t* player)
 {	
+    boolean	interpolate;
+    uint64_t	start;
+    uint64_t	trace;
+
+    trace = M_TraceBegin ();
+
+    // Only in between the tic whose start was stored and the next one;
+    // not while the game is paused, say.
+    interpolate = fractionaltic < FRACUNIT && interpolationtic == gametic - 1;
+
+    if (interpolate)
+	R_InterpolateView ();
+
     R_SetupFrame (player);
 
     // Clear buffers.
@@ -874,18 +1007,31 @@ void R_RenderPlayerView (player_t* player)
     NetUpdate ();
 
     // The head node is the last node output.
+    start = M_BenchStart ();
     R_RenderBSPNode (numnodes-1);
+    M_BenchStop (bench_bsp, start);
     
     // Check for new console commands.
     NetUpdate ();
     
+    start = M_BenchStart ();
     R_DrawPlanes ();
+    M_BenchStop (bench_planes, start);
     
     // Check for new console commands.
     NetUpdate ();
     
+    start = M_BenchStart ();
     R_DrawMasked ();
+    M_BenchStop (bench_masked, start);
+
+    R_FinishDrawing ();
+
+    if (interpolate)
+	R_RestoreView ();
 
     // Check for new console commands.
     NetUpdate ();				
+
+    M_TraceEnd (tz_renderplayerview, trace);
 }
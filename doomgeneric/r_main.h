@@ -29,25 +29,30 @@
 //
 // POV related.
 //
-extern fixed_t		viewcos;
-extern fixed_t		viewsin;
+extern THREADLOCAL fixed_t		viewcos;
+extern THREADLOCAL fixed_t		viewsin;
 
-extern int		viewwindowx;
-extern int		viewwindowy;
+extern THREADLOCAL int		viewwindowx;
+extern THREADLOCAL int		viewwindowy;
 
 
 
-extern int		centerx;
-extern int		centery;
+extern THREADLOCAL int		centerx;
+extern THREADLOCAL int		centery;
 
-extern fixed_t		centerxfrac;
-extern fixed_t		centeryfrac;
-extern fixed_t		projection;
+extern THREADLOCAL fixed_t		centerxfrac;
+extern THREADLOCAL fixed_t		centeryfrac;
+extern THREADLOCAL fixed_t		projection;
 
-extern int		validcount;
+extern THREADLOCAL int		validcount;
 
-extern int		linecount;
-extern int		loopcount;
+// How far into the next tic to draw the view, moving things and sector
+// heights part of the way from where they were when the last tic
+// started.  FRACUNIT draws them where they are.
+extern THREADLOCAL fixed_t		fractionaltic;
+
+extern THREADLOCAL int		linecount;
+extern THREADLOCAL int		loopcount;
 
 
 //
@@ -66,12 +71,12 @@ extern int		loopcount;
 #define MAXLIGHTZ	       128
 #define LIGHTZSHIFT		20
 
-extern lighttable_t*	scalelight[LIGHTLEVELS][MAXLIGHTSCALE];
-extern lighttable_t*	scalelightfixed[MAXLIGHTSCALE];
-extern lighttable_t*	zlight[LIGHTLEVELS][MAXLIGHTZ];
+extern THREADLOCAL lighttable_t*	scalelight[LIGHTLEVELS][MAXLIGHTSCALE];
+extern THREADLOCAL lighttable_t*	scalelightfixed[MAXLIGHTSCALE];
+extern THREADLOCAL lighttable_t*	zlight[LIGHTLEVELS][MAXLIGHTZ];
 
-extern int		extralight;
-extern lighttable_t*	fixedcolormap;
+extern THREADLOCAL int		extralight;
+extern THREADLOCAL lighttable_t*	fixedcolormap;
 
 
 // Number of diminishing brightness levels.
@@ -82,19 +87,19 @@ extern lighttable_t*	fixedcolormap;
 // Blocky/low detail mode.
 //B remove this?
 //  0 = high, 1 = low
-extern	int		detailshift;	
+extern THREADLOCAL int		detailshift;	
 
 
 //
 // Function pointers to switch refresh/drawing functions.
 // Used to select shadow mode etc.
 //
-extern void		(*colfunc) (void);
-extern void		(*transcolfunc) (void);
-extern void		(*basecolfunc) (void);
-extern void		(*fuzzcolfunc) (void);
+extern THREADLOCAL void		(*colfunc) (void);
+extern THREADLOCAL void		(*transcolfunc) (void);
+extern THREADLOCAL void		(*basecolfunc) (void);
+extern THREADLOCAL void		(*fuzzcolfunc) (void);
 // No shadow effects on floors.
-extern void		(*spanfunc) (void);
+extern THREADLOCAL void		(*spanfunc) (void);
 
 
 //
@@ -23,6 +23,7 @@
 #include <stdlib.h>
 
 #include "i_system.h"
+#include "m_trace.h"
 #include "z_zone.h"
 #include "w_wad.h"
 
@@ -34,8 +35,8 @@
 
 
 
-planefunction_t		floorfunc;
-planefunction_t		ceilingfunc;
+THREADLOCAL planefunction_t		floorfunc;
+THREADLOCAL planefunction_t		ceilingfunc;
 
 //
 // opening
@@ -43,15 +44,15 @@ planefunction_t		ceilingfunc;
 
 // Here comes the obnoxious "visplane".
 #define MAXVISPLANES	128
-visplane_t		visplanes[MAXVISPLANES];
-visplane_t*		lastvisplane;
-visplane_t*		floorplane;
-visplane_t*		ceilingplane;
+THREADLOCAL visplane_t		visplanes[MAXVISPLANES];
+THREADLOCAL visplane_t*		lastvisplane;
+THREADLOCAL visplane_t*		floorplane;
+THREADLOCAL visplane_t*		ceilingplane;
 
 // ?
 #define MAXOPENINGS	SCREENWIDTH*64
-short			openings[MAXOPENINGS];
-short*			lastopening;
+THREADLOCAL short			openings[MAXOPENINGS];
+THREADLOCAL short*			lastopening;
 
 
 //
@@ -59,31 +60,31 @@ short*			lastopening;
 //  floorclip starts out SCREENHEIGHT
 //  ceilingclip starts out -1
 //
-short			floorclip[SCREENWIDTH];
-short			ceilingclip[SCREENWIDTH];
+THREADLOCAL short			floorclip[SCREENWIDTH];
+THREADLOCAL short			ceilingclip[SCREENWIDTH];
 
 //
 // spanstart holds the start of a plane span
 // initialized to 0 at start
 //
-int			spanstart[SCREENHEIGHT];
-int			spanstop[SCREENHEIGHT];
+THREADLOCAL int			spanstart[SCREENHEIGHT];
+THREADLOCAL int			spanstop[SCREENHEIGHT];
 
 //
 // texture mapping
 //
-lighttable_t**		planezlight;
-fixed_t			planeheight;
+THREADLOCAL lighttable_t**		planezlight;
+THREADLOCAL fixed_t			planeheight;
 
-fixed_t			yslope[SCREENHEIGHT];
-fixed_t			distscale[SCREENWIDTH];
-fixed_t			basexscale;
-fixed_t			baseyscale;
+THREADLOCAL fixed_t			yslope[SCREENHEIGHT];
+THREADLOCAL fixed_t			distscale[SCREENWIDTH];
+THREADLOCAL fixed_t			basexscale;
+THREADLOCAL fixed_t			baseyscale;
 
-fixed_t			cachedheight[SCREENHEIGHT];
-fixed_t			cacheddistance[SCREENHEIGHT];
-fixed_t			cachedxstep[SCREENHEIGHT];
-fixed_t			cachedystep[SCREENHEIGHT];
+THREADLOCAL fixed_t			cachedheight[SCREENHEIGHT];
+THREADLOCAL fixed_t			cacheddistance[SCREENHEIGHT];
+THREADLOCAL fixed_t			cachedxstep[SCREENHEIGHT];
+THREADLOCAL fixed_t			cachedystep[SCREENHEIGHT];
 
 
 
@@ -290,7 +291,7 @@ R_CheckPlane
     }
 
     for (x=intrl ; x<= intrh ; x++)
-	if (pl->top[x] != 0xff)
+	if (pl->top[x] != 0xffff)
 	    break;
 
     if (x > intrh)
@@ -365,6 +366,9 @@ void R_DrawPlanes (void)
     int			stop;
     int			angle;
     int                 lumpnum;
+    uint64_t		trace;
+
+    trace = M_TraceBegin ();
 				
 #ifdef RANGECHECK
     if (ds_p - drawsegs > MAXDRAWSEGS)
@@ -415,7 +419,7 @@ void R_DrawPlanes (void)
 	
 	// regular flat
         lumpnum = firstflat + flattranslation[pl->picnum];
-	ds_source = W_CacheLumpNum(lumpnum, PU_STATIC);
+	ds_source = R_CacheDrawLump(lumpnum, PU_STATIC);
 	
 	planeheight = abs(pl->height-viewz);
 	light = (pl->lightlevel >> LIGHTSEGSHIFT)+extralight;
@@ -428,8 +432,8 @@ void R_DrawPlanes (void)
 
 	planezlight = zlight[light];
 
-	pl->top[pl->maxx+1] = 0xff;
-	pl->top[pl->minx-1] = 0xff;
+	pl->top[pl->maxx+1] = 0xffff;
+	pl->top[pl->minx-1] = 0xffff;
 		
 	stop = pl->maxx + 1;
 
@@ -443,4 +447,6 @@ void R_DrawPlanes (void)
 	
         W_ReleaseLumpNum(lumpnum);
     }
+
+    M_TraceEnd (tz_drawplanes, trace);
 }
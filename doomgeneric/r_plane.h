@@ -26,19 +26,19 @@
 
 
 // Visplane related.
-extern  short*		lastopening;
+extern THREADLOCAL short*		lastopening;
 
 
 typedef void (*planefunction_t) (int top, int bottom);
 
-extern planefunction_t	floorfunc;
+extern THREADLOCAL planefunction_t	floorfunc;
 extern planefunction_t	ceilingfunc_t;
 
-extern short		floorclip[SCREENWIDTH];
-extern short		ceilingclip[SCREENWIDTH];
+extern THREADLOCAL short		floorclip[SCREENWIDTH];
+extern THREADLOCAL short		ceilingclip[SCREENWIDTH];
 
-extern fixed_t		yslope[SCREENHEIGHT];
-extern fixed_t		distscale[SCREENWIDTH];
+extern THREADLOCAL fixed_t		yslope[SCREENHEIGHT];
+extern THREADLOCAL fixed_t		distscale[SCREENWIDTH];
 
 void R_InitPlanes (void);
 void R_ClearPlanes (void);
@@ -34,9 +34,9 @@
 //
 // sky mapping
 //
-int			skyflatnum;
-int			skytexture;
-int			skytexturemid;
+THREADLOCAL int			skyflatnum;
+THREADLOCAL int			skytexture;
+THREADLOCAL int			skytexturemid;
 
 
 
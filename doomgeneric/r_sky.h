@@ -28,8 +28,8 @@
 // The sky map is 256*128*4 maps.
 #define ANGLETOSKYSHIFT		22
 
-extern  int		skytexture;
-extern int		skytexturemid;
+extern THREADLOCAL int		skytexture;
+extern THREADLOCAL int		skytexturemid;
 
 // Called whenever the view size changes.
 void R_InitSkyMap (void);
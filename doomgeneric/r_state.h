@@ -35,93 +35,93 @@
 //
 
 // needed for texture pegging
-extern fixed_t*		textureheight;
+extern THREADLOCAL fixed_t*		textureheight;
 
 // needed for pre rendering (fracs)
-extern fixed_t*		spritewidth;
+extern THREADLOCAL fixed_t*		spritewidth;
 
-extern fixed_t*		spriteoffset;
-extern fixed_t*		spritetopoffset;
+extern THREADLOCAL fixed_t*		spriteoffset;
+extern THREADLOCAL fixed_t*		spritetopoffset;
 
-extern lighttable_t*	colormaps;
+extern THREADLOCAL lighttable_t*	colormaps;
 
-extern int		viewwidth;
-extern int		scaledviewwidth;
-extern int		viewheight;
+extern THREADLOCAL int		viewwidth;
+extern THREADLOCAL int		scaledviewwidth;
+extern THREADLOCAL int		viewheight;
 
-extern int		firstflat;
+extern THREADLOCAL int		firstflat;
 
 // for global animation
-extern int*		flattranslation;	
-extern int*		texturetranslation;	
+extern THREADLOCAL int*		flattranslation;	
+extern THREADLOCAL int*		texturetranslation;	
 
 
 // Sprite....
-extern int		firstspritelump;
-extern int		lastspritelump;
-extern int		numspritelumps;
+extern THREADLOCAL int		firstspritelump;
+extern THREADLOCAL int		lastspritelump;
+extern THREADLOCAL int		numspritelumps;
 
 
 
 //
 // Lookup tables for map data.
 //
-extern int		numsprites;
-extern spritedef_t*	sprites;
+extern THREADLOCAL int		numsprites;
+extern THREADLOCAL spritedef_t*	sprites;
 
-extern int		numvertexes;
-extern vertex_t*	vertexes;
+extern THREADLOCAL int		numvertexes;
+extern THREADLOCAL vertex_t*	vertexes;
 
-extern int		numsegs;
-extern seg_t*		segs;
+extern THREADLOCAL int		numsegs;
+extern THREADLOCAL seg_t*		segs;
 
-extern int		numsectors;
-extern sector_t*	sectors;
+extern THREADLOCAL int		numsectors;
+extern THREADLOCAL sector_t*	sectors;
 
-extern int		numsubsectors;
-extern subsector_t*	subsectors;
+extern THREADLOCAL int		numsubsectors;
+extern THREADLOCAL subsector_t*	subsectors;
 
-extern int		numnodes;
-extern node_t*		nodes;
+extern THREADLOCAL int		numnodes;
+extern THREADLOCAL node_t*		nodes;
 
-extern int		numlines;
-extern line_t*		lines;
+extern THREADLOCAL int		numlines;
+extern THREADLOCAL line_t*		lines;
 
-extern int		numsides;
-extern side_t*		sides;
+extern THREADLOCAL int		numsides;
+extern THREADLOCAL side_t*		sides;
 
 
 //
 // POV data.
 //
-extern fixed_t		viewx;
-extern fixed_t		viewy;
-extern fixed_t		viewz;
+extern THREADLOCAL fixed_t		viewx;
+extern THREADLOCAL fixed_t		viewy;
+extern THREADLOCAL fixed_t		viewz;
 
-extern angle_t		viewangle;
-extern player_t*	viewplayer;
+extern THREADLOCAL angle_t		viewangle;
+extern THREADLOCAL player_t*	viewplayer;
 
 
 // ?
-extern angle_t		clipangle;
+extern THREADLOCAL angle_t		clipangle;
 
-extern int		viewangletox[FINEANGLES/2];
-extern angle_t		xtoviewangle[SCREENWIDTH+1];
+extern THREADLOCAL int		viewangletox[FINEANGLES/2];
+extern THREADLOCAL angle_t		xtoviewangle[SCREENWIDTH+1];
 //extern fixed_t		finetangent[FINEANGLES/2];
 
-extern fixed_t		rw_distance;
-extern angle_t		rw_normalangle;
+extern THREADLOCAL fixed_t		rw_distance;
+extern THREADLOCAL angle_t		rw_normalangle;
 
 
 
 // angle to line origin
-extern int		rw_angle1;
+extern THREADLOCAL int		rw_angle1;
 
 // Segs count?
-extern int		sscount;
+extern THREADLOCAL int		sscount;
 
-extern visplane_t*	floorplane;
-extern visplane_t*	ceilingplane;
+extern THREADLOCAL visplane_t*	floorplane;
+extern THREADLOCAL visplane_t*	ceilingplane;
 
 
 #endif
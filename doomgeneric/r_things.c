@@ -28,6 +28,7 @@
 
 #include "i_swap.h"
 #include "i_system.h"
+#include "m_trace.h"
 #include "z_zone.h"
 #include "w_wad.h"
 
@@ -65,15 +66,15 @@ typedef struct
 //  which increases counter clockwise (protractor).
 // There was a lot of stuff grabbed wrong, so I changed it...
 //
-fixed_t		pspritescale;
-fixed_t		pspriteiscale;
+THREADLOCAL fixed_t		pspritescale;
+THREADLOCAL fixed_t		pspriteiscale;
 
-lighttable_t**	spritelights;
+THREADLOCAL lighttable_t**	spritelights;
 
 // constant arrays
 //  used for psprite clipping and initializing clipping
-short		negonearray[SCREENWIDTH];
-short		screenheightarray[SCREENWIDTH];
+THREADLOCAL short		negonearray[SCREENWIDTH];
+THREADLOCAL short		screenheightarray[SCREENWIDTH];
 
 
 //
@@ -82,12 +83,12 @@ short		screenheightarray[SCREENWIDTH];
 
 // variables used to look up
 //  and range check thing_t sprites patches
-spritedef_t*	sprites;
-int		numsprites;
+THREADLOCAL spritedef_t*	sprites;
+THREADLOCAL int		numsprites;
 
-spriteframe_t	sprtemp[29];
-int		maxframe;
-char*		spritename;
+THREADLOCAL spriteframe_t	sprtemp[29];
+THREADLOCAL int		maxframe;
+THREADLOCAL char*		spritename;
 
 
 
@@ -278,9 +279,9 @@ void R_InitSpriteDefs (char** namelist)
 //
 // GAME FUNCTIONS
 //
-vissprite_t	vissprites[MAXVISSPRITES];
-vissprite_t*	vissprite_p;
-int		newvissprite;
+THREADLOCAL vissprite_t	vissprites[MAXVISSPRITES];
+THREADLOCAL vissprite_t*	vissprite_p;
+THREADLOCAL int		newvissprite;
 
 
 
@@ -315,7 +316,7 @@ void R_ClearSprites (void)
 //
 // R_NewVisSprite
 //
-vissprite_t	overflowsprite;
+THREADLOCAL vissprite_t	overflowsprite;
 
 vissprite_t* R_NewVisSprite (void)
 {
@@ -334,11 +335,11 @@ vissprite_t* R_NewVisSprite (void)
 // Masked means: partly transparent, i.e. stored
 //  in posts/runs of opaque pixels.
 //
-short*		mfloorclip;
-short*		mceilingclip;
+THREADLOCAL short*		mfloorclip;
+THREADLOCAL short*		mceilingclip;
 
-fixed_t		spryscale;
-fixed_t		sprtopscreen;
+THREADLOCAL fixed_t		spryscale;
+THREADLOCAL fixed_t		sprtopscreen;
 
 void R_DrawMaskedColumn (column_t* column)
 {
@@ -397,7 +398,7 @@ R_DrawVisSprite
     patch_t*		patch;
 	
 	
-    patch = W_CacheLumpNum (vis->patch+firstspritelump, PU_CACHE);
+    patch = R_CacheDrawLump (vis->patch+firstspritelump, PU_CACHE);
 
     dc_colormap = vis->colormap;
     
@@ -586,7 +587,7 @@ void R_ProjectSprite (mobj_t* thing)
     else
     {
 	// diminished light
-	index = xscale>>(LIGHTSCALESHIFT-detailshift);
+	index = (xscale>>(LIGHTSCALESHIFT-detailshift)) / SCREENSCALE;
 
 	if (index >= MAXLIGHTSCALE) 
 	    index = MAXLIGHTSCALE-1;
@@ -773,7 +774,7 @@ void R_DrawPlayerSprites (void)
 //
 // R_SortVisSprites
 //
-vissprite_t	vsprsortedhead;
+THREADLOCAL vissprite_t	vsprsortedhead;
 
 
 void R_SortVisSprites (void)
@@ -832,8 +833,8 @@ void R_SortVisSprites (void)
 //
 // R_DrawSprite
 //
-static short		clipbot[SCREENWIDTH];
-static short		cliptop[SCREENWIDTH];
+static THREADLOCAL short		clipbot[SCREENWIDTH];
+static THREADLOCAL short		cliptop[SCREENWIDTH];
 void R_DrawSprite (vissprite_t* spr)
 {
     drawseg_t*		ds;
@@ -952,6 +953,9 @@ void R_DrawMasked (void)
 {
     vissprite_t*	spr;
     drawseg_t*		ds;
+    uint64_t		trace;
+
+    trace = M_TraceBegin ();
 	
     R_SortVisSprites ();
 
@@ -976,6 +980,8 @@ void R_DrawMasked (void)
     //  but does not draw on side views
     if (!viewangleoffset)		
 	R_DrawPlayerSprites ();
+
+    M_TraceEnd (tz_drawmasked, trace);
 }
 
 
@@ -24,23 +24,23 @@
 
 #define MAXVISSPRITES  	128
 
-extern vissprite_t	vissprites[MAXVISSPRITES];
-extern vissprite_t*	vissprite_p;
-extern vissprite_t	vsprsortedhead;
+extern THREADLOCAL vissprite_t	vissprites[MAXVISSPRITES];
+extern THREADLOCAL vissprite_t*	vissprite_p;
+extern THREADLOCAL vissprite_t	vsprsortedhead;
 
 // Constant arrays used for psprite clipping
 //  and initializing clipping.
-extern short		negonearray[SCREENWIDTH];
-extern short		screenheightarray[SCREENWIDTH];
+extern THREADLOCAL short		negonearray[SCREENWIDTH];
+extern THREADLOCAL short		screenheightarray[SCREENWIDTH];
 
 // vars for R_DrawMaskedColumn
-extern short*		mfloorclip;
-extern short*		mceilingclip;
-extern fixed_t		spryscale;
-extern fixed_t		sprtopscreen;
+extern THREADLOCAL short*		mfloorclip;
+extern THREADLOCAL short*		mceilingclip;
+extern THREADLOCAL fixed_t		spryscale;
+extern THREADLOCAL fixed_t		sprtopscreen;
 
-extern fixed_t		pspritescale;
-extern fixed_t		pspriteiscale;
+extern THREADLOCAL fixed_t		pspritescale;
+extern THREADLOCAL fixed_t		pspriteiscale;
 
 
 void R_DrawMaskedColumn (column_t* column);
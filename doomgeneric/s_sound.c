@@ -78,32 +78,32 @@ typedef struct
 
 // The set of channels available
 
-static channel_t *channels;
+static THREADLOCAL channel_t *channels;
 
 // Maximum volume of a sound effect.
 // Internal default is max out of 0-15.
 
-int sfxVolume = 8;
+THREADLOCAL int sfxVolume = 8;
 
 // Maximum volume of music. 
 
-int musicVolume = 8;
+THREADLOCAL int musicVolume = 8;
 
 // Internal volume level, ranging from 0-127
 
-static int snd_SfxVolume;
+static THREADLOCAL int snd_SfxVolume;
 
 // Whether songs are mus_paused
 
-static boolean mus_paused;        
+static THREADLOCAL boolean mus_paused;        
 
 // Music currently being played
 
-static musicinfo_t *mus_playing = NULL;
+static THREADLOCAL musicinfo_t *mus_playing = NULL;
 
 // Number of channels to use
 
-int snd_channels = 8;
+THREADLOCAL int snd_channels = 8;
 
 //
 // Initializes sound stuff, including volume
@@ -115,6 +115,9 @@ void S_Init(int sfxVolume, int musicVolume)
 {  
     int i;
 
+    // The chaingun reuses the pistol sound.
+    S_sfx[sfx_chgun].link = &S_sfx[sfx_pistol];
+
     I_PrecacheSounds(S_sfx, NUMSFX);
 
     S_SetSfxVolume(sfxVolume);
@@ -139,7 +142,6 @@ void S_Init(int sfxVolume, int musicVolume)
     {
         S_sfx[i].lumpnum = S_sfx[i].usefulness = -1;
     }
-
     I_AtExit(S_Shutdown, true);
 }
 
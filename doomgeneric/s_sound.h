@@ -83,7 +83,7 @@ void S_UpdateSounds(mobj_t *listener);
 void S_SetMusicVolume(int volume);
 void S_SetSfxVolume(int volume);
 
-extern int snd_channels;
+extern THREADLOCAL int snd_channels;
 
 #endif
 
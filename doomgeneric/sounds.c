@@ -31,7 +31,7 @@
 #define MUSIC(name) \
     { name, 0, NULL, NULL }
 
-musicinfo_t S_music[] =
+THREADLOCAL musicinfo_t S_music[] =
 {
     MUSIC(NULL),
     MUSIC("e1m1"),
@@ -110,10 +110,12 @@ musicinfo_t S_music[] =
 
 #define SOUND(name, priority) \
   { NULL, name, priority, NULL, -1, -1, 0, 0, -1, NULL }
+// The link pointer itself is filled in by S_Init, as S_sfx is per-thread
+// in a reentrant build.
 #define SOUND_LINK(name, priority, link_id, pitch, volume) \
-  { NULL, name, priority, &S_sfx[link_id], pitch, volume, 0, 0, -1, NULL }
+  { NULL, name, priority, NULL, pitch, volume, 0, 0, -1, NULL }
 
-sfxinfo_t S_sfx[] =
+THREADLOCAL sfxinfo_t S_sfx[] =
 {
   // S_sfx[0] needs to be a dummy for odd reasons.
   SOUND("none",   0),
@@ -37,7 +37,7 @@
 
 
 // in AM_map.c
-extern boolean		automapactive; 
+extern THREADLOCAL boolean		automapactive; 
 
 
 
@@ -46,7 +46,7 @@ extern boolean		automapactive;
 // Hack display negative frags.
 //  Loads and store the stminus lump.
 //
-patch_t*		sttminus;
+THREADLOCAL patch_t*		sttminus;
 
 void STlib_init(void)
 {
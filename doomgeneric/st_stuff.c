@@ -254,145 +254,145 @@
 #define ST_OUTHEIGHT		1
 
 #define ST_MAPTITLEX \
-    (SCREENWIDTH - ST_MAPWIDTH * ST_CHATFONTWIDTH)
+    (ORIGWIDTH - ST_MAPWIDTH * ST_CHATFONTWIDTH)
 
 #define ST_MAPTITLEY		0
 #define ST_MAPHEIGHT		1
 
 // graphics are drawn to a backing screen and blitted to the real screen
-byte                   *st_backing_screen;
+THREADLOCAL byte                   *st_backing_screen;
 	    
 // main player in game
-static player_t*	plyr; 
+static THREADLOCAL player_t*	plyr; 
 
 // ST_Start() has just been called
-static boolean		st_firsttime;
+static THREADLOCAL boolean		st_firsttime;
 
 // lump number for PLAYPAL
-static int		lu_palette;
+static THREADLOCAL int		lu_palette;
 
 // used for timing
-static unsigned int	st_clock;
+static THREADLOCAL unsigned int	st_clock;
 
 // used for making messages go away
-static int		st_msgcounter=0;
+static THREADLOCAL int		st_msgcounter=0;
 
 // used when in chat 
-static st_chatstateenum_t	st_chatstate;
+static THREADLOCAL st_chatstateenum_t	st_chatstate;
 
 // whether in automap or first-person
-static st_stateenum_t	st_gamestate;
+static THREADLOCAL st_stateenum_t	st_gamestate;
 
 // whether left-side main status bar is active
-static boolean		st_statusbaron;
+static THREADLOCAL boolean		st_statusbaron;
 
 // whether status bar chat is active
-static boolean		st_chat;
+static THREADLOCAL boolean		st_chat;
 
 // value of st_chat before message popped up
-static boolean		st_oldchat;
+static THREADLOCAL boolean		st_oldchat;
 
 // whether chat window has the cursor on
-static boolean		st_cursoron;
+static THREADLOCAL boolean		st_cursoron;
 
 // !deathmatch
-static boolean		st_notdeathmatch; 
+static THREADLOCAL boolean		st_notdeathmatch; 
 
 // !deathmatch && st_statusbaron
-static boolean		st_armson;
+static THREADLOCAL boolean		st_armson;
 
 // !deathmatch
-static boolean		st_fragson; 
+static THREADLOCAL boolean		st_fragson; 
 
 // main bar left
-static patch_t*		sbar;
+static THREADLOCAL patch_t*		sbar;
 
 // 0-9, tall numbers
-static patch_t*		tallnum[10];
+static THREADLOCAL patch_t*		tallnum[10];
 
 // tall % sign
-static patch_t*		tallpercent;
+static THREADLOCAL patch_t*		tallpercent;
 
 // 0-9, short, yellow (,different!) numbers
-static patch_t*		shortnum[10];
+static THREADLOCAL patch_t*		shortnum[10];
 
 // 3 key-cards, 3 skulls
-static patch_t*		keys[NUMCARDS]; 
+static THREADLOCAL patch_t*		keys[NUMCARDS]; 
 
 // face status patches
-static patch_t*		faces[ST_NUMFACES];
+static THREADLOCAL patch_t*		faces[ST_NUMFACES];
 
 // face background
-static patch_t*		faceback;
+static THREADLOCAL patch_t*		faceback;
 
  // main bar right
-static patch_t*		armsbg;
+static THREADLOCAL patch_t*		armsbg;
 
 // weapon ownership patches
-static patch_t*		arms[6][2]; 
+static THREADLOCAL patch_t*		arms[6][2]; 
 
 // ready-weapon widget
-static st_number_t	w_ready;
+static THREADLOCAL st_number_t	w_ready;
 
  // in deathmatch only, summary of frags stats
-static st_number_t	w_frags;
+static THREADLOCAL st_number_t	w_frags;
 
 // health widget
-static st_percent_t	w_health;
+static THREADLOCAL st_percent_t	w_health;
 
 // arms background
-static st_binicon_t	w_armsbg; 
+static THREADLOCAL st_binicon_t	w_armsbg; 
 
 
 // weapon ownership widgets
-static st_multicon_t	w_arms[6];
+static THREADLOCAL st_multicon_t	w_arms[6];
 
 // face status widget
-static st_multicon_t	w_faces; 
+static THREADLOCAL st_multicon_t	w_faces; 
 
 // keycard widgets
-static st_multicon_t	w_keyboxes[3];
+static THREADLOCAL st_multicon_t	w_keyboxes[3];
 
 // armor widget
-static st_percent_t	w_armor;
+static THREADLOCAL st_percent_t	w_armor;
 
 // ammo widgets
-static st_number_t	w_ammo[4];
+static THREADLOCAL st_number_t	w_ammo[4];
 
 // max ammo widgets
-static st_number_t	w_maxammo[4]; 
+static THREADLOCAL st_number_t	w_maxammo[4]; 
 
 
 
  // number of frags so far in deathmatch
-static int	st_fragscount;
+static THREADLOCAL int	st_fragscount;
 
 // used to use appopriately pained face
-static int	st_oldhealth = -1;
+static THREADLOCAL int	st_oldhealth = -1;
 
 // used for evil grin
-static boolean	oldweaponsowned[NUMWEAPONS]; 
+static THREADLOCAL boolean	oldweaponsowned[NUMWEAPONS]; 
 
  // count until face changes
-static int	st_facecount = 0;
+static THREADLOCAL int	st_facecount = 0;
 
 // current face index, used by w_faces
-static int	st_faceindex = 0;
+static THREADLOCAL int	st_faceindex = 0;
 
 // holds key-type for each key box on bar
-static int	keyboxes[3]; 
+static THREADLOCAL int	keyboxes[3]; 
 
 // a random number per tick
-static int	st_randomnumber;  
+static THREADLOCAL int	st_randomnumber;  
 
-cheatseq_t cheat_mus = CHEAT("idmus", 2);
-cheatseq_t cheat_god = CHEAT("iddqd", 0);
-cheatseq_t cheat_ammo = CHEAT("idkfa", 0);
-cheatseq_t cheat_ammonokey = CHEAT("idfa", 0);
-cheatseq_t cheat_noclip = CHEAT("idspispopd", 0);
-cheatseq_t cheat_commercial_noclip = CHEAT("idclip", 0);
+THREADLOCAL cheatseq_t cheat_mus = CHEAT("idmus", 2);
+THREADLOCAL cheatseq_t cheat_god = CHEAT("iddqd", 0);
+THREADLOCAL cheatseq_t cheat_ammo = CHEAT("idkfa", 0);
+THREADLOCAL cheatseq_t cheat_ammonokey = CHEAT("idfa", 0);
+THREADLOCAL cheatseq_t cheat_noclip = CHEAT("idspispopd", 0);
+THREADLOCAL cheatseq_t cheat_commercial_noclip = CHEAT("idclip", 0);
 
-cheatseq_t	cheat_powerup[7] =
+THREADLOCAL cheatseq_t	cheat_powerup[7] =
 {
     CHEAT("idbeholdv", 0),
     CHEAT("idbeholds", 0),
@@ -403,9 +403,9 @@ cheatseq_t	cheat_powerup[7] =
     CHEAT("idbehold", 0),
 };
 
-cheatseq_t cheat_choppers = CHEAT("idchoppers", 0);
-cheatseq_t cheat_clev = CHEAT("idclev", 2);
-cheatseq_t cheat_mypos = CHEAT("idmypos", 0);
+THREADLOCAL cheatseq_t cheat_choppers = CHEAT("idchoppers", 0);
+THREADLOCAL cheatseq_t cheat_clev = CHEAT("idclev", 2);
+THREADLOCAL cheatseq_t cheat_mypos = CHEAT("idmypos", 0);
 
 
 //
@@ -590,7 +590,7 @@ ST_Responder (event_t* ev)
       // 'mypos' for player position
       else if (cht_CheckCheat(&cheat_mypos, ev->data2))
       {
-        static char buf[ST_MSGWIDTH];
+        static THREADLOCAL char buf[ST_MSGWIDTH];
         M_snprintf(buf, sizeof(buf), "ang=0x%x;x,y=(0x%x,0x%x)",
                    players[consoleplayer].mo->angle,
                    players[consoleplayer].mo->x,
@@ -665,8 +665,8 @@ ST_Responder (event_t* ev)
 int ST_calcPainOffset(void)
 {
     int		health;
-    static int	lastcalc;
-    static int	oldhealth = -1;
+    static THREADLOCAL int	lastcalc;
+    static THREADLOCAL int	oldhealth = -1;
     
     health = plyr->health > 100 ? 100 : plyr->health;
 
@@ -690,8 +690,8 @@ void ST_updateFaceWidget(void)
     int		i;
     angle_t	badguyangle;
     angle_t	diffang;
-    static int	lastattackdown = -1;
-    static int	priority = 0;
+    static THREADLOCAL int	lastattackdown = -1;
+    static THREADLOCAL int	priority = 0;
     boolean	doevilgrin;
 
     if (priority < 10)
@@ -859,7 +859,7 @@ void ST_updateFaceWidget(void)
 
 void ST_updateWidgets(void)
 {
-    static int	largeammo = 1994; // means "n/a"
+    static THREADLOCAL int	largeammo = 1994; // means "n/a"
     int		i;
 
     // must redirect the pointer if the ready weapon has changed.
@@ -931,7 +931,7 @@ void ST_Ticker (void)
 
 }
 
-static int st_palette = 0;
+static THREADLOCAL int st_palette = 0;
 
 void ST_doPaletteStuff(void)
 {
@@ -1383,7 +1383,7 @@ void ST_createWidgets(void)
 
 }
 
-static boolean	st_stopped = true;
+static THREADLOCAL boolean	st_stopped = true;
 
 
 void ST_Start (void)
@@ -1411,6 +1411,8 @@ void ST_Stop (void)
 void ST_Init (void)
 {
     ST_loadData();
-    st_backing_screen = (byte *) Z_Malloc(ST_WIDTH * ST_HEIGHT, PU_STATIC, 0);
+    st_backing_screen = (byte *) Z_Malloc(ST_WIDTH * ST_HEIGHT
+                                          * SCREENSCALE * SCREENSCALE,
+                                          PU_STATIC, 0);
 }
 
@@ -28,8 +28,8 @@
 // Size of statusbar.
 // Now sensitive for scaling.
 #define ST_HEIGHT	32
-#define ST_WIDTH	SCREENWIDTH
-#define ST_Y		(SCREENHEIGHT - ST_HEIGHT)
+#define ST_WIDTH	ORIGWIDTH
+#define ST_Y		(ORIGHEIGHT - ST_HEIGHT)
 
 
 //
@@ -73,17 +73,17 @@ typedef enum
 
 
 
-extern byte *st_backing_screen;
-extern cheatseq_t cheat_mus;
-extern cheatseq_t cheat_god;
-extern cheatseq_t cheat_ammo;
-extern cheatseq_t cheat_ammonokey;
-extern cheatseq_t cheat_noclip;
-extern cheatseq_t cheat_commercial_noclip;
-extern cheatseq_t cheat_powerup[7];
-extern cheatseq_t cheat_choppers;
-extern cheatseq_t cheat_clev;
-extern cheatseq_t cheat_mypos;
+extern THREADLOCAL byte *st_backing_screen;
+extern THREADLOCAL cheatseq_t cheat_mus;
+extern THREADLOCAL cheatseq_t cheat_god;
+extern THREADLOCAL cheatseq_t cheat_ammo;
+extern THREADLOCAL cheatseq_t cheat_ammonokey;
+extern THREADLOCAL cheatseq_t cheat_noclip;
+extern THREADLOCAL cheatseq_t cheat_commercial_noclip;
+extern THREADLOCAL cheatseq_t cheat_powerup[7];
+extern THREADLOCAL cheatseq_t cheat_choppers;
+extern THREADLOCAL cheatseq_t cheat_clev;
+extern THREADLOCAL cheatseq_t cheat_mypos;
 
 
 #endif
@@ -54,8 +54,8 @@ static const char *player_colors[] =
 // Array of end-of-level statistics that have been captured.
 
 #define MAX_CAPTURES 32
-static wbstartstruct_t captured_stats[MAX_CAPTURES];
-static int num_captured_stats = 0;
+static THREADLOCAL wbstartstruct_t captured_stats[MAX_CAPTURES];
+static THREADLOCAL int num_captured_stats = 0;
 
 #if ORIGCODE
 static GameMission_t discovered_gamemission = none;
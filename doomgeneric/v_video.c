@@ -48,20 +48,24 @@
 // Blending table used for fuzzpatch, etc.
 // Only used in Heretic/Hexen
 
-byte *tinttable = NULL;
+THREADLOCAL byte *tinttable = NULL;
 
 // villsa [STRIFE] Blending table used for Strife
-byte *xlatab = NULL;
+THREADLOCAL byte *xlatab = NULL;
 
 // The screen buffer that the v_video.c code draws to.
+//
+// Apart from V_MarkRect and V_DrawBlock, which work on screen pixels,
+// the drawing functions take coordinates on the original 320x200
+// screen and draw everything SCREENSCALE times larger.
 
-static byte *dest_screen = NULL;
+static THREADLOCAL byte *dest_screen = NULL;
 
-int dirtybox[4]; 
+THREADLOCAL int dirtybox[4]; 
 
 // haleyjd 08/28/10: clipping callback function for patches.
 // This is needed for Chocolate Strife, which clips patches to the screen.
-static vpatchclipfunc_t patchclip_callback = NULL;
+static THREADLOCAL vpatchclipfunc_t patchclip_callback = NULL;
 
 //
 // V_MarkRect 
@@ -91,18 +95,25 @@ void V_CopyRect(int srcx, int srcy, byte *source,
  
 #ifdef RANGECHECK 
     if (srcx < 0
-     || srcx + width > SCREENWIDTH
+     || srcx + width > ORIGWIDTH
      || srcy < 0
-     || srcy + height > SCREENHEIGHT 
+     || srcy + height > ORIGHEIGHT 
      || destx < 0
-     || destx + width > SCREENWIDTH
+     || destx + width > ORIGWIDTH
      || desty < 0
-     || desty + height > SCREENHEIGHT)
+     || desty + height > ORIGHEIGHT)
     {
         I_Error ("Bad V_CopyRect");
     }
 #endif 
 
+    srcx *= SCREENSCALE;
+    srcy *= SCREENSCALE;
+    destx *= SCREENSCALE;
+    desty *= SCREENSCALE;
+    width *= SCREENSCALE;
+    height *= SCREENSCALE;
+
     V_MarkRect(destx, desty, width, height); 
  
     src = source + SCREENWIDTH * srcy + srcx; 
@@ -140,6 +151,7 @@ void V_DrawPatch(int x, int y, patch_t *patch)
 { 
     int count;
     int col;
+    int i;
     column_t *column;
     byte *desttop;
     byte *dest;
@@ -158,35 +170,38 @@ void V_DrawPatch(int x, int y, patch_t *patch)
 
 #ifdef RANGECHECK
     if (x < 0
-     || x + SHORT(patch->width) > SCREENWIDTH
+     || x + SHORT(patch->width) > ORIGWIDTH
      || y < 0
-     || y + SHORT(patch->height) > SCREENHEIGHT)
+     || y + SHORT(patch->height) > ORIGHEIGHT)
     {
         I_Error("Bad V_DrawPatch x=%i y=%i patch.width=%i patch.height=%i topoffset=%i leftoffset=%i", x, y, patch->width, patch->height, patch->topoffset, patch->leftoffset);
     }
 #endif
 
-    V_MarkRect(x, y, SHORT(patch->width), SHORT(patch->height));
+    V_MarkRect(x * SCREENSCALE, y * SCREENSCALE,
+               SHORT(patch->width) * SCREENSCALE,
+               SHORT(patch->height) * SCREENSCALE);
 
     col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
+    desttop = dest_screen + (y * SCREENWIDTH + x) * SCREENSCALE;
 
-    w = SHORT(patch->width);
+    w = SHORT(patch->width) * SCREENSCALE;
 
-    for ( ; col<w ; x++, col++, desttop++)
+    for ( ; col<w ; col++, desttop++)
     {
-        column = (column_t *)((byte *)patch + LONG(patch->columnofs[col]));
+        column = (column_t *)((byte *)patch
+                              + LONG(patch->columnofs[col / SCREENSCALE]));
 
         // step through the posts in a column
         while (column->topdelta != 0xff)
         {
             source = (byte *)column + 3;
-            dest = desttop + column->topdelta*SCREENWIDTH;
-            count = column->length;
+            dest = desttop + column->topdelta*SCREENWIDTH*SCREENSCALE;
+            count = column->length * SCREENSCALE;
 
-            while (count--)
+            for (i = 0; i < count; i++)
             {
-                *dest = *source++;
+                *dest = source[i / SCREENSCALE];
                 dest += SCREENWIDTH;
             }
             column = (column_t *)((byte *)column + column->length + 4);
@@ -204,6 +219,7 @@ void V_DrawPatchFlipped(int x, int y, patch_t *patch)
 {
     int count;
     int col; 
+    int i;
     column_t *column; 
     byte *desttop;
     byte *dest;
@@ -222,35 +238,38 @@ void V_DrawPatchFlipped(int x, int y, patch_t *patch)
 
 #ifdef RANGECHECK 
     if (x < 0
-     || x + SHORT(patch->width) > SCREENWIDTH
+     || x + SHORT(patch->width) > ORIGWIDTH
      || y < 0
-     || y + SHORT(patch->height) > SCREENHEIGHT)
+     || y + SHORT(patch->height) > ORIGHEIGHT)
     {
         I_Error("Bad V_DrawPatchFlipped");
     }
 #endif
 
-    V_MarkRect (x, y, SHORT(patch->width), SHORT(patch->height));
+    V_MarkRect (x * SCREENSCALE, y * SCREENSCALE,
+                SHORT(patch->width) * SCREENSCALE,
+                SHORT(patch->height) * SCREENSCALE);
 
     col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
+    desttop = dest_screen + (y * SCREENWIDTH + x) * SCREENSCALE;
 
-    w = SHORT(patch->width);
+    w = SHORT(patch->width) * SCREENSCALE;
 
-    for ( ; col<w ; x++, col++, desttop++)
+    for ( ; col<w ; col++, desttop++)
     {
-        column = (column_t *)((byte *)patch + LONG(patch->columnofs[w-1-col]));
+        column = (column_t *)((byte *)patch
+                              + LONG(patch->columnofs[(w-1-col) / SCREENSCALE]));
 
         // step through the posts in a column
         while (column->topdelta != 0xff )
         {
             source = (byte *)column + 3;
-            dest = desttop + column->topdelta*SCREENWIDTH;
-            count = column->length;
+            dest = desttop + column->topdelta*SCREENWIDTH*SCREENSCALE;
+            count = column->length * SCREENSCALE;
 
-            while (count--)
+            for (i = 0; i < count; i++)
             {
-                *dest = *source++;
+                *dest = source[i / SCREENSCALE];
                 dest += SCREENWIDTH;
             }
             column = (column_t *)((byte *)column + column->length + 4);
@@ -278,7 +297,7 @@ void V_DrawPatchDirect(int x, int y, patch_t *patch)
 
 void V_DrawTLPatch(int x, int y, patch_t * patch)
 {
-    int count, col;
+    int count, col, i;
     column_t *column;
     byte *desttop, *dest, *source;
     int w;
@@ -287,32 +306,33 @@ void V_DrawTLPatch(int x, int y, patch_t * patch)
     x -= SHORT(patch->leftoffset);
 
     if (x < 0
-     || x + SHORT(patch->width) > SCREENWIDTH 
+     || x + SHORT(patch->width) > ORIGWIDTH 
      || y < 0
-     || y + SHORT(patch->height) > SCREENHEIGHT)
+     || y + SHORT(patch->height) > ORIGHEIGHT)
     {
         I_Error("Bad V_DrawTLPatch");
     }
 
     col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
+    desttop = dest_screen + (y * SCREENWIDTH + x) * SCREENSCALE;
 
-    w = SHORT(patch->width);
-    for (; col < w; x++, col++, desttop++)
+    w = SHORT(patch->width) * SCREENSCALE;
+    for (; col < w; col++, desttop++)
     {
-        column = (column_t *) ((byte *) patch + LONG(patch->columnofs[col]));
+        column = (column_t *) ((byte *) patch
+                               + LONG(patch->columnofs[col / SCREENSCALE]));
 
         // step through the posts in a column
 
         while (column->topdelta != 0xff)
         {
             source = (byte *) column + 3;
-            dest = desttop + column->topdelta * SCREENWIDTH;
-            count = column->length;
+            dest = desttop + column->topdelta * SCREENWIDTH * SCREENSCALE;
+            count = column->length * SCREENSCALE;
 
-            while (count--)
+            for (i = 0; i < count; i++)
             {
-                *dest = tinttable[((*dest) << 8) + *source++];
+                *dest = tinttable[((*dest) << 8) + source[i / SCREENSCALE]];
                 dest += SCREENWIDTH;
             }
             column = (column_t *) ((byte *) column + column->length + 4);
@@ -328,7 +348,7 @@ void V_DrawTLPatch(int x, int y, patch_t * patch)
 
 void V_DrawXlaPatch(int x, int y, patch_t * patch)
 {
-    int count, col;
+    int count, col, i;
     column_t *column;
     byte *desttop, *dest, *source;
     int w;
@@ -343,25 +363,25 @@ void V_DrawXlaPatch(int x, int y, patch_t * patch)
     }
 
     col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
+    desttop = dest_screen + (y * SCREENWIDTH + x) * SCREENSCALE;
 
-    w = SHORT(patch->width);
-    for(; col < w; x++, col++, desttop++)
+    w = SHORT(patch->width) * SCREENSCALE;
+    for(; col < w; col++, desttop++)
     {
-        column = (column_t *) ((byte *) patch + LONG(patch->columnofs[col]));
+        column = (column_t *) ((byte *) patch
+                               + LONG(patch->columnofs[col / SCREENSCALE]));
 
         // step through the posts in a column
 
         while(column->topdelta != 0xff)
         {
             source = (byte *) column + 3;
-            dest = desttop + column->topdelta * SCREENWIDTH;
-            count = column->length;
+            dest = desttop + column->topdelta * SCREENWIDTH * SCREENSCALE;
+            count = column->length * SCREENSCALE;
 
-            while(count--)
+            for (i = 0; i < count; i++)
             {
-                *dest = xlatab[*dest + ((*source) << 8)];
-                source++;
+                *dest = xlatab[*dest + (source[i / SCREENSCALE] << 8)];
                 dest += SCREENWIDTH;
             }
             column = (column_t *) ((byte *) column + column->length + 4);
@@ -377,7 +397,7 @@ void V_DrawXlaPatch(int x, int y, patch_t * patch)
 
 void V_DrawAltTLPatch(int x, int y, patch_t * patch)
 {
-    int count, col;
+    int count, col, i;
     column_t *column;
     byte *desttop, *dest, *source;
     int w;
@@ -386,32 +406,33 @@ void V_DrawAltTLPatch(int x, int y, patch_t * patch)
     x -= SHORT(patch->leftoffset);
 
     if (x < 0
-     || x + SHORT(patch->width) > SCREENWIDTH
+     || x + SHORT(patch->width) > ORIGWIDTH
      || y < 0
-     || y + SHORT(patch->height) > SCREENHEIGHT)
+     || y + SHORT(patch->height) > ORIGHEIGHT)
     {
         I_Error("Bad V_DrawAltTLPatch");
     }
 
     col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
+    desttop = dest_screen + (y * SCREENWIDTH + x) * SCREENSCALE;
 
-    w = SHORT(patch->width);
-    for (; col < w; x++, col++, desttop++)
+    w = SHORT(patch->width) * SCREENSCALE;
+    for (; col < w; col++, desttop++)
     {
-        column = (column_t *) ((byte *) patch + LONG(patch->columnofs[col]));
+        column = (column_t *) ((byte *) patch
+                               + LONG(patch->columnofs[col / SCREENSCALE]));
 
         // step through the posts in a column
 
         while (column->topdelta != 0xff)
         {
             source = (byte *) column + 3;
-            dest = desttop + column->topdelta * SCREENWIDTH;
-            count = column->length;
+            dest = desttop + column->topdelta * SCREENWIDTH * SCREENSCALE;
+            count = column->length * SCREENSCALE;
 
-            while (count--)
+            for (i = 0; i < count; i++)
             {
-                *dest = tinttable[((*dest) << 8) + *source++];
+                *dest = tinttable[((*dest) << 8) + source[i / SCREENSCALE]];
                 dest += SCREENWIDTH;
             }
             column = (column_t *) ((byte *) column + column->length + 4);
@@ -427,7 +448,7 @@ void V_DrawAltTLPatch(int x, int y, patch_t * patch)
 
 void V_DrawShadowedPatch(int x, int y, patch_t *patch)
 {
-    int count, col;
+    int count, col, i;
     column_t *column;
     byte *desttop, *dest, *source;
     byte *desttop2, *dest2;
@@ -437,36 +458,37 @@ void V_DrawShadowedPatch(int x, int y, patch_t *patch)
     x -= SHORT(patch->leftoffset);
 
     if (x < 0
-     || x + SHORT(patch->width) > SCREENWIDTH
+     || x + SHORT(patch->width) > ORIGWIDTH
      || y < 0
-     || y + SHORT(patch->height) > SCREENHEIGHT)
+     || y + SHORT(patch->height) > ORIGHEIGHT)
     {
         I_Error("Bad V_DrawShadowedPatch");
     }
 
     col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
-    desttop2 = dest_screen + (y + 2) * SCREENWIDTH + x + 2;
+    desttop = dest_screen + (y * SCREENWIDTH + x) * SCREENSCALE;
+    desttop2 = dest_screen + ((y + 2) * SCREENWIDTH + x + 2) * SCREENSCALE;
 
-    w = SHORT(patch->width);
-    for (; col < w; x++, col++, desttop++, desttop2++)
+    w = SHORT(patch->width) * SCREENSCALE;
+    for (; col < w; col++, desttop++, desttop2++)
     {
-        column = (column_t *) ((byte *) patch + LONG(patch->columnofs[col]));
+        column = (column_t *) ((byte *) patch
+                               + LONG(patch->columnofs[col / SCREENSCALE]));
 
         // step through the posts in a column
 
         while (column->topdelta != 0xff)
         {
             source = (byte *) column + 3;
-            dest = desttop + column->topdelta * SCREENWIDTH;
-            dest2 = desttop2 + column->topdelta * SCREENWIDTH;
-            count = column->length;
+            dest = desttop + column->topdelta * SCREENWIDTH * SCREENSCALE;
+            dest2 = desttop2 + column->topdelta * SCREENWIDTH * SCREENSCALE;
+            count = column->length * SCREENSCALE;
 
-            while (count--)
+            for (i = 0; i < count; i++)
             {
                 *dest2 = tinttable[((*dest2) << 8)];
                 dest2 += SCREENWIDTH;
-                *dest = *source++;
+                *dest = source[i / SCREENSCALE];
                 dest += SCREENWIDTH;
 
             }
@@ -498,6 +520,7 @@ void V_LoadXlaTable(void)
 //
 // V_DrawBlock
 // Draw a linear block of pixels into the view buffer.
+// Unlike the other functions, this works on screen pixels.
 //
 
 void V_DrawBlock(int x, int y, int width, int height, byte *src) 
@@ -531,6 +554,11 @@ void V_DrawFilledBox(int x, int y, int w, int h, int c)
     uint8_t *buf, *buf1;
     int x1, y1;
 
+    x *= SCREENSCALE;
+    y *= SCREENSCALE;
+    w *= SCREENSCALE;
+    h *= SCREENSCALE;
+
     buf = I_VideoBuffer + SCREENWIDTH * y + x;
 
     for (y1 = 0; y1 < h; ++y1)
@@ -548,29 +576,12 @@ void V_DrawFilledBox(int x, int y, int w, int h, int c)
 
 void V_DrawHorizLine(int x, int y, int w, int c)
 {
-    uint8_t *buf;
-    int x1;
-
-    buf = I_VideoBuffer + SCREENWIDTH * y + x;
-
-    for (x1 = 0; x1 < w; ++x1)
-    {
-        *buf++ = c;
-    }
+    V_DrawFilledBox(x, y, w, 1, c);
 }
 
 void V_DrawVertLine(int x, int y, int h, int c)
 {
-    uint8_t *buf;
-    int y1;
-
-    buf = I_VideoBuffer + SCREENWIDTH * y + x;
-
-    for (y1 = 0; y1 < h; ++y1)
-    {
-        *buf = c;
-        buf += SCREENWIDTH;
-    }
+    V_DrawFilledBox(x, y, 1, h, c);
 }
 
 void V_DrawBox(int x, int y, int w, int h, int c)
@@ -588,7 +599,18 @@ void V_DrawBox(int x, int y, int w, int h, int c)
  
 void V_DrawRawScreen(byte *raw)
 {
-    memcpy(dest_screen, raw, SCREENWIDTH * SCREENHEIGHT);
+    byte *dest;
+    int x, y;
+
+    dest = dest_screen;
+
+    for (y = 0; y < SCREENHEIGHT; y++)
+    {
+        for (x = 0; x < SCREENWIDTH; x++)
+        {
+            *dest++ = raw[(y / SCREENSCALE) * ORIGWIDTH + x / SCREENSCALE];
+        }
+    }
 }
 
 //
@@ -845,7 +867,7 @@ void V_ScreenShot(char *format)
 
 void V_DrawMouseSpeedBox(int speed)
 {
-    extern int usemouse;
+    extern THREADLOCAL int usemouse;
     int bgcolor, bordercolor, red, black, white, yellow;
     int box_x, box_y;
     int original_speed;
@@ -872,7 +894,7 @@ void V_DrawMouseSpeedBox(int speed)
 
     // Calculate box position
 
-    box_x = SCREENWIDTH - MOUSE_SPEED_BOX_WIDTH - 10;
+    box_x = ORIGWIDTH - MOUSE_SPEED_BOX_WIDTH - 10;
     box_y = 15;
 
     V_DrawFilledBox(box_x, box_y,
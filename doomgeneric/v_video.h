@@ -31,12 +31,12 @@
 // VIDEO
 //
 
-#define CENTERY			(SCREENHEIGHT/2)
+#define CENTERY			(ORIGHEIGHT/2)
 
 
-extern int dirtybox[4];
+extern THREADLOCAL int dirtybox[4];
 
-extern byte *tinttable;
+extern THREADLOCAL byte *tinttable;
 
 // haleyjd 08/28/10: implemented for Strife support
 // haleyjd 08/28/10: Patch clipping callback, implemented to support Choco
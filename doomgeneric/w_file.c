@@ -25,8 +25,6 @@
 
 #include "w_file.h"
 
-extern wad_file_class_t stdc_wad_file;
-
 /*
 #ifdef _WIN32
 extern wad_file_class_t win32_wad_file;
@@ -35,9 +33,11 @@ extern wad_file_class_t win32_wad_file;
 
 #ifdef HAVE_MMAP
 extern wad_file_class_t posix_wad_file;
-#endif 
+#else
+extern wad_file_class_t stdc_wad_file;
+#endif
 
-static wad_file_class_t *wad_file_classes[] = 
+static THREADLOCAL wad_file_class_t *wad_file_classes[] = 
 {
 /*
 #ifdef _WIN32
@@ -46,8 +46,9 @@ static wad_file_class_t *wad_file_classes[] =
 */
 #ifdef HAVE_MMAP
     &posix_wad_file,
-#endif
+#else
     &stdc_wad_file,
+#endif
 };
 
 wad_file_t *W_OpenFile(char *path)
@@ -55,16 +56,6 @@ wad_file_t *W_OpenFile(char *path)
     wad_file_t *result;
     int i;
 
-    //!
-    // Use the OS's virtual memory subsystem to map WAD files
-    // directly into memory.
-    //
-
-    if (!M_CheckParm("-mmap"))
-    {
-        return stdc_wad_file.OpenFile(path);
-    }
-
     // Try all classes in order until we find one that works
 
     result = NULL;
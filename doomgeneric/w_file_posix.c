@@ -0,0 +1,186 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	WAD I/O functions.
+//
+
+#include "config.h"
+
+#ifdef HAVE_MMAP
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "w_file.h"
+#include "z_zone.h"
+
+typedef struct
+{
+    wad_file_t wad;
+    int handle;
+} posix_wad_file_t;
+
+extern wad_file_class_t posix_wad_file;
+
+// The mapping is read-only and shared, so every process that has the
+// same file open uses the same pages of the page cache.  The engine
+// never writes to lumps; if some code did, it would crash right there
+// rather than change the file.
+
+static void MapFile(posix_wad_file_t *wad, char *filename)
+{
+    void *result;
+
+    if (wad->wad.length == 0)
+    {
+        return;
+    }
+
+    result = mmap(NULL, wad->wad.length, PROT_READ, MAP_SHARED,
+                  wad->handle, 0);
+
+    if (result == MAP_FAILED)
+    {
+        fprintf(stderr, "W_POSIX_OpenFile: Unable to mmap() %s - %s\n",
+                        filename, strerror(errno));
+        return;
+    }
+
+    wad->wad.mapped = result;
+}
+
+static wad_file_t *W_POSIX_OpenFile(char *path)
+{
+    posix_wad_file_t *result;
+    struct stat st;
+    int handle;
+
+    handle = open(path, O_RDONLY);
+
+    if (handle < 0)
+    {
+        return NULL;
+    }
+
+    if (fstat(handle, &st) < 0)
+    {
+        close(handle);
+        return NULL;
+    }
+
+    // Create a new posix_wad_file_t to hold the file handle.
+
+    result = Z_Malloc(sizeof(posix_wad_file_t), PU_STATIC, 0);
+    result->wad.file_class = &posix_wad_file;
+    result->wad.length = st.st_size;
+    result->wad.mapped = NULL;
+    result->handle = handle;
+
+    // Try to map the file into memory with mmap:
+
+    MapFile(result, path);
+
+    return &result->wad;
+}
+
+static void W_POSIX_CloseFile(wad_file_t *wad)
+{
+    posix_wad_file_t *posix_wad;
+
+    posix_wad = (posix_wad_file_t *) wad;
+
+    // If mapped, unmap it.
+
+    if (posix_wad->wad.mapped != NULL)
+    {
+        munmap(posix_wad->wad.mapped, posix_wad->wad.length);
+    }
+
+    close(posix_wad->handle);
+    Z_Free(posix_wad);
+}
+
+// Read data from the specified position in the file into the
+// provided buffer.  Returns the number of bytes read.
+
+size_t W_POSIX_Read(wad_file_t *wad, unsigned int offset,
+                    void *buffer, size_t buffer_len)
+{
+    posix_wad_file_t *posix_wad;
+    byte *byte_buffer;
+    size_t bytes_read;
+    ssize_t result;
+
+    posix_wad = (posix_wad_file_t *) wad;
+
+    if (wad->mapped != NULL)
+    {
+        if (offset >= wad->length)
+        {
+            return 0;
+        }
+
+        if (offset + buffer_len > wad->length)
+        {
+            buffer_len = wad->length - offset;
+        }
+
+        memcpy(buffer, wad->mapped + offset, buffer_len);
+
+        return buffer_len;
+    }
+
+    // Read into the buffer.
+
+    bytes_read = 0;
+    byte_buffer = buffer;
+
+    while (buffer_len > 0)
+    {
+        result = pread(posix_wad->handle, byte_buffer, buffer_len, offset);
+
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (result <= 0)
+        {
+            break;
+        }
+
+        buffer_len -= result;
+        byte_buffer += result;
+        bytes_read += result;
+        offset += result;
+    }
+
+    return bytes_read;
+}
+
+
+wad_file_class_t posix_wad_file =
+{
+    W_POSIX_OpenFile,
+    W_POSIX_CloseFile,
+    W_POSIX_Read,
+};
+
+#endif /* #ifdef HAVE_MMAP */
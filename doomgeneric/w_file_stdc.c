@@ -14,8 +14,14 @@
 //
 // DESCRIPTION:
 //	WAD I/O functions.
+//	Where files can't be mapped, the IWAD is compiled in from
+//	doom_wad.h instead and opening any file gives that.
 //
 
+#include "config.h"
+
+#ifndef HAVE_MMAP
+
 #include <stdio.h>
 #include <string.h>
 
@@ -71,4 +77,4 @@ wad_file_class_t stdc_wad_file =
     W_StdC_Read,
 };
 
-
+#endif /* #ifndef HAVE_MMAP */
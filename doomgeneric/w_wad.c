@@ -34,6 +34,7 @@
 #include "i_system.h"
 #include "i_video.h"
 #include "m_misc.h"
+#include "m_trace.h"
 #include "z_zone.h"
 
 #include "w_wad.h"
@@ -60,12 +61,12 @@ typedef struct
 
 // Location of each lump on disk.
 
-lumpinfo_t *lumpinfo;		
-unsigned int numlumps = 0;
+THREADLOCAL lumpinfo_t *lumpinfo;		
+THREADLOCAL unsigned int numlumps = 0;
 
 // Hash table for fast lookups
 
-static lumpinfo_t **lumphash;
+static THREADLOCAL lumpinfo_t **lumphash;
 
 // Hash function used for lump names.
 
@@ -385,6 +386,9 @@ void *W_CacheLumpNum(int lumpnum, int tag)
 {
     byte *result;
     lumpinfo_t *lump;
+    uint64_t trace;
+
+    trace = M_TraceBegin();
 
     if ((unsigned)lumpnum >= numlumps)
     {
@@ -419,6 +423,8 @@ void *W_CacheLumpNum(int lumpnum, int tag)
 	W_ReadLump (lumpnum, lump->cache);
         result = lump->cache;
     }
+
+    M_TraceEnd(tz_cachelumpnum, trace);
 	
     return result;
 }
@@ -52,8 +52,8 @@ struct lumpinfo_s
 };
 
 
-extern lumpinfo_t *lumpinfo;
-extern unsigned int numlumps;
+extern THREADLOCAL lumpinfo_t *lumpinfo;
+extern THREADLOCAL unsigned int numlumps;
 
 wad_file_t *W_AddFile (char *filename);
 
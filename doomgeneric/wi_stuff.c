@@ -80,7 +80,7 @@
 #define SP_STATSY		50
 
 #define SP_TIMEX		16
-#define SP_TIMEY		(SCREENHEIGHT-32)
+#define SP_TIMEY		(ORIGHEIGHT-32)
 
 
 // NET GAME STUFF
@@ -169,7 +169,7 @@ typedef struct
 } anim_t;
 
 
-static point_t lnodes[NUMEPISODES][NUMMAPS] =
+static THREADLOCAL point_t lnodes[NUMEPISODES][NUMMAPS] =
 {
     // Episode 0 World Map
     {
@@ -224,7 +224,7 @@ static point_t lnodes[NUMEPISODES][NUMMAPS] =
      0, { NULL, NULL, NULL }, 0, 0, 0, 0 }
 
 
-static anim_t epsd0animinfo[] =
+static THREADLOCAL anim_t epsd0animinfo[] =
 {
     ANIM(ANIM_ALWAYS, TICRATE/3, 3, 224, 104, 0),
     ANIM(ANIM_ALWAYS, TICRATE/3, 3, 184, 160, 0),
@@ -238,7 +238,7 @@ static anim_t epsd0animinfo[] =
     ANIM(ANIM_ALWAYS, TICRATE/3, 3, 64, 24, 0),
 };
 
-static anim_t epsd1animinfo[] =
+static THREADLOCAL anim_t epsd1animinfo[] =
 {
     ANIM(ANIM_LEVEL, TICRATE/3, 1, 128, 136, 1),
     ANIM(ANIM_LEVEL, TICRATE/3, 1, 128, 136, 2),
@@ -251,7 +251,7 @@ static anim_t epsd1animinfo[] =
     ANIM(ANIM_LEVEL, TICRATE/3, 1, 128, 136, 8),
 };
 
-static anim_t epsd2animinfo[] =
+static THREADLOCAL anim_t epsd2animinfo[] =
 {
     ANIM(ANIM_ALWAYS, TICRATE/3, 3, 104, 168, 0),
     ANIM(ANIM_ALWAYS, TICRATE/3, 3, 40, 136, 0),
@@ -268,12 +268,9 @@ static int NUMANIMS[NUMEPISODES] =
     arrlen(epsd2animinfo),
 };
 
-static anim_t *anims[NUMEPISODES] =
-{
-    epsd0animinfo,
-    epsd1animinfo,
-    epsd2animinfo
-};
+// Filled in by WI_initVariables; the animinfo tables are per-thread in a
+// reentrant build.
+static THREADLOCAL anim_t *anims[NUMEPISODES];
 
 
 //
@@ -300,37 +297,37 @@ static anim_t *anims[NUMEPISODES] =
 
 
 // used to accelerate or skip a stage
-static int		acceleratestage;
+static THREADLOCAL int		acceleratestage;
 
 // wbs->pnum
-static int		me;
+static THREADLOCAL int		me;
 
  // specifies current state
-static stateenum_t	state;
+static THREADLOCAL stateenum_t	state;
 
 // contains information passed into intermission
-static wbstartstruct_t*	wbs;
+static THREADLOCAL wbstartstruct_t*	wbs;
 
-static wbplayerstruct_t* plrs;  // wbs->plyr[]
+static THREADLOCAL wbplayerstruct_t* plrs;  // wbs->plyr[]
 
 // used for general timing
-static int 		cnt;  
+static THREADLOCAL int 		cnt;  
 
 // used for timing of background animation
-static int 		bcnt;
+static THREADLOCAL int 		bcnt;
 
 // signals to refresh everything for one frame
-static int 		firstrefresh; 
+static THREADLOCAL int 		firstrefresh; 
 
-static int		cnt_kills[MAXPLAYERS];
-static int		cnt_items[MAXPLAYERS];
-static int		cnt_secret[MAXPLAYERS];
-static int		cnt_time;
-static int		cnt_par;
-static int		cnt_pause;
+static THREADLOCAL int		cnt_kills[MAXPLAYERS];
+static THREADLOCAL int		cnt_items[MAXPLAYERS];
+static THREADLOCAL int		cnt_secret[MAXPLAYERS];
+static THREADLOCAL int		cnt_time;
+static THREADLOCAL int		cnt_par;
+static THREADLOCAL int		cnt_pause;
 
 // # of commercial levels
-static int		NUMCMAPS; 
+static THREADLOCAL int		NUMCMAPS; 
 
 
 //
@@ -338,61 +335,61 @@ static int		NUMCMAPS;
 //
 
 // You Are Here graphic
-static patch_t*		yah[3] = { NULL, NULL, NULL }; 
+static THREADLOCAL patch_t*		yah[3] = { NULL, NULL, NULL }; 
 
 // splat
-static patch_t*		splat[2] = { NULL, NULL };
+static THREADLOCAL patch_t*		splat[2] = { NULL, NULL };
 
 // %, : graphics
-static patch_t*		percent;
-static patch_t*		colon;
+static THREADLOCAL patch_t*		percent;
+static THREADLOCAL patch_t*		colon;
 
 // 0-9 graphic
-static patch_t*		num[10];
+static THREADLOCAL patch_t*		num[10];
 
 // minus sign
-static patch_t*		wiminus;
+static THREADLOCAL patch_t*		wiminus;
 
 // "Finished!" graphics
-static patch_t*		finished;
+static THREADLOCAL patch_t*		finished;
 
 // "Entering" graphic
-static patch_t*		entering; 
+static THREADLOCAL patch_t*		entering; 
 
 // "secret"
-static patch_t*		sp_secret;
+static THREADLOCAL patch_t*		sp_secret;
 
  // "Kills", "Scrt", "Items", "Frags"
-static patch_t*		kills;
-static patch_t*		secret;
-static patch_t*		items;
-static patch_t*		frags;
+static THREADLOCAL patch_t*		kills;
+static THREADLOCAL patch_t*		secret;
+static THREADLOCAL patch_t*		items;
+static THREADLOCAL patch_t*		frags;
 
 // Time sucks.
-static patch_t*		timepatch;
-static patch_t*		par;
-static patch_t*		sucks;
+static THREADLOCAL patch_t*		timepatch;
+static THREADLOCAL patch_t*		par;
+static THREADLOCAL patch_t*		sucks;
 
 // "killers", "victims"
-static patch_t*		killers;
-static patch_t*		victims; 
+static THREADLOCAL patch_t*		killers;
+static THREADLOCAL patch_t*		victims; 
 
 // "Total", your face, your dead face
-static patch_t*		total;
-static patch_t*		star;
-static patch_t*		bstar;
+static THREADLOCAL patch_t*		total;
+static THREADLOCAL patch_t*		star;
+static THREADLOCAL patch_t*		bstar;
 
 // "red P[1..MAXPLAYERS]"
-static patch_t*		p[MAXPLAYERS];
+static THREADLOCAL patch_t*		p[MAXPLAYERS];
 
 // "gray P[1..MAXPLAYERS]"
-static patch_t*		bp[MAXPLAYERS];
+static THREADLOCAL patch_t*		bp[MAXPLAYERS];
 
  // Name graphics of each level (centered)
-static patch_t**	lnames;
+static THREADLOCAL patch_t**	lnames;
 
 // Buffer storing the backdrop
-static patch_t *background;
+static THREADLOCAL patch_t *background;
 
 //
 // CODE
@@ -420,13 +417,13 @@ void WI_drawLF(void)
     if (gamemode != commercial || wbs->last < NUMCMAPS)
     {
         // draw <LevelName> 
-        V_DrawPatch((SCREENWIDTH - SHORT(lnames[wbs->last]->width))/2,
+        V_DrawPatch((ORIGWIDTH - SHORT(lnames[wbs->last]->width))/2,
                     y, lnames[wbs->last]);
 
         // draw "Finished!"
         y += (5*SHORT(lnames[wbs->last]->height))/4;
 
-        V_DrawPatch((SCREENWIDTH - SHORT(finished->width)) / 2, y, finished);
+        V_DrawPatch((ORIGWIDTH - SHORT(finished->width)) / 2, y, finished);
     }
     else if (wbs->last == NUMCMAPS)
     {
@@ -439,7 +436,7 @@ void WI_drawLF(void)
         // bits of memory at this point, but let's try to be accurate
         // anyway.  This deliberately triggers a V_DrawPatch error.
 
-        patch_t tmp = { SCREENWIDTH, SCREENHEIGHT, 1, 1, 
+        patch_t tmp = { ORIGWIDTH, ORIGHEIGHT, 1, 1, 
                         { 0, 0, 0, 0, 0, 0, 0, 0 } };
 
         V_DrawPatch(0, y, &tmp);
@@ -454,14 +451,14 @@ void WI_drawEL(void)
     int y = WI_TITLEY;
 
     // draw "Entering"
-    V_DrawPatch((SCREENWIDTH - SHORT(entering->width))/2,
+    V_DrawPatch((ORIGWIDTH - SHORT(entering->width))/2,
 		y,
                 entering);
 
     // draw level
     y += (5*SHORT(lnames[wbs->next]->height))/4;
 
-    V_DrawPatch((SCREENWIDTH - SHORT(lnames[wbs->next]->width))/2,
+    V_DrawPatch((ORIGWIDTH - SHORT(lnames[wbs->next]->width))/2,
 		y, 
                 lnames[wbs->next]);
 
@@ -489,9 +486,9 @@ WI_drawOnLnode
 	bottom = top + SHORT(c[i]->height);
 
 	if (left >= 0
-	    && right < SCREENWIDTH
+	    && right < ORIGWIDTH
 	    && top >= 0
-	    && bottom < SCREENHEIGHT)
+	    && bottom < ORIGHEIGHT)
 	{
 	    fits = true;
 	}
@@ -766,7 +763,7 @@ void WI_updateNoState(void) {
 
 }
 
-static boolean		snl_pointeron = false;
+static THREADLOCAL boolean		snl_pointeron = false;
 
 
 void WI_initShowNextLoc(void)
@@ -860,9 +857,9 @@ int WI_fragSum(int playernum)
 
 
 
-static int		dm_state;
-static int		dm_frags[MAXPLAYERS][MAXPLAYERS];
-static int		dm_totals[MAXPLAYERS];
+static THREADLOCAL int		dm_state;
+static THREADLOCAL int		dm_frags[MAXPLAYERS][MAXPLAYERS];
+static THREADLOCAL int		dm_totals[MAXPLAYERS];
 
 
 
@@ -1082,9 +1079,9 @@ void WI_drawDeathmatchStats(void)
     }
 }
 
-static int	cnt_frags[MAXPLAYERS];
-static int	dofrags;
-static int	ng_state;
+static THREADLOCAL int	cnt_frags[MAXPLAYERS];
+static THREADLOCAL int	dofrags;
+static THREADLOCAL int	ng_state;
 
 void WI_initNetgameStats(void)
 {
@@ -1324,7 +1321,7 @@ void WI_drawNetgameStats(void)
 
 }
 
-static int	sp_state;
+static THREADLOCAL int	sp_state;
 
 void WI_initStats(void)
 {
@@ -1459,21 +1456,21 @@ void WI_drawStats(void)
     WI_drawLF();
 
     V_DrawPatch(SP_STATSX, SP_STATSY, kills);
-    WI_drawPercent(SCREENWIDTH - SP_STATSX, SP_STATSY, cnt_kills[0]);
+    WI_drawPercent(ORIGWIDTH - SP_STATSX, SP_STATSY, cnt_kills[0]);
 
     V_DrawPatch(SP_STATSX, SP_STATSY+lh, items);
-    WI_drawPercent(SCREENWIDTH - SP_STATSX, SP_STATSY+lh, cnt_items[0]);
+    WI_drawPercent(ORIGWIDTH - SP_STATSX, SP_STATSY+lh, cnt_items[0]);
 
     V_DrawPatch(SP_STATSX, SP_STATSY+2*lh, sp_secret);
-    WI_drawPercent(SCREENWIDTH - SP_STATSX, SP_STATSY+2*lh, cnt_secret[0]);
+    WI_drawPercent(ORIGWIDTH - SP_STATSX, SP_STATSY+2*lh, cnt_secret[0]);
 
     V_DrawPatch(SP_TIMEX, SP_TIMEY, timepatch);
-    WI_drawTime(SCREENWIDTH/2 - SP_TIMEX, SP_TIMEY, cnt_time);
+    WI_drawTime(ORIGWIDTH/2 - SP_TIMEX, SP_TIMEY, cnt_time);
 
     if (wbs->epsd < 3)
     {
-	V_DrawPatch(SCREENWIDTH/2 + SP_TIMEX, SP_TIMEY, par);
-	WI_drawTime(SCREENWIDTH - SP_TIMEX, SP_TIMEY, cnt_par);
+	V_DrawPatch(ORIGWIDTH/2 + SP_TIMEX, SP_TIMEY, par);
+	WI_drawTime(ORIGWIDTH - SP_TIMEX, SP_TIMEY, cnt_par);
     }
 
 }
@@ -1778,6 +1775,10 @@ void WI_initVariables(wbstartstruct_t* wbstartstruct)
 
     wbs = wbstartstruct;
 
+    anims[0] = epsd0animinfo;
+    anims[1] = epsd1animinfo;
+    anims[2] = epsd2animinfo;
+
 #ifdef RANGECHECKING
     if (gamemode != commercial)
     {
@@ -0,0 +1,693 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Zone Memory Allocation with segregated free lists.
+//	Built instead of z_zone.c when DOOMGENERIC_SEGREGATED_ZONE
+//	is defined.
+//
+
+#ifdef DOOMGENERIC_SEGREGATED_ZONE
+
+#include "z_zone.h"
+#include "i_system.h"
+#include "doomtype.h"
+#include "m_trace.h"
+
+
+//
+// ZONE MEMORY ALLOCATION
+//
+// The zone is carved up into blocks the same way z_zone.c does it:
+//  there is never any space between memblocks, and there will never
+//  be two contiguous free memblocks.
+//
+// Free blocks are also kept in lists by size class, as in TLSF: a
+//  class per power of two, split into SL_COUNT linear steps.  Bitmaps
+//  tell which lists are not empty, so finding a block that fits and
+//  freeing one are O(1).
+//
+// Purgable blocks (tag >= PU_PURGELEVEL) are kept in a list, least
+//  recently made purgable first.  They are only thrown out when no
+//  free block is big enough, oldest first, until one is.
+//
+
+#define MEM_ALIGN sizeof(void *)
+#define ZONEID	0x1d4a11
+
+#define FL_COUNT 32
+#define SL_LOG2 2
+#define SL_COUNT (1 << SL_LOG2)
+
+typedef struct memblock_s
+{
+    int			size;	// including the header and possibly tiny fragments
+    void**		user;
+    int			tag;	// PU_FREE if this is free
+    int			id;	// should be ZONEID
+    struct memblock_s*	next;
+    struct memblock_s*	prev;
+
+    // free list if free, purge list if purgable
+    struct memblock_s*	lnext;
+    struct memblock_s*	lprev;
+} memblock_t;
+
+
+typedef struct
+{
+    // total bytes malloced, including header
+    int		size;
+
+    // start / end cap for linked list
+    memblock_t	blocklist;
+
+    // free blocks by size class
+    unsigned int	fl_bitmap;
+    unsigned int	sl_bitmap[FL_COUNT];
+    memblock_t*		freelists[FL_COUNT][SL_COUNT];
+
+    // start / end cap for the purgable blocks
+    memblock_t	purgelist;
+
+} memzone_t;
+
+
+
+THREADLOCAL memzone_t*	mainzone;
+
+
+
+static int HighestBit(unsigned int x)
+{
+#if defined(__GNUC__)
+    return 31 - __builtin_clz(x);
+#else
+    int result = 0;
+
+    while (x >>= 1)
+        result++;
+
+    return result;
+#endif
+}
+
+static int LowestBit(unsigned int x)
+{
+#if defined(__GNUC__)
+    return __builtin_ctz(x);
+#else
+    int result = 0;
+
+    while (!(x & 1))
+    {
+        x >>= 1;
+        result++;
+    }
+
+    return result;
+#endif
+}
+
+//
+// Size classes
+//
+// Blocks are never smaller than sizeof(memblock_t), so the first
+// SL_LOG2 levels are never used.
+//
+
+static void MapSize(unsigned int size, int *fl, int *sl)
+{
+    *fl = HighestBit(size);
+    *sl = (size >> (*fl - SL_LOG2)) & (SL_COUNT - 1);
+}
+
+// Class of the smallest list whose every block is at least size bytes,
+// and the first non-empty one from there.  Returns false if there is
+// none.
+
+static boolean FindFreeList(unsigned int size, int *fl, int *sl)
+{
+    unsigned int bits;
+
+    size += (1 << (HighestBit(size) - SL_LOG2)) - 1;
+    MapSize(size, fl, sl);
+
+    if (*fl >= FL_COUNT)
+        return false;
+
+    bits = mainzone->sl_bitmap[*fl] & (~0u << *sl);
+
+    if (bits == 0)
+    {
+        if (*fl + 1 >= FL_COUNT)
+            return false;
+
+        bits = mainzone->fl_bitmap & (~0u << (*fl + 1));
+
+        if (bits == 0)
+            return false;
+
+        *fl = LowestBit(bits);
+        bits = mainzone->sl_bitmap[*fl];
+    }
+
+    *sl = LowestBit(bits);
+
+    return true;
+}
+
+// The lists that FindFreeList skips may still hold a block that fits,
+// just not every block in them does.
+
+static memblock_t *SearchFreeList(unsigned int size)
+{
+    memblock_t *block;
+    int fl, sl;
+
+    MapSize(size, &fl, &sl);
+
+    for (block = mainzone->freelists[fl][sl]; block != NULL;
+         block = block->lnext)
+    {
+        if (block->size >= size)
+            return block;
+    }
+
+    return NULL;
+}
+
+static void InsertFree(memblock_t *block)
+{
+    memblock_t **head;
+    int fl, sl;
+
+    MapSize(block->size, &fl, &sl);
+    head = &mainzone->freelists[fl][sl];
+
+    block->lprev = NULL;
+    block->lnext = *head;
+
+    if (*head != NULL)
+        (*head)->lprev = block;
+
+    *head = block;
+
+    mainzone->fl_bitmap |= 1u << fl;
+    mainzone->sl_bitmap[fl] |= 1u << sl;
+}
+
+static void RemoveFree(memblock_t *block)
+{
+    int fl, sl;
+
+    MapSize(block->size, &fl, &sl);
+
+    if (block->lprev != NULL)
+        block->lprev->lnext = block->lnext;
+    else
+        mainzone->freelists[fl][sl] = block->lnext;
+
+    if (block->lnext != NULL)
+        block->lnext->lprev = block->lprev;
+
+    if (mainzone->freelists[fl][sl] == NULL)
+    {
+        mainzone->sl_bitmap[fl] &= ~(1u << sl);
+
+        if (mainzone->sl_bitmap[fl] == 0)
+            mainzone->fl_bitmap &= ~(1u << fl);
+    }
+}
+
+static void InsertPurgable(memblock_t *block)
+{
+    block->lnext = &mainzone->purgelist;
+    block->lprev = mainzone->purgelist.lprev;
+    block->lprev->lnext = block;
+    mainzone->purgelist.lprev = block;
+}
+
+static void RemovePurgable(memblock_t *block)
+{
+    block->lprev->lnext = block->lnext;
+    block->lnext->lprev = block->lprev;
+}
+
+
+
+//
+// Z_ClearZone
+//
+void Z_ClearZone (memzone_t* zone)
+{
+    memblock_t*		block;
+    int			i, j;
+
+    // set the entire zone to one free block
+    zone->blocklist.next =
+	zone->blocklist.prev =
+	block = (memblock_t *)( (byte *)zone + sizeof(memzone_t) );
+
+    zone->blocklist.user = (void *)zone;
+    zone->blocklist.tag = PU_STATIC;
+
+    zone->purgelist.lnext = zone->purgelist.lprev = &zone->purgelist;
+
+    zone->fl_bitmap = 0;
+
+    for (i = 0; i < FL_COUNT; ++i)
+    {
+        zone->sl_bitmap[i] = 0;
+
+        for (j = 0; j < SL_COUNT; ++j)
+            zone->freelists[i][j] = NULL;
+    }
+
+    block->prev = block->next = &zone->blocklist;
+
+    // a free block.
+    block->tag = PU_FREE;
+    block->user = NULL;
+    block->id = 0;
+
+    block->size = zone->size - sizeof(memzone_t);
+
+    InsertFree(block);
+}
+
+
+
+//
+// Z_Init
+//
+void Z_Init (void)
+{
+    int		size;
+
+    mainzone = (memzone_t *)I_ZoneBase (&size);
+    mainzone->size = size;
+
+    Z_ClearZone(mainzone);
+}
+
+
+//
+// FreeBlock
+// Returns the free block that block ended up in.
+//
+static memblock_t *FreeBlock (memblock_t *block)
+{
+    memblock_t*		other;
+
+    if (block->tag != PU_FREE && block->user != NULL)
+    {
+    	// clear the user's mark
+	    *block->user = 0;
+    }
+
+    if (block->tag >= PU_PURGELEVEL)
+        RemovePurgable(block);
+
+    // mark as free
+    block->tag = PU_FREE;
+    block->user = NULL;
+    block->id = 0;
+
+    other = block->prev;
+
+    if (other->tag == PU_FREE)
+    {
+        // merge with previous free block
+        RemoveFree(other);
+        other->size += block->size;
+        other->next = block->next;
+        other->next->prev = other;
+
+        block = other;
+    }
+
+    other = block->next;
+    if (other->tag == PU_FREE)
+    {
+        // merge the next free block onto the end
+        RemoveFree(other);
+        block->size += other->size;
+        block->next = other->next;
+        block->next->prev = block;
+    }
+
+    InsertFree(block);
+
+    return block;
+}
+
+
+//
+// Z_Free
+//
+void Z_Free (void* ptr)
+{
+    memblock_t*		block;
+
+    block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
+
+    if (block->id != ZONEID)
+	I_Error ("Z_Free: freed a pointer without ZONEID");
+
+    FreeBlock(block);
+}
+
+
+
+//
+// Z_Malloc
+// You can pass a NULL user if the tag is < PU_PURGELEVEL.
+//
+#define MINFRAGMENT		64
+
+
+void*
+Z_Malloc
+( int		size,
+  int		tag,
+  void*		user )
+{
+    int		extra;
+    int		fl, sl;
+    memblock_t* base;
+    memblock_t* newblock;
+    void *result;
+    uint64_t trace;
+
+    trace = M_TraceBegin();
+
+    size = (size + MEM_ALIGN - 1) & ~(MEM_ALIGN - 1);
+
+    // account for size of block header
+    size += sizeof(memblock_t);
+
+    if (FindFreeList(size, &fl, &sl))
+    {
+        base = mainzone->freelists[fl][sl];
+    }
+    else if ((base = SearchFreeList(size)) == NULL)
+    {
+        // No free block is big enough: throw out purgable blocks,
+        // oldest first, until freeing one leaves a big enough hole.
+
+        base = NULL;
+
+        while (mainzone->purgelist.lnext != &mainzone->purgelist)
+        {
+            base = FreeBlock(mainzone->purgelist.lnext);
+
+            if (base->size >= size)
+                break;
+
+            base = NULL;
+        }
+
+        if (base == NULL)
+            I_Error ("Z_Malloc: failed on allocation of %i bytes", size);
+    }
+
+    RemoveFree(base);
+
+    // found a block big enough
+    extra = base->size - size;
+
+    if (extra >  MINFRAGMENT)
+    {
+        // there will be a free fragment after the allocated block
+        newblock = (memblock_t *) ((byte *)base + size );
+        newblock->size = extra;
+
+        newblock->tag = PU_FREE;
+        newblock->user = NULL;
+        newblock->id = 0;
+        newblock->prev = base;
+        newblock->next = base->next;
+        newblock->next->prev = newblock;
+
+        base->next = newblock;
+        base->size = size;
+
+        InsertFree(newblock);
+    }
+
+	if (user == NULL && tag >= PU_PURGELEVEL)
+	    I_Error ("Z_Malloc: an owner is required for purgable blocks");
+
+    base->user = user;
+    base->tag = tag;
+
+    if (tag >= PU_PURGELEVEL)
+        InsertPurgable(base);
+
+    result  = (void *) ((byte *)base + sizeof(memblock_t));
+
+    if (base->user)
+    {
+        *base->user = result;
+    }
+
+    base->id = ZONEID;
+
+    M_TraceEnd(tz_malloc, trace);
+
+    return result;
+}
+
+
+
+//
+// Z_FreeTags
+//
+void
+Z_FreeTags
+( int		lowtag,
+  int		hightag )
+{
+    memblock_t*	block;
+
+    for (block = mainzone->blocklist.next ;
+	 block != &mainzone->blocklist ;
+	 block = block->next)
+    {
+	// free block?
+	if (block->tag == PU_FREE)
+	    continue;
+
+	if (block->tag >= lowtag && block->tag <= hightag)
+	    block = FreeBlock (block);
+    }
+}
+
+
+
+//
+// Z_DumpHeap
+// Note: TFileDumpHeap( stdout ) ?
+//
+void
+Z_DumpHeap
+( int		lowtag,
+  int		hightag )
+{
+    memblock_t*	block;
+
+    printf ("zone size: %i  location: %p\n",
+	    mainzone->size,mainzone);
+
+    printf ("tag range: %i to %i\n",
+	    lowtag, hightag);
+
+    for (block = mainzone->blocklist.next ; ; block = block->next)
+    {
+	if (block->tag >= lowtag && block->tag <= hightag)
+	    printf ("block:%p    size:%7i    user:%p    tag:%3i\n",
+		    block, block->size, block->user, block->tag);
+
+	if (block->next == &mainzone->blocklist)
+	{
+	    // all blocks have been hit
+	    break;
+	}
+
+	if ( (byte *)block + block->size != (byte *)block->next)
+	    printf ("ERROR: block size does not touch the next block\n");
+
+	if ( block->next->prev != block)
+	    printf ("ERROR: next block doesn't have proper back link\n");
+
+	if (block->tag == PU_FREE && block->next->tag == PU_FREE)
+	    printf ("ERROR: two consecutive free blocks\n");
+    }
+}
+
+
+//
+// Z_FileDumpHeap
+//
+void Z_FileDumpHeap (FILE* f)
+{
+    memblock_t*	block;
+
+    fprintf (f,"zone size: %i  location: %p\n",mainzone->size,mainzone);
+
+    for (block = mainzone->blocklist.next ; ; block = block->next)
+    {
+	fprintf (f,"block:%p    size:%7i    user:%p    tag:%3i\n",
+		 block, block->size, block->user, block->tag);
+
+	if (block->next == &mainzone->blocklist)
+	{
+	    // all blocks have been hit
+	    break;
+	}
+
+	if ( (byte *)block + block->size != (byte *)block->next)
+	    fprintf (f,"ERROR: block size does not touch the next block\n");
+
+	if ( block->next->prev != block)
+	    fprintf (f,"ERROR: next block doesn't have proper back link\n");
+
+	if (block->tag == PU_FREE && block->next->tag == PU_FREE)
+	    fprintf (f,"ERROR: two consecutive free blocks\n");
+    }
+}
+
+
+
+//
+// Z_CheckHeap
+//
+void Z_CheckHeap (void)
+{
+    memblock_t*	block;
+    int		fl, sl;
+
+    for (block = mainzone->blocklist.next ; ; block = block->next)
+    {
+	if (block->next == &mainzone->blocklist)
+	{
+	    // all blocks have been hit
+	    break;
+	}
+
+	if ( (byte *)block + block->size != (byte *)block->next)
+	    I_Error ("Z_CheckHeap: block size does not touch the next block\n");
+
+	if ( block->next->prev != block)
+	    I_Error ("Z_CheckHeap: next block doesn't have proper back link\n");
+
+	if (block->tag == PU_FREE && block->next->tag == PU_FREE)
+	    I_Error ("Z_CheckHeap: two consecutive free blocks\n");
+    }
+
+    for (fl = 0; fl < FL_COUNT; ++fl)
+    {
+        for (sl = 0; sl < SL_COUNT; ++sl)
+        {
+            if ((mainzone->freelists[fl][sl] != NULL)
+             != ((mainzone->sl_bitmap[fl] >> sl) & 1))
+                I_Error ("Z_CheckHeap: free list bitmap is wrong\n");
+
+            for (block = mainzone->freelists[fl][sl] ;
+                 block != NULL ;
+                 block = block->lnext)
+            {
+                if (block->tag != PU_FREE)
+                    I_Error ("Z_CheckHeap: used block in a free list\n");
+            }
+        }
+    }
+}
+
+
+
+
+//
+// Z_ChangeTag
+//
+void Z_ChangeTag2(void *ptr, int tag, char *file, int line)
+{
+    memblock_t*	block;
+
+    block = (memblock_t *) ((byte *)ptr - sizeof(memblock_t));
+
+    if (block->id != ZONEID)
+        I_Error("%s:%i: Z_ChangeTag: block without a ZONEID!",
+                file, line);
+
+    if (tag >= PU_PURGELEVEL && block->user == NULL)
+        I_Error("%s:%i: Z_ChangeTag: an owner is required "
+                "for purgable blocks", file, line);
+
+    // Made purgable again: it goes to the back of the purge list.
+
+    if (block->tag >= PU_PURGELEVEL)
+        RemovePurgable(block);
+
+    if (tag >= PU_PURGELEVEL)
+        InsertPurgable(block);
+
+    block->tag = tag;
+}
+
+void Z_ChangeUser(void *ptr, void **user)
+{
+    memblock_t*	block;
+
+    block = (memblock_t *) ((byte *)ptr - sizeof(memblock_t));
+
+    if (block->id != ZONEID)
+    {
+        I_Error("Z_ChangeUser: Tried to change user for invalid block!");
+    }
+
+    block->user = user;
+    *user = ptr;
+}
+
+
+
+//
+// Z_FreeMemory
+//
+int Z_FreeMemory (void)
+{
+    memblock_t*		block;
+    int			free;
+
+    free = 0;
+
+    for (block = mainzone->blocklist.next ;
+         block != &mainzone->blocklist;
+         block = block->next)
+    {
+        if (block->tag == PU_FREE || block->tag >= PU_PURGELEVEL)
+            free += block->size;
+    }
+
+    return free;
+}
+
+unsigned int Z_ZoneSize(void)
+{
+    return mainzone->size;
+}
+
+#endif // DOOMGENERIC_SEGREGATED_ZONE
@@ -14,12 +14,16 @@
 //
 // DESCRIPTION:
 //	Zone Memory Allocation. Neat.
+//	z_segzone.c replaces this when DOOMGENERIC_SEGREGATED_ZONE
+//	is defined.
 //
 
+#ifndef DOOMGENERIC_SEGREGATED_ZONE
 
 #include "z_zone.h"
 #include "i_system.h"
 #include "doomtype.h"
+#include "m_trace.h"
 
 
 //
@@ -61,7 +65,7 @@ typedef struct
 
 
 
-memzone_t*	mainzone;
+THREADLOCAL memzone_t*	mainzone;
 
 
 
@@ -193,6 +197,9 @@ Z_Malloc
     memblock_t* newblock;
     memblock_t*	base;
     void *result;
+    uint64_t trace;
+
+    trace = M_TraceBegin();
 
     size = (size + MEM_ALIGN - 1) & ~(MEM_ALIGN - 1);
     
@@ -285,6 +292,8 @@ Z_Malloc
     mainzone->rover = base->next;	
 	
     base->id = ZONEID;
+
+    M_TraceEnd(tz_malloc, trace);
     
     return result;
 }
@@ -486,3 +495,4 @@ unsigned int Z_ZoneSize(void)
     return mainzone->size;
 }
 
+#endif // DOOMGENERIC_SEGREGATED_ZONE